@@ -36,6 +36,14 @@
 #include "maidsafe/common/types.h"
 #include "maidsafe/passport/passport.h"
 
+#include "maidsafe/vault_manager/lifecycle_latency.h"
+#include "maidsafe/vault_manager/resource_limits.h"
+#include "maidsafe/vault_manager/resource_usage.h"
+#include "maidsafe/vault_manager/scheduling_class.h"
+#include "maidsafe/vault_manager/restart_queue_stats.h"
+#include "maidsafe/vault_manager/timeout_metrics.h"
+#include "maidsafe/vault_manager/upgrade_progress.h"
+
 namespace maidsafe {
 
 namespace vault_manager {
@@ -59,15 +67,58 @@ class ClientInterface {
   std::future<std::unique_ptr<passport::PmidAndSigner>> TakeOwnership(const NonEmptyString& label,
       const boost::filesystem::path& vault_dir, DiskUsage max_disk_usage);
 
+  // The vault is started in 'scheduling_class' (see SetSchedulingClass), and if 'launch_profile'
+  // isn't empty, with the named launch profile from the VaultManager's launch profiles file applied
+  // each time it's started.  Each non-zero field of 'resource_limits' overrides the VaultManager's
+  // default for the vault's cgroup.  If 'in_process' is true, the vault is hosted as a thread of
+  // the VaultManager's vault host process rather than run as its own process.  The future holds an
+  // error if the profile isn't defined, or if 'in_process' is true but the VaultManager doesn't
+  // have in-process hosting enabled.
 #ifdef USE_VLOGGING
   std::future<std::unique_ptr<passport::PmidAndSigner>> StartVault(
       const boost::filesystem::path& vault_dir, DiskUsage max_disk_usage,
-      const std::string& vlog_session_id);
+      const std::string& vlog_session_id,
+      SchedulingClass scheduling_class = SchedulingClass::kNormal,
+      const std::string& launch_profile = std::string(),
+      const ResourceLimits& resource_limits = ResourceLimits(), bool in_process = false);
 #else
   std::future<std::unique_ptr<passport::PmidAndSigner>> StartVault(
-      const boost::filesystem::path& vault_dir, DiskUsage max_disk_usage);
+      const boost::filesystem::path& vault_dir, DiskUsage max_disk_usage,
+      SchedulingClass scheduling_class = SchedulingClass::kNormal,
+      const std::string& launch_profile = std::string(),
+      const ResourceLimits& resource_limits = ResourceLimits(), bool in_process = false);
 #endif
 
+  // Returns the resource usage samples which the VaultManager holds for the vault, oldest first.
+  // There are none unless the VaultManager is sampling, which is only supported on Linux.
+  std::future<std::vector<ResourceSample>> GetResourceUsage(const NonEmptyString& label);
+
+  // Changes the scheduling class of the vault, applying it immediately if the vault is running.
+  // The future holds the vault's new class, or an error if it couldn't be applied in full (in which
+  // case the class is still recorded, and applied when the vault next starts).
+  std::future<SchedulingClass> SetSchedulingClass(const NonEmptyString& label,
+                                                  SchedulingClass scheduling_class);
+
+  // Return the percentiles of the time taken by each phase of starting a vault, either across every
+  // vault started by the VaultManager, or for the given vault only.
+  std::future<std::vector<PhaseLatency>> GetLifecycleLatencies();
+  std::future<std::vector<PhaseLatency>> GetLifecycleLatencies(const NonEmptyString& label);
+
+  // Returns the current value of each of the VaultManager's adaptive timeouts.
+  std::future<std::vector<TimeoutMetric>> GetTimeoutMetrics();
+
+  // Returns the state of the VaultManager's host-wide restart throttle, including how many vault
+  // restarts are queued.
+  std::future<RestartQueueStats> GetRestartQueueStats();
+
+  // Restarts every vault onto the executable at 'vault_executable_path', 'wave_size' at a time,
+  // waiting for each wave to rejoin the network before starting the next.  If more than
+  // 'failure_threshold' (a fraction between 0 and 1) of the restarted vaults fail, the upgrade is
+  // rolled back and the future holds the first failure.  Only one upgrade can be requested at a
+  // time.
+  std::future<UpgradeProgress> UpgradeVaults(const boost::filesystem::path& vault_executable_path,
+                                             size_t wave_size, double failure_threshold);
+
 #ifdef TESTING
   // This function sets up global variables specifying:
   // * the desired TCP listening port of the VaultManager (VM)
@@ -104,6 +155,12 @@ class ClientInterface {
 
  private:
   typedef detail::PromiseAndTimer<std::unique_ptr<passport::PmidAndSigner>> VaultRequest;
+  typedef detail::PromiseAndTimer<std::vector<ResourceSample>> ResourceUsageRequest;
+  typedef detail::PromiseAndTimer<SchedulingClass> SchedulingClassRequest;
+  typedef detail::PromiseAndTimer<std::vector<PhaseLatency>> LifecycleLatencyRequest;
+  typedef detail::PromiseAndTimer<std::vector<TimeoutMetric>> TimeoutMetricsRequest;
+  typedef detail::PromiseAndTimer<RestartQueueStats> RestartQueueRequest;
+  typedef detail::PromiseAndTimer<UpgradeProgress> UpgradeRequest;
 
   std::shared_ptr<tcp::Connection> ConnectToVaultManager();
   std::future<std::unique_ptr<passport::PmidAndSigner>> AddVaultRequest(
@@ -113,6 +170,16 @@ class ClientInterface {
   void HandleNetworkStableResponse();
   void InvokeCallBack(const std::string& message, std::function<void(std::string)>& callback);
   void HandleLogMessage(const std::string& message);
+  void HandleShutdownProgress(const std::string& message);
+  void HandleResourceUsageResponse(const std::string& message);
+  void HandleSchedulingClassResponse(const std::string& message);
+  std::future<std::vector<PhaseLatency>> RequestLifecycleLatencies(
+      const NonEmptyString* const label);
+  void HandleLifecycleLatencyResponse(const std::string& message);
+  void HandleTimeoutMetricsResponse(const std::string& message);
+  void HandleRestartQueueResponse(const std::string& message);
+  void HandleUpgradeProgress(const std::string& message);
+  void HandleUpgradeResponse(const std::string& message);
 
   const passport::Maid kMaid_;
   std::mutex mutex_;
@@ -120,6 +187,16 @@ class ClientInterface {
   std::promise<void> network_stable_;
   std::once_flag network_stable_flag_;
   std::map<NonEmptyString, std::shared_ptr<VaultRequest>> ongoing_vault_requests_;
+  std::multimap<NonEmptyString, std::shared_ptr<ResourceUsageRequest>>
+      ongoing_resource_usage_requests_;
+  std::multimap<NonEmptyString, std::shared_ptr<SchedulingClassRequest>>
+      ongoing_scheduling_class_requests_;
+  // Keyed by vault label, or by an empty string for host-wide requests.
+  std::multimap<std::string, std::shared_ptr<LifecycleLatencyRequest>>
+      ongoing_lifecycle_latency_requests_;
+  std::vector<std::shared_ptr<TimeoutMetricsRequest>> ongoing_timeout_metrics_requests_;
+  std::vector<std::shared_ptr<RestartQueueRequest>> ongoing_restart_queue_requests_;
+  std::shared_ptr<UpgradeRequest> ongoing_upgrade_request_;
   AsioService asio_service_;
   std::shared_ptr<tcp::Connection> tcp_connection_;
   // We need to ensure the connection is closed in the event of the constructor throwing, or the
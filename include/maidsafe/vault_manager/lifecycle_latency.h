@@ -0,0 +1,59 @@
+/*  Copyright 2014 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#ifndef MAIDSAFE_VAULT_MANAGER_LIFECYCLE_LATENCY_H_
+#define MAIDSAFE_VAULT_MANAGER_LIFECYCLE_LATENCY_H_
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+#include "maidsafe/common/type_macros.h"
+
+namespace maidsafe {
+
+namespace vault_manager {
+
+// The phases of starting a vault:
+// * Spawn: from launching the process until it sends VaultStarted.
+// * Credentials: from receiving VaultStarted until the VaultStartedResponse has been sent.
+// * NetworkJoin: from sending the VaultStartedResponse until the vault sends JoinedNetwork.
+// * Total: from launching the process until it sends JoinedNetwork.
+// A vault started from a spare process skips the Spawn phase, and its Total starts when the spare
+// is assigned to it.
+DEFINE_OSTREAMABLE_ENUM_VALUES(LifecyclePhase, int32_t,
+    (Spawn)
+    (Credentials)
+    (NetworkJoin)
+    (Total))
+
+const size_t kLifecyclePhaseCount(4);
+
+// Percentiles are accurate to within 12.5%, and never exceed 'max'.
+struct PhaseLatency {
+  PhaseLatency() : phase(LifecyclePhase::kSpawn), count(0), p50(0), p90(0), p99(0), max(0) {}
+  LifecyclePhase phase;
+  uint64_t count;
+  std::chrono::microseconds p50, p90, p99, max;
+};
+
+}  // namespace vault_manager
+
+}  // namespace maidsafe
+
+#endif  // MAIDSAFE_VAULT_MANAGER_LIFECYCLE_LATENCY_H_
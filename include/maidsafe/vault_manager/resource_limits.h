@@ -0,0 +1,45 @@
+/*  Copyright 2014 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#ifndef MAIDSAFE_VAULT_MANAGER_RESOURCE_LIMITS_H_
+#define MAIDSAFE_VAULT_MANAGER_RESOURCE_LIMITS_H_
+
+#include <cstdint>
+
+namespace maidsafe {
+
+namespace vault_manager {
+
+// Limits applied to a vault's cgroup when the VaultManager has cgroups enabled.  Zero leaves the
+// corresponding kernel default in place (no memory limits, and weights of 100).  Persisted in the
+// config file.
+struct ResourceLimits {
+  ResourceLimits() : cpu_weight(0), memory_high(0), memory_max(0), io_weight(0) {}
+  // cpu.weight, in the range [1, 10000].
+  uint32_t cpu_weight;
+  // memory.high and memory.max, in bytes.
+  uint64_t memory_high, memory_max;
+  // io.weight, in the range [1, 10000].
+  uint32_t io_weight;
+};
+
+}  // namespace vault_manager
+
+}  // namespace maidsafe
+
+#endif  // MAIDSAFE_VAULT_MANAGER_RESOURCE_LIMITS_H_
@@ -0,0 +1,47 @@
+/*  Copyright 2014 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#ifndef MAIDSAFE_VAULT_MANAGER_RESOURCE_USAGE_H_
+#define MAIDSAFE_VAULT_MANAGER_RESOURCE_USAGE_H_
+
+#include <chrono>
+#include <cstdint>
+
+namespace maidsafe {
+
+namespace vault_manager {
+
+// A snapshot of a vault process's resource usage.  'cpu_time', 'read_bytes' and 'write_bytes' are
+// cumulative since the process started, so usage over an interval is the difference between two
+// samples.  Sampling is only supported on Linux.
+struct ResourceSample {
+  ResourceSample()
+      : time(), cpu_time(0), rss(0), read_bytes(0), write_bytes(0), file_descriptors(0),
+        threads(0) {}
+  std::chrono::steady_clock::time_point time;
+  std::chrono::milliseconds cpu_time;
+  uint64_t rss;
+  uint64_t read_bytes, write_bytes;
+  uint32_t file_descriptors, threads;
+};
+
+}  // namespace vault_manager
+
+}  // namespace maidsafe
+
+#endif  // MAIDSAFE_VAULT_MANAGER_RESOURCE_USAGE_H_
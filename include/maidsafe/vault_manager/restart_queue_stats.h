@@ -0,0 +1,45 @@
+/*  Copyright 2014 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+#ifndef MAIDSAFE_VAULT_MANAGER_RESTART_QUEUE_STATS_H_
+#define MAIDSAFE_VAULT_MANAGER_RESTART_QUEUE_STATS_H_
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+namespace maidsafe {
+
+namespace vault_manager {
+
+// The state of the host-wide restart throttle (see ProcessManager::SetRestartThrottle).  'queued'
+// restarts are waiting for a token now, and 'peak_queued' is the most which have waited at once.
+// 'tokens' restarts could start without waiting.  Of the 'admitted' restarts started so far,
+// 'throttled' had to wait, the longest of them for 'longest_wait'.
+struct RestartQueueStats {
+  RestartQueueStats()
+      : queued(0), peak_queued(0), tokens(0), admitted(0), throttled(0), longest_wait(0) {}
+  size_t queued, peak_queued, tokens;
+  uint64_t admitted, throttled;
+  std::chrono::milliseconds longest_wait;
+};
+
+}  // namespace vault_manager
+
+}  // namespace maidsafe
+
+#endif  // MAIDSAFE_VAULT_MANAGER_RESTART_QUEUE_STATS_H_
@@ -0,0 +1,46 @@
+/*  Copyright 2014 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#ifndef MAIDSAFE_VAULT_MANAGER_SCHEDULING_CLASS_H_
+#define MAIDSAFE_VAULT_MANAGER_SCHEDULING_CLASS_H_
+
+#include <cstdint>
+
+#include "maidsafe/common/type_macros.h"
+
+namespace maidsafe {
+
+namespace vault_manager {
+
+// How a vault's CPU and disk time are prioritised against the other vaults on the host.  Only
+// applied on Linux.
+// * Normal: the kernel defaults.
+// * Interactive: for vaults serving their owner; a raised CPU and I/O priority.  Raising priority
+//   needs CAP_SYS_NICE, without which the vault runs as Normal.
+// * Batch: for bulk vaults, e.g. those catching up on replication; a lowered CPU and I/O priority,
+//   with the CPU scheduler treating the vault as non-interactive (SCHED_BATCH).
+DEFINE_OSTREAMABLE_ENUM_VALUES(SchedulingClass, int32_t,
+    (Normal)
+    (Interactive)
+    (Batch))
+
+}  // namespace vault_manager
+
+}  // namespace maidsafe
+
+#endif  // MAIDSAFE_VAULT_MANAGER_SCHEDULING_CLASS_H_
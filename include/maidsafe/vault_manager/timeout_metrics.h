@@ -0,0 +1,60 @@
+/*  Copyright 2014 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#ifndef MAIDSAFE_VAULT_MANAGER_TIMEOUT_METRICS_H_
+#define MAIDSAFE_VAULT_MANAGER_TIMEOUT_METRICS_H_
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+#include "maidsafe/common/type_macros.h"
+
+namespace maidsafe {
+
+namespace vault_manager {
+
+// The deadlines which the VaultManager adapts to observed latency:
+// * VaultConnect: for a newly launched vault process to connect back to the VaultManager.
+// * NewConnection: for a new TCP connection to identify itself as a vault or a client.
+// * ClientValidation: for a client to answer the VaultManager's challenge.
+DEFINE_OSTREAMABLE_ENUM_VALUES(TimeoutKind, int32_t,
+    (VaultConnect)
+    (NewConnection)
+    (ClientValidation))
+
+const size_t kTimeoutKindCount(3);
+
+struct TimeoutMetric {
+  TimeoutMetric()
+      : kind(TimeoutKind::kVaultConnect), current(0), smoothed(0), variation(0), p99(0), samples(0),
+        expiries(0) {}
+  TimeoutKind kind;
+  // The deadline now being applied, after backoff and clamping.
+  std::chrono::milliseconds current;
+  // The smoothed latency and its mean deviation, as in TCP's SRTT and RTTVAR.
+  std::chrono::milliseconds smoothed, variation;
+  std::chrono::milliseconds p99;
+  uint64_t samples, expiries;
+};
+
+}  // namespace vault_manager
+
+}  // namespace maidsafe
+
+#endif  // MAIDSAFE_VAULT_MANAGER_TIMEOUT_METRICS_H_
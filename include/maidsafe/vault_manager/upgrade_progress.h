@@ -0,0 +1,43 @@
+/*  Copyright 2014 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#ifndef MAIDSAFE_VAULT_MANAGER_UPGRADE_PROGRESS_H_
+#define MAIDSAFE_VAULT_MANAGER_UPGRADE_PROGRESS_H_
+
+#include <cstddef>
+
+namespace maidsafe {
+
+namespace vault_manager {
+
+// Progress of a rolling upgrade of the vault executable.  'upgraded' counts vaults which rejoined
+// the network on the new executable, 'failed' those which exited or didn't rejoin in time, and
+// 'skipped' those stopped by other means before they could be upgraded.  Once 'rolling_back' is
+// set, the counts start again from zero and describe the return to the old executable.
+struct UpgradeProgress {
+  UpgradeProgress() : total(0), upgraded(0), failed(0), skipped(0), rolling_back(false) {}
+  size_t Remaining() const { return total - upgraded - failed - skipped; }
+  size_t total, upgraded, failed, skipped;
+  bool rolling_back;
+};
+
+}  // namespace vault_manager
+
+}  // namespace maidsafe
+
+#endif  // MAIDSAFE_VAULT_MANAGER_UPGRADE_PROGRESS_H_
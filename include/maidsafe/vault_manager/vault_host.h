@@ -0,0 +1,80 @@
+/*  Copyright 2014 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#ifndef MAIDSAFE_VAULT_MANAGER_VAULT_HOST_H_
+#define MAIDSAFE_VAULT_MANAGER_VAULT_HOST_H_
+
+#include <cstdint>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+
+#include "maidsafe/common/asio_service.h"
+#include "maidsafe/common/tcp/connection.h"
+
+namespace maidsafe {
+
+namespace vault_manager {
+
+class InProcessHost;
+class VaultInterface;
+
+// The argument, following the VaultManager's port, with which the VaultManager launches the vault
+// executable as a vault host.
+extern const char kVaultHostArgument[];
+
+// Runs the vaults which the VaultManager hosts in-process, each as a thread of this process rather
+// than as a process of its own.  A vault executable launched with kVaultHostArgument should
+// construct one of these with the function it would otherwise run for its single vault, then call
+// WaitForExit.  The VaultManager supervises the host as it would a vault process, and starts and
+// stops its vaults via the host's connection.
+class VaultHost {
+ public:
+  // Runs a single vault, returning its exit code.
+  typedef std::function<int(VaultInterface&)> VaultMain;
+
+  // Throws if 'vault_main' is empty or if the VaultManager can't be reached.
+  VaultHost(tcp::Port vault_manager_port, VaultMain vault_main);
+  VaultHost(const VaultHost&) = delete;
+  VaultHost(VaultHost&&) = delete;
+  VaultHost& operator=(VaultHost) = delete;
+  // Stops every vault, allowing them up to kVaultStopTimeout to finish.
+  ~VaultHost();
+
+  // Blocks until the VaultManager closes the host's connection, as it does once it has no further
+  // use for the host.  Doesn't throw.
+  int WaitForExit();
+
+ private:
+  void HandleReceivedMessage(const std::string& wrapped_message);
+  void SetExitCode(int exit_code);
+
+  std::promise<int> exit_code_promise_;
+  std::once_flag exit_code_flag_;
+  AsioService asio_service_;
+  std::shared_ptr<tcp::Connection> tcp_connection_;
+  std::unique_ptr<InProcessHost> in_process_host_;
+};
+
+}  // namespace vault_manager
+
+}  // namespace maidsafe
+
+#endif  // MAIDSAFE_VAULT_MANAGER_VAULT_HOST_H_
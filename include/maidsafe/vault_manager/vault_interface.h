@@ -19,6 +19,8 @@
 #ifndef MAIDSAFE_VAULT_MANAGER_VAULT_INTERFACE_H_
 #define MAIDSAFE_VAULT_MANAGER_VAULT_INTERFACE_H_
 
+#include <atomic>
+#include <chrono>
 #include <condition_variable>
 #include <cstdint>
 #include <functional>
@@ -46,13 +48,22 @@ class VaultInterface {
 
   explicit VaultInterface(tcp::Port vault_manager_port);
 
+  // For a vault hosted as a thread of another process, which identifies itself to the VaultManager
+  // by 'instance_id' since it shares that process's ID.
+  VaultInterface(tcp::Port vault_manager_port, uint64_t instance_id);
+
   VaultConfig GetConfiguration();
 
-  // Doesn't throw.
+  // Doesn't throw.  If the connection to the VaultManager is lost once the vault has started, the
+  // vault keeps trying to reconnect (in case the VaultManager is re-executing itself) for
+  // kVaultReattachTimeout before exiting.
   int WaitForExit();
 
   void SendJoined();
 
+  // Makes WaitForExit return as though the VaultManager had asked the vault to stop.  Thread-safe.
+  void Stop();
+
 #ifdef TESTING
   void KillConnection();
   void SendInvalidMessage();
@@ -60,18 +71,29 @@ class VaultInterface {
 #endif
 
  private:
+  std::shared_ptr<tcp::Connection> Connection();
   void HandleReceivedMessage(const std::string& wrapped_message);
   void OnConnectionClosed();
+  void Reconnect();
+  void SetExitCode(int exit_code);
 
   void HandleVaultStartedResponse(const std::string& message);
   void HandleVaultShutdownRequest();
+  void HandleHeartbeat(const std::string& message);
+  void HandleVaultReattachedResponse();
 
   std::promise<int> exit_code_promise_;
   std::once_flag exit_code_flag_;
   tcp::Port vault_manager_port_;
+  const uint64_t process_id_;
   std::function<void(std::string)> on_vault_started_response_;
   std::unique_ptr<VaultConfig> vault_config_;
+  std::atomic<bool> started_, exiting_;
+  std::mutex mutex_;
+  // Set while reconnecting, and cleared once the VaultManager has re-attached this vault.
+  std::chrono::steady_clock::time_point reconnect_deadline_;
   AsioService asio_service_;
+  std::future<void> reconnect_future_;
   std::shared_ptr<tcp::Connection> tcp_connection_;
   // We need to ensure the connection is closed in the event of the constructor throwing, or the
   // asio_service destructor will hang.
@@ -0,0 +1,127 @@
+/*  Copyright 2014 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include "maidsafe/vault_manager/adaptive_timeout.h"
+
+#include <algorithm>
+#include <utility>
+
+#include "maidsafe/common/error.h"
+#include "maidsafe/common/log.h"
+
+namespace maidsafe {
+
+namespace vault_manager {
+
+const int AdaptiveTimeout::kMaxBackoffShift;
+
+AdaptiveTimeout::AdaptiveTimeout(TimeoutKind kind, std::chrono::milliseconds initial,
+                                 std::chrono::milliseconds floor,
+                                 std::chrono::milliseconds ceiling,
+                                 std::chrono::steady_clock::duration window)
+    : kKind_(kind),
+      kInitial_(initial),
+      kFloor_(floor),
+      kCeiling_(ceiling),
+      kWindow_(window),
+      current_latencies_(new LatencyHistogram),
+      previous_latencies_(new LatencyHistogram),
+      window_start_(std::chrono::steady_clock::now()),
+      smoothed_(0),
+      variation_(0),
+      backoff_shift_(0),
+      samples_(0),
+      expiries_(0) {
+  if (floor.count() <= 0 || ceiling < floor || window.count() <= 0)
+    BOOST_THROW_EXCEPTION(MakeError(CommonErrors::invalid_parameter));
+}
+
+void AdaptiveTimeout::Sample(std::chrono::steady_clock::duration latency) {
+  auto sample(std::max(std::chrono::microseconds(0),
+                       std::chrono::duration_cast<std::chrono::microseconds>(latency)));
+  if (samples_ == 0) {
+    smoothed_ = sample;
+    variation_ = sample / 2;
+  } else {
+    auto deviation(smoothed_ > sample ? smoothed_ - sample : sample - smoothed_);
+    variation_ = (3 * variation_ + deviation) / 4;
+    smoothed_ = (7 * smoothed_ + sample) / 8;
+  }
+  RotateWindows(std::chrono::steady_clock::now());
+  current_latencies_->Record(sample);
+  ++samples_;
+  // As with Karn's algorithm, only a completed operation ends the backoff.
+  backoff_shift_ = 0;
+}
+
+std::chrono::milliseconds AdaptiveTimeout::OnExpiry() {
+  ++expiries_;
+  if (backoff_shift_ < kMaxBackoffShift)
+    ++backoff_shift_;
+  auto value(Value());
+  LOG(kWarning) << kKind_ << " timeout expired; backing off to " << value.count() << " ms.";
+  return value;
+}
+
+std::chrono::milliseconds AdaptiveTimeout::Value() const {
+  std::chrono::microseconds base(kInitial_);
+  if (samples_ != 0)
+    base = std::max(smoothed_ + 4 * variation_, RecentPercentile99());
+  auto value(std::chrono::duration_cast<std::chrono::milliseconds>(base) * (1 << backoff_shift_));
+  return std::min(std::max(value, kFloor_), kCeiling_);
+}
+
+TimeoutMetric AdaptiveTimeout::Metric() const {
+  TimeoutMetric metric;
+  metric.kind = kKind_;
+  metric.current = Value();
+  metric.smoothed = std::chrono::duration_cast<std::chrono::milliseconds>(smoothed_);
+  metric.variation = std::chrono::duration_cast<std::chrono::milliseconds>(variation_);
+  metric.p99 = std::chrono::duration_cast<std::chrono::milliseconds>(RecentPercentile99());
+  metric.samples = samples_;
+  metric.expiries = expiries_;
+  return metric;
+}
+
+void AdaptiveTimeout::RotateWindows(std::chrono::steady_clock::time_point now) {
+  if (now - window_start_ < kWindow_)
+    return;
+  if (now - window_start_ < 2 * kWindow_) {
+    previous_latencies_ = std::move(current_latencies_);
+    window_start_ += kWindow_;
+  } else {
+    previous_latencies_.reset(new LatencyHistogram);
+    window_start_ = now;
+  }
+  current_latencies_.reset(new LatencyHistogram);
+}
+
+std::chrono::microseconds AdaptiveTimeout::RecentPercentile99() const {
+  // Windows are only rotated by samples, so after a quiet spell the stored ones may be stale.
+  auto age(std::chrono::steady_clock::now() - window_start_);
+  if (age >= 2 * kWindow_)
+    return std::chrono::microseconds(0);
+  if (age >= kWindow_)
+    return current_latencies_->Percentile(0.99);
+  // Merging the windows' buckets would be exact, but taking the larger p99 errs towards patience.
+  return std::max(current_latencies_->Percentile(0.99), previous_latencies_->Percentile(0.99));
+}
+
+}  // namespace vault_manager
+
+}  // namespace maidsafe
@@ -0,0 +1,77 @@
+/*  Copyright 2014 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#ifndef MAIDSAFE_VAULT_MANAGER_ADAPTIVE_TIMEOUT_H_
+#define MAIDSAFE_VAULT_MANAGER_ADAPTIVE_TIMEOUT_H_
+
+#include <chrono>
+#include <cstdint>
+#include <memory>
+
+#include "maidsafe/vault_manager/config.h"
+#include "maidsafe/vault_manager/latency_histogram.h"
+#include "maidsafe/vault_manager/timeout_metrics.h"
+
+namespace maidsafe {
+
+namespace vault_manager {
+
+// A deadline which follows the observed latency of the operation it guards, in the manner of TCP's
+// retransmission timeout (RFC 6298).  The deadline is SRTT + 4 * RTTVAR, but never less than the
+// p99 of the latencies seen within the last one to two 'window's.  Each expiry doubles it until the
+// next successful sample, so a loaded host backs off rather than killing slow starts in a storm.
+// The result is clamped to ['floor', 'ceiling'].
+//
+// Not thread-safe; each instance is used on its owner's io_service thread.
+class AdaptiveTimeout {
+ public:
+  AdaptiveTimeout(TimeoutKind kind, std::chrono::milliseconds initial,
+                  std::chrono::milliseconds floor, std::chrono::milliseconds ceiling,
+                  std::chrono::steady_clock::duration window = kLatencyWindow);
+  AdaptiveTimeout(const AdaptiveTimeout&) = delete;
+  AdaptiveTimeout& operator=(const AdaptiveTimeout&) = delete;
+
+  void Sample(std::chrono::steady_clock::duration latency);
+  // Returns the new deadline.
+  std::chrono::milliseconds OnExpiry();
+  std::chrono::milliseconds Value() const;
+  TimeoutMetric Metric() const;
+
+ private:
+  static const int kMaxBackoffShift = 6;
+
+  // Starts a new window once the current one has run its length.
+  void RotateWindows(std::chrono::steady_clock::time_point now);
+  // The p99 of the current and previous windows, ignoring either once it's too old.
+  std::chrono::microseconds RecentPercentile99() const;
+
+  const TimeoutKind kKind_;
+  const std::chrono::milliseconds kInitial_, kFloor_, kCeiling_;
+  const std::chrono::steady_clock::duration kWindow_;
+  std::unique_ptr<LatencyHistogram> current_latencies_, previous_latencies_;
+  std::chrono::steady_clock::time_point window_start_;
+  std::chrono::microseconds smoothed_, variation_;
+  int backoff_shift_;
+  uint64_t samples_, expiries_;
+};
+
+}  // namespace vault_manager
+
+}  // namespace maidsafe
+
+#endif  // MAIDSAFE_VAULT_MANAGER_ADAPTIVE_TIMEOUT_H_
@@ -0,0 +1,164 @@
+/*  Copyright 2014 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include "maidsafe/vault_manager/cgroups.h"
+
+#include <fstream>
+#include <iterator>
+#include <sstream>
+#include <utility>
+
+#include "boost/filesystem/operations.hpp"
+
+#include "maidsafe/common/error.h"
+#include "maidsafe/common/log.h"
+#include "maidsafe/common/process.h"
+
+#include "maidsafe/vault_manager/exit_classification.h"
+
+namespace fs = boost::filesystem;
+
+namespace maidsafe {
+
+namespace vault_manager {
+
+namespace {
+
+const std::string kVaultGroupPrefix("vault_");
+const std::string kManagerGroup("manager");
+const uint32_t kMaxWeight(10000);
+
+void CheckWeight(uint32_t weight) {
+  if (weight > kMaxWeight) {
+    LOG(kError) << "cgroup weight " << weight << " is outside the range [1, " << kMaxWeight << "]";
+    BOOST_THROW_EXCEPTION(MakeError(CommonErrors::invalid_parameter));
+  }
+}
+
+std::string MemoryLimit(uint64_t bytes) {
+  return bytes == 0 ? std::string("max") : std::to_string(bytes);
+}
+
+}  // unnamed namespace
+
+Cgroups::Cgroups(fs::path root) : kRoot_(std::move(root)), controllers_() {
+  std::ifstream controllers_file((kRoot_ / "cgroup.controllers").string());
+  if (!controllers_file) {
+    LOG(kError) << kRoot_ << " isn't a cgroup v2 directory.";
+    BOOST_THROW_EXCEPTION(MakeError(CommonErrors::invalid_parameter));
+  }
+  for (std::istream_iterator<std::string> itr(controllers_file);
+       itr != std::istream_iterator<std::string>(); ++itr) {
+    if (*itr == "cpu" || *itr == "memory" || *itr == "io")
+      controllers_.insert(*itr);
+  }
+
+  boost::system::error_code error_code;
+  fs::create_directory(kRoot_ / kManagerGroup, error_code);
+  if (error_code) {
+    LOG(kError) << "Failed to create " << kRoot_ / kManagerGroup << ": " << error_code.message();
+    BOOST_THROW_EXCEPTION(MakeError(CommonErrors::filesystem_io_error));
+  }
+  WriteInterfaceFile(kRoot_ / kManagerGroup / "cgroup.procs",
+                     std::to_string(process::GetProcessId()));
+  if (!controllers_.empty()) {
+    std::string enable;
+    for (const auto& controller : controllers_)
+      enable += (enable.empty() ? "+" : " +") + controller;
+    WriteInterfaceFile(kRoot_ / "cgroup.subtree_control", enable);
+  }
+  LOG(kInfo) << "Managing vault cgroups below " << kRoot_ << " with " << controllers_.size()
+             << " controllers enabled.";
+
+  // Groups of vaults which are no longer running are empty, and so can be removed.
+  fs::directory_iterator itr(kRoot_, error_code);
+  for (; !error_code && itr != fs::directory_iterator(); itr.increment(error_code)) {
+    std::string name(itr->path().filename().string());
+    if (name.compare(0, kVaultGroupPrefix.size(), kVaultGroupPrefix) == 0 &&
+        fs::is_directory(itr->status())) {
+      boost::system::error_code ignored_ec;
+      fs::remove(itr->path(), ignored_ec);
+    }
+  }
+}
+
+void Cgroups::AddProcess(const NonEmptyString& label, const ResourceLimits& limits,
+                         uint64_t process_id) const {
+  boost::system::error_code error_code;
+  fs::create_directory(GroupPath(label), error_code);
+  if (error_code) {
+    LOG(kError) << "Failed to create " << GroupPath(label) << ": " << error_code.message();
+    BOOST_THROW_EXCEPTION(MakeError(CommonErrors::filesystem_io_error));
+  }
+  SetLimits(label, limits);
+  WriteInterfaceFile(GroupPath(label) / "cgroup.procs", std::to_string(process_id));
+}
+
+void Cgroups::SetLimits(const NonEmptyString& label, const ResourceLimits& limits) const {
+  CheckWeight(limits.cpu_weight);
+  CheckWeight(limits.io_weight);
+  // Unset limits are written too, in case they were previously set.
+  const fs::path kGroup(GroupPath(label));
+  if (controllers_.count("cpu") != 0) {
+    WriteInterfaceFile(kGroup / "cpu.weight",
+                       std::to_string(limits.cpu_weight == 0 ? 100 : limits.cpu_weight));
+  }
+  if (controllers_.count("memory") != 0) {
+    WriteInterfaceFile(kGroup / "memory.high", MemoryLimit(limits.memory_high));
+    WriteInterfaceFile(kGroup / "memory.max", MemoryLimit(limits.memory_max));
+  }
+  if (controllers_.count("io") != 0) {
+    WriteInterfaceFile(kGroup / "io.weight",
+                       "default " + std::to_string(limits.io_weight == 0 ? 100 : limits.io_weight));
+  }
+}
+
+void Cgroups::Remove(const NonEmptyString& label) const {
+  boost::system::error_code error_code;
+  fs::remove(GroupPath(label), error_code);
+  if (error_code)
+    LOG(kWarning) << "Failed to remove " << GroupPath(label) << ": " << error_code.message();
+}
+
+uint64_t Cgroups::OomKills(const NonEmptyString& label) const {
+  std::ifstream events_file((GroupPath(label) / "memory.events").string());
+  std::stringstream contents;
+  contents << events_file.rdbuf();
+  uint64_t oom_kills(0);
+  ParseOomKills(contents.str(), oom_kills);
+  return oom_kills;
+}
+
+fs::path Cgroups::GroupPath(const NonEmptyString& label) const {
+  return kRoot_ / (kVaultGroupPrefix + label.string());
+}
+
+void Cgroups::WriteInterfaceFile(const fs::path& path, const std::string& value) const {
+  // Each value must be written with a single write call, which the stream's buffer ensures.
+  std::ofstream file(path.string(), std::ios::out | std::ios::trunc);
+  file << value;
+  file.flush();
+  if (!file) {
+    LOG(kError) << "Failed to write \"" << value << "\" to " << path;
+    BOOST_THROW_EXCEPTION(MakeError(CommonErrors::filesystem_io_error));
+  }
+}
+
+}  // namespace vault_manager
+
+}  // namespace maidsafe
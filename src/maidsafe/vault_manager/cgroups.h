@@ -0,0 +1,80 @@
+/*  Copyright 2014 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#ifndef MAIDSAFE_VAULT_MANAGER_CGROUPS_H_
+#define MAIDSAFE_VAULT_MANAGER_CGROUPS_H_
+
+#include <cstdint>
+#include <set>
+#include <string>
+
+#include "boost/filesystem/path.hpp"
+
+#include "maidsafe/common/types.h"
+
+#include "maidsafe/vault_manager/vault_info.h"
+
+namespace maidsafe {
+
+namespace vault_manager {
+
+// Gives each vault its own cgroup v2 group below 'root', named "vault_<label>".
+//
+// 'root' must be a cgroup v2 directory which the VaultManager is allowed to manage, e.g. one
+// delegated by systemd's "Delegate=yes".  cgroup v2 only allows controllers to be enabled for the
+// children of a group with no processes of its own, so the constructor moves the VaultManager into
+// the leaf "vault_manager" below 'root' before enabling whichever of the cpu, memory and io
+// controllers 'root' supports.  Only the files themselves are used, so tests can use an ordinary
+// directory containing a "cgroup.controllers" file in place of 'root'.
+//
+// Vaults are moved into their group just after being launched, so any resources used before then
+// are charged to the VaultManager's group.
+class Cgroups {
+ public:
+  Cgroups(const Cgroups&) = delete;
+  Cgroups(Cgroups&&) = delete;
+  Cgroups& operator=(Cgroups) = delete;
+
+  // Throws if 'root' isn't a cgroup v2 directory.  Removes any empty vault groups left behind.
+  explicit Cgroups(boost::filesystem::path root);
+
+  // Creates the vault's group if required, applies 'limits' to it and moves the process into it.
+  void AddProcess(const NonEmptyString& label, const ResourceLimits& limits,
+                  uint64_t process_id) const;
+  // Applies 'limits' to the vault's existing group.
+  void SetLimits(const NonEmptyString& label, const ResourceLimits& limits) const;
+  // Removes the vault's group.  Doesn't throw; fails (and logs) if the group isn't yet empty.
+  void Remove(const NonEmptyString& label) const;
+  // The number of the group's processes killed by the OOM killer, read from memory.events.  Returns
+  // 0 if the group or the memory controller isn't available.
+  uint64_t OomKills(const NonEmptyString& label) const;
+
+  boost::filesystem::path GroupPath(const NonEmptyString& label) const;
+
+ private:
+  void WriteInterfaceFile(const boost::filesystem::path& path, const std::string& value) const;
+
+  const boost::filesystem::path kRoot_;
+  std::set<std::string> controllers_;
+};
+
+}  // namespace vault_manager
+
+}  // namespace maidsafe
+
+#endif  // MAIDSAFE_VAULT_MANAGER_CGROUPS_H_
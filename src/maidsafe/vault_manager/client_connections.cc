@@ -29,7 +29,10 @@ namespace maidsafe {
 namespace vault_manager {
 
 ClientConnections::ClientConnections(boost::asio::io_service& io_service)
-    : io_service_(io_service), unvalidated_clients_(), clients_() {}
+    : io_service_(io_service),
+      unvalidated_clients_(),
+      clients_(),
+      timeout_(TimeoutKind::kClientValidation, kRpcTimeout, kRpcTimeoutFloor, kRpcTimeoutCeiling) {}
 
 std::shared_ptr<ClientConnections> ClientConnections::MakeShared(
     boost::asio::io_service& io_service) {
@@ -42,16 +45,20 @@ ClientConnections::~ClientConnections() {
 
 void ClientConnections::Add(tcp::ConnectionPtr connection, const asymm::PlainText& challenge) {
   assert(clients_.find(connection) == std::end(clients_));
-  TimerPtr timer{ std::make_shared<Timer>(io_service_, kRpcTimeout) };
+  TimerPtr timer{ std::make_shared<Timer>(io_service_, timeout_.Value()) };
+  std::weak_ptr<ClientConnections> this_weak_ptr{ shared_from_this() };
   timer->async_wait([=](const boost::system::error_code& error_code) {
     if (error_code && error_code == boost::asio::error::operation_aborted) {
       LOG(kVerbose) << "Client connection timer cancelled OK.";
     } else {
       LOG(kWarning) << "Timed out waiting for Client to validate.";
+      if (std::shared_ptr<ClientConnections> this_ptr{ this_weak_ptr.lock() })
+        this_ptr->timeout_.OnExpiry();
       connection->Close();
     }
   });
-  bool result{ unvalidated_clients_.emplace(connection, std::make_pair(challenge, timer)).second };
+  Unvalidated unvalidated{ challenge, timer, std::chrono::steady_clock::now() };
+  bool result{ unvalidated_clients_.emplace(connection, unvalidated).second };
   assert(result);
   static_cast<void>(result);
 }
@@ -66,7 +73,7 @@ void ClientConnections::Validate(tcp::ConnectionPtr connection, const passport::
 
   on_scope_exit cleanup{ [this, itr] { itr->first->Close(); } };
 
-  if (asymm::CheckSignature(itr->second.first, signature, maid.public_key())) {
+  if (asymm::CheckSignature(itr->second.challenge, signature, maid.public_key())) {
     LOG(kSuccess) << "Client " << DebugId(maid.name().value) << " TCP connection validated.";
   } else {
     LOG(kError) << "Client TCP connection validation failed.";
@@ -74,6 +81,7 @@ void ClientConnections::Validate(tcp::ConnectionPtr connection, const passport::
   }
 
   bool result{ clients_.emplace(connection, maid.name()).second };
+  timeout_.Sample(std::chrono::steady_clock::now() - itr->second.added);
   unvalidated_clients_.erase(itr);
   cleanup.Release();
   assert(result);
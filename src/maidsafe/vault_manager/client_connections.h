@@ -19,6 +19,7 @@
 #ifndef MAIDSAFE_VAULT_MANAGER_CLIENT_CONNECTIONS_H_
 #define MAIDSAFE_VAULT_MANAGER_CLIENT_CONNECTIONS_H_
 
+#include <chrono>
 #include <map>
 #include <memory>
 #include <utility>
@@ -29,13 +30,14 @@
 #include "maidsafe/common/rsa.h"
 #include "maidsafe/passport/types.h"
 
+#include "maidsafe/vault_manager/adaptive_timeout.h"
 #include "maidsafe/vault_manager/config.h"
 
 namespace maidsafe {
 
 namespace vault_manager {
 
-class ClientConnections {
+class ClientConnections : public std::enable_shared_from_this<ClientConnections> {
  public:
   typedef passport::PublicMaid::Name MaidName;
   static std::shared_ptr<ClientConnections> MakeShared(boost::asio::io_service& io_service);
@@ -48,15 +50,23 @@ class ClientConnections {
   MaidName FindValidated(tcp::ConnectionPtr connection) const;
   tcp::ConnectionPtr FindValidated(MaidName maid_name) const;
   std::vector<tcp::ConnectionPtr> GetAll() const;
+  TimeoutMetric GetTimeoutMetric() const { return timeout_.Metric(); }
 
  private:
   explicit ClientConnections(boost::asio::io_service& io_service);
 
   boost::asio::io_service& io_service_;
-  std::map<tcp::ConnectionPtr, std::pair<asymm::PlainText, TimerPtr>,
+  struct Unvalidated {
+    asymm::PlainText challenge;
+    TimerPtr timer;
+    std::chrono::steady_clock::time_point added;
+  };
+
+  std::map<tcp::ConnectionPtr, Unvalidated,
     std::owner_less<tcp::ConnectionPtr >> unvalidated_clients_;
   std::map<tcp::ConnectionPtr, MaidName,
     std::owner_less<tcp::ConnectionPtr>> clients_;
+  AdaptiveTimeout timeout_;
 };
 
 }  // namespace vault_manager
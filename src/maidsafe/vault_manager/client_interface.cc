@@ -18,6 +18,8 @@
 
 #include "maidsafe/vault_manager/client_interface.h"
 
+#include <algorithm>
+
 #include "maidsafe/common/make_unique.h"
 #include "maidsafe/common/utils.h"
 #include "maidsafe/common/config.h"
@@ -107,20 +109,208 @@ std::future<std::unique_ptr<passport::PmidAndSigner>> ClientInterface::TakeOwner
 #ifdef USE_VLOGGING
 std::future<std::unique_ptr<passport::PmidAndSigner>> ClientInterface::StartVault(
     const boost::filesystem::path& vault_dir, DiskUsage max_disk_usage,
-    const std::string& vlog_session_id) {
+    const std::string& vlog_session_id, SchedulingClass scheduling_class,
+    const std::string& launch_profile, const ResourceLimits& resource_limits, bool in_process) {
   NonEmptyString label{ GenerateLabel() };
-  SendStartVaultRequest(tcp_connection_, label, vault_dir, max_disk_usage, vlog_session_id);
+  SendStartVaultRequest(tcp_connection_, label, vault_dir, max_disk_usage, vlog_session_id,
+                        scheduling_class, launch_profile, resource_limits, in_process);
   return AddVaultRequest(label);
 }
 #else
 std::future<std::unique_ptr<passport::PmidAndSigner>> ClientInterface::StartVault(
-    const boost::filesystem::path& vault_dir, DiskUsage max_disk_usage) {
+    const boost::filesystem::path& vault_dir, DiskUsage max_disk_usage,
+    SchedulingClass scheduling_class, const std::string& launch_profile,
+    const ResourceLimits& resource_limits, bool in_process) {
   NonEmptyString label{ GenerateLabel() };
-  SendStartVaultRequest(tcp_connection_, label, vault_dir, max_disk_usage);
+  SendStartVaultRequest(tcp_connection_, label, vault_dir, max_disk_usage, scheduling_class,
+                        launch_profile, resource_limits, in_process);
   return AddVaultRequest(label);
 }
 #endif
 
+std::future<std::vector<ResourceSample>> ClientInterface::GetResourceUsage(
+    const NonEmptyString& label) {
+  std::shared_ptr<ResourceUsageRequest> request(
+      std::make_shared<ResourceUsageRequest>(asio_service_.service()));
+  request->timer.async_wait([request, label, this](const boost::system::error_code& ec) {
+    if (ec && ec == boost::asio::error::operation_aborted)
+      return;
+    LOG(kWarning) << "Timed out waiting for resource usage of vault " << label.string();
+    std::lock_guard<std::mutex> lock{ mutex_ };
+    if (ec)
+      request->SetException(ec);
+    else
+      request->SetException(MakeError(VaultManagerErrors::timed_out));
+    auto range(ongoing_resource_usage_requests_.equal_range(label));
+    for (auto itr(range.first); itr != range.second; ++itr) {
+      if (itr->second == request) {
+        ongoing_resource_usage_requests_.erase(itr);
+        break;
+      }
+    }
+  });
+
+  {
+    std::lock_guard<std::mutex> lock{ mutex_ };
+    ongoing_resource_usage_requests_.insert(std::make_pair(label, request));
+  }
+  SendResourceUsageRequest(tcp_connection_, label);
+  return request->promise.get_future();
+}
+
+std::future<SchedulingClass> ClientInterface::SetSchedulingClass(
+    const NonEmptyString& label, SchedulingClass scheduling_class) {
+  std::shared_ptr<SchedulingClassRequest> request(
+      std::make_shared<SchedulingClassRequest>(asio_service_.service()));
+  request->timer.async_wait([request, label, this](const boost::system::error_code& ec) {
+    if (ec && ec == boost::asio::error::operation_aborted)
+      return;
+    LOG(kWarning) << "Timed out waiting for scheduling class of vault " << label.string();
+    std::lock_guard<std::mutex> lock{ mutex_ };
+    if (ec)
+      request->SetException(ec);
+    else
+      request->SetException(MakeError(VaultManagerErrors::timed_out));
+    auto range(ongoing_scheduling_class_requests_.equal_range(label));
+    for (auto itr(range.first); itr != range.second; ++itr) {
+      if (itr->second == request) {
+        ongoing_scheduling_class_requests_.erase(itr);
+        break;
+      }
+    }
+  });
+
+  {
+    std::lock_guard<std::mutex> lock{ mutex_ };
+    ongoing_scheduling_class_requests_.insert(std::make_pair(label, request));
+  }
+  SendSchedulingClassRequest(tcp_connection_, label, scheduling_class);
+  return request->promise.get_future();
+}
+
+std::future<std::vector<PhaseLatency>> ClientInterface::GetLifecycleLatencies() {
+  return RequestLifecycleLatencies(nullptr);
+}
+
+std::future<std::vector<PhaseLatency>> ClientInterface::GetLifecycleLatencies(
+    const NonEmptyString& label) {
+  return RequestLifecycleLatencies(&label);
+}
+
+std::future<std::vector<PhaseLatency>> ClientInterface::RequestLifecycleLatencies(
+    const NonEmptyString* const label) {
+  std::string key(label ? label->string() : std::string());
+  std::shared_ptr<LifecycleLatencyRequest> request(
+      std::make_shared<LifecycleLatencyRequest>(asio_service_.service()));
+  request->timer.async_wait([request, key, this](const boost::system::error_code& ec) {
+    if (ec && ec == boost::asio::error::operation_aborted)
+      return;
+    LOG(kWarning) << "Timed out waiting for lifecycle latencies"
+                  << (key.empty() ? std::string() : " of vault " + key);
+    std::lock_guard<std::mutex> lock{ mutex_ };
+    if (ec)
+      request->SetException(ec);
+    else
+      request->SetException(MakeError(VaultManagerErrors::timed_out));
+    auto range(ongoing_lifecycle_latency_requests_.equal_range(key));
+    for (auto itr(range.first); itr != range.second; ++itr) {
+      if (itr->second == request) {
+        ongoing_lifecycle_latency_requests_.erase(itr);
+        break;
+      }
+    }
+  });
+
+  {
+    std::lock_guard<std::mutex> lock{ mutex_ };
+    ongoing_lifecycle_latency_requests_.insert(std::make_pair(key, request));
+  }
+  SendLifecycleLatencyRequest(tcp_connection_, label);
+  return request->promise.get_future();
+}
+
+std::future<std::vector<TimeoutMetric>> ClientInterface::GetTimeoutMetrics() {
+  std::shared_ptr<TimeoutMetricsRequest> request(
+      std::make_shared<TimeoutMetricsRequest>(asio_service_.service()));
+  request->timer.async_wait([request, this](const boost::system::error_code& ec) {
+    if (ec && ec == boost::asio::error::operation_aborted)
+      return;
+    LOG(kWarning) << "Timed out waiting for timeout metrics";
+    std::lock_guard<std::mutex> lock{ mutex_ };
+    if (ec)
+      request->SetException(ec);
+    else
+      request->SetException(MakeError(VaultManagerErrors::timed_out));
+    ongoing_timeout_metrics_requests_.erase(
+        std::remove(std::begin(ongoing_timeout_metrics_requests_),
+                    std::end(ongoing_timeout_metrics_requests_), request),
+        std::end(ongoing_timeout_metrics_requests_));
+  });
+
+  {
+    std::lock_guard<std::mutex> lock{ mutex_ };
+    ongoing_timeout_metrics_requests_.push_back(request);
+  }
+  SendTimeoutMetricsRequest(tcp_connection_);
+  return request->promise.get_future();
+}
+
+std::future<RestartQueueStats> ClientInterface::GetRestartQueueStats() {
+  std::shared_ptr<RestartQueueRequest> request(
+      std::make_shared<RestartQueueRequest>(asio_service_.service()));
+  request->timer.async_wait([request, this](const boost::system::error_code& ec) {
+    if (ec && ec == boost::asio::error::operation_aborted)
+      return;
+    LOG(kWarning) << "Timed out waiting for restart queue stats";
+    std::lock_guard<std::mutex> lock{ mutex_ };
+    if (ec)
+      request->SetException(ec);
+    else
+      request->SetException(MakeError(VaultManagerErrors::timed_out));
+    ongoing_restart_queue_requests_.erase(
+        std::remove(std::begin(ongoing_restart_queue_requests_),
+                    std::end(ongoing_restart_queue_requests_), request),
+        std::end(ongoing_restart_queue_requests_));
+  });
+
+  {
+    std::lock_guard<std::mutex> lock{ mutex_ };
+    ongoing_restart_queue_requests_.push_back(request);
+  }
+  SendRestartQueueRequest(tcp_connection_);
+  return request->promise.get_future();
+}
+
+std::future<UpgradeProgress> ClientInterface::UpgradeVaults(
+    const boost::filesystem::path& vault_executable_path, size_t wave_size,
+    double failure_threshold) {
+  std::shared_ptr<UpgradeRequest> request(
+      std::make_shared<UpgradeRequest>(asio_service_.service(), kUpgradeTimeout));
+  {
+    std::lock_guard<std::mutex> lock{ mutex_ };
+    if (ongoing_upgrade_request_) {
+      LOG(kError) << "An upgrade has already been requested.";
+      request->SetException(MakeError(CommonErrors::unable_to_handle_request));
+      return request->promise.get_future();
+    }
+    ongoing_upgrade_request_ = request;
+  }
+  request->timer.async_wait([request, this](const boost::system::error_code& ec) {
+    if (ec && ec == boost::asio::error::operation_aborted)
+      return;
+    LOG(kWarning) << "Timed out waiting for upgrade to finish";
+    std::lock_guard<std::mutex> lock{ mutex_ };
+    if (ec)
+      request->SetException(ec);
+    else
+      request->SetException(MakeError(VaultManagerErrors::timed_out));
+    if (ongoing_upgrade_request_ == request)
+      ongoing_upgrade_request_.reset();
+  });
+  SendUpgradeRequest(tcp_connection_, vault_executable_path, wave_size, failure_threshold);
+  return request->promise.get_future();
+}
+
 std::future<std::unique_ptr<passport::PmidAndSigner>> ClientInterface::AddVaultRequest(
     const NonEmptyString& label) {
   LOG(kVerbose) << "ClientInterface::AddVaultRequest : " << label.string();
@@ -163,6 +353,30 @@ void ClientInterface::HandleReceivedMessage(const std::string& wrapped_message)
       case MessageType::kLogMessage:
         HandleLogMessage(message_and_type.first);
         break;
+      case MessageType::kShutdownProgress:
+        HandleShutdownProgress(message_and_type.first);
+        break;
+      case MessageType::kResourceUsageResponse:
+        HandleResourceUsageResponse(message_and_type.first);
+        break;
+      case MessageType::kSchedulingClassResponse:
+        HandleSchedulingClassResponse(message_and_type.first);
+        break;
+      case MessageType::kLifecycleLatencyResponse:
+        HandleLifecycleLatencyResponse(message_and_type.first);
+        break;
+      case MessageType::kTimeoutMetricsResponse:
+        HandleTimeoutMetricsResponse(message_and_type.first);
+        break;
+      case MessageType::kRestartQueueResponse:
+        HandleRestartQueueResponse(message_and_type.first);
+        break;
+      case MessageType::kUpgradeProgress:
+        HandleUpgradeProgress(message_and_type.first);
+        break;
+      case MessageType::kUpgradeResponse:
+        HandleUpgradeResponse(message_and_type.first);
+        break;
       default:
         return;
     }
@@ -222,6 +436,208 @@ void ClientInterface::HandleLogMessage(const std::string& message) {
   LOG(kInfo) << message;
 }
 
+void ClientInterface::HandleShutdownProgress(const std::string& message) {
+  protobuf::ShutdownProgress shutdown_progress{ ParseProto<protobuf::ShutdownProgress>(message) };
+  LOG(kInfo) << "VaultManager shutting down: " << shutdown_progress.stopped() << " vaults stopped, "
+             << shutdown_progress.terminated() << " terminated, of "
+             << shutdown_progress.total() << '.';
+}
+
+void ClientInterface::HandleResourceUsageResponse(const std::string& message) {
+  protobuf::ResourceUsageResponse response{ ParseProto<protobuf::ResourceUsageResponse>(message) };
+  NonEmptyString label(response.label());
+  std::unique_ptr<maidsafe_error> error;
+  std::vector<ResourceSample> samples;
+  if (response.has_serialised_maidsafe_error()) {
+    SerialisedData serialised_error{ std::begin(response.serialised_maidsafe_error()),
+                                     std::end(response.serialised_maidsafe_error()) };
+    error = maidsafe::make_unique<maidsafe_error>(Parse<maidsafe_error>(serialised_error));
+  } else {
+    auto now(std::chrono::steady_clock::now());
+    samples.reserve(response.samples_size());
+    for (const auto& proto_sample : response.samples()) {
+      ResourceSample sample;
+      sample.time = now - std::chrono::milliseconds(proto_sample.age_ms());
+      sample.cpu_time = std::chrono::milliseconds(proto_sample.cpu_time_ms());
+      sample.rss = proto_sample.rss();
+      sample.read_bytes = proto_sample.read_bytes();
+      sample.write_bytes = proto_sample.write_bytes();
+      sample.file_descriptors = proto_sample.file_descriptors();
+      sample.threads = proto_sample.threads();
+      samples.push_back(sample);
+    }
+  }
+
+  // Every outstanding request for the vault is answered by the first response to arrive.
+  std::lock_guard<std::mutex> lock{ mutex_ };
+  auto range(ongoing_resource_usage_requests_.equal_range(label));
+  for (auto itr(range.first); itr != range.second; ++itr) {
+    if (error)
+      itr->second->SetException(*error);
+    else
+      itr->second->SetValue(std::vector<ResourceSample>(samples));
+    itr->second->timer.cancel();
+  }
+  ongoing_resource_usage_requests_.erase(range.first, range.second);
+}
+
+void ClientInterface::HandleSchedulingClassResponse(const std::string& message) {
+  protobuf::SchedulingClassResponse response{
+      ParseProto<protobuf::SchedulingClassResponse>(message) };
+  NonEmptyString label(response.label());
+  std::unique_ptr<maidsafe_error> error;
+  if (response.has_serialised_maidsafe_error()) {
+    SerialisedData serialised_error{ std::begin(response.serialised_maidsafe_error()),
+                                     std::end(response.serialised_maidsafe_error()) };
+    error = maidsafe::make_unique<maidsafe_error>(Parse<maidsafe_error>(serialised_error));
+  } else if (!response.has_scheduling_class()) {
+    error = maidsafe::make_unique<maidsafe_error>(MakeError(CommonErrors::invalid_parameter));
+  }
+
+  // Concurrent requests for the same vault are all answered with the class it ended up with.
+  std::lock_guard<std::mutex> lock{ mutex_ };
+  auto range(ongoing_scheduling_class_requests_.equal_range(label));
+  for (auto itr(range.first); itr != range.second; ++itr) {
+    if (error)
+      itr->second->SetException(*error);
+    else
+      itr->second->SetValue(static_cast<SchedulingClass>(response.scheduling_class()));
+    itr->second->timer.cancel();
+  }
+  ongoing_scheduling_class_requests_.erase(range.first, range.second);
+}
+
+void ClientInterface::HandleLifecycleLatencyResponse(const std::string& message) {
+  protobuf::LifecycleLatencyResponse response{
+      ParseProto<protobuf::LifecycleLatencyResponse>(message) };
+  std::string key(response.has_label() ? response.label() : std::string());
+  std::unique_ptr<maidsafe_error> error;
+  std::vector<PhaseLatency> latencies;
+  if (response.has_serialised_maidsafe_error()) {
+    SerialisedData serialised_error{ std::begin(response.serialised_maidsafe_error()),
+                                     std::end(response.serialised_maidsafe_error()) };
+    error = maidsafe::make_unique<maidsafe_error>(Parse<maidsafe_error>(serialised_error));
+  } else {
+    latencies.reserve(response.phases_size());
+    for (const auto& proto_phase : response.phases()) {
+      PhaseLatency latency;
+      latency.phase = static_cast<LifecyclePhase>(proto_phase.phase());
+      latency.count = proto_phase.count();
+      latency.p50 = std::chrono::microseconds(proto_phase.p50_us());
+      latency.p90 = std::chrono::microseconds(proto_phase.p90_us());
+      latency.p99 = std::chrono::microseconds(proto_phase.p99_us());
+      latency.max = std::chrono::microseconds(proto_phase.max_us());
+      latencies.push_back(latency);
+    }
+  }
+
+  std::lock_guard<std::mutex> lock{ mutex_ };
+  auto range(ongoing_lifecycle_latency_requests_.equal_range(key));
+  for (auto itr(range.first); itr != range.second; ++itr) {
+    if (error)
+      itr->second->SetException(*error);
+    else
+      itr->second->SetValue(std::vector<PhaseLatency>(latencies));
+    itr->second->timer.cancel();
+  }
+  ongoing_lifecycle_latency_requests_.erase(range.first, range.second);
+}
+
+void ClientInterface::HandleTimeoutMetricsResponse(const std::string& message) {
+  protobuf::TimeoutMetricsResponse response{
+      ParseProto<protobuf::TimeoutMetricsResponse>(message) };
+  std::unique_ptr<maidsafe_error> error;
+  std::vector<TimeoutMetric> metrics;
+  if (response.has_serialised_maidsafe_error()) {
+    SerialisedData serialised_error{ std::begin(response.serialised_maidsafe_error()),
+                                     std::end(response.serialised_maidsafe_error()) };
+    error = maidsafe::make_unique<maidsafe_error>(Parse<maidsafe_error>(serialised_error));
+  } else {
+    metrics.reserve(response.metrics_size());
+    for (const auto& proto_metric : response.metrics()) {
+      TimeoutMetric metric;
+      metric.kind = static_cast<TimeoutKind>(proto_metric.kind());
+      metric.current = std::chrono::milliseconds(proto_metric.current_ms());
+      metric.smoothed = std::chrono::milliseconds(proto_metric.smoothed_ms());
+      metric.variation = std::chrono::milliseconds(proto_metric.variation_ms());
+      metric.p99 = std::chrono::milliseconds(proto_metric.p99_ms());
+      metric.samples = proto_metric.samples();
+      metric.expiries = proto_metric.expiries();
+      metrics.push_back(metric);
+    }
+  }
+
+  std::lock_guard<std::mutex> lock{ mutex_ };
+  for (auto& request : ongoing_timeout_metrics_requests_) {
+    if (error)
+      request->SetException(*error);
+    else
+      request->SetValue(std::vector<TimeoutMetric>(metrics));
+    request->timer.cancel();
+  }
+  ongoing_timeout_metrics_requests_.clear();
+}
+
+void ClientInterface::HandleRestartQueueResponse(const std::string& message) {
+  protobuf::RestartQueueResponse response{ ParseProto<protobuf::RestartQueueResponse>(message) };
+  std::unique_ptr<maidsafe_error> error;
+  RestartQueueStats stats;
+  if (response.has_serialised_maidsafe_error()) {
+    SerialisedData serialised_error{ std::begin(response.serialised_maidsafe_error()),
+                                     std::end(response.serialised_maidsafe_error()) };
+    error = maidsafe::make_unique<maidsafe_error>(Parse<maidsafe_error>(serialised_error));
+  } else {
+    stats.queued = static_cast<size_t>(response.queued());
+    stats.peak_queued = static_cast<size_t>(response.peak_queued());
+    stats.tokens = static_cast<size_t>(response.tokens());
+    stats.admitted = response.admitted();
+    stats.throttled = response.throttled();
+    stats.longest_wait = std::chrono::milliseconds(response.longest_wait_ms());
+  }
+
+  std::lock_guard<std::mutex> lock{ mutex_ };
+  for (auto& request : ongoing_restart_queue_requests_) {
+    if (error)
+      request->SetException(*error);
+    else
+      request->SetValue(RestartQueueStats(stats));
+    request->timer.cancel();
+  }
+  ongoing_restart_queue_requests_.clear();
+}
+
+void ClientInterface::HandleUpgradeProgress(const std::string& message) {
+  protobuf::UpgradeProgress progress{ ParseProto<protobuf::UpgradeProgress>(message) };
+  LOG(kInfo) << (progress.rolling_back() ? "Rolling back vault upgrade: " : "Upgrading vaults: ")
+             << progress.upgraded() << " done, " << progress.failed() << " failed, "
+             << progress.skipped() << " skipped, of " << progress.total() << '.';
+}
+
+void ClientInterface::HandleUpgradeResponse(const std::string& message) {
+  protobuf::UpgradeResponse response{ ParseProto<protobuf::UpgradeResponse>(message) };
+  std::lock_guard<std::mutex> lock{ mutex_ };
+  std::shared_ptr<UpgradeRequest> request;
+  request.swap(ongoing_upgrade_request_);
+  if (!request) {
+    LOG(kWarning) << "Received an upgrade response, but no upgrade was requested.";
+    return;
+  }
+  if (response.has_serialised_maidsafe_error()) {
+    SerialisedData serialised_error{ std::begin(response.serialised_maidsafe_error()),
+                                     std::end(response.serialised_maidsafe_error()) };
+    request->SetException(Parse<maidsafe_error>(serialised_error));
+  } else {
+    UpgradeProgress progress;
+    progress.total = response.progress().total();
+    progress.upgraded = response.progress().upgraded();
+    progress.failed = response.progress().failed();
+    progress.skipped = response.progress().skipped();
+    progress.rolling_back = response.progress().rolling_back();
+    request->SetValue(std::move(progress));
+  }
+  request->timer.cancel();
+}
+
 #ifdef TESTING
 void ClientInterface::SetTestEnvironment(tcp::Port test_vault_manager_port,
     boost::filesystem::path test_env_root_dir, boost::filesystem::path path_to_vault,
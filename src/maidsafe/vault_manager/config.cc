@@ -24,10 +24,52 @@ namespace vault_manager {
 
 const std::string kConfigFilename("vault_manager_config.dat");
 const std::string kBootstrapFilename("bootstrap.dat");
+const std::string kHandoverFilename("vault_manager_handover.dat");
+const std::string kRuntimeStateFilename("vault_manager_runtime.dat");
+const std::string kVaultOutputFilename("vault_output.log");
+const std::string kVaultHostDirname("vault_host");
 
 const std::chrono::seconds kRpcTimeout(2);
+const std::chrono::seconds kRpcTimeoutFloor(2);
+const std::chrono::seconds kRpcTimeoutCeiling(120);
+const std::chrono::minutes kLatencyWindow(5);
 const std::chrono::seconds kVaultStopTimeout(10);
-const int kMaxVaultRestarts(5);
+const std::chrono::seconds kConnectionClosedGracePeriod(3);
+const std::chrono::milliseconds kRestartBackoffBase(1000);
+const std::chrono::milliseconds kRestartBackoffCeiling(5 * 60 * 1000);
+const std::chrono::minutes kRestartDecayPeriod(10);
+const std::chrono::minutes kCrashLoopWindow(10);
+const int kCrashLoopThreshold(5);
+const std::chrono::hours kQuarantineDuration(1);
+const int kMaxConsecutiveBadConfigs(3);
+const int kMaxConsecutiveQuarantines(3);
+const size_t kRestartBurst(16);
+const std::chrono::milliseconds kRestartRefillInterval(500);
+const uint64_t kMinFreeDiskSpace(256 * 1024 * 1024);
+const std::chrono::seconds kDiskSpacePollInterval(30);
+const size_t kExitHistorySize(16);
+const int kMaxConcurrentVaultStarts(32);
+const size_t kDefaultSparePoolSize(2);
+const int kMaxConcurrentVaultStops(16);
+const std::chrono::seconds kShutdownDeadline(75);
+const std::chrono::seconds kResourceSampleInterval(10);
+const size_t kResourceHistorySize(360);
+const size_t kResourceSampleBatchSize(64);
+const std::chrono::seconds kHeartbeatInterval(5);
+const int kMissedHeartbeatThreshold(3);
+const double kMemoryPressureThreshold(10.0);
+const std::chrono::seconds kMemoryPressureRestartInterval(60);
+const double kMemoryPressureMinRssGrowth(0.25);
+const uint64_t kVaultOutputMaxFileSize(10 * 1024 * 1024);
+const int kVaultOutputRotatedFiles(5);
+const size_t kDefaultUpgradeWaveSize(4);
+const double kDefaultUpgradeFailureThreshold(0.25);
+const std::chrono::minutes kUpgradeJoinTimeout(5);
+const std::chrono::hours kUpgradeTimeout(24);
+const std::chrono::seconds kVaultReattachTimeout(30);
+const std::chrono::milliseconds kVaultReconnectInterval(250);
+const std::chrono::seconds kOrphanPollInterval(1);
+const std::chrono::milliseconds kRuntimeStateWriteDelay(200);
 
 }  // namespace vault_manager
 
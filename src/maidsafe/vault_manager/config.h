@@ -20,6 +20,7 @@
 #define MAIDSAFE_VAULT_MANAGER_CONFIG_H_
 
 #include <chrono>
+#include <cstddef>
 #include <cstdint>
 #include <functional>
 #include <memory>
@@ -39,9 +40,88 @@ typedef std::shared_ptr<Timer> TimerPtr;
 
 extern const std::string kConfigFilename;
 extern const std::string kBootstrapFilename;
+extern const std::string kHandoverFilename;
+// Lists the running vaults, so that a VaultManager restarted after crashing can adopt them.
+extern const std::string kRuntimeStateFilename;
+// Each vault's captured stdout and stderr, in its "logs" folder (see VaultOutput).
+extern const std::string kVaultOutputFilename;
+// The folder holding the vault host's logs (see VaultHost).
+extern const std::string kVaultHostDirname;
+// The initial value of each adaptive timeout, before any latency has been observed.
 extern const std::chrono::seconds kRpcTimeout;
+// Adaptive timeouts never drop below the old fixed deadline, so adapting can only make the
+// VaultManager more patient.
+extern const std::chrono::seconds kRpcTimeoutFloor;
+extern const std::chrono::seconds kRpcTimeoutCeiling;
+// Adaptive timeouts take their p99 from latencies seen within the last one to two of these, so a
+// slow spell is forgotten once it's over.
+extern const std::chrono::minutes kLatencyWindow;
 extern const std::chrono::seconds kVaultStopTimeout;
-extern const int kMaxVaultRestarts;
+// How long a running vault whose connection has closed is given to exit before it's terminated.
+// Its exit status, not the close, decides how it's restarted.
+extern const std::chrono::seconds kConnectionClosedGracePeriod;
+extern const std::chrono::milliseconds kRestartBackoffBase;
+extern const std::chrono::milliseconds kRestartBackoffCeiling;
+extern const std::chrono::minutes kRestartDecayPeriod;
+extern const std::chrono::minutes kCrashLoopWindow;
+extern const int kCrashLoopThreshold;
+extern const std::chrono::hours kQuarantineDuration;
+// A vault is given up on (see RecordUnexpectedExit) once it has exited kMaxConsecutiveBadConfigs
+// times in a row with a bad configuration, or once it crash-loops again after
+// kMaxConsecutiveQuarantines consecutive quarantines.
+extern const int kMaxConsecutiveBadConfigs;
+extern const int kMaxConsecutiveQuarantines;
+// The default host-wide restart throttle: up to kRestartBurst restarts at once, then one per
+// kRestartRefillInterval (see ProcessManager::SetRestartThrottle).
+extern const size_t kRestartBurst;
+extern const std::chrono::milliseconds kRestartRefillInterval;
+// A vault which exited because its disk was full is restarted once the filesystem holding its
+// vault_dir has this much space available, checked every kDiskSpacePollInterval.
+extern const uint64_t kMinFreeDiskSpace;
+extern const std::chrono::seconds kDiskSpacePollInterval;
+// The number of exits kept per vault (see ProcessManager::GetExitHistory).
+extern const size_t kExitHistorySize;
+extern const int kMaxConcurrentVaultStarts;
+extern const size_t kDefaultSparePoolSize;
+extern const int kMaxConcurrentVaultStops;
+// Leaves time to spare within systemd's default 90 second stop timeout.
+extern const std::chrono::seconds kShutdownDeadline;
+extern const std::chrono::seconds kResourceSampleInterval;
+// An hour of samples at the default interval.
+extern const size_t kResourceHistorySize;
+// The number of vaults sampled before yielding to other work on the io_service.
+extern const size_t kResourceSampleBatchSize;
+extern const std::chrono::seconds kHeartbeatInterval;
+// Consecutive unanswered heartbeats after which a vault is deemed to have hung.
+extern const int kMissedHeartbeatThreshold;
+// The host memory pressure (the percentage of time all non-idle tasks were stalled on memory) at
+// which the vault which has grown the most is restarted.
+extern const double kMemoryPressureThreshold;
+// How long to wait between restarts due to host memory pressure, to let the pressure ease.
+extern const std::chrono::seconds kMemoryPressureRestartInterval;
+// The fraction of its initial RSS by which a vault must have grown to be restarted due to host
+// memory pressure, so that the pressure of other processes doesn't cycle healthy vaults.
+extern const double kMemoryPressureMinRssGrowth;
+// The size at which a vault's output file is rotated, and how many rotated files are kept.
+extern const uint64_t kVaultOutputMaxFileSize;
+extern const int kVaultOutputRotatedFiles;
+extern const size_t kDefaultUpgradeWaveSize;
+// The fraction of upgraded vaults which may fail before an upgrade is halted and rolled back.
+extern const double kDefaultUpgradeFailureThreshold;
+// How long each vault in an upgrade wave has to rejoin the network.
+extern const std::chrono::minutes kUpgradeJoinTimeout;
+// How long a client waits for an upgrade to finish.
+extern const std::chrono::hours kUpgradeTimeout;
+// How long a vault keeps trying to reconnect after losing its VaultManager, and how long a
+// VaultManager which has re-executed itself (or been restarted after crashing) waits for each of
+// its vaults to do so.
+extern const std::chrono::seconds kVaultReattachTimeout;
+extern const std::chrono::milliseconds kVaultReconnectInterval;
+// How often the exits of vaults which aren't our children (and so raise no SIGCHLD) are polled for.
+extern const std::chrono::seconds kOrphanPollInterval;
+// How long after a vault starts or stops the runtime state file is rewritten, so that a burst of
+// changes costs a single write.
+extern const std::chrono::milliseconds kRuntimeStateWriteDelay;
 
 DEFINE_OSTREAMABLE_ENUM_VALUES(MessageType, int32_t,
     (ValidateConnectionRequest)
@@ -59,7 +139,29 @@ DEFINE_OSTREAMABLE_ENUM_VALUES(MessageType, int32_t,
     (LogMessage)
     (MarkNetworkAsStable)
     (NetworkStableRequest)
-    (NetworkStableResponse))
+    (NetworkStableResponse)
+    (ShutdownProgress)
+    (ResourceUsageRequest)
+    (ResourceUsageResponse)
+    (Heartbeat)
+    (HeartbeatResponse)
+    (LifecycleLatencyRequest)
+    (LifecycleLatencyResponse)
+    (TimeoutMetricsRequest)
+    (TimeoutMetricsResponse)
+    (UpgradeRequest)
+    (UpgradeProgress)
+    (UpgradeResponse)
+    (VaultReattached)
+    (VaultReattachedResponse)
+    (SchedulingClassRequest)
+    (SchedulingClassResponse)
+    (RestartQueueRequest)
+    (RestartQueueResponse)
+    (VaultHostStarted)
+    (StartInstanceRequest)
+    (StopInstanceRequest)
+    (InstanceExited))
 
 typedef std::pair<std::string, MessageType> MessageAndType;
 
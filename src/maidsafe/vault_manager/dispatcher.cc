@@ -18,6 +18,8 @@
 
 #include "maidsafe/vault_manager/dispatcher.h"
 
+#include <chrono>
+
 #include "maidsafe/common/process.h"
 #include "maidsafe/common/utils.h"
 #include "maidsafe/common/tcp/connection.h"
@@ -39,7 +41,10 @@ void DoSendStartVaultRequest(tcp::ConnectionPtr connection, const NonEmptyString
                              const boost::filesystem::path& vault_dir, DiskUsage max_disk_usage,
                              const std::string* const vlog_session_id,
                              const bool* const send_hostname_to_visualiser_server,
-                             const int* const pmid_list_index) {
+                             const int* const pmid_list_index,
+                             SchedulingClass scheduling_class,
+                             const std::string& launch_profile,
+                             const ResourceLimits& resource_limits, bool in_process) {
   protobuf::StartVaultRequest message;
   message.set_label(vault_label.string());
   if (!vault_dir.empty())
@@ -51,10 +56,33 @@ void DoSendStartVaultRequest(tcp::ConnectionPtr connection, const NonEmptyString
     message.set_send_hostname_to_visualiser_server(*send_hostname_to_visualiser_server);
   if (pmid_list_index)
     message.set_pmid_list_index(*pmid_list_index);
+  if (scheduling_class != SchedulingClass::kNormal)
+    message.set_scheduling_class(static_cast<int32_t>(scheduling_class));
+  if (!launch_profile.empty())
+    message.set_launch_profile(launch_profile);
+  // Zero limits are left unset, so that the VaultManager's defaults apply.
+  if (resource_limits.cpu_weight != 0)
+    message.set_cpu_weight(resource_limits.cpu_weight);
+  if (resource_limits.memory_high != 0)
+    message.set_memory_high(resource_limits.memory_high);
+  if (resource_limits.memory_max != 0)
+    message.set_memory_max(resource_limits.memory_max);
+  if (resource_limits.io_weight != 0)
+    message.set_io_weight(resource_limits.io_weight);
+  if (in_process)
+    message.set_in_process(true);
   connection->Send(WrapMessage(std::make_pair(message.SerializeAsString(),
                                               MessageType::kStartVaultRequest)));
 }
 
+void SetUpgradeProgress(const UpgradeProgress& progress, protobuf::UpgradeProgress& message) {
+  message.set_total(static_cast<uint32_t>(progress.total));
+  message.set_upgraded(static_cast<uint32_t>(progress.upgraded));
+  message.set_failed(static_cast<uint32_t>(progress.failed));
+  message.set_skipped(static_cast<uint32_t>(progress.skipped));
+  message.set_rolling_back(progress.rolling_back);
+}
+
 }  // unnamed namespace
 
 void SendValidateConnectionRequest(tcp::ConnectionPtr connection) {
@@ -82,15 +110,22 @@ void SendChallengeResponse(tcp::ConnectionPtr connection, const passport::Public
 #ifdef USE_VLOGGING
 void SendStartVaultRequest(tcp::ConnectionPtr connection, const NonEmptyString& vault_label,
                            const fs::path& vault_dir, DiskUsage max_disk_usage,
-                           const std::string& vlog_session_id) {
+                           const std::string& vlog_session_id,
+                           SchedulingClass scheduling_class,
+                           const std::string& launch_profile,
+                           const ResourceLimits& resource_limits, bool in_process) {
   DoSendStartVaultRequest(connection, vault_label, vault_dir, max_disk_usage, &vlog_session_id,
-                          nullptr, nullptr);
+                          nullptr, nullptr, scheduling_class, launch_profile, resource_limits,
+                          in_process);
 }
 #else
 void SendStartVaultRequest(tcp::ConnectionPtr connection, const NonEmptyString& vault_label,
-                           const fs::path& vault_dir, DiskUsage max_disk_usage) {
+                           const fs::path& vault_dir, DiskUsage max_disk_usage,
+                           SchedulingClass scheduling_class,
+                           const std::string& launch_profile,
+                           const ResourceLimits& resource_limits, bool in_process) {
   DoSendStartVaultRequest(connection, vault_label, vault_dir, max_disk_usage, nullptr, nullptr,
-                          nullptr);
+                          nullptr, scheduling_class, launch_profile, resource_limits, in_process);
 }
 #endif
 
@@ -131,20 +166,20 @@ void SendVaultRunningResponse(tcp::ConnectionPtr connection,
                    MessageType::kVaultRunningResponse)));
 }
 
-void SendVaultStarted(tcp::ConnectionPtr connection) {
+void SendVaultStarted(tcp::ConnectionPtr connection, uint64_t process_id) {
   protobuf::VaultStarted message;
-  message.set_process_id(process::GetProcessId());
+  message.set_process_id(process_id);
   connection->Send(WrapMessage(std::make_pair(message.SerializeAsString(),
                                               MessageType::kVaultStarted)));
 }
 
-void SendVaultStartedResponse(VaultInfo& vault_info, crypto::AES256Key symm_key,
-                              crypto::AES256InitialisationVector symm_iv) {
+std::string MakeVaultStartedResponse(const VaultInfo& vault_info, const std::string& encrypted_pmid,
+                                     const crypto::AES256Key& symm_key,
+                                     const crypto::AES256InitialisationVector& symm_iv) {
   protobuf::VaultStartedResponse message;
   message.set_aes256key(symm_key.string());
   message.set_aes256iv(symm_iv.string());
-  message.set_encrypted_pmid(
-      passport::EncryptPmid(vault_info.pmid_and_signer->first, symm_key, symm_iv)->string());
+  message.set_encrypted_pmid(encrypted_pmid);
   message.set_vault_dir(vault_info.vault_dir.string());
   message.set_max_disk_usage(vault_info.max_disk_usage.data);
 #ifdef USE_VLOGGING
@@ -160,8 +195,27 @@ void SendVaultStartedResponse(VaultInfo& vault_info, crypto::AES256Key symm_key,
     message.set_serialised_public_pmids(serialised_public_pmids);
 #endif
 
-  vault_info.tcp_connection->Send(WrapMessage(std::make_pair(message.SerializeAsString(),
-                                                             MessageType::kVaultStartedResponse)));
+  return WrapMessage(std::make_pair(message.SerializeAsString(),
+                                    MessageType::kVaultStartedResponse));
+}
+
+void SendVaultStartedResponse(tcp::ConnectionPtr connection,
+                              const std::string& vault_started_response) {
+  connection->Send(vault_started_response);
+}
+
+void SendVaultReattached(tcp::ConnectionPtr connection, const Identity& pmid_name,
+                         uint64_t process_id) {
+  protobuf::VaultReattached message;
+  message.set_process_id(process_id);
+  message.set_pmid_name(pmid_name.string());
+  connection->Send(WrapMessage(std::make_pair(message.SerializeAsString(),
+                                              MessageType::kVaultReattached)));
+}
+
+void SendVaultReattachedResponse(tcp::ConnectionPtr connection) {
+  connection->Send(WrapMessage(std::make_pair(std::string{},
+                                              MessageType::kVaultReattachedResponse)));
 }
 
 void SendJoinedNetwork(tcp::ConnectionPtr connection) {
@@ -183,6 +237,253 @@ void SendLogMessage(tcp::ConnectionPtr connection, const std::string& log_messag
   connection->Send(WrapMessage(std::make_pair(log_message, MessageType::kLogMessage)));
 }
 
+void SendShutdownProgress(tcp::ConnectionPtr connection, size_t total, size_t stopped,
+                          size_t terminated) {
+  protobuf::ShutdownProgress message;
+  message.set_total(static_cast<uint32_t>(total));
+  message.set_stopped(static_cast<uint32_t>(stopped));
+  message.set_terminated(static_cast<uint32_t>(terminated));
+  connection->Send(WrapMessage(std::make_pair(message.SerializeAsString(),
+                                              MessageType::kShutdownProgress)));
+}
+
+void SendResourceUsageRequest(tcp::ConnectionPtr connection, const NonEmptyString& vault_label) {
+  protobuf::ResourceUsageRequest message;
+  message.set_label(vault_label.string());
+  connection->Send(WrapMessage(std::make_pair(message.SerializeAsString(),
+                                              MessageType::kResourceUsageRequest)));
+}
+
+void SendResourceUsageResponse(tcp::ConnectionPtr connection, const NonEmptyString& vault_label,
+                               const std::vector<ResourceSample>& samples,
+                               const maidsafe_error* const error) {
+  protobuf::ResourceUsageResponse message;
+  message.set_label(vault_label.string());
+  if (error) {
+    auto serialised_error = Serialise(*error);
+    message.set_serialised_maidsafe_error(std::string(std::begin(serialised_error),
+                                                      std::end(serialised_error)));
+  } else {
+    auto now(std::chrono::steady_clock::now());
+    for (const auto& sample : samples) {
+      auto proto_sample(message.add_samples());
+      proto_sample->set_age_ms(std::chrono::duration_cast<std::chrono::milliseconds>(
+          now - sample.time).count());
+      proto_sample->set_cpu_time_ms(sample.cpu_time.count());
+      proto_sample->set_rss(sample.rss);
+      proto_sample->set_read_bytes(sample.read_bytes);
+      proto_sample->set_write_bytes(sample.write_bytes);
+      proto_sample->set_file_descriptors(sample.file_descriptors);
+      proto_sample->set_threads(sample.threads);
+    }
+  }
+  connection->Send(WrapMessage(std::make_pair(message.SerializeAsString(),
+                                              MessageType::kResourceUsageResponse)));
+}
+
+void SendSchedulingClassRequest(tcp::ConnectionPtr connection, const NonEmptyString& vault_label,
+                                SchedulingClass scheduling_class) {
+  protobuf::SchedulingClassRequest message;
+  message.set_label(vault_label.string());
+  message.set_scheduling_class(static_cast<int32_t>(scheduling_class));
+  connection->Send(WrapMessage(std::make_pair(message.SerializeAsString(),
+                                              MessageType::kSchedulingClassRequest)));
+}
+
+void SendSchedulingClassResponse(tcp::ConnectionPtr connection, const NonEmptyString& vault_label,
+                                 SchedulingClass scheduling_class,
+                                 const maidsafe_error* const error) {
+  protobuf::SchedulingClassResponse message;
+  message.set_label(vault_label.string());
+  if (error) {
+    auto serialised_error = Serialise(*error);
+    message.set_serialised_maidsafe_error(std::string(std::begin(serialised_error),
+                                                      std::end(serialised_error)));
+  } else {
+    message.set_scheduling_class(static_cast<int32_t>(scheduling_class));
+  if (!launch_profile.empty())
+    message.set_launch_profile(launch_profile);
+  // Zero limits are left unset, so that the VaultManager's defaults apply.
+  if (resource_limits.cpu_weight != 0)
+    message.set_cpu_weight(resource_limits.cpu_weight);
+  if (resource_limits.memory_high != 0)
+    message.set_memory_high(resource_limits.memory_high);
+  if (resource_limits.memory_max != 0)
+    message.set_memory_max(resource_limits.memory_max);
+  if (resource_limits.io_weight != 0)
+    message.set_io_weight(resource_limits.io_weight);
+  if (in_process)
+    message.set_in_process(true);
+  }
+  connection->Send(WrapMessage(std::make_pair(message.SerializeAsString(),
+                                              MessageType::kSchedulingClassResponse)));
+}
+
+void SendHeartbeat(tcp::ConnectionPtr connection, uint64_t sequence_number) {
+  protobuf::Heartbeat message;
+  message.set_sequence_number(sequence_number);
+  connection->Send(WrapMessage(std::make_pair(message.SerializeAsString(),
+                                              MessageType::kHeartbeat)));
+}
+
+void SendLifecycleLatencyRequest(tcp::ConnectionPtr connection,
+                                 const NonEmptyString* const vault_label) {
+  protobuf::LifecycleLatencyRequest message;
+  if (vault_label)
+    message.set_label(vault_label->string());
+  connection->Send(WrapMessage(std::make_pair(message.SerializeAsString(),
+                                              MessageType::kLifecycleLatencyRequest)));
+}
+
+void SendLifecycleLatencyResponse(tcp::ConnectionPtr connection,
+                                  const NonEmptyString* const vault_label,
+                                  const std::vector<PhaseLatency>& latencies,
+                                  const maidsafe_error* const error) {
+  protobuf::LifecycleLatencyResponse message;
+  if (vault_label)
+    message.set_label(vault_label->string());
+  if (error) {
+    auto serialised_error = Serialise(*error);
+    message.set_serialised_maidsafe_error(std::string(std::begin(serialised_error),
+                                                      std::end(serialised_error)));
+  } else {
+    for (const auto& latency : latencies) {
+      auto phase(message.add_phases());
+      phase->set_phase(static_cast<int32_t>(latency.phase));
+      phase->set_count(latency.count);
+      phase->set_p50_us(latency.p50.count());
+      phase->set_p90_us(latency.p90.count());
+      phase->set_p99_us(latency.p99.count());
+      phase->set_max_us(latency.max.count());
+    }
+  }
+  connection->Send(WrapMessage(std::make_pair(message.SerializeAsString(),
+                                              MessageType::kLifecycleLatencyResponse)));
+}
+
+void SendUpgradeRequest(tcp::ConnectionPtr connection, const fs::path& vault_executable_path,
+                        size_t wave_size, double failure_threshold) {
+  protobuf::UpgradeRequest message;
+  message.set_vault_executable_path(vault_executable_path.string());
+  message.set_wave_size(static_cast<uint32_t>(wave_size));
+  message.set_failure_threshold(failure_threshold);
+  connection->Send(WrapMessage(std::make_pair(message.SerializeAsString(),
+                                              MessageType::kUpgradeRequest)));
+}
+
+void SendUpgradeProgress(tcp::ConnectionPtr connection, const UpgradeProgress& progress) {
+  protobuf::UpgradeProgress message;
+  SetUpgradeProgress(progress, message);
+  connection->Send(WrapMessage(std::make_pair(message.SerializeAsString(),
+                                              MessageType::kUpgradeProgress)));
+}
+
+void SendUpgradeResponse(tcp::ConnectionPtr connection, const UpgradeProgress& progress,
+                         const maidsafe_error* const error) {
+  protobuf::UpgradeResponse message;
+  SetUpgradeProgress(progress, *message.mutable_progress());
+  if (error) {
+    auto serialised_error = Serialise(*error);
+    message.set_serialised_maidsafe_error(std::string(std::begin(serialised_error),
+                                                      std::end(serialised_error)));
+  }
+  connection->Send(WrapMessage(std::make_pair(message.SerializeAsString(),
+                                              MessageType::kUpgradeResponse)));
+}
+
+void SendTimeoutMetricsRequest(tcp::ConnectionPtr connection) {
+  connection->Send(WrapMessage(std::make_pair(std::string(),
+                                              MessageType::kTimeoutMetricsRequest)));
+}
+
+void SendTimeoutMetricsResponse(tcp::ConnectionPtr connection,
+                                const std::vector<TimeoutMetric>& metrics,
+                                const maidsafe_error* const error) {
+  protobuf::TimeoutMetricsResponse message;
+  if (error) {
+    auto serialised_error = Serialise(*error);
+    message.set_serialised_maidsafe_error(std::string(std::begin(serialised_error),
+                                                      std::end(serialised_error)));
+  } else {
+    for (const auto& metric : metrics) {
+      auto proto_metric(message.add_metrics());
+      proto_metric->set_kind(static_cast<int32_t>(metric.kind));
+      proto_metric->set_current_ms(metric.current.count());
+      proto_metric->set_smoothed_ms(metric.smoothed.count());
+      proto_metric->set_variation_ms(metric.variation.count());
+      proto_metric->set_p99_ms(metric.p99.count());
+      proto_metric->set_samples(metric.samples);
+      proto_metric->set_expiries(metric.expiries);
+    }
+  }
+  connection->Send(WrapMessage(std::make_pair(message.SerializeAsString(),
+                                              MessageType::kTimeoutMetricsResponse)));
+}
+
+void SendRestartQueueRequest(tcp::ConnectionPtr connection) {
+  connection->Send(WrapMessage(std::make_pair(std::string(),
+                                              MessageType::kRestartQueueRequest)));
+}
+
+void SendRestartQueueResponse(tcp::ConnectionPtr connection, const RestartQueueStats& stats,
+                              const maidsafe_error* const error) {
+  protobuf::RestartQueueResponse message;
+  if (error) {
+    auto serialised_error = Serialise(*error);
+    message.set_serialised_maidsafe_error(std::string(std::begin(serialised_error),
+                                                      std::end(serialised_error)));
+  } else {
+    message.set_queued(stats.queued);
+    message.set_peak_queued(stats.peak_queued);
+    message.set_tokens(stats.tokens);
+    message.set_admitted(stats.admitted);
+    message.set_throttled(stats.throttled);
+    message.set_longest_wait_ms(stats.longest_wait.count());
+  }
+  connection->Send(WrapMessage(std::make_pair(message.SerializeAsString(),
+                                              MessageType::kRestartQueueResponse)));
+}
+
+void SendHeartbeatResponse(tcp::ConnectionPtr connection, uint64_t sequence_number,
+                           std::chrono::microseconds loop_lag) {
+  protobuf::HeartbeatResponse message;
+  message.set_sequence_number(sequence_number);
+  message.set_loop_lag_us(loop_lag.count());
+  message.set_timestamp_ms(std::chrono::duration_cast<std::chrono::milliseconds>(
+      std::chrono::system_clock::now().time_since_epoch()).count());
+  connection->Send(WrapMessage(std::make_pair(message.SerializeAsString(),
+                                              MessageType::kHeartbeatResponse)));
+}
+
+void SendVaultHostStarted(tcp::ConnectionPtr connection, uint64_t process_id) {
+  protobuf::VaultHostStarted message;
+  message.set_process_id(process_id);
+  connection->Send(WrapMessage(std::make_pair(message.SerializeAsString(),
+                                              MessageType::kVaultHostStarted)));
+}
+
+void SendStartInstanceRequest(tcp::ConnectionPtr connection, uint64_t instance_id) {
+  protobuf::StartInstanceRequest message;
+  message.set_instance_id(instance_id);
+  connection->Send(WrapMessage(std::make_pair(message.SerializeAsString(),
+                                              MessageType::kStartInstanceRequest)));
+}
+
+void SendStopInstanceRequest(tcp::ConnectionPtr connection, uint64_t instance_id) {
+  protobuf::StopInstanceRequest message;
+  message.set_instance_id(instance_id);
+  connection->Send(WrapMessage(std::make_pair(message.SerializeAsString(),
+                                              MessageType::kStopInstanceRequest)));
+}
+
+void SendInstanceExited(tcp::ConnectionPtr connection, uint64_t instance_id, int exit_code) {
+  protobuf::InstanceExited message;
+  message.set_instance_id(instance_id);
+  message.set_exit_code(exit_code);
+  connection->Send(WrapMessage(std::make_pair(message.SerializeAsString(),
+                                              MessageType::kInstanceExited)));
+}
+
 #ifdef TESTING
 # ifdef USE_VLOGGING
 void SendStartVaultRequest(tcp::ConnectionPtr connection, const NonEmptyString& vault_label,
@@ -190,7 +491,8 @@ void SendStartVaultRequest(tcp::ConnectionPtr connection, const NonEmptyString&
                            const std::string& vlog_session_id,
                            bool send_hostname_to_visualiser_server) {
   DoSendStartVaultRequest(connection, vault_label, vault_dir, max_disk_usage, &vlog_session_id,
-                          &send_hostname_to_visualiser_server, nullptr);
+                          &send_hostname_to_visualiser_server, nullptr, SchedulingClass::kNormal,
+                          std::string(), ResourceLimits(), false);
 }
 
 void SendStartVaultRequest(tcp::ConnectionPtr connection, const NonEmptyString& vault_label,
@@ -198,14 +500,16 @@ void SendStartVaultRequest(tcp::ConnectionPtr connection, const NonEmptyString&
                            const std::string& vlog_session_id,
                            bool send_hostname_to_visualiser_server, int pmid_list_index) {
   DoSendStartVaultRequest(connection, vault_label, vault_dir, max_disk_usage, &vlog_session_id,
-                          &send_hostname_to_visualiser_server, &pmid_list_index);
+                          &send_hostname_to_visualiser_server, &pmid_list_index,
+                          SchedulingClass::kNormal, std::string(), ResourceLimits(), false);
 }
 # else
 void SendStartVaultRequest(tcp::ConnectionPtr connection, const NonEmptyString& vault_label,
                            const boost::filesystem::path& vault_dir, DiskUsage max_disk_usage,
                            int pmid_list_index) {
   DoSendStartVaultRequest(connection, vault_label, vault_dir, max_disk_usage, nullptr, nullptr,
-                          &pmid_list_index);
+                          &pmid_list_index, SchedulingClass::kNormal, std::string(),
+                          ResourceLimits(), false);
 }
 # endif  // USE_VLOGGING
 
@@ -19,8 +19,12 @@
 #ifndef MAIDSAFE_VAULT_MANAGER_DISPATCHER_H_
 #define MAIDSAFE_VAULT_MANAGER_DISPATCHER_H_
 
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
 #include <memory>
 #include <string>
+#include <vector>
 
 #include "boost/filesystem/path.hpp"
 
@@ -30,6 +34,13 @@
 #include "maidsafe/common/types.h"
 #include "maidsafe/passport/passport.h"
 #include "maidsafe/vault_manager/config.h"
+#include "maidsafe/vault_manager/lifecycle_latency.h"
+#include "maidsafe/vault_manager/resource_limits.h"
+#include "maidsafe/vault_manager/resource_usage.h"
+#include "maidsafe/vault_manager/restart_queue_stats.h"
+#include "maidsafe/vault_manager/scheduling_class.h"
+#include "maidsafe/vault_manager/timeout_metrics.h"
+#include "maidsafe/vault_manager/upgrade_progress.h"
 
 namespace maidsafe {
 
@@ -47,10 +58,18 @@ void SendChallengeResponse(tcp::ConnectionPtr connection, const passport::Public
 #ifdef USE_VLOGGING
 void SendStartVaultRequest(tcp::ConnectionPtr connection, const NonEmptyString& vault_label,
                            const boost::filesystem::path& vault_dir, DiskUsage max_disk_usage,
-                           const std::string& vlog_session_id);
+                           const std::string& vlog_session_id,
+                           SchedulingClass scheduling_class = SchedulingClass::kNormal,
+                           const std::string& launch_profile = std::string(),
+                           const ResourceLimits& resource_limits = ResourceLimits(),
+                           bool in_process = false);
 #else
 void SendStartVaultRequest(tcp::ConnectionPtr connection, const NonEmptyString& vault_label,
-                           const boost::filesystem::path& vault_dir, DiskUsage max_disk_usage);
+                           const boost::filesystem::path& vault_dir, DiskUsage max_disk_usage,
+                           SchedulingClass scheduling_class = SchedulingClass::kNormal,
+                           const std::string& launch_profile = std::string(),
+                           const ResourceLimits& resource_limits = ResourceLimits(),
+                           bool in_process = false);
 #endif
 
 void SendTakeOwnershipRequest(tcp::ConnectionPtr connection, const NonEmptyString& vault_label,
@@ -60,10 +79,21 @@ void SendVaultRunningResponse(tcp::ConnectionPtr connection, const NonEmptyStrin
                               const passport::PmidAndSigner* const pmid_and_signer,
                               const maidsafe_error* const error = nullptr);
 
-void SendVaultStarted(tcp::ConnectionPtr connection);
+void SendVaultStarted(tcp::ConnectionPtr connection, uint64_t process_id);
+
+// Returns the vault's wrapped VaultStartedResponse, ready to be sent.  'encrypted_pmid' is the
+// vault's PMID encrypted using 'symm_key' and 'symm_iv'.  See VaultStartedResponseCache.
+std::string MakeVaultStartedResponse(const VaultInfo& vault_info, const std::string& encrypted_pmid,
+                                     const crypto::AES256Key& symm_key,
+                                     const crypto::AES256InitialisationVector& symm_iv);
+
+void SendVaultStartedResponse(tcp::ConnectionPtr connection,
+                              const std::string& vault_started_response);
 
-void SendVaultStartedResponse(VaultInfo& vault_info, crypto::AES256Key symm_key,
-                              crypto::AES256InitialisationVector symm_iv);
+void SendVaultReattached(tcp::ConnectionPtr connection, const Identity& pmid_name,
+                         uint64_t process_id);
+
+void SendVaultReattachedResponse(tcp::ConnectionPtr connection);
 
 void SendJoinedNetwork(tcp::ConnectionPtr connection);
 
@@ -73,6 +103,64 @@ void SendMaxDiskUsageUpdate(tcp::ConnectionPtr connection, DiskUsage max_disk_us
 
 void SendLogMessage(tcp::ConnectionPtr connection, const std::string& log_message);
 
+void SendShutdownProgress(tcp::ConnectionPtr connection, size_t total, size_t stopped,
+                          size_t terminated);
+
+void SendResourceUsageRequest(tcp::ConnectionPtr connection, const NonEmptyString& vault_label);
+
+void SendResourceUsageResponse(tcp::ConnectionPtr connection, const NonEmptyString& vault_label,
+                               const std::vector<ResourceSample>& samples,
+                               const maidsafe_error* const error = nullptr);
+
+void SendHeartbeat(tcp::ConnectionPtr connection, uint64_t sequence_number);
+
+void SendSchedulingClassRequest(tcp::ConnectionPtr connection, const NonEmptyString& vault_label,
+                                SchedulingClass scheduling_class);
+
+void SendSchedulingClassResponse(tcp::ConnectionPtr connection, const NonEmptyString& vault_label,
+                                 SchedulingClass scheduling_class,
+                                 const maidsafe_error* const error = nullptr);
+
+void SendTimeoutMetricsRequest(tcp::ConnectionPtr connection);
+
+void SendUpgradeRequest(tcp::ConnectionPtr connection,
+                        const boost::filesystem::path& vault_executable_path, size_t wave_size,
+                        double failure_threshold);
+
+void SendUpgradeProgress(tcp::ConnectionPtr connection, const UpgradeProgress& progress);
+
+void SendUpgradeResponse(tcp::ConnectionPtr connection, const UpgradeProgress& progress,
+                         const maidsafe_error* const error = nullptr);
+
+void SendTimeoutMetricsResponse(tcp::ConnectionPtr connection,
+                                const std::vector<TimeoutMetric>& metrics,
+                                const maidsafe_error* const error = nullptr);
+
+void SendRestartQueueRequest(tcp::ConnectionPtr connection);
+
+void SendRestartQueueResponse(tcp::ConnectionPtr connection, const RestartQueueStats& stats,
+                              const maidsafe_error* const error = nullptr);
+
+// A null 'vault_label' asks for, or reports, the latencies of every vault on the host.
+void SendLifecycleLatencyRequest(tcp::ConnectionPtr connection,
+                                 const NonEmptyString* const vault_label);
+
+void SendLifecycleLatencyResponse(tcp::ConnectionPtr connection,
+                                  const NonEmptyString* const vault_label,
+                                  const std::vector<PhaseLatency>& latencies,
+                                  const maidsafe_error* const error = nullptr);
+
+void SendHeartbeatResponse(tcp::ConnectionPtr connection, uint64_t sequence_number,
+                           std::chrono::microseconds loop_lag);
+
+void SendVaultHostStarted(tcp::ConnectionPtr connection, uint64_t process_id);
+
+void SendStartInstanceRequest(tcp::ConnectionPtr connection, uint64_t instance_id);
+
+void SendStopInstanceRequest(tcp::ConnectionPtr connection, uint64_t instance_id);
+
+void SendInstanceExited(tcp::ConnectionPtr connection, uint64_t instance_id, int exit_code);
+
 #ifdef TESTING
 # ifdef USE_VLOGGING
 void SendStartVaultRequest(tcp::ConnectionPtr connection, const NonEmptyString& vault_label,
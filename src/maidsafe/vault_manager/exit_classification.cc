@@ -0,0 +1,149 @@
+/*  Copyright 2014 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include "maidsafe/vault_manager/exit_classification.h"
+
+#ifndef MAIDSAFE_WIN32
+#include <signal.h>
+#include <sys/wait.h>
+#endif
+
+#include <fstream>
+#include <sstream>
+
+namespace maidsafe {
+
+namespace vault_manager {
+
+namespace {
+
+bool ExitedWith(int exit_code, const maidsafe_error& error) {
+  return exit_code == ExitCode(error);
+}
+
+#ifndef MAIDSAFE_WIN32
+bool IsFatalSignal(int signal) {
+  switch (signal) {
+    case SIGSEGV:
+    case SIGBUS:
+    case SIGILL:
+    case SIGFPE:
+    case SIGABRT:
+    case SIGSYS:
+    case SIGTRAP:
+      return true;
+    default:
+      return false;
+  }
+}
+#endif
+
+}  // unnamed namespace
+
+ExitStatus DecodeWaitStatus(int wait_status) {
+#ifdef MAIDSAFE_WIN32
+  return ExitStatus(wait_status);
+#else
+  ExitStatus exit_status;
+  if (WIFEXITED(wait_status)) {
+    exit_status.exit_code = WEXITSTATUS(wait_status);
+  } else if (WIFSIGNALED(wait_status)) {
+    exit_status.signal = WTERMSIG(wait_status);
+#ifdef WCOREDUMP
+    exit_status.core_dumped = WCOREDUMP(wait_status) != 0;
+#endif
+  }
+  return exit_status;
+#endif
+}
+
+int ExitCode(const maidsafe_error& error) {
+#ifdef MAIDSAFE_WIN32
+  return ErrorToInt(error);
+#else
+  return ErrorToInt(error) & 0xff;
+#endif
+}
+
+ExitClass ClassifyExit(const ExitStatus& exit_status, bool terminated, bool oom_killed,
+                       bool connected) {
+  if (terminated)
+    return ExitClass::kTerminated;
+  if (oom_killed)
+    return ExitClass::kOutOfMemory;
+#ifndef MAIDSAFE_WIN32
+  if (exit_status.core_dumped || IsFatalSignal(exit_status.signal))
+    return ExitClass::kCrashed;
+#endif
+  if (exit_status.signal != 0)
+    return ExitClass::kKilled;
+  if (exit_status.exit_code == 0)
+    return ExitClass::kClean;
+  if (ExitedWith(exit_status.exit_code, MakeError(CommonErrors::cannot_exceed_limit)))
+    return ExitClass::kDiskFull;
+  if (!connected &&
+      (ExitedWith(exit_status.exit_code, MakeError(CommonErrors::invalid_parameter)) ||
+       ExitedWith(exit_status.exit_code, MakeError(CommonErrors::parsing_error)))) {
+    return ExitClass::kBadConfig;
+  }
+  return ExitClass::kFailed;
+}
+
+RestartAction GetRestartAction(ExitClass exit_class) {
+  switch (exit_class) {
+    case ExitClass::kClean:
+      // Nothing suggests that the vault is unhealthy.  A vault killed by a signal is still backed
+      // off, since the OOM killer can't always be identified as the sender of SIGKILL.
+      return RestartAction::kRestartNow;
+    case ExitClass::kDiskFull:
+      return RestartAction::kAwaitDiskSpace;
+    default:
+      return RestartAction::kRestartAfterBackoff;
+  }
+}
+
+bool ParseOomKills(const std::string& contents, uint64_t& oom_kills) {
+  std::istringstream stream(contents);
+  std::string key;
+  uint64_t value(0);
+  while (stream >> key >> value) {
+    if (key == "oom_kill") {
+      oom_kills = value;
+      return true;
+    }
+  }
+  return false;
+}
+
+uint64_t ReadHostOomKills() {
+#ifdef MAIDSAFE_LINUX
+  // /proc files report a size of zero, so are read as streams rather than using ReadFile.
+  std::ifstream file("/proc/vmstat");
+  std::stringstream contents;
+  contents << file.rdbuf();
+  uint64_t oom_kills(0);
+  ParseOomKills(contents.str(), oom_kills);
+  return oom_kills;
+#else
+  return 0;
+#endif
+}
+
+}  // namespace vault_manager
+
+}  // namespace maidsafe
@@ -0,0 +1,107 @@
+/*  Copyright 2014 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#ifndef MAIDSAFE_VAULT_MANAGER_EXIT_CLASSIFICATION_H_
+#define MAIDSAFE_VAULT_MANAGER_EXIT_CLASSIFICATION_H_
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+#include "maidsafe/common/error.h"
+#include "maidsafe/common/type_macros.h"
+
+namespace maidsafe {
+
+namespace vault_manager {
+
+// How a vault's process ended.  'exit_code' is -1 if the process was killed by a signal, or if its
+// status couldn't be collected (e.g. an adopted vault reaped by another process).  On POSIX
+// systems, only the low 8 bits of the value the vault returned survive.
+struct ExitStatus {
+  explicit ExitStatus(int exit_code_in = -1)
+      : exit_code(exit_code_in), signal(0), core_dumped(false) {}
+  int exit_code;
+  int signal;
+  bool core_dumped;
+};
+
+// Decodes a status as returned by waitpid.  On Windows, 'wait_status' is the exit code.
+ExitStatus DecodeWaitStatus(int wait_status);
+
+// The exit code seen by the VaultManager when a vault returns ErrorToInt(error) from main; i.e. its
+// low 8 bits on POSIX systems.  Distinct errors can therefore share an exit code.
+int ExitCode(const maidsafe_error& error);
+
+// Why a vault exited.  'Stopped' exits were asked for by the VaultManager, and 'Terminated' ones
+// forced by it (e.g. after a timeout or missed heartbeats).  'Crashed' covers fatal signals such as
+// SIGSEGV and any exit which dumped core, and 'Killed' every other signal.  'OutOfMemory',
+// 'DiskFull' and 'BadConfig' are recognised from an OOM kill or from the maidsafe error code the
+// vault exited with (see ExitCode), and 'Failed' covers any other non-zero exit.
+DEFINE_OSTREAMABLE_ENUM_VALUES(ExitClass, int32_t,
+    (Stopped)
+    (Clean)
+    (Crashed)
+    (Killed)
+    (Terminated)
+    (OutOfMemory)
+    (DiskFull)
+    (BadConfig)
+    (Failed))
+
+// What to do about an unexpected exit.  Every exit counts towards crash-loop quarantine (see
+// RecordUnexpectedExit); 'kRestartNow' only skips the backoff delay.
+enum class RestartAction { kRestartNow, kRestartAfterBackoff, kAwaitDiskSpace };
+
+// 'terminated' is true if the VaultManager killed the vault itself, 'oom_killed' if the kernel's
+// OOM killer is known to have killed it, and 'connected' if the vault had connected to the
+// VaultManager before exiting; only a vault which fails as it starts up is deemed to have a bad
+// configuration.
+ExitClass ClassifyExit(const ExitStatus& exit_status, bool terminated, bool oom_killed,
+                       bool connected);
+
+// The per-class restart policy.  Restarting helps after a crash or an unexplained failure, but not
+// while the disk is full.  A single bad configuration is still retried after the usual backoff,
+// since it is only inferred from the low 8 bits of the vault's exit code on POSIX systems and so
+// can't rule out a transient failure; only a run of them gives up on the vault (see
+// RecordUnexpectedExit).
+RestartAction GetRestartAction(ExitClass exit_class);
+
+// Reads the "oom_kill" count from the contents of a cgroup's memory.events file or of
+// /proc/vmstat.  Returns false if it isn't present.
+bool ParseOomKills(const std::string& contents, uint64_t& oom_kills);
+
+// The number of processes killed by the host's OOM killer since boot, or 0 if unknown.
+uint64_t ReadHostOomKills();
+
+// One entry of a vault's exit history.
+struct ExitRecord {
+  ExitRecord() : time(), exit_class(ExitClass::kStopped), exit_status() {}
+  ExitRecord(std::chrono::system_clock::time_point time_in, ExitClass exit_class_in,
+             ExitStatus exit_status_in)
+      : time(time_in), exit_class(exit_class_in), exit_status(exit_status_in) {}
+  std::chrono::system_clock::time_point time;
+  ExitClass exit_class;
+  ExitStatus exit_status;
+};
+
+}  // namespace vault_manager
+
+}  // namespace maidsafe
+
+#endif  // MAIDSAFE_VAULT_MANAGER_EXIT_CLASSIFICATION_H_
@@ -0,0 +1,97 @@
+/*  Copyright 2014 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+
+#include "maidsafe/vault_manager/handover.h"
+
+#include <string>
+
+#include "boost/filesystem/operations.hpp"
+
+#include "maidsafe/common/error.h"
+#include "maidsafe/common/log.h"
+#include "maidsafe/common/utils.h"
+
+#include "maidsafe/vault_manager/vault_info.pb.h"
+
+namespace fs = boost::filesystem;
+
+namespace maidsafe {
+
+namespace vault_manager {
+
+void WriteHandoverFile(const fs::path& handover_file, const Handover& handover) {
+  protobuf::Handover message;
+  message.set_listening_port(handover.listening_port);
+  for (const auto& vault : handover.vaults) {
+    auto attached_vault(message.add_attached_vault());
+    attached_vault->set_label(vault.label.string());
+    attached_vault->set_process_id(vault.process_id);
+    attached_vault->set_executable(vault.executable.string());
+    attached_vault->set_uptime(vault.uptime.count());
+    attached_vault->set_start_token(vault.start_token);
+    attached_vault->set_output_descriptor(vault.output_descriptor);
+  }
+  for (const auto& process_id : handover.terminated_process_ids)
+    message.add_terminated_process_id(process_id);
+  const fs::path kTempFile(handover_file.string() + ".tmp");
+  if (!WriteFile(kTempFile, message.SerializeAsString())) {
+    LOG(kError) << "Failed to write handover file " << kTempFile;
+    BOOST_THROW_EXCEPTION(MakeError(CommonErrors::filesystem_io_error));
+  }
+  boost::system::error_code error_code;
+  fs::rename(kTempFile, handover_file, error_code);
+  if (error_code) {
+    LOG(kError) << "Failed to rename " << kTempFile << " to " << handover_file << ": "
+                << error_code.message();
+    BOOST_THROW_EXCEPTION(MakeError(CommonErrors::filesystem_io_error));
+  }
+}
+
+Handover ReadHandoverFile(const fs::path& handover_file) {
+  protobuf::Handover message;
+  if (!message.ParseFromString(ReadFile(handover_file).string())) {
+    LOG(kError) << "Failed to parse handover file " << handover_file;
+    BOOST_THROW_EXCEPTION(MakeError(CommonErrors::parsing_error));
+  }
+  boost::system::error_code error_code;
+  if (!fs::remove(handover_file, error_code) || error_code) {
+    LOG(kWarning) << "Failed to remove handover file " << handover_file << ": "
+                  << error_code.message();
+  }
+
+  Handover handover;
+  handover.listening_port = static_cast<tcp::Port>(message.listening_port());
+  for (int i(0); i != message.attached_vault_size(); ++i) {
+    const auto& attached_vault(message.attached_vault(i));
+    handover.vaults.emplace_back();
+    handover.vaults.back().label = NonEmptyString{ attached_vault.label() };
+    handover.vaults.back().process_id = attached_vault.process_id();
+    handover.vaults.back().executable = attached_vault.executable();
+    handover.vaults.back().uptime = std::chrono::milliseconds(attached_vault.uptime());
+    handover.vaults.back().start_token = attached_vault.start_token();
+    handover.vaults.back().output_descriptor = attached_vault.output_descriptor();
+  }
+  for (int i(0); i != message.terminated_process_id_size(); ++i)
+    handover.terminated_process_ids.push_back(message.terminated_process_id(i));
+  return handover;
+}
+
+}  // namespace vault_manager
+
+}  // namespace maidsafe
@@ -0,0 +1,74 @@
+/*  Copyright 2014 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+
+#ifndef MAIDSAFE_VAULT_MANAGER_HANDOVER_H_
+#define MAIDSAFE_VAULT_MANAGER_HANDOVER_H_
+
+#include <chrono>
+#include <vector>
+
+#include "boost/filesystem/path.hpp"
+
+#include "maidsafe/common/types.h"
+#include "maidsafe/common/tcp/connection.h"
+
+namespace maidsafe {
+
+namespace vault_manager {
+
+// A vault left running by a VaultManager which re-executed itself or crashed.  'uptime' is how long
+// the vault had been running, so that its restart history is treated the same as if it had never
+// detached.  'start_token' is the process's start time as recorded by the kernel (see
+// ParseProcStartTime), which guards against adopting an unrelated process which has since been
+// given the same ID.  It's 0 where unavailable.  'output_descriptor' is the read end of the pipe
+// carrying the vault's stdout and stderr (see VaultOutput), left open across the exec, or -1.
+struct AttachedVault {
+  AttachedVault()
+      : label(), process_id(0), executable(), uptime(0), start_token(0), output_descriptor(-1) {}
+  NonEmptyString label;
+  uint64_t process_id;
+  boost::filesystem::path executable;
+  std::chrono::milliseconds uptime;
+  uint64_t start_token;
+  int output_descriptor;
+};
+
+// What a VaultManager passes to its re-executed successor, or keeps up to date in its runtime state
+// file in case it crashes.  Vaults keep trying to reconnect to 'listening_port', so the successor
+// must listen there too.  'terminated_process_ids' are vaults terminated during the handover which
+// hadn't yet exited; the successor inherits them as children, so must reap them.
+struct Handover {
+  Handover() : listening_port(0), vaults(), terminated_process_ids() {}
+  tcp::Port listening_port;
+  std::vector<AttachedVault> vaults;
+  std::vector<uint64_t> terminated_process_ids;
+};
+
+// Writes to a temporary file which is then renamed into place, so that a crash part way through
+// can't leave a truncated file behind.
+void WriteHandoverFile(const boost::filesystem::path& handover_file, const Handover& handover);
+
+// Removes the file once read, so that a later restart can't re-attach vaults which are long gone.
+Handover ReadHandoverFile(const boost::filesystem::path& handover_file);
+
+}  // namespace vault_manager
+
+}  // namespace maidsafe
+
+#endif  // MAIDSAFE_VAULT_MANAGER_HANDOVER_H_
@@ -0,0 +1,184 @@
+/*  Copyright 2014 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include "maidsafe/vault_manager/in_process_host.h"
+
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+#include "boost/exception/diagnostic_information.hpp"
+
+#include "maidsafe/common/error.h"
+#include "maidsafe/common/log.h"
+#include "maidsafe/common/on_scope_exit.h"
+
+#include "maidsafe/vault_manager/config.h"
+#include "maidsafe/vault_manager/vault_interface.h"
+
+namespace maidsafe {
+
+namespace vault_manager {
+
+// Above the range of process IDs on every supported platform (Windows' are 32-bit).
+const InProcessHost::InstanceId InProcessHost::kFirstInstanceId(1ULL << 32);
+
+InProcessHost::InProcessHost(boost::asio::io_service& io_service, tcp::Port vault_manager_port,
+                             VaultMain vault_main, OnExitFunctor on_exit)
+    : kVaultManagerPort_(vault_manager_port),
+      kVaultMain_(std::move(vault_main)),
+      state_(std::make_shared<State>(io_service, std::move(on_exit))) {
+  if (!kVaultMain_ || !state_->on_exit)
+    BOOST_THROW_EXCEPTION(MakeError(CommonErrors::invalid_parameter));
+}
+
+InProcessHost::~InProcessHost() {
+  std::vector<std::thread> finished, abandoned;
+  {
+    std::unique_lock<std::mutex> lock{ state_->mutex };
+    state_->io_service = nullptr;
+    for (auto& entry : state_->instances) {
+      entry.second->stop_requested = true;
+      if (entry.second->vault_interface)
+        entry.second->vault_interface->Stop();
+    }
+    state_->cond_var.wait_for(lock, kVaultStopTimeout, [this] {
+      return std::none_of(std::begin(state_->instances), std::end(state_->instances),
+          [](const std::pair<const InstanceId, std::shared_ptr<Instance>>& entry) {
+            return entry.second->running;
+          });
+    });
+    for (auto& entry : state_->instances) {
+      if (entry.second->running)
+        abandoned.push_back(std::move(entry.second->thread));
+      else
+        finished.push_back(std::move(entry.second->thread));
+    }
+    state_->instances.clear();
+  }
+  for (auto& thread : finished)
+    thread.join();
+  if (!abandoned.empty()) {
+    LOG(kError) << "Abandoning " << abandoned.size() << " in-process vaults which failed to stop.";
+    for (auto& thread : abandoned)
+      thread.detach();
+  }
+}
+
+void InProcessHost::Start(InstanceId instance_id) {
+  if (!IsInstanceId(instance_id)) {
+    LOG(kError) << instance_id << " isn't an instance ID.";
+    BOOST_THROW_EXCEPTION(MakeError(CommonErrors::invalid_parameter));
+  }
+  auto instance(std::make_shared<Instance>());
+  std::lock_guard<std::mutex> lock{ state_->mutex };
+  if (state_->instances.count(instance_id) != 0U) {
+    LOG(kError) << "In-process vault " << instance_id << " is already running.";
+    BOOST_THROW_EXCEPTION(MakeError(CommonErrors::already_initialised));
+  }
+  // The thread can't report its exit until the instance has been added, since that needs the lock.
+  instance->thread = std::thread(&InProcessHost::Run, state_, instance, instance_id,
+                                 kVaultManagerPort_, kVaultMain_);
+  state_->instances.emplace(instance_id, instance);
+  LOG(kVerbose) << "Started in-process vault " << instance_id;
+}
+
+void InProcessHost::Stop(InstanceId instance_id) {
+  std::lock_guard<std::mutex> lock{ state_->mutex };
+  auto itr(state_->instances.find(instance_id));
+  if (itr == std::end(state_->instances) || !itr->second->running)
+    return;
+  itr->second->stop_requested = true;
+  if (itr->second->vault_interface)
+    itr->second->vault_interface->Stop();
+}
+
+bool InProcessHost::IsRunning(InstanceId instance_id) const {
+  std::lock_guard<std::mutex> lock{ state_->mutex };
+  auto itr(state_->instances.find(instance_id));
+  return itr != std::end(state_->instances) && itr->second->running;
+}
+
+size_t InProcessHost::RunningCount() const {
+  std::lock_guard<std::mutex> lock{ state_->mutex };
+  return static_cast<size_t>(std::count_if(std::begin(state_->instances),
+      std::end(state_->instances),
+      [](const std::pair<const InstanceId, std::shared_ptr<Instance>>& entry) {
+        return entry.second->running;
+      }));
+}
+
+void InProcessHost::Run(std::shared_ptr<State> state, std::shared_ptr<Instance> instance,
+                        InstanceId instance_id, tcp::Port vault_manager_port,
+                        VaultMain vault_main) {
+  int exit_code(0);
+  try {
+    VaultInterface vault_interface{ vault_manager_port, instance_id };
+    {
+      std::lock_guard<std::mutex> lock{ state->mutex };
+      instance->vault_interface = &vault_interface;
+      if (instance->stop_requested)
+        vault_interface.Stop();
+    }
+    on_scope_exit clear_vault_interface{ [&] {
+      std::lock_guard<std::mutex> lock{ state->mutex };
+      instance->vault_interface = nullptr;
+    } };
+    exit_code = vault_main(vault_interface);
+  }
+  catch (const maidsafe_error& error) {
+    LOG(kError) << "In-process vault " << instance_id << " failed: "
+                << boost::diagnostic_information(error);
+    exit_code = ErrorToInt(error);
+  }
+  catch (const std::exception& e) {
+    LOG(kError) << "In-process vault " << instance_id << " failed: "
+                << boost::diagnostic_information(e);
+    exit_code = ErrorToInt(MakeError(CommonErrors::unknown));
+  }
+
+  std::lock_guard<std::mutex> lock{ state->mutex };
+  instance->running = false;
+  state->cond_var.notify_all();
+  if (state->io_service) {
+    state->io_service->post([state, instance_id, exit_code] {
+      Reap(state, instance_id, exit_code);
+    });
+  }
+}
+
+void InProcessHost::Reap(std::shared_ptr<State> state, InstanceId instance_id, int exit_code) {
+  std::thread thread;
+  {
+    std::lock_guard<std::mutex> lock{ state->mutex };
+    auto itr(state->instances.find(instance_id));
+    // Missing if the host has since been destroyed.
+    if (itr == std::end(state->instances))
+      return;
+    thread = std::move(itr->second->thread);
+    state->instances.erase(itr);
+  }
+  // The thread only has to release the lock to finish.
+  thread.join();
+  LOG(kInfo) << "In-process vault " << instance_id << " exited with code " << exit_code;
+  state->on_exit(instance_id, exit_code);
+}
+
+}  // namespace vault_manager
+
+}  // namespace maidsafe
@@ -0,0 +1,117 @@
+/*  Copyright 2014 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#ifndef MAIDSAFE_VAULT_MANAGER_IN_PROCESS_HOST_H_
+#define MAIDSAFE_VAULT_MANAGER_IN_PROCESS_HOST_H_
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+#include "boost/asio/io_service.hpp"
+
+#include "maidsafe/common/tcp/connection.h"
+
+namespace maidsafe {
+
+namespace vault_manager {
+
+class VaultInterface;
+
+// Runs vaults as threads of the current process, which is a vault host launched and supervised by
+// the VaultManager (see VaultHost), for hosts where the memory overhead of a process per vault
+// limits how many can be run.  Each instance still connects to the VaultManager on
+// 'vault_manager_port' via its own VaultInterface, so the VaultManager handles it exactly as it
+// would a vault process.  Instances are identified by IDs beyond the range of real process IDs,
+// which the VaultManager assigns.
+//
+// The saving comes at the cost of isolation: an instance which crashes takes every other instance
+// in the host down with it (though not the VaultManager), and one which hangs can't be killed, only
+// asked to stop.
+//
+// 'vault_main' is run on each instance's thread, and its return value is the instance's exit code.
+// An exception escaping it is converted to an exit code via ErrorToInt.  'on_exit' is posted to
+// 'io_service' once an instance's thread has finished.  The public functions are thread-safe.
+class InProcessHost {
+ public:
+  typedef uint64_t InstanceId;
+  typedef std::function<int(VaultInterface&)> VaultMain;
+  typedef std::function<void(InstanceId, int)> OnExitFunctor;
+
+  // Throws if either functor is empty.
+  InProcessHost(boost::asio::io_service& io_service, tcp::Port vault_manager_port,
+                VaultMain vault_main, OnExitFunctor on_exit);
+  InProcessHost(const InProcessHost&) = delete;
+  InProcessHost(InProcessHost&&) = delete;
+  InProcessHost& operator=(InProcessHost) = delete;
+  // Stops every instance, allowing them up to kVaultStopTimeout to finish.  Any still running after
+  // that are abandoned.  'on_exit' isn't invoked for instances stopped this way.
+  ~InProcessHost();
+
+  // Throws if 'instance_id' isn't an instance ID, or is already in use.
+  void Start(InstanceId instance_id);
+  // Asks the instance to stop, as if the VaultManager had sent it VaultShutdownRequest.  Does
+  // nothing if the instance has already finished.
+  void Stop(InstanceId instance_id);
+  bool IsRunning(InstanceId instance_id) const;
+  size_t RunningCount() const;
+
+  static bool IsInstanceId(uint64_t id) { return id >= kFirstInstanceId; }
+
+  static const InstanceId kFirstInstanceId;
+
+ private:
+  struct Instance {
+    Instance() : vault_interface(nullptr), stop_requested(false), running(true), thread() {}
+    // Set while 'vault_main' is running.
+    VaultInterface* vault_interface;
+    bool stop_requested, running;
+    std::thread thread;
+  };
+  // Shared with the instance threads, since these can outlive the host if abandoned.
+  struct State {
+    State(boost::asio::io_service& io_service_in, OnExitFunctor on_exit_in)
+        : mutex(), cond_var(), io_service(&io_service_in), on_exit(std::move(on_exit_in)),
+          instances() {}
+    std::mutex mutex;
+    std::condition_variable cond_var;
+    // Null once the host has been destroyed.
+    boost::asio::io_service* io_service;
+    OnExitFunctor on_exit;
+    std::map<InstanceId, std::shared_ptr<Instance>> instances;
+  };
+
+  static void Run(std::shared_ptr<State> state, std::shared_ptr<Instance> instance,
+                  InstanceId instance_id, tcp::Port vault_manager_port, VaultMain vault_main);
+  static void Reap(std::shared_ptr<State> state, InstanceId instance_id, int exit_code);
+
+  const tcp::Port kVaultManagerPort_;
+  const VaultMain kVaultMain_;
+  std::shared_ptr<State> state_;
+};
+
+}  // namespace vault_manager
+
+}  // namespace maidsafe
+
+#endif  // MAIDSAFE_VAULT_MANAGER_IN_PROCESS_HOST_H_
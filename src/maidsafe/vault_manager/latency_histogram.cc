@@ -0,0 +1,121 @@
+/*  Copyright 2014 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include "maidsafe/vault_manager/latency_histogram.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "maidsafe/common/error.h"
+#include "maidsafe/common/log.h"
+
+namespace maidsafe {
+
+namespace vault_manager {
+
+const size_t LatencyHistogram::kSubBuckets;
+const size_t LatencyHistogram::kBucketCount;
+
+LatencyHistogram::LatencyHistogram() : buckets_(), count_(0), max_(0) {
+  for (auto& bucket : buckets_)
+    bucket.store(0, std::memory_order_relaxed);
+}
+
+void LatencyHistogram::Record(std::chrono::steady_clock::duration duration) {
+  auto microseconds(std::chrono::duration_cast<std::chrono::microseconds>(duration).count());
+  uint64_t value(microseconds < 0 ? 0 : static_cast<uint64_t>(microseconds));
+  buckets_[BucketIndex(value)].fetch_add(1, std::memory_order_relaxed);
+  count_.fetch_add(1, std::memory_order_relaxed);
+  uint64_t max(max_.load(std::memory_order_relaxed));
+  while (value > max && !max_.compare_exchange_weak(max, value, std::memory_order_relaxed)) {}
+}
+
+std::chrono::microseconds LatencyHistogram::Percentile(double quantile) const {
+  if (quantile < 0.0 || quantile > 1.0)
+    BOOST_THROW_EXCEPTION(MakeError(CommonErrors::invalid_parameter));
+  // Recording may continue while we read, so work from a snapshot of the buckets.
+  std::array<uint64_t, kBucketCount> snapshot;
+  uint64_t total(0);
+  for (size_t i(0); i < kBucketCount; ++i) {
+    snapshot[i] = buckets_[i].load(std::memory_order_relaxed);
+    total += snapshot[i];
+  }
+  if (total == 0)
+    return std::chrono::microseconds(0);
+
+  uint64_t rank(std::max<uint64_t>(1, static_cast<uint64_t>(std::ceil(quantile * total))));
+  uint64_t cumulative(0);
+  size_t index(0);
+  for (; index < kBucketCount - 1; ++index) {
+    cumulative += snapshot[index];
+    if (cumulative >= rank)
+      break;
+  }
+  return std::chrono::microseconds(std::min(BucketUpperBound(index),
+                                            max_.load(std::memory_order_relaxed)));
+}
+
+std::chrono::microseconds LatencyHistogram::Max() const {
+  return std::chrono::microseconds(max_.load(std::memory_order_relaxed));
+}
+
+size_t LatencyHistogram::BucketIndex(uint64_t microseconds) {
+  // Values below kSubBuckets each get a bucket of their own.
+  if (microseconds < kSubBuckets)
+    return static_cast<size_t>(microseconds);
+  size_t most_significant_bit(0);
+  for (uint64_t value(microseconds); value > 1; value >>= 1)
+    ++most_significant_bit;
+  // The three bits below the most significant select the sub-bucket.
+  size_t sub_bucket((microseconds >> (most_significant_bit - 3)) & (kSubBuckets - 1));
+  return std::min((most_significant_bit - 2) * kSubBuckets + sub_bucket, kBucketCount - 1);
+}
+
+uint64_t LatencyHistogram::BucketUpperBound(size_t index) {
+  if (index < kSubBuckets)
+    return index;
+  size_t most_significant_bit(index / kSubBuckets + 2);
+  uint64_t sub_bucket(index % kSubBuckets);
+  uint64_t width(uint64_t{ 1 } << (most_significant_bit - 3));
+  return ((kSubBuckets + sub_bucket) << (most_significant_bit - 3)) + width - 1;
+}
+
+void LifecycleHistograms::Record(LifecyclePhase phase,
+                                 std::chrono::steady_clock::duration duration) {
+  histograms_[static_cast<size_t>(phase)].Record(duration);
+}
+
+std::vector<PhaseLatency> LifecycleHistograms::Summarise() const {
+  std::vector<PhaseLatency> summary;
+  summary.reserve(kLifecyclePhaseCount);
+  for (size_t i(0); i < kLifecyclePhaseCount; ++i) {
+    PhaseLatency latency;
+    latency.phase = static_cast<LifecyclePhase>(i);
+    latency.count = histograms_[i].Count();
+    latency.p50 = histograms_[i].Percentile(0.5);
+    latency.p90 = histograms_[i].Percentile(0.9);
+    latency.p99 = histograms_[i].Percentile(0.99);
+    latency.max = histograms_[i].Max();
+    summary.push_back(latency);
+  }
+  return summary;
+}
+
+}  // namespace vault_manager
+
+}  // namespace maidsafe
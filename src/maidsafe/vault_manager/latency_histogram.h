@@ -0,0 +1,79 @@
+/*  Copyright 2014 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#ifndef MAIDSAFE_VAULT_MANAGER_LATENCY_HISTOGRAM_H_
+#define MAIDSAFE_VAULT_MANAGER_LATENCY_HISTOGRAM_H_
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "maidsafe/vault_manager/lifecycle_latency.h"
+
+namespace maidsafe {
+
+namespace vault_manager {
+
+// A histogram of durations which can be recorded and read concurrently without locking.  Durations
+// are held in microseconds.  Each power of two is split into kSubBuckets linear buckets, so every
+// bucket is at most 12.5% wide relative to its lower bound.  Durations beyond 2^41 us (25 days)
+// share the last bucket.
+class LatencyHistogram {
+ public:
+  static const size_t kSubBuckets = 8;
+  static const size_t kBucketCount = 39 * kSubBuckets;
+
+  LatencyHistogram();
+  LatencyHistogram(const LatencyHistogram&) = delete;
+  LatencyHistogram& operator=(const LatencyHistogram&) = delete;
+
+  void Record(std::chrono::steady_clock::duration duration);
+  // 'quantile' must lie in [0, 1].  Returns the upper bound of the bucket holding the quantile,
+  // capped at the largest duration recorded, or zero if nothing has been recorded.
+  std::chrono::microseconds Percentile(double quantile) const;
+  uint64_t Count() const { return count_.load(std::memory_order_relaxed); }
+  std::chrono::microseconds Max() const;
+
+  static size_t BucketIndex(uint64_t microseconds);
+  static uint64_t BucketUpperBound(size_t index);
+
+ private:
+  std::array<std::atomic<uint64_t>, kBucketCount> buckets_;
+  std::atomic<uint64_t> count_, max_;
+};
+
+// One histogram per LifecyclePhase.
+class LifecycleHistograms {
+ public:
+  LifecycleHistograms() : histograms_() {}
+  void Record(LifecyclePhase phase, std::chrono::steady_clock::duration duration);
+  // Returns the count, p50, p90, p99 and max of every phase, in LifecyclePhase order.
+  std::vector<PhaseLatency> Summarise() const;
+
+ private:
+  std::array<LatencyHistogram, kLifecyclePhaseCount> histograms_;
+};
+
+}  // namespace vault_manager
+
+}  // namespace maidsafe
+
+#endif  // MAIDSAFE_VAULT_MANAGER_LATENCY_HISTOGRAM_H_
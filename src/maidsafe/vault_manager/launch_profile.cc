@@ -0,0 +1,194 @@
+/*  Copyright 2014 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include "maidsafe/vault_manager/launch_profile.h"
+
+#ifdef MAIDSAFE_LINUX
+#include <sys/resource.h>
+#include <sys/types.h>
+#endif
+
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <sstream>
+#include <utility>
+
+#include "maidsafe/common/error.h"
+#include "maidsafe/common/log.h"
+
+#ifdef MAIDSAFE_WIN32
+#define environ _environ
+#else
+extern "C" char **environ;
+#endif
+
+namespace maidsafe {
+
+namespace vault_manager {
+
+namespace {
+
+std::string Trim(const std::string& text) {
+  const char* const kWhitespace(" \t\r");
+  const auto kBegin(text.find_first_not_of(kWhitespace));
+  if (kBegin == std::string::npos)
+    return std::string();
+  return text.substr(kBegin, text.find_last_not_of(kWhitespace) - kBegin + 1);
+}
+
+void ThrowParsingError(int line_number, const std::string& reason) {
+  LOG(kError) << "Invalid launch profile at line " << line_number << ": " << reason;
+  BOOST_THROW_EXCEPTION(MakeError(CommonErrors::parsing_error));
+}
+
+int64_t ParseLimit(const std::string& value, int line_number) {
+  if (value == "unlimited")
+    return LaunchProfile::kUnlimited;
+  char* end(nullptr);
+  errno = 0;
+  const long long kLimit(std::strtoll(value.c_str(), &end, 10));  // NOLINT (Fraser)
+  if (value.empty() || *end != '\0' || errno != 0 || kLimit < 0)
+    ThrowParsingError(line_number, "\"" + value + "\" isn't a limit");
+  return static_cast<int64_t>(kLimit);
+}
+
+#ifdef MAIDSAFE_LINUX
+bool SetLimit(pid_t process_id, int resource, const char* const name, int64_t limit) {
+  if (limit == LaunchProfile::kInheritLimit)
+    return true;
+  rlimit new_limit;
+  new_limit.rlim_cur = new_limit.rlim_max =
+      (limit == LaunchProfile::kUnlimited ? RLIM_INFINITY : static_cast<rlim_t>(limit));
+  // Raising the hard limit needs CAP_SYS_RESOURCE, so fall back to raising just the soft one.
+  if (prlimit(process_id, resource, &new_limit, nullptr) == 0)
+    return true;
+  rlimit old_limit;
+  if (errno == EPERM && prlimit(process_id, resource, nullptr, &old_limit) == 0) {
+    new_limit.rlim_max = old_limit.rlim_max;
+    if (new_limit.rlim_cur <= new_limit.rlim_max &&
+        prlimit(process_id, resource, &new_limit, nullptr) == 0) {
+      return true;
+    }
+  }
+  LOG(kWarning) << "Failed to set " << name << " of process " << process_id << " to " << limit
+                << ": " << std::strerror(errno);
+  return false;
+}
+#endif
+
+}  // unnamed namespace
+
+const int64_t LaunchProfile::kInheritLimit(-1);
+const int64_t LaunchProfile::kUnlimited(std::numeric_limits<int64_t>::max());
+
+LaunchProfile::LaunchProfile()
+    : preload(), environment(), max_open_files(kInheritLimit), max_core_size(kInheritLimit),
+      args() {}
+
+std::map<std::string, LaunchProfile> ParseLaunchProfiles(const std::string& contents) {
+  std::map<std::string, LaunchProfile> profiles;
+  LaunchProfile* profile(nullptr);
+  std::istringstream stream(contents);
+  std::string line;
+  int line_number(0);
+  while (std::getline(stream, line)) {
+    ++line_number;
+    line = Trim(line);
+    if (line.empty() || line[0] == '#')
+      continue;
+    if (line[0] == '[') {
+      if (line.size() < 3 || line.back() != ']')
+        ThrowParsingError(line_number, "expected \"[<profile name>]\"");
+      const std::string kName(Trim(line.substr(1, line.size() - 2)));
+      if (kName.empty())
+        ThrowParsingError(line_number, "empty profile name");
+      auto result(profiles.insert(std::make_pair(kName, LaunchProfile())));
+      if (!result.second)
+        ThrowParsingError(line_number, "profile \"" + kName + "\" is defined twice");
+      profile = &result.first->second;
+      continue;
+    }
+
+    const auto kEquals(line.find('='));
+    if (kEquals == std::string::npos)
+      ThrowParsingError(line_number, "expected \"<key> = <value>\"");
+    if (!profile)
+      ThrowParsingError(line_number, "setting outside a profile");
+    const std::string kKey(Trim(line.substr(0, kEquals)));
+    const std::string kValue(Trim(line.substr(kEquals + 1)));
+    if (kKey == "preload") {
+      profile->preload = kValue;
+    } else if (kKey == "environment") {
+      const auto kVariableEquals(kValue.find('='));
+      if (kVariableEquals == 0 || kVariableEquals == std::string::npos)
+        ThrowParsingError(line_number, "expected \"environment = <name>=<value>\"");
+      profile->environment[kValue.substr(0, kVariableEquals)] = kValue.substr(kVariableEquals + 1);
+    } else if (kKey == "max_open_files") {
+      profile->max_open_files = ParseLimit(kValue, line_number);
+    } else if (kKey == "max_core_size") {
+      profile->max_core_size = ParseLimit(kValue, line_number);
+    } else if (kKey == "arg") {
+      if (kValue.empty())
+        ThrowParsingError(line_number, "empty arg");
+      profile->args.push_back(kValue);
+    } else {
+      ThrowParsingError(line_number, "unknown key \"" + kKey + "\"");
+    }
+  }
+  return profiles;
+}
+
+std::vector<std::string> MakeEnvironment(const LaunchProfile& profile) {
+  std::map<std::string, std::string> variables;
+  for (char** variable(environ); variable && *variable; ++variable) {
+    const char* const kEquals(std::strchr(*variable, '='));
+    if (kEquals)
+      variables[std::string(*variable, kEquals)] = kEquals + 1;
+  }
+  for (const auto& variable : profile.environment)
+    variables[variable.first] = variable.second;
+  if (!profile.preload.empty()) {
+    std::string& preload(variables["LD_PRELOAD"]);
+    preload = preload.empty() ? profile.preload : profile.preload + ':' + preload;
+  }
+
+  std::vector<std::string> environment;
+  environment.reserve(variables.size());
+  for (const auto& variable : variables)
+    environment.push_back(variable.first + '=' + variable.second);
+  return environment;
+}
+
+bool ApplyLaunchLimits(uint64_t process_id, const LaunchProfile& profile) {
+#ifdef MAIDSAFE_LINUX
+  bool applied(SetLimit(static_cast<pid_t>(process_id), RLIMIT_NOFILE, "RLIMIT_NOFILE",
+                        profile.max_open_files));
+  return SetLimit(static_cast<pid_t>(process_id), RLIMIT_CORE, "RLIMIT_CORE",
+                  profile.max_core_size) && applied;
+#else
+  static_cast<void>(process_id);
+  return profile.max_open_files == LaunchProfile::kInheritLimit &&
+         profile.max_core_size == LaunchProfile::kInheritLimit;
+#endif
+}
+
+}  // namespace vault_manager
+
+}  // namespace maidsafe
@@ -0,0 +1,76 @@
+/*  Copyright 2014 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#ifndef MAIDSAFE_VAULT_MANAGER_LAUNCH_PROFILE_H_
+#define MAIDSAFE_VAULT_MANAGER_LAUNCH_PROFILE_H_
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace maidsafe {
+
+namespace vault_manager {
+
+// Settings applied to a vault's process as it's launched, so that vaults can be tuned per host
+// without rebuilding anything, e.g. to preload a different allocator.  The profiles are defined in
+// a file read by the VaultManager at startup (see ParseLaunchProfiles), and each vault refers to
+// its profile by name.
+struct LaunchProfile {
+  // Leaves the VaultManager's own limit in place.
+  static const int64_t kInheritLimit;
+  // RLIM_INFINITY.
+  static const int64_t kUnlimited;
+
+  LaunchProfile();
+  // Prepended to LD_PRELOAD, e.g. "/usr/lib/x86_64-linux-gnu/libjemalloc.so.2".
+  std::string preload;
+  // Set in the vault's environment, replacing any value inherited from the VaultManager, e.g.
+  // MALLOC_ARENA_MAX=2.
+  std::map<std::string, std::string> environment;
+  // RLIMIT_NOFILE, and RLIMIT_CORE in bytes.
+  int64_t max_open_files, max_core_size;
+  // Appended to the vault's command line.
+  std::vector<std::string> args;
+};
+
+// Parses profiles of the form below.  Each key is optional, and 'environment' and 'arg' can be
+// repeated.  Blank lines and lines starting with '#' are ignored.  Throws if 'contents' is
+// malformed or names a profile twice.
+//
+//   [jemalloc]
+//   preload = /usr/lib/x86_64-linux-gnu/libjemalloc.so.2
+//   environment = MALLOC_CONF=background_thread:true
+//   max_open_files = 65536
+//   max_core_size = unlimited
+//   arg = --some_flag
+std::map<std::string, LaunchProfile> ParseLaunchProfiles(const std::string& contents);
+
+// Returns the VaultManager's environment as "NAME=VALUE" entries, with 'profile' applied.
+std::vector<std::string> MakeEnvironment(const LaunchProfile& profile);
+
+// Sets the process's RLIMIT_NOFILE and RLIMIT_CORE as required by 'profile'.  Returns false if
+// either couldn't be set (always on non-Linux systems if either is required).
+bool ApplyLaunchLimits(uint64_t process_id, const LaunchProfile& profile);
+
+}  // namespace vault_manager
+
+}  // namespace maidsafe
+
+#endif  // MAIDSAFE_VAULT_MANAGER_LAUNCH_PROFILE_H_
@@ -30,7 +30,9 @@ namespace maidsafe {
 namespace vault_manager {
 
 NewConnections::NewConnections(boost::asio::io_service& io_service)
-    : io_service_(io_service), connections_() {}
+    : io_service_(io_service),
+      connections_(),
+      timeout_(TimeoutKind::kNewConnection, kRpcTimeout, kRpcTimeoutFloor, kRpcTimeoutCeiling) {}
 
 std::shared_ptr<NewConnections> NewConnections::MakeShared(boost::asio::io_service& io_service) {
   return std::shared_ptr<NewConnections>{ new NewConnections{ io_service } };
@@ -41,20 +43,33 @@ NewConnections::~NewConnections() {
 }
 
 void NewConnections::Add(tcp::ConnectionPtr connection) {
-  TimerPtr timer{ std::make_shared<Timer>(io_service_, kRpcTimeout) };
-  timer->async_wait([connection](const boost::system::error_code& error_code) {
+  TimerPtr timer{ std::make_shared<Timer>(io_service_, timeout_.Value()) };
+  std::weak_ptr<NewConnections> this_weak_ptr{ shared_from_this() };
+  timer->async_wait([this_weak_ptr, connection](const boost::system::error_code& error_code) {
     if (error_code && error_code == boost::asio::error::operation_aborted) {
       LOG(kVerbose) << "New connection timer cancelled OK.";
     } else {
       LOG(kWarning) << "Timed out waiting for new connection to identify itself.";
+      if (std::shared_ptr<NewConnections> this_ptr{ this_weak_ptr.lock() })
+        this_ptr->timeout_.OnExpiry();
       connection->Close();
     }
   });
-  bool result{ connections_.emplace(connection, timer).second };
+  bool result{ connections_.emplace(connection,
+      std::make_pair(timer, std::chrono::steady_clock::now())).second };
   assert(result);
   static_cast<void>(result);
 }
 
+bool NewConnections::Identified(tcp::ConnectionPtr connection) {
+  auto itr(connections_.find(connection));
+  if (itr == std::end(connections_))
+    return false;
+  timeout_.Sample(std::chrono::steady_clock::now() - itr->second.second);
+  connections_.erase(itr);
+  return true;
+}
+
 bool NewConnections::Remove(tcp::ConnectionPtr connection) {
   return connections_.erase(connection) == 1U;
 }
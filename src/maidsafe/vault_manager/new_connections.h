@@ -19,13 +19,16 @@
 #ifndef MAIDSAFE_VAULT_MANAGER_NEW_CONNECTIONS_H_
 #define MAIDSAFE_VAULT_MANAGER_NEW_CONNECTIONS_H_
 
+#include <chrono>
 #include <map>
 #include <memory>
+#include <utility>
 
 #include "boost/asio/io_service.hpp"
 
 #include "maidsafe/common/types.h"
 
+#include "maidsafe/vault_manager/adaptive_timeout.h"
 #include "maidsafe/vault_manager/config.h"
 
 namespace maidsafe {
@@ -37,14 +40,19 @@ class NewConnections : public std::enable_shared_from_this<NewConnections> {
   static std::shared_ptr<NewConnections> MakeShared(boost::asio::io_service& io_service);
   ~NewConnections();
   void Add(tcp::ConnectionPtr connection);
+  // Removes a connection which has identified itself, feeding the time it took into the timeout.
+  bool Identified(tcp::ConnectionPtr connection);
   bool Remove(tcp::ConnectionPtr connection);
   void CloseAll();
+  TimeoutMetric GetTimeoutMetric() const { return timeout_.Metric(); }
 
  private:
   explicit NewConnections(boost::asio::io_service& io_service);
 
   boost::asio::io_service& io_service_;
-  std::map<tcp::ConnectionPtr, TimerPtr, std::owner_less<tcp::ConnectionPtr>> connections_;
+  std::map<tcp::ConnectionPtr, std::pair<TimerPtr, std::chrono::steady_clock::time_point>,
+           std::owner_less<tcp::ConnectionPtr>> connections_;
+  AdaptiveTimeout timeout_;
 };
 
 }  // namespace vault_manager
@@ -0,0 +1,237 @@
+/*  Copyright 2014 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include "maidsafe/vault_manager/placement.h"
+
+#ifdef MAIDSAFE_LINUX
+#include <sched.h>
+#include <sys/types.h>
+#endif
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <thread>
+#include <tuple>
+
+#include "boost/algorithm/string/trim.hpp"
+#include "boost/filesystem/operations.hpp"
+#include "boost/tokenizer.hpp"
+
+#include "maidsafe/common/error.h"
+#include "maidsafe/common/log.h"
+
+namespace fs = boost::filesystem;
+
+namespace maidsafe {
+
+namespace vault_manager {
+
+namespace {
+
+int ParseCpu(const std::string& cpu) {
+  char* end(nullptr);
+  long value(std::strtol(cpu.c_str(), &end, 10));  // NOLINT (Fraser)
+  if (cpu.empty() || *end != '\0' || value < 0 || value > 65535) {
+    LOG(kError) << "Invalid CPU number \"" << cpu << '\"';
+    BOOST_THROW_EXCEPTION(MakeError(CommonErrors::parsing_error));
+  }
+  return static_cast<int>(value);
+}
+
+}  // unnamed namespace
+
+std::vector<int> ParseCpuList(const std::string& cpu_list) {
+  std::vector<int> cpus;
+  boost::char_separator<char> separator(",");
+  std::string trimmed(boost::algorithm::trim_copy(cpu_list));
+  boost::tokenizer<boost::char_separator<char>> ranges(trimmed, separator);
+  for (const auto& range : ranges) {
+    auto dash(range.find('-'));
+    int first(ParseCpu(range.substr(0, dash)));
+    int last(dash == std::string::npos ? first : ParseCpu(range.substr(dash + 1)));
+    if (last < first) {
+      LOG(kError) << "Invalid CPU range \"" << range << '\"';
+      BOOST_THROW_EXCEPTION(MakeError(CommonErrors::parsing_error));
+    }
+    for (int cpu(first); cpu <= last; ++cpu)
+      cpus.push_back(cpu);
+  }
+  return cpus;
+}
+
+Topology ReadTopology(const fs::path& node_dir) {
+  Topology topology;
+  boost::system::error_code error_code;
+  fs::directory_iterator itr(node_dir, error_code);
+  for (; !error_code && itr != fs::directory_iterator(); itr.increment(error_code)) {
+    std::string name(itr->path().filename().string());
+    if (name.size() <= 4 || name.compare(0, 4, "node") != 0 ||
+        name.find_first_not_of("0123456789", 4) != std::string::npos) {
+      continue;
+    }
+    std::ifstream cpu_list_file((itr->path() / "cpulist").string());
+    std::string cpu_list;
+    std::getline(cpu_list_file, cpu_list);
+    std::vector<int> cpus(ParseCpuList(cpu_list));
+    if (!cpus.empty())  // Memory-only nodes can't run vaults.
+      topology.emplace_back(std::atoi(name.c_str() + 4), std::move(cpus));
+  }
+  std::sort(std::begin(topology), std::end(topology),
+            [](const NumaNode& lhs, const NumaNode& rhs) { return lhs.id < rhs.id; });
+
+  if (topology.empty()) {
+    std::vector<int> cpus(std::max(1U, std::thread::hardware_concurrency()));
+    for (size_t i(0); i < cpus.size(); ++i)
+      cpus[i] = static_cast<int>(i);
+    topology.emplace_back(0, std::move(cpus));
+  }
+  return topology;
+}
+
+bool PinProcess(uint64_t process_id, const std::vector<int>& cpus) {
+#ifdef MAIDSAFE_LINUX
+  cpu_set_t cpu_set;
+  CPU_ZERO(&cpu_set);
+  for (int cpu : cpus) {
+    if (cpu < 0 || cpu >= CPU_SETSIZE)
+      return false;
+    CPU_SET(cpu, &cpu_set);
+  }
+
+  // sched_setaffinity only applies to a single thread, so set each of the process's threads.
+  std::vector<pid_t> thread_ids;
+  boost::system::error_code error_code;
+  fs::directory_iterator itr(fs::path("/proc") / std::to_string(process_id) / "task", error_code);
+  for (; !error_code && itr != fs::directory_iterator(); itr.increment(error_code))
+    thread_ids.push_back(static_cast<pid_t>(std::atoi(itr->path().filename().c_str())));
+  if (thread_ids.empty())
+    thread_ids.push_back(static_cast<pid_t>(process_id));
+
+  bool pinned(true);
+  for (pid_t thread_id : thread_ids) {
+    if (sched_setaffinity(thread_id, sizeof(cpu_set), &cpu_set) != 0 && errno != ESRCH) {
+      LOG(kWarning) << "Failed to set affinity of thread " << thread_id << " of process "
+                    << process_id << ": " << std::strerror(errno);
+      pinned = false;
+    }
+  }
+  return pinned;
+#else
+  static_cast<void>(process_id);
+  static_cast<void>(cpus);
+  return false;
+#endif
+}
+
+Placement::Placement(const Topology& topology, PlacementPolicy policy)
+    : units_(), assignments_() {
+  if (policy == PlacementPolicy::kSpreadNodes) {
+    for (size_t node(0); node < topology.size(); ++node) {
+      if (!topology[node].cpus.empty())
+        units_.emplace_back(node, topology[node].cpus);
+    }
+  } else if (policy == PlacementPolicy::kSpreadCores) {
+    // Interleaved by node, so that ties are broken by alternating between nodes.
+    for (size_t i(0), added(1); added != 0; ++i) {
+      added = 0;
+      for (size_t node(0); node < topology.size(); ++node) {
+        if (i < topology[node].cpus.size()) {
+          units_.emplace_back(node, std::vector<int>(1, topology[node].cpus[i]));
+          ++added;
+        }
+      }
+    }
+  }
+  if (units_.empty()) {
+    LOG(kError) << "Placement requires a policy and at least one CPU.";
+    BOOST_THROW_EXCEPTION(MakeError(CommonErrors::invalid_parameter));
+  }
+}
+
+std::vector<int> Placement::Assign(const NonEmptyString& label) {
+  Release(label);
+  size_t unit(LeastBusy());
+  units_[unit].vaults.insert(label);
+  assignments_[label] = unit;
+  return units_[unit].cpus;
+}
+
+void Placement::Release(const NonEmptyString& label) {
+  auto itr(assignments_.find(label));
+  if (itr == std::end(assignments_))
+    return;
+  units_[itr->second].vaults.erase(label);
+  assignments_.erase(itr);
+}
+
+std::map<NonEmptyString, std::vector<int>> Placement::Rebalance() {
+  std::map<NonEmptyString, std::vector<int>> moved;
+  for (;;) {
+    size_t busiest(Busiest()), least_busy(LeastBusy());
+    if (units_[busiest].vaults.size() <= units_[least_busy].vaults.size() + 1)
+      return moved;
+    NonEmptyString label{ *units_[busiest].vaults.begin() };
+    units_[busiest].vaults.erase(label);
+    units_[least_busy].vaults.insert(label);
+    assignments_[label] = least_busy;
+    moved[label] = units_[least_busy].cpus;
+  }
+}
+
+std::vector<int> Placement::Cpus(const NonEmptyString& label) const {
+  auto itr(assignments_.find(label));
+  return itr == std::end(assignments_) ? std::vector<int>() : units_[itr->second].cpus;
+}
+
+size_t Placement::LeastBusy() const {
+  size_t least_busy(0);
+  for (size_t unit(1); unit < units_.size(); ++unit) {
+    if (std::make_tuple(units_[unit].vaults.size(), NodeLoad(units_[unit].node)) <
+        std::make_tuple(units_[least_busy].vaults.size(), NodeLoad(units_[least_busy].node))) {
+      least_busy = unit;
+    }
+  }
+  return least_busy;
+}
+
+size_t Placement::Busiest() const {
+  size_t busiest(0);
+  for (size_t unit(1); unit < units_.size(); ++unit) {
+    if (std::make_tuple(units_[unit].vaults.size(), NodeLoad(units_[unit].node)) >
+        std::make_tuple(units_[busiest].vaults.size(), NodeLoad(units_[busiest].node))) {
+      busiest = unit;
+    }
+  }
+  return busiest;
+}
+
+size_t Placement::NodeLoad(size_t node) const {
+  size_t load(0);
+  for (const auto& unit : units_) {
+    if (unit.node == node)
+      load += unit.vaults.size();
+  }
+  return load;
+}
+
+}  // namespace vault_manager
+
+}  // namespace maidsafe
@@ -0,0 +1,98 @@
+/*  Copyright 2014 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#ifndef MAIDSAFE_VAULT_MANAGER_PLACEMENT_H_
+#define MAIDSAFE_VAULT_MANAGER_PLACEMENT_H_
+
+#include <cstdint>
+#include <map>
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "boost/filesystem/path.hpp"
+
+#include "maidsafe/common/types.h"
+
+namespace maidsafe {
+
+namespace vault_manager {
+
+struct NumaNode {
+  NumaNode(int id_in, std::vector<int> cpus_in) : id(id_in), cpus(std::move(cpus_in)) {}
+  int id;
+  std::vector<int> cpus;
+};
+
+typedef std::vector<NumaNode> Topology;
+
+// How vault processes are pinned to CPUs.  'kSpreadNodes' pins each vault to every CPU of the NUMA
+// node with the fewest vaults, and 'kSpreadCores' to the single CPU with the fewest vaults
+// (preferring the least busy node where CPUs are equally busy).
+enum class PlacementPolicy { kNone, kSpreadNodes, kSpreadCores };
+
+// Parses a kernel CPU list such as "0-3,8,10-11".  Throws if 'cpu_list' is malformed.
+std::vector<int> ParseCpuList(const std::string& cpu_list);
+
+// Reads the NUMA nodes with CPUs from 'node_dir' (normally /sys/devices/system/node).  If there are
+// none, e.g. on a kernel without NUMA support, returns a single node holding every CPU.
+Topology ReadTopology(
+    const boost::filesystem::path& node_dir = boost::filesystem::path("/sys/devices/system/node"));
+
+// Restricts every thread of the process to 'cpus'.  Returns false on failure (always on non-Linux
+// systems).
+bool PinProcess(uint64_t process_id, const std::vector<int>& cpus);
+
+// Tracks which CPUs each vault has been assigned under a given policy.  Not thread-safe.
+class Placement {
+ public:
+  // Throws if 'policy' is kNone or 'topology' has no CPUs.
+  Placement(const Topology& topology, PlacementPolicy policy);
+
+  // Assigns the least busy node or CPU, replacing any existing assignment, and returns its CPUs.
+  std::vector<int> Assign(const NonEmptyString& label);
+  void Release(const NonEmptyString& label);
+  // Moves vaults from the busiest nodes or CPUs to the least busy until their vault counts differ
+  // by at most one.  Returns the new CPUs of each vault moved.
+  std::map<NonEmptyString, std::vector<int>> Rebalance();
+  // Returns an empty vector if the vault isn't assigned.
+  std::vector<int> Cpus(const NonEmptyString& label) const;
+
+ private:
+  struct Unit {
+    Unit(size_t node_in, std::vector<int> cpus_in)
+        : node(node_in), cpus(std::move(cpus_in)), vaults() {}
+    size_t node;
+    std::vector<int> cpus;
+    std::set<NonEmptyString> vaults;
+  };
+
+  size_t LeastBusy() const;
+  size_t Busiest() const;
+  size_t NodeLoad(size_t node) const;
+
+  std::vector<Unit> units_;
+  std::map<NonEmptyString, size_t> assignments_;
+};
+
+}  // namespace vault_manager
+
+}  // namespace maidsafe
+
+#endif  // MAIDSAFE_VAULT_MANAGER_PLACEMENT_H_
@@ -19,12 +19,34 @@
 #include "maidsafe/vault_manager/process_manager.h"
 
 #include <algorithm>
+#include <memory>
 #include <type_traits>
+#include <utility>
 
-#ifdef MAIDSAFE_BSD
+#ifndef MAIDSAFE_WIN32
+#include <dirent.h>
+#include <fcntl.h>
+#include <spawn.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <cerrno>
+#include <csignal>
+#include <cstdlib>
+#include <cstring>
+#endif
+#ifdef MAIDSAFE_LINUX
+#include <sys/prctl.h>
+#include <sys/syscall.h>
+#endif
+
+#if defined MAIDSAFE_BSD || defined MAIDSAFE_APPLE
 extern "C" char **environ;
 #endif
 
+#ifdef MAIDSAFE_LINUX
+#include "boost/asio/posix/stream_descriptor.hpp"
+#endif
 #ifdef _MSC_VER
 #pragma warning(push)
 #pragma warning(disable : 4702)
@@ -37,6 +59,10 @@ extern "C" char **environ;
 #include "boost/process/mitigate.hpp"
 #include "boost/process/terminate.hpp"
 #include "boost/process/wait_for_exit.hpp"
+#ifndef MAIDSAFE_WIN32
+#include "boost/system/system_error.hpp"
+#include "boost/tokenizer.hpp"
+#endif
 
 #include "maidsafe/common/log.h"
 #include "maidsafe/common/make_unique.h"
@@ -45,9 +71,15 @@ extern "C" char **environ;
 #include "maidsafe/common/utils.h"
 #include "maidsafe/common/visualiser_log.h"
 
+#include "maidsafe/vault_manager/cgroups.h"
 #include "maidsafe/vault_manager/dispatcher.h"
+#include "maidsafe/vault_manager/in_process_host.h"
+#include "maidsafe/vault_manager/restart_scheduler.h"
+#include "maidsafe/vault_manager/scheduling.h"
 #include "maidsafe/vault_manager/utils.h"
 #include "maidsafe/vault_manager/vault_info.pb.h"
+#include "maidsafe/vault_manager/vault_host.h"
+#include "maidsafe/vault_manager/vault_output.h"
 
 namespace bp = boost::process;
 namespace fs = boost::filesystem;
@@ -58,43 +90,257 @@ namespace vault_manager {
 
 namespace {
 
-bool ConnectionsEqual(const tcp::ConnectionPtr& lhs, const tcp::ConnectionPtr& rhs) {
-  return !lhs.owner_before(rhs) && !rhs.owner_before(lhs);
+void CheckExecutable(const fs::path& executable) {
+  boost::system::error_code ec;
+  if (!fs::exists(executable, ec) || ec) {
+    LOG(kError) << executable << " doesn't exist.  " << (ec ? ec.message() : "");
+    BOOST_THROW_EXCEPTION(MakeError(CommonErrors::invalid_parameter));
+  }
+  if (!fs::is_regular_file(executable, ec) || ec) {
+    LOG(kError) << executable << " is not a regular file.  " << (ec ? ec.message() : "");
+    BOOST_THROW_EXCEPTION(MakeError(CommonErrors::invalid_parameter));
+  }
+  if (fs::is_symlink(executable, ec) || ec) {
+    LOG(kError) << executable << " is a symlink.  " << (ec ? ec.message() : "");
+    BOOST_THROW_EXCEPTION(MakeError(CommonErrors::invalid_parameter));
+  }
+#ifndef MAIDSAFE_WIN32
+  if (access(executable.c_str(), X_OK) != 0) {
+    LOG(kError) << executable << " is not executable.  " << std::strerror(errno);
+    BOOST_THROW_EXCEPTION(MakeError(CommonErrors::invalid_parameter));
+  }
+#endif
 }
 
-void CheckNewVaultDoesntConflict(const VaultInfo& new_vault, const VaultInfo& existing_vault) {
-  if (new_vault.pmid_and_signer && existing_vault.pmid_and_signer &&
-      new_vault.pmid_and_signer->first.name() == existing_vault.pmid_and_signer->first.name()) {
-    LOG(kError) << "Vault process with Pmid "
-                << DebugId(new_vault.pmid_and_signer->first.name().value) << " already exists.";
-    BOOST_THROW_EXCEPTION(MakeError(CommonErrors::already_initialised));
+#ifdef MAIDSAFE_LINUX
+#ifndef SYS_pidfd_open
+#define SYS_pidfd_open 434
+#endif
+
+bool PidfdSupported() {
+  int pidfd{ static_cast<int>(syscall(SYS_pidfd_open, getpid(), 0)) };
+  if (pidfd < 0) {
+    LOG(kWarning) << "pidfd_open unavailable: " << std::strerror(errno);
+    return false;
   }
+  close(pidfd);
+  return true;
+}
+#endif
 
-  if (new_vault.vault_dir == existing_vault.vault_dir) {
-    LOG(kError) << "Vault process with vault dir " << new_vault.vault_dir << " already exists.";
-    BOOST_THROW_EXCEPTION(MakeError(CommonErrors::already_initialised));
+#ifndef MAIDSAFE_WIN32
+void ThrowSpawnError(int error, const char* function_name) {
+  LOG(kError) << function_name << " failed: " << std::strerror(error);
+  BOOST_THROW_EXCEPTION(boost::system::system_error(
+      boost::system::error_code(error, boost::system::system_category()), function_name));
+}
+
+// Splits the command line exactly as boost::process::initializers::set_cmd_line does on POSIX.
+std::vector<std::string> SplitCommandLine(const std::string& command_line) {
+  boost::escaped_list_separator<char> separator('\\', ' ', '\"');
+  boost::tokenizer<boost::escaped_list_separator<char>> tokens(command_line, separator);
+  return std::vector<std::string>(std::begin(tokens), std::end(tokens));
+}
+
+// glibc 2.34 added posix_spawn_file_actions_addclosefrom_np, so that the child can close every
+// descriptor it shouldn't inherit without the parent first listing those open.  macOS can instead
+// make close-on-exec the default via POSIX_SPAWN_CLOEXEC_DEFAULT.
+#if defined __GLIBC__ && defined __GLIBC_PREREQ
+#if __GLIBC_PREREQ(2, 34)
+#define MAIDSAFE_VAULT_MANAGER_SPAWN_CLOSEFROM
+#endif
+#endif
+
+#if !defined MAIDSAFE_VAULT_MANAGER_SPAWN_CLOSEFROM && !defined MAIDSAFE_APPLE
+std::vector<int> OpenFileDescriptors() {
+  std::vector<int> file_descriptors;
+#ifdef MAIDSAFE_LINUX
+  DIR* directory(opendir("/proc/self/fd"));
+#else
+  DIR* directory(opendir("/dev/fd"));
+#endif
+  if (!directory) {  // Probe every possible descriptor instead.
+    LOG(kWarning) << "Failed to list open file descriptors: " << std::strerror(errno);
+    long max_descriptors(sysconf(_SC_OPEN_MAX));  // NOLINT (Fraser)
+    for (int fd(0); fd < max_descriptors; ++fd) {
+      if (fcntl(fd, F_GETFD) != -1)
+        file_descriptors.push_back(fd);
+    }
+    return file_descriptors;
   }
 
-  if (new_vault.label == existing_vault.label) {
-    LOG(kError) << "Vault process with label " << new_vault.label.string() << " already exists.";
-    BOOST_THROW_EXCEPTION(MakeError(CommonErrors::already_initialised));
+  const int kDirectoryDescriptor(dirfd(directory));
+  while (dirent* entry = readdir(directory)) {
+    char* end(nullptr);
+    long fd(std::strtol(entry->d_name, &end, 10));  // NOLINT (Fraser)
+    if (end == entry->d_name || *end != '\0' || fd == kDirectoryDescriptor)
+      continue;  // "." or ".." or the descriptor used for the listing itself.
+    file_descriptors.push_back(static_cast<int>(fd));
   }
+  closedir(directory);
+  return file_descriptors;
+}
+#endif
 
-  if (ConnectionsEqual(new_vault.tcp_connection, existing_vault.tcp_connection)) {
-    LOG(kError) << "Vault process with this tcp_connection already exists.";
-    BOOST_THROW_EXCEPTION(MakeError(CommonErrors::already_initialised));
+// Launches the vault via posix_spawn, which glibc implements using clone(CLONE_VM | CLONE_VFORK).
+// Unlike fork, this doesn't copy the page tables of the parent, so the cost doesn't grow with the
+// size of the VaultManager.  If 'output_descriptor' isn't -1, it replaces the child's stdout and
+// stderr.  Every descriptor not in 'inheritable_descriptors' is then closed in the child before the
+// exec; where the C library allows, this is done without listing the parent's open descriptors on
+// each spawn.
+pid_t SpawnVault(const fs::path& executable_path, const std::string& command_line,
+                 const std::set<int>& inheritable_descriptors, int output_descriptor,
+                 char* const* environment) {
+  std::vector<std::string> args(SplitCommandLine(command_line));
+  std::vector<char*> argv;
+  for (auto& arg : args)
+    argv.push_back(&arg[0]);
+  argv.push_back(nullptr);
+
+  posix_spawn_file_actions_t file_actions;
+  int result(posix_spawn_file_actions_init(&file_actions));
+  if (result != 0)
+    ThrowSpawnError(result, "posix_spawn_file_actions_init");
+  on_scope_exit destroy_file_actions{ [&] { posix_spawn_file_actions_destroy(&file_actions); } };
+  if (output_descriptor != -1) {
+    for (int target : { STDOUT_FILENO, STDERR_FILENO }) {
+      result = posix_spawn_file_actions_adddup2(&file_actions, output_descriptor, target);
+      if (result != 0)
+        ThrowSpawnError(result, "posix_spawn_file_actions_adddup2");
+    }
+  }
+  short flags(0);  // NOLINT (Fraser)
+#if defined MAIDSAFE_VAULT_MANAGER_SPAWN_CLOSEFROM
+  // Each allowed descriptor is duplicated onto itself, which also clears its FD_CLOEXEC flag in the
+  // child, and every other descriptor above stderr is closed.
+  int next_descriptor(STDERR_FILENO + 1);
+  for (int fd : inheritable_descriptors) {
+    if (fd < next_descriptor)
+      continue;
+    for (; next_descriptor != fd; ++next_descriptor) {
+      result = posix_spawn_file_actions_addclose(&file_actions, next_descriptor);
+      if (result != 0)
+        ThrowSpawnError(result, "posix_spawn_file_actions_addclose");
+    }
+    result = posix_spawn_file_actions_adddup2(&file_actions, fd, fd);
+    if (result != 0)
+      ThrowSpawnError(result, "posix_spawn_file_actions_adddup2");
+    ++next_descriptor;
+  }
+  result = posix_spawn_file_actions_addclosefrom_np(&file_actions, next_descriptor);
+  if (result != 0)
+    ThrowSpawnError(result, "posix_spawn_file_actions_addclosefrom_np");
+#elif defined MAIDSAFE_APPLE
+  // Every descriptor not explicitly inherited (or the target of a dup2) is closed in the child.
+  for (int fd : inheritable_descriptors) {
+    if (output_descriptor != -1 && (fd == STDOUT_FILENO || fd == STDERR_FILENO))
+      continue;
+    result = posix_spawn_file_actions_addinherit_np(&file_actions, fd);
+    if (result != 0)
+      ThrowSpawnError(result, "posix_spawn_file_actions_addinherit_np");
+  }
+  flags |= POSIX_SPAWN_CLOEXEC_DEFAULT;
+#else
+  for (int fd : OpenFileDescriptors()) {
+    if (inheritable_descriptors.count(fd) != 0)
+      continue;
+    result = posix_spawn_file_actions_addclose(&file_actions, fd);
+    if (result != 0)
+      ThrowSpawnError(result, "posix_spawn_file_actions_addclose");
+  }
+#endif
+
+  posix_spawnattr_t attributes;
+  result = posix_spawnattr_init(&attributes);
+  if (result != 0)
+    ThrowSpawnError(result, "posix_spawnattr_init");
+  on_scope_exit destroy_attributes{ [&] { posix_spawnattr_destroy(&attributes); } };
+#ifdef POSIX_SPAWN_USEVFORK
+  // Only needed by glibc versions older than 2.24, which otherwise fall back to fork.
+  flags |= POSIX_SPAWN_USEVFORK;
+#endif
+  if (flags != 0) {
+    result = posix_spawnattr_setflags(&attributes, flags);
+    if (result != 0)
+      ThrowSpawnError(result, "posix_spawnattr_setflags");
   }
+
+  pid_t pid{ 0 };
+  result = posix_spawn(&pid, executable_path.c_str(), &file_actions, &attributes, &argv[0],
+                       environment);
+  if (result != 0)
+    ThrowSpawnError(result, "posix_spawn");
+  return pid;
+}
+#endif
+
+#ifndef MAIDSAFE_WIN32
+// Polls until every one of 'process_ids' has been reaped or 'timeout' has elapsed, and returns the
+// number left unreaped.
+// Returns those of 'process_ids' which haven't exited yet.  Doesn't block.
+std::vector<pid_t> ReapIfExited(std::vector<pid_t> process_ids) {
+  process_ids.erase(std::remove_if(std::begin(process_ids), std::end(process_ids),
+                                   [](pid_t process_id) {
+                                     pid_t pid{ -1 };
+                                     do {
+                                       pid = waitpid(process_id, nullptr, WNOHANG);
+                                     } while (pid < 0 && errno == EINTR);
+                                     return pid != 0;  // Reaped, or not our child after all.
+                                   }),
+                    std::end(process_ids));
+  return process_ids;
 }
+#endif
 
 }  // unnamed namespace
 
-ProcessManager::Child::Child(VaultInfo info, boost::asio::io_service &io_service, int restarts)
+#ifndef MAIDSAFE_WIN32
+ProcessManager::Host::Host(boost::asio::io_service& io_service, fs::path executable_in)
+    : executable(std::move(executable_in)),
+      process(0),
+      connection(),
+      queued(),
+      timer(io_service),
+      launch_time(std::chrono::steady_clock::now()),
+      output(),
+      stopping(false) {}
+
+ProcessManager::Spare::Spare(boost::asio::io_service& io_service, fs::path executable_in)
+    : executable(std::move(executable_in)),
+      process(0),
+      connection(),
+      timer(maidsafe::make_unique<Timer>(io_service)),
+      launch_time(std::chrono::steady_clock::now()),
+      output() {}
+#endif
+
+ProcessManager::Child::Child(VaultInfo info, fs::path executable,
+                             boost::asio::io_service &io_service)
     : info(std::move(info)),
+      executable(std::move(executable)),
+      restarting(false),
+      awaiting_reattach(false),
+      orphaned(false),
       on_exit(),
+      instance_id(0),
+      terminating(false),
+      restart_when_stopped(false),
       timer(maidsafe::make_unique<Timer>(io_service)),
-      restart_count(restarts),
+      start_time(),
       process_args(),
       status(ProcessStatus::kBeforeStarted),
+      admission(),
+      admission_index(0),
+      resource_history(),
+      initial_rss(0),
+      latest_rss(0),
+      exit_history(kExitHistorySize),
+      oom_kills_at_launch(0),
+      heartbeat(),
+      connected_time(),
+      credentials_time(),
+      latencies(maidsafe::make_unique<LifecycleHistograms>()),
+      output(),
 #ifdef MAIDSAFE_WIN32
       process(PROCESS_INFORMATION()),
       handle(io_service) {}
@@ -104,11 +350,30 @@ ProcessManager::Child::Child(VaultInfo info, boost::asio::io_service &io_service
 
 ProcessManager::Child::Child(Child&& other)
     : info(std::move(other.info)),
+      executable(std::move(other.executable)),
+      restarting(std::move(other.restarting)),
+      awaiting_reattach(std::move(other.awaiting_reattach)),
+      orphaned(std::move(other.orphaned)),
       on_exit(std::move(other.on_exit)),
+      instance_id(std::move(other.instance_id)),
+      terminating(std::move(other.terminating)),
+      restart_when_stopped(std::move(other.restart_when_stopped)),
       timer(std::move(other.timer)),
-      restart_count(std::move(other.restart_count)),
+      start_time(std::move(other.start_time)),
       process_args(std::move(other.process_args)),
       status(std::move(other.status)),
+      admission(std::move(other.admission)),
+      admission_index(std::move(other.admission_index)),
+      resource_history(std::move(other.resource_history)),
+      initial_rss(std::move(other.initial_rss)),
+      latest_rss(std::move(other.latest_rss)),
+      exit_history(std::move(other.exit_history)),
+      oom_kills_at_launch(std::move(other.oom_kills_at_launch)),
+      heartbeat(std::move(other.heartbeat)),
+      connected_time(std::move(other.connected_time)),
+      credentials_time(std::move(other.credentials_time)),
+      latencies(std::move(other.latencies)),
+      output(std::move(other.output)),
 #ifdef MAIDSAFE_WIN32
       process(std::move(other.process)),
       handle(std::move(other.handle)) {}
@@ -124,10 +389,29 @@ ProcessManager::Child& ProcessManager::Child::operator=(Child other) {
 void swap(ProcessManager::Child& lhs, ProcessManager::Child& rhs){
   using std::swap;
   swap(lhs.info, rhs.info);
+  swap(lhs.executable, rhs.executable);
+  swap(lhs.restarting, rhs.restarting);
+  swap(lhs.awaiting_reattach, rhs.awaiting_reattach);
+  swap(lhs.orphaned, rhs.orphaned);
   swap(lhs.on_exit, rhs.on_exit);
+  swap(lhs.instance_id, rhs.instance_id);
+  swap(lhs.terminating, rhs.terminating);
+  swap(lhs.restart_when_stopped, rhs.restart_when_stopped);
   swap(lhs.timer, rhs.timer);
-  swap(lhs.restart_count, rhs.restart_count);
+  swap(lhs.start_time, rhs.start_time);
   swap(lhs.process_args, rhs.process_args);
+  swap(lhs.admission, rhs.admission);
+  swap(lhs.admission_index, rhs.admission_index);
+  swap(lhs.resource_history, rhs.resource_history);
+  swap(lhs.initial_rss, rhs.initial_rss);
+  swap(lhs.latest_rss, rhs.latest_rss);
+  swap(lhs.exit_history, rhs.exit_history);
+  swap(lhs.oom_kills_at_launch, rhs.oom_kills_at_launch);
+  swap(lhs.heartbeat, rhs.heartbeat);
+  swap(lhs.connected_time, rhs.connected_time);
+  swap(lhs.credentials_time, rhs.credentials_time);
+  swap(lhs.latencies, rhs.latencies);
+  swap(lhs.output, rhs.output);
   swap(lhs.status, rhs.status);
   swap(lhs.process, rhs.process);
 #ifdef MAIDSAFE_WIN32
@@ -135,177 +419,640 @@ void swap(ProcessManager::Child& lhs, ProcessManager::Child& rhs){
 #endif
 }
 
-
-
 ProcessManager::ProcessManager(boost::asio::io_service &io_service, fs::path vault_executable_path,
-                               tcp::Port listening_port)
+                               tcp::Port listening_port, ExitDetection preferred_exit_detection,
+                               SpawnMethod spawn_method)
     : io_service_(io_service),
 #ifndef MAIDSAFE_WIN32
-      signal_set_(io_service_, SIGCHLD),
+      signal_set_(io_service_),
 #endif
+      exit_detection_(preferred_exit_detection),
       stop_all_flag_(),
+      stopping_all_(false),
+      stopped_all_(false),
       kListeningPort_(listening_port),
-      kVaultExecutablePath_(vault_executable_path),
+      vault_executable_path_(vault_executable_path),
+      kSpawnMethod_(spawn_method),
+#ifndef MAIDSAFE_WIN32
+      inheritable_descriptors_{ STDIN_FILENO, STDOUT_FILENO, STDERR_FILENO },
+      output_max_file_size_(0),
+      output_rotated_files_(0),
+#endif
+      on_restart_history_changed_(),
+      on_vault_failed_(),
+      on_vault_removed_(),
+      on_attached_vaults_changed_(),
+      cgroups_(),
+      placement_(),
+      launch_profiles_(),
+      sampler_(),
+      memory_watchdog_(),
+      heartbeats_(),
+      restart_throttle_(std::make_shared<RestartThrottle>(io_service_, kRestartBurst,
+                                                          kRestartRefillInterval)),
+      host_latencies_(),
+      connect_timeout_(TimeoutKind::kVaultConnect, kRpcTimeout, kRpcTimeoutFloor,
+                       kRpcTimeoutCeiling),
+      rollout_(),
+#ifndef MAIDSAFE_WIN32
+      spare_pool_size_(0),
+      consecutive_spare_failures_(0),
+      on_spare_assigned_(),
+      spare_refill_timer_(io_service_),
+      spares_(),
+      terminated_children_(),
+      subreaper_(false),
+      orphan_poll_scheduled_(false),
+      orphan_timer_(io_service_),
+      host_dir_(),
+      host_args_(),
+      host_(),
+      next_instance_id_(InProcessHost::kFirstInstanceId),
+#endif
       vaults_() {
   static_assert(std::is_same<ProcessId, process::ProcessId>::value,
                 "process::ProcessId is statically checked as being of suitable size for holding a "
                 "pid_t or DWORD, so vault_manager::ProcessId should use the same type.");
-  boost::system::error_code ec;
-  if (!fs::exists(kVaultExecutablePath_, ec) || ec) {
-    LOG(kError) << kVaultExecutablePath_ << " doesn't exist.  " << (ec ? ec.message() : "");
-    BOOST_THROW_EXCEPTION(MakeError(CommonErrors::invalid_parameter));
-  }
-  if (!fs::is_regular_file(kVaultExecutablePath_, ec) || ec) {
-    LOG(kError) << kVaultExecutablePath_ << " is not a regular file.  " << (ec ? ec.message() : "");
-    BOOST_THROW_EXCEPTION(MakeError(CommonErrors::invalid_parameter));
-  }
-  if (fs::is_symlink(kVaultExecutablePath_, ec) || ec) {
-    LOG(kError) << kVaultExecutablePath_ << " is a symlink.  " << (ec ? ec.message() : "");
-    BOOST_THROW_EXCEPTION(MakeError(CommonErrors::invalid_parameter));
+  CheckExecutable(vault_executable_path_);
+  LOG(kVerbose) << "Vault executable found at " << vault_executable_path_;
+#ifdef MAIDSAFE_LINUX
+  if (exit_detection_ == ExitDetection::kPidfd && PidfdSupported()) {
+    LOG(kVerbose) << "Using pidfds to detect vault process exits.";
+    return;
   }
-  LOG(kVerbose) << "Vault executable found at " << kVaultExecutablePath_;
-  InitSignalHandler();
+#endif
+#ifndef MAIDSAFE_WIN32
+  FallBackToSigchld();
+#endif
 }
 
 std::shared_ptr<ProcessManager> ProcessManager::MakeShared(
     boost::asio::io_service& io_service, boost::filesystem::path vault_executable_path,
-    tcp::Port listening_port) {
+    tcp::Port listening_port, ExitDetection preferred_exit_detection, SpawnMethod spawn_method) {
   return std::shared_ptr<ProcessManager>{ new ProcessManager{ io_service, vault_executable_path,
-                                                              listening_port } };
+      listening_port, preferred_exit_detection, spawn_method } };
 }
 
 ProcessManager::~ProcessManager() {
-  assert(vaults_.empty());
+  assert(vaults_.Empty());
 }
 
 void ProcessManager::StopAll() {
   std::call_once(stop_all_flag_, [this] {
-    for (const auto& vault : vaults_)
-      StopProcess(vault.info.tcp_connection);
+    stopping_all_ = true;
+    StopSampling();
+    StopHeartbeats();
+    StopRestartThrottle();
+    LogLifecycleLatencies();
+    StopUpgrade();
 #ifndef MAIDSAFE_WIN32
-    boost::system::error_code ignored_ec;
-    signal_set_.cancel(ignored_ec);
+    DrainSparePool();
 #endif
-  });
-}
-
-void ProcessManager::StopAllWithInterval() {
-  int index(0);
-  std::call_once(stop_all_flag_, [this, &index] {
     std::vector<tcp::ConnectionPtr> connections;
-    for (const auto& vault : vaults_)
-      connections.push_back(vault.info.tcp_connection);
-    for (const auto& connection : connections) {
-      ++index;
-      TLOG(kDefaultColour) << "stopping vault " << index << '\n';
+    std::vector<NonEmptyString> unconnected_labels;
+    vaults_.ForEach([&](const Child& vault) {
+      if (vault.info.tcp_connection)
+        connections.push_back(vault.info.tcp_connection);
+      else
+        unconnected_labels.push_back(vault.info.label);
+    });
+    for (const auto& connection : connections)
       StopProcess(connection);
-      Sleep(std::chrono::seconds(5));
+    // Vaults which haven't yet connected can't be asked to stop, so terminate them.
+    for (const auto& label : unconnected_labels) {
+      DoFind(label).status = ProcessStatus::kStopping;
+      OnProcessExit(label, ExitStatus(), true);
     }
+    StopSignalHandlerWhenIdle();
+  });
+}
+
+void ProcessManager::StopAllRolling(int max_concurrent_stops,
+                                    std::chrono::steady_clock::duration deadline,
+                                    OnShutdownProgressFunctor on_progress,
+                                    std::function<void()> on_stopped) {
+  if (max_concurrent_stops < 1)
+    BOOST_THROW_EXCEPTION(MakeError(CommonErrors::invalid_parameter));
+  std::call_once(stop_all_flag_, [&] {
+    stopping_all_ = true;
+    StopSampling();
+    StopHeartbeats();
+    StopRestartThrottle();
+    LogLifecycleLatencies();
+    StopUpgrade();
 #ifndef MAIDSAFE_WIN32
-    boost::system::error_code ignored_ec;
-    signal_set_.cancel(ignored_ec);
+    DrainSparePool();
 #endif
+    auto shutdown(std::make_shared<Shutdown>(io_service_, max_concurrent_stops,
+                                             std::move(on_progress), std::move(on_stopped)));
+    std::vector<NonEmptyString> unconnected_labels;
+    vaults_.ForEach([&](const Child& vault) {
+      if (vault.info.tcp_connection)
+        shutdown->queued.push_back(vault.info.label);
+      else
+        unconnected_labels.push_back(vault.info.label);
+    });
+    shutdown->progress.total = shutdown->queued.size() + unconnected_labels.size();
+    LOG(kInfo) << "Stopping " << shutdown->progress.total << " vaults, at most "
+               << max_concurrent_stops << " at a time.";
+    if (shutdown->progress.total == 0U) {
+      StopSignalHandlerWhenIdle();
+      io_service_.post([shutdown] {
+        if (shutdown->on_stopped)
+          shutdown->on_stopped();
+      });
+      return;
+    }
+
+    // Every vault reports its exit to the shutdown from now on, and none will be restarted, even
+    // if it's still waiting its turn when it exits.
+    vaults_.ForEach([&](Child& vault) {
+      NonEmptyString label{ vault.info.label };
+      vault.status = ProcessStatus::kStopping;
+      vault.on_exit = [this, shutdown, label](maidsafe_error error, int /*exit_code*/) {
+        OnVaultStopped(shutdown, label, error);
+      };
+    });
+
+    shutdown->deadline_timer.expires_from_now(deadline);
+    shutdown->deadline_timer.async_wait([this, shutdown](const boost::system::error_code& ec) {
+      if (ec && ec == boost::asio::error::operation_aborted)
+        return;
+      OnShutdownDeadline(shutdown);
+    });
+
+    // Includes vaults awaiting a restart or in quarantine.
+    for (const auto& label : unconnected_labels)
+      OnProcessExit(label, ExitStatus(), true);
+    StopNext(shutdown);
   });
 }
 
 std::vector<VaultInfo> ProcessManager::GetAll() const {
   std::vector<VaultInfo> all_vaults;
-  for (const auto& vault : vaults_)
-    all_vaults.push_back(vault.info);
+  all_vaults.reserve(vaults_.Size());
+  vaults_.ForEach([&](const Child& vault) { all_vaults.push_back(vault.info); });
   return all_vaults;
 }
 
-void ProcessManager::AddProcess(VaultInfo info, int restart_count) {
-  if (info.vault_dir.empty() || !info.label.IsInitialised() || !info.pmid_and_signer) {
-    LOG(kError) << "Can't add vault: vault_dir path and/or vault label and/or Pmid is empty.";
-    BOOST_THROW_EXCEPTION(MakeError(CommonErrors::invalid_parameter));
+void ProcessManager::AddProcess(VaultInfo info) {
+  CheckCanAdd(info);
+  // Insert checks for conflicts and offers strong exception guarantee - only need to cover
+  // subsequent calls.
+  Child& vault(vaults_.Insert(Child{ info, vault_executable_path_, io_service_ }, info));
+  on_scope_exit strong_guarantee{ [this, &info] { EraseVault(info.label); } };
+  std::chrono::milliseconds quarantine{
+      QuarantineRemaining(info.restart_history, std::chrono::system_clock::now()) };
+  if (info.restart_history.failed) {
+    LOG(kWarning) << "Vault " << info.label.string() << " has failed and won't be started.";
+    vault.status = ProcessStatus::kFailed;
+  } else if (quarantine.count() > 0) {
+    LOG(kWarning) << "Vault " << info.label.string() << " is quarantined for a further "
+                  << quarantine.count() << " ms.";
+    vault.status = ProcessStatus::kQuarantined;
+    ScheduleStart(vault, quarantine);
+  } else {
+    StartProcess(vault);
+    RegisterProcessId(vault);
   }
-  if (restart_count > kMaxVaultRestarts) {
-    LOG(kError) << "Can't add vault process - too many restarts.";
+  strong_guarantee.Release();
+}
+
+void ProcessManager::AddProcesses(std::vector<VaultInfo> infos, OnProcessesAddedFunctor on_added,
+                                  int max_concurrent_starts) {
+  if (max_concurrent_starts < 1) {
+    LOG(kError) << "Invalid limit on concurrent vault starts: " << max_concurrent_starts;
     BOOST_THROW_EXCEPTION(MakeError(CommonErrors::invalid_parameter));
   }
-  for (const auto& vault : vaults_)
-    CheckNewVaultDoesntConflict(info, vault.info);
-
-  // emplace offers strong exception guarantee - only need to cover subsequent calls.
-  auto itr(vaults_.emplace(std::end(vaults_), Child{ info, io_service_, restart_count }));
-  on_scope_exit strong_guarantee{ [this, itr] { vaults_.erase(itr); } };
-  StartProcess(itr);
-  strong_guarantee.Release();
+  auto admission(std::make_shared<Admission>(std::move(on_added), max_concurrent_starts));
+  admission->outcomes.reserve(infos.size());
+  // Each vault is checked against the registry, which by then also holds the accepted vaults from
+  // earlier in this batch.
+  for (auto& info : infos) {
+    admission->outcomes.emplace_back(info.label, MakeError(CommonErrors::success));
+    try {
+      CheckCanAdd(info);
+      Child& vault(vaults_.Insert(Child{ info, vault_executable_path_, io_service_ }, info));
+      if (info.restart_history.failed) {
+        LOG(kWarning) << "Vault " << info.label.string() << " has failed and won't be started.";
+        vault.status = ProcessStatus::kFailed;
+        admission->outcomes.back().error = MakeError(VaultManagerErrors::vault_exited_with_error);
+        continue;
+      }
+      std::chrono::milliseconds quarantine{
+          QuarantineRemaining(info.restart_history, std::chrono::system_clock::now()) };
+      if (quarantine.count() > 0) {
+        LOG(kWarning) << "Vault " << info.label.string() << " is quarantined for a further "
+                      << quarantine.count() << " ms.";
+        vault.status = ProcessStatus::kQuarantined;
+        ScheduleStart(vault, quarantine);
+        admission->outcomes.back().error = MakeError(CommonErrors::unable_to_handle_request);
+        continue;
+      }
+      vault.admission = admission;
+      vault.admission_index = admission->outcomes.size() - 1;
+      admission->queued.push_back(info.label);
+    }
+    catch (const maidsafe_error& error) {
+      admission->outcomes.back().error = error;
+    }
+    catch (const std::exception& e) {
+      LOG(kError) << boost::diagnostic_information(e);
+      admission->outcomes.back().error = MakeError(CommonErrors::unknown);
+    }
+  }
+  admission->pending = admission->queued.size();
+  LOG(kInfo) << "Admitted " << admission->pending << " of " << infos.size() << " vaults.";
+  io_service_.post([this, admission] { AdmitNext(admission); });
 }
 
 VaultInfo ProcessManager::HandleVaultStarted(tcp::ConnectionPtr connection, ProcessId process_id) {
-  auto itr(std::find_if(std::begin(vaults_), std::end(vaults_),
-                        [this, process_id](const Child& vault) {
-                          return GetProcessId(vault) == process_id;
-                        }));
-  if (itr == std::end(vaults_)) {
+  Child* vault(vaults_.Find(process_id));
+  if (!vault) {
     LOG(kError) << "Failed to find vault with process ID " << process_id << " in child processes.";
     BOOST_THROW_EXCEPTION(MakeError(CommonErrors::no_such_element));
   }
-  itr->timer->cancel();
-  itr->info.tcp_connection = connection;
-  itr->status = ProcessStatus::kRunning;
-  return itr->info;
+  if (vault->terminating) {
+    LOG(kError) << "Vault " << vault->info.label.string() << " connected after being terminated.";
+    BOOST_THROW_EXCEPTION(MakeError(VaultManagerErrors::vault_terminated));
+  }
+  vaults_.SetConnection(vault->info.label, connection);
+  vault->timer->cancel();
+  vault->info.tcp_connection = connection;
+  vault->status = ProcessStatus::kRunning;
+  vault->connected_time = std::chrono::steady_clock::now();
+  RecordLatency(*vault, LifecyclePhase::kSpawn, vault->connected_time - vault->start_time);
+  connect_timeout_.Sample(vault->connected_time - vault->start_time);
+  CompleteAdmission(*vault, MakeError(CommonErrors::success));
+  NotifyAttachedVaultsChanged();
+  return vault->info;
+}
+
+VaultInfo ProcessManager::HandleVaultReattached(tcp::ConnectionPtr connection,
+                                                ProcessId process_id, const Identity& pmid_name) {
+  Child* vault(vaults_.Find(process_id));
+  if (!vault || !vault->awaiting_reattach) {
+    LOG(kError) << "No vault with process ID " << process_id << " is awaiting reconnection.";
+    BOOST_THROW_EXCEPTION(MakeError(CommonErrors::no_such_element));
+  }
+  if (vault->info.pmid_and_signer->first.name().value != pmid_name) {
+    LOG(kError) << "Process ID " << process_id << " isn't running vault "
+                << vault->info.label.string();
+    BOOST_THROW_EXCEPTION(MakeError(CommonErrors::invalid_parameter));
+  }
+  vaults_.SetConnection(vault->info.label, connection);
+  vault->timer->cancel();
+  vault->info.tcp_connection = connection;
+  vault->status = ProcessStatus::kRunning;
+  vault->awaiting_reattach = false;
+  LOG(kInfo) << "Vault " << vault->info.label.string() << " has re-attached.";
+  NotifyAttachedVaultsChanged();
+  return vault->info;
 }
 
 void ProcessManager::AssignOwner(const NonEmptyString& label,
                                  const passport::PublicMaid::Name& owner_name,
                                  DiskUsage max_disk_usage) {
-  auto itr(DoFind(label));
-  itr->info.owner_name = owner_name;
-  itr->info.max_disk_usage = max_disk_usage;
+  Child& vault(DoFind(label));
+  vault.info.owner_name = owner_name;
+  vault.info.max_disk_usage = max_disk_usage;
+}
+
+void ProcessManager::CheckCanAdd(const VaultInfo& info) const {
+  if (info.vault_dir.empty() || !info.label.IsInitialised() || !info.pmid_and_signer) {
+    LOG(kError) << "Can't add vault: vault_dir path and/or vault label and/or Pmid is empty.";
+    BOOST_THROW_EXCEPTION(MakeError(CommonErrors::invalid_parameter));
+  }
 }
 
-void ProcessManager::StartProcess(std::vector<Child>::iterator itr) {
-  if (itr->status != ProcessStatus::kBeforeStarted) {
+void ProcessManager::StartProcess(Child& vault) {
+  if (vault.status != ProcessStatus::kBeforeStarted) {
     LOG(kError) << "Process has already been started.";
     BOOST_THROW_EXCEPTION(MakeError(CommonErrors::already_initialised));
   }
 
-  std::vector<std::string> args{ 1, kVaultExecutablePath_.string() };
-  args.emplace_back(std::to_string(kListeningPort_));
-  args.emplace_back("--log_folder " + (itr->info.vault_dir / "logs").string());
-  args.insert(std::end(args), std::begin(itr->process_args), std::end(itr->process_args));
+  if (vault.info.in_process) {
+#ifndef MAIDSAFE_WIN32
+    if (InProcessHostingEnabled())
+      return StartInstance(vault);
+#endif
+    LOG(kWarning) << "In-process hosting isn't enabled, so vault " << vault.info.label.string()
+                  << " will run as a separate process.";
+  }
 
-  NonEmptyString label{ itr->info.label };
-  itr->process = bp::execute(
-      bp::initializers::run_exe(kVaultExecutablePath_),
-      bp::initializers::set_cmd_line(process::ConstructCommandLine(args)),
+  const LaunchProfile* const kLaunchProfile(FindLaunchProfile(vault));
 #ifndef MAIDSAFE_WIN32
-      bp::initializers::notify_io_service(io_service_),
+  if (vault.process_args.empty() && !kLaunchProfile && TakeSpare(vault))
+    return;
 #endif
-      bp::initializers::throw_on_error(),
-      bp::initializers::inherit_env());
 
-  itr->status = ProcessStatus::kStarting;
+  std::vector<std::string> args{ 1, vault.executable.string() };
+  args.emplace_back(std::to_string(kListeningPort_));
+  args.emplace_back("--log_folder " + (vault.info.vault_dir / "logs").string());
+  args.insert(std::end(args), std::begin(vault.process_args), std::end(vault.process_args));
+  if (kLaunchProfile)
+    args.insert(std::end(args), std::begin(kLaunchProfile->args), std::end(kLaunchProfile->args));
+
+  NonEmptyString label{ vault.info.label };
+  const auto kLaunchTime(std::chrono::steady_clock::now());
+  std::shared_ptr<VaultOutput> output;
+  vault.process = LaunchProcess(vault.executable, args, kLaunchProfile, output);
+#ifndef MAIDSAFE_WIN32
+  AttachOutput(vault, std::move(output));
+#endif
+  vault.status = ProcessStatus::kStarting;
+  vault.start_time = kLaunchTime;
+  vault.credentials_time = std::chrono::steady_clock::time_point();
+  PlaceInCgroup(vault);
+  PinToCpus(vault);
+  Prioritise(vault);
+  vault.oom_kills_at_launch = ReadOomKills(vault);
+  // posix_spawn can't set the child's limits, so they're set straight after it has been launched.
+  if (kLaunchProfile && !ApplyLaunchLimits(GetProcessId(vault), *kLaunchProfile)) {
+    LOG(kWarning) << "Failed to apply the limits of launch profile " << vault.info.launch_profile
+                  << " to vault " << label.string();
+  }
+
+#ifdef MAIDSAFE_LINUX
+  if (exit_detection_ == ExitDetection::kPidfd)
+    WatchPidfd(GetProcessId(vault));
+#endif
 
 #ifdef MAIDSAFE_WIN32
   HANDLE copied_handle;
-  DuplicateHandle(GetCurrentProcess(), itr->process.process_handle(), GetCurrentProcess(),
+  DuplicateHandle(GetCurrentProcess(), vault.process.process_handle(), GetCurrentProcess(),
                   &copied_handle, 0, FALSE, DUPLICATE_SAME_ACCESS);
-  itr->handle.assign(copied_handle);
-  HANDLE native_handle{ itr->handle.native_handle() };
-  itr->handle.async_wait([this, label, native_handle](const boost::system::error_code&) {
+  vault.handle.assign(copied_handle);
+  HANDLE native_handle{ vault.handle.native_handle() };
+  vault.handle.async_wait([this, label, native_handle](const boost::system::error_code& ec) {
+    if (ec == boost::asio::error::operation_aborted)  // Handle closed pending a restart.
+      return;
     DWORD exit_code;
     GetExitCodeProcess(native_handle, &exit_code);
-    OnProcessExit(label, BOOST_PROCESS_EXITSTATUS(exit_code));
+    OnProcessExit(label, DecodeWaitStatus(static_cast<int>(exit_code)));
   });
 #endif
 
-  itr->timer->expires_from_now(kRpcTimeout);
-  itr->timer->async_wait([this, label](const boost::system::error_code& error_code) {
+  AwaitConnection(vault);
+}
+
+void ProcessManager::RegisterProcessId(Child& vault) {
+  const ProcessId kProcessId(GetProcessId(vault));
+  Child* stale(kProcessId == 0 ? nullptr : vaults_.Find(kProcessId));
+  if (stale && stale != &vault) {
+    // Two live processes can't share an ID, so this is a vault which has exited unnoticed, e.g. an
+    // orphan awaiting its next poll.  Its handle is released first so that nothing handling its
+    // exit can act on the new process instead.
+    NonEmptyString stale_label{ stale->info.label };
+    LOG(kWarning) << "Vault " << stale_label.string() << " has exited, and its process ID "
+                  << kProcessId << " has been reused by vault " << vault.info.label.string();
+    vaults_.SetProcessId(stale_label, 0);
+    ReleaseProcessHandle(*stale);
+    io_service_.post([this, stale_label] { OnProcessExit(stale_label, ExitStatus()); });
+  }
+  vaults_.SetProcessId(vault.info.label, kProcessId);
+}
+
+void ProcessManager::AwaitConnection(Child& vault) {
+  NonEmptyString label{ vault.info.label };
+  vault.timer->expires_from_now(connect_timeout_.Value());
+  vault.timer->async_wait([this, label](const boost::system::error_code& error_code) {
     if (error_code && error_code == boost::asio::error::operation_aborted) {
       LOG(kVerbose) << "New process timer cancelled OK.";
       return;
     }
     LOG(kWarning) << "Timed out waiting for new process to connect via TCP.";
-    OnProcessExit(label, -1, true);
+    connect_timeout_.OnExpiry();
+    OnProcessExit(label, ExitStatus(), true);
   });
 }
 
+const LaunchProfile* ProcessManager::FindLaunchProfile(const Child& vault) const {
+  if (vault.info.launch_profile.empty())
+    return nullptr;
+  auto itr(launch_profiles_.find(vault.info.launch_profile));
+  if (itr == std::end(launch_profiles_)) {
+    // Better to run the vault with the defaults than not at all.
+    LOG(kError) << "Launch profile " << vault.info.launch_profile << " of vault "
+                << vault.info.label.string() << " isn't defined; launching with the defaults.";
+    return nullptr;
+  }
+  return &itr->second;
+}
+
+bp::child ProcessManager::LaunchProcess(const fs::path& executable,
+                                        const std::vector<std::string>& args,
+                                        const LaunchProfile* launch_profile,
+                                        std::shared_ptr<VaultOutput>& output) {
+  output.reset();
+  // Must outlive the launch, since only pointers to its contents are passed on.
+  std::vector<std::string> environment;
+  if (launch_profile)
+    environment = MakeEnvironment(*launch_profile);
+#ifndef MAIDSAFE_WIN32
+  if (kSpawnMethod_ == SpawnMethod::kPosixSpawn) {
+    std::vector<char*> envp;
+    for (auto& variable : environment)
+      envp.push_back(&variable[0]);
+    envp.push_back(nullptr);
+    char* const* const kEnvironment(launch_profile ? &envp[0] : environ);
+    if (output_max_file_size_ == 0) {
+      return bp::child{ SpawnVault(executable, process::ConstructCommandLine(args),
+                                   inheritable_descriptors_, -1, kEnvironment) };
+    }
+    int read_descriptor(-1), write_descriptor(-1);
+    MakeOutputPipe(read_descriptor, write_descriptor);
+    on_scope_exit close_write_end{ [write_descriptor] { close(write_descriptor); } };
+    std::shared_ptr<VaultOutput> pipe_reader{ VaultOutput::MakeShared(io_service_,
+                                                                      read_descriptor) };
+    bp::child child{ SpawnVault(executable, process::ConstructCommandLine(args),
+                                inheritable_descriptors_, write_descriptor, kEnvironment) };
+    output = std::move(pipe_reader);
+    return child;
+  }
+#endif
+  if (launch_profile) {
+    return bp::execute(
+        bp::initializers::run_exe(executable),
+        bp::initializers::set_cmd_line(process::ConstructCommandLine(args)),
+#ifndef MAIDSAFE_WIN32
+        bp::initializers::notify_io_service(io_service_),
+#endif
+        bp::initializers::throw_on_error(),
+        bp::initializers::set_env(environment));
+  }
+  return bp::execute(
+      bp::initializers::run_exe(executable),
+      bp::initializers::set_cmd_line(process::ConstructCommandLine(args)),
+#ifndef MAIDSAFE_WIN32
+      bp::initializers::notify_io_service(io_service_),
+#endif
+      bp::initializers::throw_on_error(),
+      bp::initializers::inherit_env());
+}
+
+void ProcessManager::PlaceInCgroup(const Child& vault) {
+  if (!cgroups_)
+    return;
+  try {
+    cgroups_->AddProcess(vault.info.label, vault.info.resource_limits, GetProcessId(vault));
+  }
+  catch (const std::exception& e) {
+    // Better to run the vault unconstrained than not at all.
+    LOG(kError) << "Failed to place vault " << vault.info.label.string() << " in its cgroup: "
+                << boost::diagnostic_information(e);
+  }
+}
+
+void ProcessManager::PinToCpus(const Child& vault) {
+  if (!placement_)
+    return;
+  std::vector<int> cpus(placement_->Assign(vault.info.label));
+  if (!PinProcess(GetProcessId(vault), cpus))
+    LOG(kWarning) << "Failed to pin vault " << vault.info.label.string() << " to its CPUs.";
+}
+
+void ProcessManager::Prioritise(const Child& vault) {
+  // A Normal vault is left with the settings it inherited from the VaultManager.
+  if (vault.info.scheduling_class == SchedulingClass::kNormal)
+    return;
+  if (!ApplySchedulingClass(GetProcessId(vault), vault.info.scheduling_class)) {
+    LOG(kWarning) << "Failed to apply scheduling class " << vault.info.scheduling_class
+                  << " to vault " << vault.info.label.string();
+  }
+}
+
+void ProcessManager::ReleaseCpus(const NonEmptyString& label) {
+  if (!placement_)
+    return;
+  placement_->Release(label);
+  for (const auto& moved : placement_->Rebalance()) {
+    const Child* vault(vaults_.Find(moved.first));
+    if (vault && GetProcessId(*vault) != 0 && !PinProcess(GetProcessId(*vault), moved.second))
+      LOG(kWarning) << "Failed to re-pin vault " << moved.first.string() << " to its new CPUs.";
+  }
+}
+
+void ProcessManager::AdmitNext(const std::shared_ptr<Admission>& admission) {
+  while (static_cast<int>(admission->starting.size()) < admission->max_concurrent_starts &&
+         !admission->queued.empty()) {
+    NonEmptyString label{ admission->queued.front() };
+    admission->queued.pop_front();
+    Child* vault(vaults_.Find(label));
+    if (!vault || vault->admission != admission)  // Stopped while queued.
+      continue;
+    admission->starting.insert(label);
+    try {
+      StartProcess(*vault);
+      RegisterProcessId(*vault);
+    }
+    catch (const maidsafe_error& error) {
+      CompleteAdmission(*vault, error);
+      EraseVault(label);
+    }
+    catch (const std::exception& e) {
+      LOG(kError) << boost::diagnostic_information(e);
+      CompleteAdmission(*vault, MakeError(CommonErrors::unknown));
+      EraseVault(label);
+    }
+  }
+
+  if (admission->pending == 0 && admission->on_added) {
+    OnProcessesAddedFunctor on_added;
+    on_added.swap(admission->on_added);
+    try {
+      on_added(std::move(admission->outcomes));
+    }
+    catch (const std::exception& e) {
+      LOG(kError) << "Error executing on_added functor: " << boost::diagnostic_information(e);
+    }
+  }
+}
+
+void ProcessManager::CompleteAdmission(Child& vault, maidsafe_error error) {
+  if (!vault.admission)
+    return;
+  std::shared_ptr<Admission> admission;
+  admission.swap(vault.admission);
+  admission->outcomes[vault.admission_index].error = error;
+  admission->starting.erase(vault.info.label);
+  --admission->pending;
+  // Posted since this can be called while 'vault' is being handled elsewhere.
+  io_service_.post([this, admission] { AdmitNext(admission); });
+}
+
+void ProcessManager::EraseVault(const NonEmptyString& label) {
+  vaults_.Erase(label);
+  if (!on_vault_removed_)
+    return;
+  try {
+    on_vault_removed_(label);
+  }
+  catch (const std::exception& e) {
+    LOG(kError) << "Error executing on_vault_removed functor: " << boost::diagnostic_information(e);
+  }
+  catch (...) {
+    LOG(kError) << "Unknown error type while executing on_vault_removed functor.";
+  }
+}
+
+void ProcessManager::StopNext(const std::shared_ptr<Shutdown>& shutdown) {
+  while (shutdown->stopping.size() < static_cast<size_t>(shutdown->max_concurrent_stops) &&
+         !shutdown->queued.empty()) {
+    NonEmptyString label{ shutdown->queued.front() };
+    shutdown->queued.pop_front();
+    // The vault may have exited (and been accounted for) while waiting its turn.
+    Child* vault(vaults_.Find(label));
+    if (!vault)
+      continue;
+    shutdown->stopping.insert(label);
+    // A vault which has closed its connection is already exiting, and will report to the shutdown.
+    if (vault->info.tcp_connection)
+      StopProcess(vault->info.tcp_connection, vault->on_exit);
+  }
+}
+
+void ProcessManager::OnVaultStopped(const std::shared_ptr<Shutdown>& shutdown,
+                                    const NonEmptyString& label, const maidsafe_error& error) {
+  shutdown->stopping.erase(label);
+  if (error.code() == make_error_code(VaultManagerErrors::vault_terminated))
+    ++shutdown->progress.terminated;
+  else
+    ++shutdown->progress.stopped;
+  LOG(kVerbose) << "Vault " << label.string() << " stopped; " << shutdown->progress.Remaining()
+                << " of " << shutdown->progress.total << " remaining.";
+  try {
+    if (shutdown->on_progress)
+      shutdown->on_progress(shutdown->progress);
+  }
+  catch (const std::exception& e) {
+    LOG(kError) << "Error executing on_progress functor: " << boost::diagnostic_information(e);
+  }
+
+  if (shutdown->progress.Remaining() != 0U)
+    return StopNext(shutdown);
+
+  boost::system::error_code ignored_ec;
+  shutdown->deadline_timer.cancel(ignored_ec);
+  LOG(kInfo) << "All vaults stopped: " << shutdown->progress.stopped << " exited and "
+             << shutdown->progress.terminated << " terminated.";
+  if (shutdown->on_stopped)
+    shutdown->on_stopped();
+}
+
+void ProcessManager::OnShutdownDeadline(const std::shared_ptr<Shutdown>& shutdown) {
+  std::vector<NonEmptyString> stragglers(shutdown->queued.begin(), shutdown->queued.end());
+  stragglers.insert(stragglers.end(), shutdown->stopping.begin(), shutdown->stopping.end());
+  shutdown->queued.clear();
+  LOG(kWarning) << "Shutdown deadline passed; terminating " << stragglers.size() << " vaults.";
+  for (const auto& label : stragglers)
+    OnProcessExit(label, ExitStatus(), true);
+}
+
 void ProcessManager::InitSignalHandler() {
 #ifndef MAIDSAFE_WIN32
+  if (stopped_all_)
+    return;
   LOG(kVerbose) << "Initialising signal handler.";
   signal_set_.async_wait([this](const boost::system::error_code& error_code, int signum) {
     if (error_code && error_code == boost::asio::error::operation_aborted) {
@@ -320,122 +1067,1582 @@ void ProcessManager::InitSignalHandler() {
       return;
     }
 
-    int exit_code;
-    ProcessId process_id{ static_cast<ProcessId>(wait(&exit_code)) };
-    LOG(kWarning) << "Process ID " << process::GetProcessId() << " received SIGCHLD pid: "
-                  << process_id;
-    if (process_id == process::GetProcessId())
-      return;
-
-    auto child_itr(std::find_if(std::begin(vaults_), std::end(vaults_),
-        [this, process_id](const Child& vault) { return GetProcessId(vault) == process_id; }));
-    if (child_itr == std::end(vaults_))
-      return;
-
-    OnProcessExit(child_itr->info.label, BOOST_PROCESS_EXITSTATUS(exit_code));
+    ReapExitedChildren();
   });
 #endif
 }
 
-void ProcessManager::StopProcess(tcp::ConnectionPtr connection, OnExitFunctor on_exit_functor) {
-  auto itr(std::begin(vaults_));
-  try {
-    itr = DoFind(connection);
-  }
-  catch (const std::exception& e) {
-    LOG(kError) << "Vault process doesn't exist: " << boost::diagnostic_information(e);
+void ProcessManager::StopSignalHandlerWhenIdle() {
+  if (!stopping_all_ || !vaults_.Empty() || stopped_all_)
     return;
-  }
-  itr->on_exit = on_exit_functor;
-  itr->status = ProcessStatus::kStopping;
-  SendVaultShutdownRequest(itr->info.tcp_connection);
-  NonEmptyString label{ itr->info.label };
-  itr->timer->expires_from_now(kVaultStopTimeout);
-  itr->timer->async_wait([this, label](const boost::system::error_code& error_code) {
-    if (error_code && error_code == boost::asio::error::operation_aborted) {
-      LOG(kVerbose) << "Vault termination timer cancelled OK.";
-      return;
-    }
-    LOG(kWarning) << "Timed out waiting for Vault to stop; terminating now.";
-    OnProcessExit(label, -1, true);
-  });
+#ifndef MAIDSAFE_WIN32
+  // This is called again once the host's exit has been reaped.
+  if (host_)
+    return StopHost();
+#endif
+  stopped_all_ = true;
+#ifndef MAIDSAFE_WIN32
+  boost::system::error_code ignored_ec;
+  signal_set_.cancel(ignored_ec);
+#endif
 }
 
-bool ProcessManager::HandleConnectionClosed(tcp::ConnectionPtr connection) {
-  try {
-    OnProcessExit(DoFind(connection)->info.label, -1, true);
-  }
-  catch (const maidsafe_error& error) {
-    if (error.code() == make_error_code(CommonErrors::no_such_element))
-      return false;
-    throw;
-  }
-  return true;
+void ProcessManager::SetOnRestartHistoryChanged(OnRestartHistoryChangedFunctor functor) {
+  on_restart_history_changed_ = std::move(functor);
 }
 
-VaultInfo ProcessManager::Find(const NonEmptyString& label) const {
-  return DoFind(label)->info;
+void ProcessManager::SetOnVaultFailed(OnVaultFailedFunctor functor) {
+  on_vault_failed_ = std::move(functor);
 }
 
-std::vector<ProcessManager::Child>::const_iterator ProcessManager::DoFind(
-    const NonEmptyString& label) const {
-  auto itr(std::find_if(std::begin(vaults_), std::end(vaults_),
-                        [this, &label](const Child& vault) {
-                          return vault.info.label == label;
-                        }));
-  if (itr == std::end(vaults_)) {
-    LOG(kError) << "Vault process with label " << label.string() << " doesn't exist.";
-    BOOST_THROW_EXCEPTION(MakeError(CommonErrors::no_such_element));
-  }
-  return itr;
+void ProcessManager::SetOnVaultRemoved(OnVaultRemovedFunctor functor) {
+  on_vault_removed_ = std::move(functor);
 }
 
-std::vector<ProcessManager::Child>::iterator ProcessManager::DoFind(const NonEmptyString& label) {
-  auto itr(std::find_if(std::begin(vaults_), std::end(vaults_),
-                        [this, &label](const Child& vault) {
-                          return vault.info.label == label;
-                        }));
-  if (itr == std::end(vaults_)) {
-    LOG(kError) << "Vault process with label " << label.string() << " doesn't exist.";
-    BOOST_THROW_EXCEPTION(MakeError(CommonErrors::no_such_element));
-  }
-  return itr;
+std::vector<ExitRecord> ProcessManager::GetExitHistory(const NonEmptyString& label) const {
+  return DoFind(label).exit_history.Contents();
 }
 
-VaultInfo ProcessManager::Find(tcp::ConnectionPtr connection) const {
-  return DoFind(connection)->info;
+void ProcessManager::SetRestartThrottle(size_t burst, std::chrono::milliseconds refill_interval) {
+  restart_throttle_->bucket = TokenBucket(burst, refill_interval, std::chrono::steady_clock::now());
+  LOG(kInfo) << "Throttling vault restarts to " << burst << " at once, then one every "
+             << refill_interval.count() << " ms.";
+  if (!restart_throttle_->queued.empty())
+    ServeRestartQueue();
 }
 
-std::vector<ProcessManager::Child>::const_iterator ProcessManager::DoFind(
-    tcp::ConnectionPtr connection) const {
-  auto itr(std::find_if(std::begin(vaults_), std::end(vaults_),
-                        [this, connection](const Child& vault) {
-                          return ConnectionsEqual(vault.info.tcp_connection, connection);
-                        }));
-  if (itr == std::end(vaults_))
-    BOOST_THROW_EXCEPTION(MakeError(CommonErrors::no_such_element));
-  return itr;
+RestartQueueStats ProcessManager::GetRestartQueueStats() const {
+  RestartQueueStats stats(restart_throttle_->stats);
+  stats.queued = restart_throttle_->queued.size();
+  stats.tokens = restart_throttle_->bucket.Available(std::chrono::steady_clock::now());
+  return stats;
 }
 
-std::vector<ProcessManager::Child>::iterator ProcessManager::DoFind(tcp::ConnectionPtr connection) {
-  auto itr(std::find_if(std::begin(vaults_), std::end(vaults_),
-                        [this, connection](const Child& vault) {
-                          return ConnectionsEqual(vault.info.tcp_connection, connection);
-                        }));
-  if (itr == std::end(vaults_))
-    BOOST_THROW_EXCEPTION(MakeError(CommonErrors::no_such_element));
-  return itr;
+void ProcessManager::SetOnAttachedVaultsChanged(OnAttachedVaultsChangedFunctor functor) {
+  on_attached_vaults_changed_ = std::move(functor);
 }
 
-ProcessId ProcessManager::GetProcessId(const Child& vault) const {
+void ProcessManager::SetSparePool(size_t pool_size, OnSpareAssignedFunctor on_assigned) {
 #ifdef MAIDSAFE_WIN32
-  return static_cast<ProcessId>(vault.process.proc_info.dwProcessId);
+  static_cast<void>(on_assigned);
+  if (pool_size != 0)
+    LOG(kWarning) << "Spare vault pool isn't supported on Windows.";
 #else
-  return static_cast<ProcessId>(vault.process.pid);
+  if (pool_size != 0 && !on_assigned)
+    BOOST_THROW_EXCEPTION(MakeError(CommonErrors::invalid_parameter));
+  spare_pool_size_ = pool_size;
+  on_spare_assigned_ = std::move(on_assigned);
+  while (spares_.size() > spare_pool_size_)
+    OnSpareExit(spares_.rbegin()->first, true);
+  RefillSpares();
+#endif
+}
+
+bool ProcessManager::HandleSpareStarted(tcp::ConnectionPtr connection, ProcessId process_id) {
+#ifdef MAIDSAFE_WIN32
+  static_cast<void>(connection);
+  static_cast<void>(process_id);
+  return false;
+#else
+  auto itr(spares_.find(process_id));
+  if (itr == std::end(spares_) || itr->second.connection)
+    return false;
+  itr->second.timer->cancel();
+  itr->second.connection = connection;
+  connect_timeout_.Sample(std::chrono::steady_clock::now() - itr->second.launch_time);
+  consecutive_spare_failures_ = 0;
+  LOG(kVerbose) << "Spare vault with process ID " << process_id << " is ready.";
+  return true;
+#endif
+}
+
+void ProcessManager::EnableCgroups(const fs::path& cgroup_root) {
+  cgroups_ = maidsafe::make_unique<Cgroups>(cgroup_root);
+}
+
+void ProcessManager::SetResourceLimits(const NonEmptyString& label, const ResourceLimits& limits) {
+  Child& vault(DoFind(label));
+  if (cgroups_ && GetProcessId(vault) != 0 && vault.instance_id == 0)
+    cgroups_->SetLimits(label, limits);
+  vault.info.resource_limits = limits;
+}
+
+bool ProcessManager::SetSchedulingClass(const NonEmptyString& label,
+                                        SchedulingClass scheduling_class) {
+  Child& vault(DoFind(label));
+  vault.info.scheduling_class = scheduling_class;
+  if (vault.instance_id != 0)  // It shares the VaultManager's priority.
+    return false;
+  if (GetProcessId(vault) == 0)
+    return true;
+  return ApplySchedulingClass(GetProcessId(vault), scheduling_class);
+}
+
+void ProcessManager::SetLaunchProfiles(std::map<std::string, LaunchProfile> launch_profiles) {
+  launch_profiles_ = std::move(launch_profiles);
+  LOG(kInfo) << launch_profiles_.size() << " launch profiles defined.";
+}
+
+void ProcessManager::EnableInProcessHosting(const fs::path& host_dir,
+                                            std::vector<std::string> host_args) {
+#ifdef MAIDSAFE_WIN32
+  static_cast<void>(host_dir);
+  static_cast<void>(host_args);
+  LOG(kWarning) << "In-process hosting isn't supported on Windows.";
+#else
+  if (host_dir.empty())
+    BOOST_THROW_EXCEPTION(MakeError(CommonErrors::invalid_parameter));
+  if (InProcessHostingEnabled()) {
+    LOG(kError) << "In-process hosting is already enabled.";
+    BOOST_THROW_EXCEPTION(MakeError(CommonErrors::already_initialised));
+  }
+  host_dir_ = host_dir;
+  host_args_ = std::move(host_args);
+#endif
+}
+
+bool ProcessManager::InProcessHostingEnabled() const {
+#ifdef MAIDSAFE_WIN32
+  return false;
+#else
+  return !host_dir_.empty();
+#endif
+}
+
+bool ProcessManager::HandleVaultHostStarted(tcp::ConnectionPtr connection, ProcessId process_id) {
+#ifdef MAIDSAFE_WIN32
+  static_cast<void>(connection);
+  static_cast<void>(process_id);
+  return false;
+#else
+  if (!host_ || host_->connection || process_id != HostProcessId())
+    return false;
+  host_->timer.cancel();
+  host_->connection = connection;
+  connect_timeout_.Sample(std::chrono::steady_clock::now() - host_->launch_time);
+  LOG(kInfo) << "Vault host with process ID " << process_id << " is ready; starting "
+             << host_->queued.size() << " vaults in it.";
+  for (ProcessId instance_id : host_->queued)
+    SendStartInstanceRequest(connection, instance_id);
+  host_->queued.clear();
+  return true;
+#endif
+}
+
+bool ProcessManager::HandleInstanceExited(tcp::ConnectionPtr connection, ProcessId instance_id,
+                                          int exit_code) {
+#ifdef MAIDSAFE_WIN32
+  static_cast<void>(connection);
+  static_cast<void>(instance_id);
+  static_cast<void>(exit_code);
+  return false;
+#else
+  if (!host_ || !connection || host_->connection != connection)
+    return false;
+  OnInstanceExit(instance_id, exit_code);
+  return true;
+#endif
+}
+
+bool ProcessManager::HasLaunchProfile(const std::string& name) const {
+  return launch_profiles_.count(name) != 0;
+}
+
+void ProcessManager::EnablePlacement(PlacementPolicy policy, const Topology& topology) {
+  placement_ = maidsafe::make_unique<Placement>(topology, policy);
+  LOG(kInfo) << "Placing vaults across " << topology.size() << " NUMA nodes.";
+}
+
+void ProcessManager::EnableResourceSampling(std::chrono::milliseconds interval,
+                                            size_t history_size) {
+  if (interval.count() <= 0 || history_size == 0)
+    BOOST_THROW_EXCEPTION(MakeError(CommonErrors::invalid_parameter));
+#ifdef MAIDSAFE_LINUX
+  StopSampling();
+  sampler_ = std::make_shared<Sampler>(io_service_, interval, history_size);
+  sampler_->pending.reserve(vaults_.Size());
+  vaults_.ForEach([&](Child& vault) {
+    vault.resource_history = RingBuffer<ResourceSample>(history_size);
+  });
+  ScheduleSampling();
+  LOG(kInfo) << "Sampling vault resource usage every " << interval.count() << " ms.";
+#else
+  LOG(kWarning) << "Resource sampling is only supported on Linux.";
+#endif
+}
+
+std::vector<ResourceSample> ProcessManager::GetResourceUsage(const NonEmptyString& label) const {
+  return DoFind(label).resource_history.Contents();
+}
+
+void ProcessManager::ScheduleSampling() {
+  sampler_->timer.expires_from_now(sampler_->interval);
+  std::weak_ptr<Sampler> sampler(sampler_);
+  sampler_->timer.async_wait([this, sampler](const boost::system::error_code& error_code) {
+    if ((error_code && error_code == boost::asio::error::operation_aborted) || sampler.expired())
+      return;
+    StartSamplingPass();
+  });
+}
+
+void ProcessManager::StartSamplingPass() {
+  // Only the process IDs are gathered up front; a vault which exits or restarts before its batch
+  // is read is simply skipped.  The vector's capacity is kept between passes.
+  sampler_->pending.clear();
+  sampler_->next = 0;
+  vaults_.ForEach([&](const Child& vault) {
+    // An in-process vault's usage can't be told apart from the VaultManager's own.
+    if (vault.instance_id != 0)
+      return;
+    if (vault.status == ProcessStatus::kStarting || vault.status == ProcessStatus::kRunning)
+      sampler_->pending.push_back(GetProcessId(vault));
+  });
+  SampleNextBatch();
+}
+
+void ProcessManager::SampleNextBatch() {
+  const size_t kEnd(std::min(sampler_->next + kResourceSampleBatchSize, sampler_->pending.size()));
+  ResourceSample sample;
+  for (; sampler_->next < kEnd; ++sampler_->next) {
+    Child* vault(vaults_.Find(sampler_->pending[sampler_->next]));
+    if (!vault || !sampler_->reader.Read(sampler_->pending[sampler_->next], sample))
+      continue;
+    // A vault added since sampling was enabled allocates its history on its first sample.
+    if (vault->resource_history.Capacity() != sampler_->history_size)
+      vault->resource_history = RingBuffer<ResourceSample>(sampler_->history_size);
+    vault->resource_history.Push(sample);
+    if (memory_watchdog_)
+      CheckRss(*vault, sample.rss);
+  }
+
+  if (sampler_->next < sampler_->pending.size()) {
+    std::weak_ptr<Sampler> sampler(sampler_);
+    io_service_.post([this, sampler] {
+      // Sampling may have been stopped or re-enabled since this batch was posted.
+      if (!sampler.expired())
+        SampleNextBatch();
+    });
+  } else {
+    if (memory_watchdog_)
+      CheckMemoryPressure();
+    ScheduleSampling();
+  }
+}
+
+void ProcessManager::StopSampling() {
+  if (!sampler_)
+    return;
+  boost::system::error_code ignored_ec;
+  sampler_->timer.cancel(ignored_ec);
+  sampler_.reset();
+}
+
+void ProcessManager::EnableMemoryWatchdog(const MemoryWatchdogOptions& options) {
+  if (options.pressure_threshold < 0.0 || options.pressure_threshold > 100.0 ||
+      options.pressure_restart_interval.count() < 0) {
+    BOOST_THROW_EXCEPTION(MakeError(CommonErrors::invalid_parameter));
+  }
+  if (!sampler_) {
+    LOG(kError) << "The memory watchdog needs resource sampling to be enabled.";
+    BOOST_THROW_EXCEPTION(MakeError(CommonErrors::uninitialised));
+  }
+  memory_watchdog_ = std::make_shared<MemoryWatchdog>(options);
+  if (options.pressure_threshold != 0.0) {
+    MemoryPressure pressure;
+    if (!sampler_->reader.ReadMemoryPressure(pressure)) {
+      LOG(kWarning) << "Host memory pressure isn't available; only vaults' own RSS will be "
+                    << "checked.";
+    }
+  }
+  LOG(kInfo) << "Memory watchdog enabled: RSS ceiling " << (options.max_rss >> 20) << " MiB, "
+             << "growth ceiling " << (options.max_rss_growth >> 20) << " MiB, pressure threshold "
+             << options.pressure_threshold << "% (zero disables each).";
+}
+
+void ProcessManager::CheckRss(Child& vault, uint64_t rss) {
+  // Memory used while starting isn't counted as growth.
+  if (vault.status != ProcessStatus::kRunning)
+    return;
+  vault.latest_rss = rss;
+  if (vault.initial_rss == 0) {
+    vault.initial_rss = rss;
+    return;
+  }
+  const MemoryWatchdogOptions& options(memory_watchdog_->options);
+  if (options.max_rss != 0 && rss > options.max_rss) {
+    RestartToReleaseMemory(vault, "its RSS of " + std::to_string(rss >> 20) +
+                           " MiB exceeds the ceiling of " + std::to_string(options.max_rss >> 20) +
+                           " MiB");
+  } else if (options.max_rss_growth != 0 && rss > vault.initial_rss + options.max_rss_growth) {
+    RestartToReleaseMemory(vault, "its RSS has grown from " +
+                           std::to_string(vault.initial_rss >> 20) + " MiB to " +
+                           std::to_string(rss >> 20) + " MiB, beyond the growth ceiling of " +
+                           std::to_string(options.max_rss_growth >> 20) + " MiB");
+  }
+}
+
+void ProcessManager::CheckMemoryPressure() {
+  MemoryWatchdog& watchdog(*memory_watchdog_);
+  MemoryPressure pressure;
+  if (watchdog.options.pressure_threshold == 0.0 ||
+      !sampler_->reader.ReadMemoryPressure(pressure)) {
+    return;
+  }
+  const bool kUnderPressure(pressure.full_avg10 >= watchdog.options.pressure_threshold);
+  if (kUnderPressure && !watchdog.under_pressure) {
+    LOG(kWarning) << "Host memory pressure has risen to " << pressure.full_avg10 << "% (full), "
+                  << pressure.some_avg10 << "% (some), reaching the threshold of "
+                  << watchdog.options.pressure_threshold << "%.";
+  } else if (!kUnderPressure && watchdog.under_pressure) {
+    LOG(kInfo) << "Host memory pressure has eased to " << pressure.full_avg10 << "% (full), "
+               << pressure.some_avg10 << "% (some).";
+  }
+  watchdog.under_pressure = kUnderPressure;
+  const auto kNow(std::chrono::steady_clock::now());
+  if (!kUnderPressure ||
+      kNow - watchdog.last_pressure_restart < watchdog.options.pressure_restart_interval) {
+    return;
+  }
+
+  Child* largest_growth(nullptr);
+  uint64_t growth(0);
+  vaults_.ForEach([&](Child& vault) {
+    if (vault.status != ProcessStatus::kRunning || vault.initial_rss == 0 ||
+        vault.latest_rss <= vault.initial_rss) {
+      return;
+    }
+    if (vault.latest_rss - vault.initial_rss > growth) {
+      growth = vault.latest_rss - vault.initial_rss;
+      largest_growth = &vault;
+    }
+  });
+  if (!largest_growth ||
+      growth < static_cast<uint64_t>(kMemoryPressureMinRssGrowth * largest_growth->initial_rss)) {
+    LOG(kInfo) << "Not restarting any vault despite host memory pressure of "
+               << pressure.full_avg10 << "%, since none has grown by more than "
+               << 100.0 * kMemoryPressureMinRssGrowth << "% of its initial RSS.";
+    return;
+  }
+  watchdog.last_pressure_restart = kNow;
+  RestartToReleaseMemory(*largest_growth, "host memory pressure is " +
+                         std::to_string(pressure.full_avg10) + "%, and its RSS has grown the "
+                         "most of any vault, by " + std::to_string(growth >> 20) + " MiB");
+}
+
+void ProcessManager::RestartToReleaseMemory(Child& vault, const std::string& reason) {
+  LOG(kWarning) << "Restarting vault " << vault.info.label.string() << " since " << reason << '.';
+  if (!RestartOnto(vault, vault.executable)) {
+    LOG(kWarning) << "Vault " << vault.info.label.string() << " isn't running, so can't be "
+                  << "restarted.";
+  }
+}
+
+void ProcessManager::EnableHeartbeats(std::chrono::milliseconds interval, int missed_threshold) {
+  if (interval.count() <= 0 || missed_threshold < 1)
+    BOOST_THROW_EXCEPTION(MakeError(CommonErrors::invalid_parameter));
+  StopHeartbeats();
+  heartbeats_ = std::make_shared<Heartbeats>(io_service_, interval, missed_threshold);
+  ScheduleHeartbeats();
+  LOG(kInfo) << "Sending vaults heartbeats every " << interval.count() << " ms; "
+             << missed_threshold << " missed in a row will restart a vault.";
+}
+
+void ProcessManager::HandleHeartbeatResponse(tcp::ConnectionPtr connection,
+                                             uint64_t sequence_number,
+                                             std::chrono::microseconds loop_lag,
+                                             std::chrono::system_clock::time_point vault_time) {
+  Child* vault(vaults_.Find(connection));
+  if (!vault)
+    return;
+  HeartbeatState& heartbeat(vault->heartbeat);
+  if (!heartbeat.awaiting_reply || sequence_number != heartbeat.sequence_number) {
+    LOG(kVerbose) << "Ignoring late heartbeat reply " << sequence_number << " from vault "
+                  << vault->info.label.string();
+    return;
+  }
+  auto round_trip(std::chrono::duration_cast<std::chrono::microseconds>(
+      std::chrono::steady_clock::now() - heartbeat.sent));
+  heartbeat.awaiting_reply = false;
+  heartbeat.consecutive_missed = 0;
+
+  HeartbeatStats& stats(heartbeat.stats);
+  stats.smoothed_round_trip = (stats.answered == 0) ? round_trip :
+                              (7 * stats.smoothed_round_trip + round_trip) / 8;
+  ++stats.answered;
+  stats.last_round_trip = round_trip;
+  stats.max_round_trip = std::max(stats.max_round_trip, round_trip);
+  stats.loop_lag = loop_lag;
+  // Assume the reply took half the round trip to reach us.
+  stats.clock_offset = std::chrono::duration_cast<std::chrono::milliseconds>(
+      vault_time - (std::chrono::system_clock::now() - round_trip / 2));
+}
+
+HeartbeatStats ProcessManager::GetHeartbeatStats(const NonEmptyString& label) const {
+  return DoFind(label).heartbeat.stats;
+}
+
+void ProcessManager::ScheduleHeartbeats() {
+  heartbeats_->timer.expires_from_now(heartbeats_->interval);
+  std::weak_ptr<Heartbeats> heartbeats(heartbeats_);
+  heartbeats_->timer.async_wait([this, heartbeats](const boost::system::error_code& error_code) {
+    if ((error_code && error_code == boost::asio::error::operation_aborted) ||
+        heartbeats.expired()) {
+      return;
+    }
+    SendHeartbeats();
+  });
+}
+
+void ProcessManager::SendHeartbeats() {
+  const auto kNow(std::chrono::steady_clock::now());
+  const int kMissedThreshold(heartbeats_->missed_threshold);
+  std::vector<NonEmptyString> hung_labels;
+  vaults_.ForEach([&](Child& vault) {
+    if (vault.status != ProcessStatus::kRunning || !vault.info.tcp_connection)
+      return;
+    HeartbeatState& heartbeat(vault.heartbeat);
+    if (heartbeat.awaiting_reply) {
+      ++heartbeat.stats.missed;
+      if (++heartbeat.consecutive_missed >= kMissedThreshold) {
+        hung_labels.push_back(vault.info.label);
+        return;
+      }
+    }
+    heartbeat.awaiting_reply = true;
+    heartbeat.sent = kNow;
+    SendHeartbeat(vault.info.tcp_connection, ++heartbeat.sequence_number);
+  });
+
+  for (const auto& label : hung_labels) {
+    LOG(kError) << "Vault " << label.string() << " has missed " << kMissedThreshold
+                << " heartbeats in a row and is assumed to have hung.";
+    OnProcessExit(label, ExitStatus(), true);
+  }
+  // An on_exit functor may have stopped everything.
+  if (heartbeats_)
+    ScheduleHeartbeats();
+}
+
+void ProcessManager::StopHeartbeats() {
+  if (!heartbeats_)
+    return;
+  boost::system::error_code ignored_ec;
+  heartbeats_->timer.cancel(ignored_ec);
+  heartbeats_.reset();
+}
+
+void ProcessManager::MarkCredentialsSent(const NonEmptyString& label) {
+  Child& vault(DoFind(label));
+  vault.credentials_time = std::chrono::steady_clock::now();
+  RecordLatency(vault, LifecyclePhase::kCredentials, vault.credentials_time - vault.connected_time);
+}
+
+void ProcessManager::MarkJoinedNetwork(tcp::ConnectionPtr connection) {
+  Child& vault(DoFind(connection));
+  if (vault.status == ProcessStatus::kRunning)
+    SettleUpgrade(vault.info.label, MakeError(CommonErrors::success));
+  // Only the first JoinedNetwork after the credentials were sent completes the start.
+  if (vault.credentials_time == std::chrono::steady_clock::time_point())
+    return;
+  auto now(std::chrono::steady_clock::now());
+  RecordLatency(vault, LifecyclePhase::kNetworkJoin, now - vault.credentials_time);
+  RecordLatency(vault, LifecyclePhase::kTotal, now - vault.start_time);
+  vault.credentials_time = std::chrono::steady_clock::time_point();
+}
+
+std::vector<PhaseLatency> ProcessManager::GetLifecycleLatencies(
+    const NonEmptyString& label) const {
+  return DoFind(label).latencies->Summarise();
+}
+
+std::vector<PhaseLatency> ProcessManager::GetLifecycleLatencies() const {
+  return host_latencies_.Summarise();
+}
+
+void ProcessManager::RecordLatency(Child& vault, LifecyclePhase phase,
+                                   std::chrono::steady_clock::duration duration) {
+  vault.latencies->Record(phase, duration);
+  host_latencies_.Record(phase, duration);
+}
+
+void ProcessManager::LogLifecycleLatencies() const {
+  for (const auto& latency : host_latencies_.Summarise()) {
+    if (latency.count == 0)
+      continue;
+    LOG(kInfo) << "Vault start phase " << latency.phase << " over " << latency.count
+               << " starts: p50 " << latency.p50.count() << " us, p90 " << latency.p90.count()
+               << " us, p99 " << latency.p99.count() << " us, max " << latency.max.count()
+               << " us";
+  }
+}
+
+void ProcessManager::Upgrade(const fs::path& new_executable_path, UpgradeOptions options,
+                             OnUpgradeProgressFunctor on_progress, OnUpgradedFunctor on_upgraded) {
+  if (rollout_) {
+    LOG(kError) << "An upgrade to " << rollout_->to << " is already in progress.";
+    BOOST_THROW_EXCEPTION(MakeError(CommonErrors::unable_to_handle_request));
+  }
+  if (options.wave_size == 0 || options.failure_threshold < 0.0 ||
+      options.failure_threshold > 1.0) {
+    LOG(kError) << "Invalid upgrade options: wave size " << options.wave_size
+                << ", failure threshold " << options.failure_threshold;
+    BOOST_THROW_EXCEPTION(MakeError(CommonErrors::invalid_parameter));
+  }
+  CheckExecutable(new_executable_path);
+  boost::system::error_code ec;
+  if (fs::equivalent(new_executable_path, vault_executable_path_, ec) || ec) {
+    LOG(kError) << new_executable_path << " is already the vault executable.  "
+                << (ec ? ec.message() : "");
+    BOOST_THROW_EXCEPTION(MakeError(CommonErrors::invalid_parameter));
+  }
+
+  auto rollout(std::make_shared<Rollout>(io_service_, vault_executable_path_, new_executable_path,
+      std::move(options), std::move(on_progress), std::move(on_upgraded)));
+  QueueForRollout(*rollout);
+  rollout_ = rollout;
+  LOG(kInfo) << "Upgrading " << rollout->progress.total << " vaults from " << rollout->from
+             << " to " << rollout->to << ", " << rollout->options.wave_size << " at a time.";
+  StartWave(rollout);
+}
+
+void ProcessManager::QueueForRollout(Rollout& rollout) {
+  vault_executable_path_ = rollout.to;
+#ifndef MAIDSAFE_WIN32
+  ReplaceSpares();
+#endif
+  rollout.queued.clear();
+  vaults_.ForEach([&](const Child& vault) {
+    // In-process vaults don't run the executable.
+    if (vault.executable != rollout.to && vault.status != ProcessStatus::kStopping &&
+        vault.instance_id == 0) {
+      rollout.queued.push_back(vault.info.label);
+    }
+  });
+  rollout.progress.total = rollout.queued.size();
+}
+
+void ProcessManager::StartWave(const std::shared_ptr<Rollout>& rollout) {
+  if (rollout != rollout_)
+    return;
+  while (rollout->wave.size() < rollout->options.wave_size && !rollout->queued.empty()) {
+    NonEmptyString label{ rollout->queued.front() };
+    rollout->queued.pop_front();
+    Child* vault(vaults_.Find(label));
+    if (!vault || vault->status == ProcessStatus::kStopping) {
+      ++rollout->progress.skipped;
+    } else if (RestartOnto(*vault, rollout->to)) {
+      rollout->wave.insert(label);
+    } else {
+      // It will use the new executable whenever it's next started, but can't be waited for.
+      ++rollout->progress.upgraded;
+    }
+  }
+  if (rollout->wave.empty()) {
+    EndWave(rollout);
+    return;
+  }
+
+  std::weak_ptr<Rollout> rollout_weak_ptr{ rollout };
+  rollout->wave_timer.expires_from_now(rollout->options.join_timeout);
+  rollout->wave_timer.async_wait([this, rollout_weak_ptr](const boost::system::error_code& ec) {
+    std::shared_ptr<Rollout> rollout{ rollout_weak_ptr.lock() };
+    if ((ec && ec == boost::asio::error::operation_aborted) || !rollout)
+      return;
+    OnWaveTimeout(rollout);
+  });
+}
+
+bool ProcessManager::RestartOnto(Child& vault, const fs::path& executable) {
+  vault.executable = executable;
+  NonEmptyString label{ vault.info.label };
+  switch (vault.status) {
+    case ProcessStatus::kRunning:
+      vault.status = ProcessStatus::kStopping;
+      vault.restarting = true;
+      // Unless it's already exiting, having closed its connection.
+      if (vault.info.tcp_connection)
+        SendVaultShutdownRequest(vault.info.tcp_connection);
+      vault.timer->expires_from_now(kVaultStopTimeout);
+      vault.timer->async_wait([this, label](const boost::system::error_code& error_code) {
+        if (error_code && error_code == boost::asio::error::operation_aborted)
+          return;
+        LOG(kWarning) << "Timed out waiting for vault " << label.string() << " to stop for "
+                      << "restart; terminating now.";
+        OnProcessExit(label, ExitStatus(), true);
+      });
+      return true;
+    case ProcessStatus::kStarting:
+      // It can't be asked to stop until it has connected, so start it again straight away.
+      vault.status = ProcessStatus::kStopping;
+      vault.restarting = true;
+      OnProcessExit(label, ExitStatus(), true);
+      return true;
+    default:
+      return false;
+  }
+}
+
+void ProcessManager::SettleUpgrade(const NonEmptyString& label, const maidsafe_error& result) {
+  std::shared_ptr<Rollout> rollout{ rollout_ };
+  if (!rollout || rollout->wave.erase(label) == 0U)
+    return;
+  if (result.code() == make_error_code(CommonErrors::success)) {
+    ++rollout->progress.upgraded;
+  } else if (result.code() == make_error_code(CommonErrors::no_such_element)) {
+    ++rollout->progress.skipped;
+  } else {
+    LOG(kWarning) << "Vault " << label.string() << " failed on " << rollout->to << ": "
+                  << result.what();
+    if (rollout->progress.failed++ == 0U && !rollout->progress.rolling_back)
+      rollout->first_error = result;
+  }
+  if (rollout->on_progress) {
+    try {
+      rollout->on_progress(rollout->progress);
+    }
+    catch (const std::exception& e) {
+      LOG(kError) << "Error executing on_progress functor: " << boost::diagnostic_information(e);
+    }
+  }
+  if (rollout->wave.empty()) {
+    boost::system::error_code ignored_ec;
+    rollout->wave_timer.cancel(ignored_ec);
+    // Settling can happen deep within OnProcessExit, so move on once that has unwound.
+    io_service_.post([this, rollout] { EndWave(rollout); });
+  }
+}
+
+void ProcessManager::OnWaveTimeout(const std::shared_ptr<Rollout>& rollout) {
+  if (rollout != rollout_)
+    return;
+  LOG(kWarning) << rollout->wave.size() << " vaults didn't rejoin the network within "
+                << std::chrono::duration_cast<std::chrono::seconds>(
+                       rollout->options.join_timeout).count() << " s of being upgraded.";
+  std::vector<NonEmptyString> late(std::begin(rollout->wave), std::end(rollout->wave));
+  for (const auto& label : late)
+    SettleUpgrade(label, MakeError(VaultManagerErrors::timed_out));
+}
+
+void ProcessManager::EndWave(const std::shared_ptr<Rollout>& rollout) {
+  if (rollout != rollout_)
+    return;
+  const UpgradeProgress& progress(rollout->progress);
+  size_t attempted(progress.upgraded + progress.failed);
+  if (!progress.rolling_back && progress.failed != 0U &&
+      static_cast<double>(progress.failed) >
+          rollout->options.failure_threshold * static_cast<double>(attempted)) {
+    LOG(kError) << progress.failed << " of " << attempted << " upgraded vaults failed; rolling "
+                << "back to " << rollout->from;
+    std::swap(rollout->from, rollout->to);
+    rollout->progress = UpgradeProgress();
+    rollout->progress.rolling_back = true;
+    QueueForRollout(*rollout);
+  }
+  if (rollout->queued.empty()) {
+    FinishUpgrade(rollout->progress.rolling_back ? rollout->first_error :
+                                                   MakeError(CommonErrors::success));
+  } else {
+    io_service_.post([this, rollout] { StartWave(rollout); });
+  }
+}
+
+void ProcessManager::FinishUpgrade(const maidsafe_error& error) {
+  std::shared_ptr<Rollout> rollout{ rollout_ };
+  rollout_.reset();
+  boost::system::error_code ignored_ec;
+  rollout->wave_timer.cancel(ignored_ec);
+  LOG(kInfo) << "Upgrade to " << rollout->to << " finished: " << rollout->progress.upgraded
+             << " vaults upgraded, " << rollout->progress.failed << " failed, "
+             << rollout->progress.skipped << " skipped.";
+  if (!rollout->on_upgraded)
+    return;
+  try {
+    rollout->on_upgraded(error, rollout->progress);
+  }
+  catch (const std::exception& e) {
+    LOG(kError) << "Error executing on_upgraded functor: " << boost::diagnostic_information(e);
+  }
+}
+
+void ProcessManager::StopUpgrade() {
+  if (!rollout_)
+    return;
+  // The vaults are about to be stopped for good.
+  vaults_.ForEach([](Child& vault) { vault.restarting = false; });
+  FinishUpgrade(MakeError(CommonErrors::unable_to_handle_request));
+}
+
+void ProcessManager::AdmitRestart(Child& vault) {
+  RestartThrottle& throttle(*restart_throttle_);
+  const std::chrono::steady_clock::time_point kNow(std::chrono::steady_clock::now());
+  // Restarts already waiting go first.
+  if (throttle.queued.empty() && throttle.bucket.TryTake(kNow)) {
+    ++throttle.stats.admitted;
+    StartDueVault(vault);
+    return;
+  }
+  throttle.queued.emplace_back(vault.info.label, kNow);
+  throttle.stats.peak_queued = std::max(throttle.stats.peak_queued, throttle.queued.size());
+  LOG(kInfo) << "Restart of vault " << vault.info.label.string() << " throttled; "
+             << throttle.queued.size() << " restarts queued.";
+  if (throttle.queued.size() == 1U)
+    ScheduleRestartQueue();
+}
+
+void ProcessManager::ScheduleRestartQueue() {
+  restart_throttle_->timer.expires_from_now(
+      restart_throttle_->bucket.TimeUntilAvailable(std::chrono::steady_clock::now()));
+  std::weak_ptr<RestartThrottle> throttle(restart_throttle_);
+  restart_throttle_->timer.async_wait([this, throttle](const boost::system::error_code& ec) {
+    if ((ec && ec == boost::asio::error::operation_aborted) || !throttle.lock())
+      return;
+    ServeRestartQueue();
+  });
+}
+
+void ProcessManager::ServeRestartQueue() {
+  RestartThrottle& throttle(*restart_throttle_);
+  const std::chrono::steady_clock::time_point kNow(std::chrono::steady_clock::now());
+  while (!throttle.queued.empty()) {
+    const NonEmptyString label(throttle.queued.front().first);
+    Child* vault(vaults_.Find(label));
+    // Skip vaults which have since been removed, stopped or started by other means.
+    if (!vault || vault->status != ProcessStatus::kBeforeStarted || GetProcessId(*vault) != 0) {
+      throttle.queued.pop_front();
+      continue;
+    }
+    if (!throttle.bucket.TryTake(kNow))
+      break;
+    const auto kWait(std::chrono::duration_cast<std::chrono::milliseconds>(
+        kNow - throttle.queued.front().second));
+    throttle.queued.pop_front();
+    ++throttle.stats.admitted;
+    ++throttle.stats.throttled;
+    throttle.stats.longest_wait = std::max(throttle.stats.longest_wait, kWait);
+    LOG(kVerbose) << "Restarting vault " << label.string() << " after waiting " << kWait.count()
+                  << " ms; " << throttle.queued.size() << " restarts still queued.";
+    StartDueVault(*vault);
+  }
+  if (!throttle.queued.empty())
+    ScheduleRestartQueue();
+}
+
+void ProcessManager::StopRestartThrottle() {
+  boost::system::error_code ignored_ec;
+  restart_throttle_->timer.cancel(ignored_ec);
+  restart_throttle_->queued.clear();
+}
+
+#ifndef MAIDSAFE_WIN32
+bool ProcessManager::TakeSpare(Child& vault) {
+  auto itr(std::find_if(std::begin(spares_), std::end(spares_),
+      [&](const std::pair<const ProcessId, Spare>& spare) {
+        return spare.second.connection && spare.second.executable == vault.executable;
+      }));
+  if (itr == std::end(spares_)) {
+    if (spare_pool_size_ != 0)
+      LOG(kInfo) << "No spare vault ready; starting " << vault.info.label.string() << " cold.";
+    return false;
+  }
+
+  NonEmptyString label{ vault.info.label };
+  LOG(kVerbose) << "Assigning spare vault with process ID " << itr->first << " to vault "
+                << label.string();
+  vault.process = itr->second.process;
+  AttachOutput(vault, itr->second.output);
+  vault.info.tcp_connection = itr->second.connection;
+  vaults_.SetConnection(label, vault.info.tcp_connection);
+  vault.status = ProcessStatus::kRunning;
+  vault.start_time = std::chrono::steady_clock::now();
+  // The spare already connected, so this start has no Spawn phase.
+  vault.connected_time = vault.start_time;
+  vault.credentials_time = std::chrono::steady_clock::time_point();
+  vault.timer->cancel();
+  spares_.erase(itr);
+  PlaceInCgroup(vault);
+  PinToCpus(vault);
+  Prioritise(vault);
+  vault.oom_kills_at_launch = ReadOomKills(vault);
+  // Posted since the caller only registers the vault's process ID once this returns.
+  io_service_.post([this, label] { OnSpareAssigned(label); });
+  io_service_.post([this] { RefillSpares(); });
+  return true;
+}
+
+void ProcessManager::AttachOutput(Child& vault, std::shared_ptr<VaultOutput> output) {
+  if (vault.output)
+    vault.output->Close();
+  vault.output = std::move(output);
+  if (!vault.output)
+    return;
+  // An adopted vault's output is collected even if capture isn't enabled here.
+  const bool kEnabled(output_max_file_size_ != 0);
+  vault.output->Attach(vault.info.vault_dir / "logs",
+                       kEnabled ? output_max_file_size_ : kVaultOutputMaxFileSize,
+                       kEnabled ? output_rotated_files_ : kVaultOutputRotatedFiles);
+}
+
+void ProcessManager::OnSpareAssigned(const NonEmptyString& label) {
+  Child* vault(vaults_.Find(label));
+  if (!vault || vault->status != ProcessStatus::kRunning)
+    return;
+  CompleteAdmission(*vault, MakeError(CommonErrors::success));
+  NotifyAttachedVaultsChanged();
+  try {
+    on_spare_assigned_(vault->info, GetProcessId(*vault));
+  }
+  catch (const std::exception& e) {
+    LOG(kError) << "Error executing on_spare_assigned functor: "
+                << boost::diagnostic_information(e);
+  }
+}
+
+void ProcessManager::RefillSpares() {
+  while (spares_.size() < spare_pool_size_) {
+    Spare spare(io_service_, vault_executable_path_);
+    try {
+      // Without a vault_dir there's nowhere to put the log folder, so spares use the default one.
+      spare.process = LaunchProcess(vault_executable_path_, { vault_executable_path_.string(),
+                                    std::to_string(kListeningPort_) }, nullptr, spare.output);
+    }
+    catch (const std::exception& e) {
+      LOG(kError) << "Failed to start spare vault: " << boost::diagnostic_information(e);
+      return;
+    }
+    ProcessId process_id{ static_cast<ProcessId>(spare.process.pid) };
+    spare.timer->expires_from_now(connect_timeout_.Value());
+    spare.timer->async_wait([this, process_id](const boost::system::error_code& error_code) {
+      if (error_code && error_code == boost::asio::error::operation_aborted)
+        return;
+      LOG(kWarning) << "Timed out waiting for spare vault to connect via TCP.";
+      connect_timeout_.OnExpiry();
+      OnSpareExit(process_id, true);
+    });
+    spares_.insert(std::make_pair(process_id, std::move(spare)));
+#ifdef MAIDSAFE_LINUX
+    if (exit_detection_ == ExitDetection::kPidfd)
+      WatchPidfd(process_id);
+#endif
+  }
+}
+
+void ProcessManager::OnSpareExit(ProcessId process_id, bool terminate) {
+  auto itr(spares_.find(process_id));
+  if (itr == std::end(spares_))
+    return;
+  LOG(kWarning) << "Spare vault with process ID " << process_id
+                << (terminate ? " being terminated." : " exited.");
+  if (terminate) {
+    boost::system::error_code ec;
+    bp::terminate(itr->second.process, ec);
+    if (ec)
+      LOG(kWarning) << "Error while terminating spare vault: " << ec.message();
+    RememberTerminated(process_id);
+  }
+  if (itr->second.connection)
+    itr->second.connection->Close();
+  spares_.erase(itr);
+  if (spares_.size() >= spare_pool_size_)
+    return;
+
+  // Back off in case the vault executable is failing to start at all.
+  std::chrono::milliseconds delay{ BackoffDelay(++consecutive_spare_failures_) };
+  spare_refill_timer_.expires_from_now(delay);
+  spare_refill_timer_.async_wait([this](const boost::system::error_code& error_code) {
+    if (error_code && error_code == boost::asio::error::operation_aborted)
+      return;
+    RefillSpares();
+  });
+}
+
+void ProcessManager::ReplaceSpares() {
+  // Unlike OnSpareExit, this isn't a failure of the spares, so don't back off.
+  boost::system::error_code ignored_ec;
+  spare_refill_timer_.cancel(ignored_ec);
+  std::map<ProcessId, Spare> old_spares;
+  old_spares.swap(spares_);
+  for (auto& spare : old_spares) {
+    boost::system::error_code ec;
+    bp::terminate(spare.second.process, ec);
+    RememberTerminated(spare.first);
+    if (spare.second.connection)
+      spare.second.connection->Close();
+  }
+  consecutive_spare_failures_ = 0;
+  RefillSpares();
+}
+
+void ProcessManager::DrainSparePool() {
+  spare_pool_size_ = 0;
+  boost::system::error_code ignored_ec;
+  spare_refill_timer_.cancel(ignored_ec);
+  while (!spares_.empty())
+    OnSpareExit(spares_.begin()->first, true);
+}
+
+void ProcessManager::StartInstance(Child& vault) {
+  if (!host_)
+    LaunchHost();
+  vault.instance_id = next_instance_id_++;
+  vault.status = ProcessStatus::kStarting;
+  vault.start_time = std::chrono::steady_clock::now();
+  vault.credentials_time = std::chrono::steady_clock::time_point();
+  if (host_->connection)
+    SendStartInstanceRequest(host_->connection, vault.instance_id);
+  else
+    host_->queued.push_back(vault.instance_id);
+  LOG(kInfo) << "Starting vault " << vault.info.label.string() << " in vault host as instance "
+             << vault.instance_id;
+  AwaitConnection(vault);
+}
+
+void ProcessManager::TerminateInstance(Child& vault) {
+  NonEmptyString label{ vault.info.label };
+  LOG(kWarning) << "Asking hosted vault " << label.string() << " to stop.";
+  vault.terminating = true;
+  vault.restart_when_stopped = vault.status != ProcessStatus::kStopping;
+  vault.status = ProcessStatus::kStopping;
+  if (host_->connection)
+    SendStopInstanceRequest(host_->connection, vault.instance_id);
+  vault.timer->expires_from_now(kVaultStopTimeout);
+  vault.timer->async_wait([this, label](const boost::system::error_code& error_code) {
+    if (error_code && error_code == boost::asio::error::operation_aborted)
+      return;
+    Child* vault(vaults_.Find(label));
+    if (!vault || !vault->terminating)
+      return;
+    if (stopping_all_)
+      return KillHost();
+    // Starting it again would have two copies running with the same identity and vault_dir.
+    LOG(kError) << "Hosted vault " << label.string() << " hasn't stopped; quarantining it until "
+                << "it does.";
+    vault->status = ProcessStatus::kQuarantined;
+    CompleteAdmission(*vault, MakeError(VaultManagerErrors::vault_terminated));
+  });
+}
+
+void ProcessManager::OnInstanceExit(ProcessId instance_id, int exit_code) {
+  // Missing if the vault has already been handled as having exited, e.g. along with its host.
+  Child* vault(vaults_.Find(instance_id));
+  if (!vault || vault->instance_id != instance_id)
+    return;
+  NonEmptyString label{ vault->info.label };
+  vaults_.SetProcessId(label, 0);
+  vault->instance_id = 0;
+  // As seen by the VaultManager had the vault returned 'exit_code' from main as a process.
+  OnProcessExit(label, ExitStatus(exit_code & 0xff), vault->terminating);
+}
+
+void ProcessManager::LaunchHost() {
+  std::unique_ptr<Host> host(maidsafe::make_unique<Host>(io_service_, vault_executable_path_));
+  std::vector<std::string> args{ host->executable.string(), std::to_string(kListeningPort_),
+                                 "--log_folder " + (host_dir_ / "logs").string(),
+                                 kVaultHostArgument };
+  args.insert(std::end(args), std::begin(host_args_), std::end(host_args_));
+  host->process = LaunchProcess(host->executable, args, nullptr, host->output);
+  if (host->output)
+    host->output->Attach(host_dir_ / "logs", output_max_file_size_, output_rotated_files_);
+  const ProcessId kProcessId(static_cast<ProcessId>(host->process.pid));
+  host->timer.expires_from_now(connect_timeout_.Value());
+  host->timer.async_wait([this, kProcessId](const boost::system::error_code& error_code) {
+    if ((error_code && error_code == boost::asio::error::operation_aborted) ||
+        HostProcessId() != kProcessId) {
+      return;
+    }
+    LOG(kWarning) << "Timed out waiting for vault host to connect via TCP.";
+    connect_timeout_.OnExpiry();
+    KillHost();
+  });
+  host_ = std::move(host);
+  LOG(kInfo) << "Launched vault host with process ID " << kProcessId;
+#ifdef MAIDSAFE_LINUX
+  if (exit_detection_ == ExitDetection::kPidfd)
+    WatchPidfd(kProcessId);
+#endif
+}
+
+ProcessId ProcessManager::HostProcessId() const {
+  return host_ ? static_cast<ProcessId>(host_->process.pid) : 0;
+}
+
+bool ProcessManager::IsQueuedInstance(ProcessId instance_id) const {
+  return host_ && std::find(std::begin(host_->queued), std::end(host_->queued), instance_id) !=
+                      std::end(host_->queued);
+}
+
+void ProcessManager::StopHost() {
+  if (!host_ || host_->stopping)
+    return;
+  const ProcessId kProcessId(HostProcessId());
+  LOG(kInfo) << "Stopping vault host with process ID " << kProcessId;
+  host_->stopping = true;
+  if (!host_->connection)
+    return KillHost();
+  host_->connection->Close();
+  host_->timer.expires_from_now(kVaultStopTimeout);
+  host_->timer.async_wait([this, kProcessId](const boost::system::error_code& error_code) {
+    if ((error_code && error_code == boost::asio::error::operation_aborted) ||
+        HostProcessId() != kProcessId) {
+      return;
+    }
+    LOG(kWarning) << "Timed out waiting for vault host to exit.";
+    KillHost();
+  });
+}
+
+void ProcessManager::KillHost() {
+  if (!host_)
+    return;
+  LOG(kWarning) << "Killing vault host with process ID " << HostProcessId();
+  boost::system::error_code ec;
+  bp::terminate(host_->process, ec);
+  if (ec)
+    LOG(kWarning) << "Error while killing vault host: " << ec.message();
+}
+
+void ProcessManager::OnHostExit(const ExitStatus& exit_status) {
+  LOG(kWarning) << "Vault host with process ID " << HostProcessId() << " exited.";
+  std::unique_ptr<Host> host;
+  host.swap(host_);
+  if (host->connection)
+    host->connection->Close();
+  if (host->output)
+    host->output->Close();
+  // Every hosted vault, including those the host hadn't started yet, exits along with it.
+  std::vector<NonEmptyString> hosted_labels;
+  vaults_.ForEach([&](const Child& vault) {
+    if (vault.instance_id != 0)
+      hosted_labels.push_back(vault.info.label);
+  });
+  for (const auto& label : hosted_labels) {
+    Child* vault(vaults_.Find(label));
+    if (!vault || vault->instance_id == 0)
+      continue;
+    vaults_.SetProcessId(label, 0);
+    vault->instance_id = 0;
+    OnProcessExit(label, exit_status, vault->terminating);
+  }
+  StopSignalHandlerWhenIdle();
+}
+#endif
+
+#ifndef MAIDSAFE_WIN32
+void ProcessManager::AllowInheritance(int file_descriptor) {
+  if (file_descriptor < 0) {
+    LOG(kError) << "Invalid file descriptor " << file_descriptor;
+    BOOST_THROW_EXCEPTION(MakeError(CommonErrors::invalid_parameter));
+  }
+  inheritable_descriptors_.insert(file_descriptor);
+}
+
+void ProcessManager::EnableOutputCapture(uint64_t max_file_size, int max_rotated_files) {
+  if (max_file_size == 0 || max_rotated_files < 0) {
+    LOG(kError) << "Invalid vault output limits.";
+    BOOST_THROW_EXCEPTION(MakeError(CommonErrors::invalid_parameter));
+  }
+  if (kSpawnMethod_ != SpawnMethod::kPosixSpawn)
+    LOG(kWarning) << "Vault output is only captured when vaults are launched via posix_spawn.";
+  output_max_file_size_ = max_file_size;
+  output_rotated_files_ = max_rotated_files;
+}
+
+Handover ProcessManager::HandOver() {
+  Handover handover;
+  std::call_once(stop_all_flag_, [&] {
+    StopSampling();
+    StopHeartbeats();
+    StopUpgrade();
+    DrainSparePool();
+    orphan_timer_.cancel();
+    boost::system::error_code ignored_ec;
+    signal_set_.cancel(ignored_ec);
+
+    std::vector<NonEmptyString> running_labels, other_labels;
+    // Hosted vaults die with their host, so are stopped along with any which aren't running.
+    vaults_.ForEach([&](const Child& vault) {
+      if (vault.status == ProcessStatus::kRunning && vault.info.tcp_connection &&
+          vault.instance_id == 0) {
+        running_labels.push_back(vault.info.label);
+      } else {
+        other_labels.push_back(vault.info.label);
+      }
+    });
+
+    std::vector<pid_t> terminated;
+    if (host_) {
+      // The successor launches a host of its own if it needs one.
+      terminated.push_back(static_cast<pid_t>(HostProcessId()));
+      KillHost();
+      if (host_->connection)
+        host_->connection->Close();
+      if (host_->output)
+        host_->output->Close();
+      host_.reset();
+    }
+    for (const auto& label : other_labels) {
+      Child& vault(DoFind(label));
+      ProcessId process_id{ GetProcessId(vault) };
+      vault.on_exit = nullptr;
+      vault.status = ProcessStatus::kStopping;
+      OnProcessExit(label, ExitStatus(), true);
+      if (process_id != 0 && !InProcessHost::IsInstanceId(process_id))
+        terminated.push_back(static_cast<pid_t>(process_id));
+    }
+    // Reap those which have already exited.  Rather than block the io_service thread waiting for
+    // the rest, they're left to the successor, which inherits them as children.
+    for (pid_t process_id : ReapIfExited(std::move(terminated)))
+      handover.terminated_process_ids.push_back(static_cast<uint64_t>(process_id));
+    if (!handover.terminated_process_ids.empty()) {
+      LOG(kInfo) << handover.terminated_process_ids.size()
+                 << " terminated vaults not yet reaped; leaving to successor.";
+    }
+
+    ResourceReader reader;
+    for (const auto& label : running_labels) {
+      Child& vault(DoFind(label));
+      vault.timer->cancel();
+      handover.vaults.push_back(Describe(vault, reader));
+      if (vault.output)
+        handover.vaults.back().output_descriptor = vault.output->Release();
+      tcp::ConnectionPtr connection{ vault.info.tcp_connection };
+      EraseVault(label);
+      connection->Close();
+    }
+    LOG(kInfo) << "Handing over " << handover.vaults.size() << " running vaults; terminated "
+               << other_labels.size() << " others.";
+  });
+  return handover;
+}
+
+std::vector<AttachedVault> ProcessManager::GetAttachedVaults() const {
+  std::vector<AttachedVault> attached_vaults;
+  ResourceReader reader;
+  vaults_.ForEach([&](const Child& vault) {
+    if (GetProcessId(vault) != 0 && vault.instance_id == 0 && (vault.awaiting_reattach ||
+        (vault.status == ProcessStatus::kRunning && vault.info.tcp_connection))) {
+      attached_vaults.push_back(Describe(vault, reader));
+    }
+  });
+  return attached_vaults;
+}
+
+AttachedVault ProcessManager::Describe(const Child& vault, ResourceReader& reader) const {
+  AttachedVault attached_vault;
+  attached_vault.label = vault.info.label;
+  attached_vault.process_id = GetProcessId(vault);
+  attached_vault.executable = vault.executable;
+  attached_vault.uptime = std::chrono::duration_cast<std::chrono::milliseconds>(
+      std::chrono::steady_clock::now() - vault.start_time);
+  attached_vault.start_token = reader.ReadStartTime(attached_vault.process_id);
+  return attached_vault;
+}
+
+void ProcessManager::AdoptProcess(VaultInfo info, const AttachedVault& attached_vault) {
+  CheckCanAdd(info);
+  if (info.label != attached_vault.label || attached_vault.process_id == 0) {
+    LOG(kError) << "Can't adopt vault: label doesn't match or process ID is 0.";
+    BOOST_THROW_EXCEPTION(MakeError(CommonErrors::invalid_parameter));
+  }
+  Child& vault(vaults_.Insert(Child{ info, attached_vault.executable, io_service_ }, info));
+  on_scope_exit strong_guarantee{ [this, &info] { EraseVault(info.label); } };
+  vault.process = bp::child{ static_cast<pid_t>(attached_vault.process_id) };
+  if (!IsRunning(vault)) {
+    LOG(kWarning) << "Vault " << info.label.string() << " exited during the handover.";
+    BOOST_THROW_EXCEPTION(MakeError(CommonErrors::no_such_element));
+  }
+  if (attached_vault.start_token != 0 &&
+      ResourceReader().ReadStartTime(attached_vault.process_id) != attached_vault.start_token) {
+    LOG(kWarning) << "Vault " << info.label.string() << " has exited, and its process ID "
+                  << attached_vault.process_id << " has been reused.";
+    BOOST_THROW_EXCEPTION(MakeError(CommonErrors::no_such_element));
+  }
+  // After an exec the vault is still our child, but after a crash it will have been re-parented.
+  pid_t pid{ -1 };
+  do {
+    pid = waitpid(static_cast<pid_t>(attached_vault.process_id), nullptr, WNOHANG);
+  } while (pid < 0 && errno == EINTR);
+  const bool kOrphaned{ pid < 0 && errno == ECHILD };
+  if (pid > 0) {
+    LOG(kWarning) << "Vault " << info.label.string() << " exited during the handover.";
+    BOOST_THROW_EXCEPTION(MakeError(CommonErrors::no_such_element));
+  }
+  vaults_.SetProcessId(info.label, attached_vault.process_id);
+  vault.status = ProcessStatus::kStarting;
+  vault.awaiting_reattach = true;
+  vault.orphaned = kOrphaned;
+  vault.start_time = std::chrono::steady_clock::now() - attached_vault.uptime;
+  PlaceInCgroup(vault);
+  PinToCpus(vault);
+  Prioritise(vault);
+  vault.oom_kills_at_launch = ReadOomKills(vault);
+
+#ifdef MAIDSAFE_LINUX
+  if (exit_detection_ == ExitDetection::kPidfd)
+    WatchPidfd(attached_vault.process_id);
+#endif
+  // Any SIGCHLD raised while the VaultManager was re-executing itself has been lost, and an
+  // orphan's exit won't raise one at all.
+  if (exit_detection_ == ExitDetection::kSigchld) {
+    io_service_.post([this] { ReapExitedChildren(); });
+    if (vault.orphaned)
+      ScheduleOrphanPoll();
+  }
+
+  NonEmptyString label{ info.label };
+  vault.timer->expires_from_now(kVaultReattachTimeout);
+  vault.timer->async_wait([this, label](const boost::system::error_code& error_code) {
+    if (error_code && error_code == boost::asio::error::operation_aborted) {
+      LOG(kVerbose) << "Reattach timer cancelled OK.";
+      return;
+    }
+    LOG(kWarning) << "Timed out waiting for vault " << label.string() << " to reconnect.";
+    OnProcessExit(label, ExitStatus(), true);
+  });
+  if (attached_vault.output_descriptor != -1) {
+    try {
+      AttachOutput(vault, VaultOutput::MakeShared(io_service_, attached_vault.output_descriptor));
+    }
+    catch (const std::exception& e) {
+      LOG(kWarning) << "Can't collect output of vault " << label.string() << ": "
+                    << boost::diagnostic_information(e);
+    }
+  }
+  strong_guarantee.Release();
+  LOG(kInfo) << "Adopted " << (vault.orphaned ? "orphaned " : "") << "vault " << label.string()
+             << " with process ID " << attached_vault.process_id;
+  NotifyAttachedVaultsChanged();
+}
+
+void ProcessManager::AdoptTerminated(const std::vector<uint64_t>& process_ids) {
+  for (const auto& process_id : process_ids) {
+#ifdef MAIDSAFE_LINUX
+    if (exit_detection_ == ExitDetection::kPidfd)
+      WatchPidfd(process_id);
+#endif
+    // Also covers WatchPidfd having fallen back to SIGCHLD.
+    RememberTerminated(process_id);
+  }
+  // Any which have already exited won't raise another SIGCHLD.
+  if (!process_ids.empty() && exit_detection_ == ExitDetection::kSigchld)
+    io_service_.post([this] { ReapExitedChildren(); });
+}
+
+void ProcessManager::BecomeSubreaper() {
+#ifdef MAIDSAFE_LINUX
+  if (prctl(PR_SET_CHILD_SUBREAPER, 1) != 0) {
+    LOG(kError) << "Failed to become a child subreaper: " << std::strerror(errno);
+    BOOST_THROW_EXCEPTION(MakeError(CommonErrors::unknown));
+  }
+  subreaper_ = true;
+  // Under SIGCHLD, re-parented descendants are reaped along with our own children.
+  if (exit_detection_ == ExitDetection::kPidfd)
+    ScheduleOrphanPoll();
+#endif
+}
+
+void ProcessManager::ScheduleOrphanPoll() {
+  if (orphan_poll_scheduled_)
+    return;
+  orphan_poll_scheduled_ = true;
+  orphan_timer_.expires_from_now(kOrphanPollInterval);
+  orphan_timer_.async_wait([this](const boost::system::error_code& error_code) {
+    if (error_code && error_code == boost::asio::error::operation_aborted)
+      return;
+    orphan_poll_scheduled_ = false;
+    PollOrphans();
+  });
+}
+
+void ProcessManager::PollOrphans() {
+  bool orphans_remain{ false };
+  if (exit_detection_ == ExitDetection::kSigchld) {
+    std::vector<NonEmptyString> exited_labels;
+    ResourceReader reader;
+    vaults_.ForEach([&](const Child& vault) {
+      if (!vault.orphaned || GetProcessId(vault) == 0)
+        return;
+      bool is_running{ IsRunning(vault) };
+#ifdef MAIDSAFE_LINUX
+      // An orphan remains a zombie until its new parent reaps it, which may not be promptly.
+      is_running = is_running && reader.ReadStartTime(GetProcessId(vault)) != 0;
+#endif
+      if (is_running)
+        orphans_remain = true;
+      else
+        exited_labels.push_back(vault.info.label);
+    });
+    for (const auto& label : exited_labels) {
+      LOG(kWarning) << "Orphaned vault " << label.string() << " has exited.";
+      OnProcessExit(label, ExitStatus());
+    }
+  }
+#ifdef MAIDSAFE_LINUX
+  if (subreaper_ && exit_detection_ == ExitDetection::kPidfd) {
+    ReapStrayDescendants();
+    orphans_remain = orphans_remain || !vaults_.Empty();
+  }
+#endif
+  if (orphans_remain)
+    ScheduleOrphanPoll();
+}
+
+void ProcessManager::FallBackToSigchld() {
+  exit_detection_ = ExitDetection::kSigchld;
+  boost::system::error_code error_code;
+  signal_set_.add(SIGCHLD, error_code);
+  if (error_code) {
+    LOG(kError) << "Failed to add SIGCHLD to signal set: " << error_code.message();
+    BOOST_THROW_EXCEPTION(MakeError(CommonErrors::unknown));
+  }
+  InitSignalHandler();
+}
+#endif
+
+#ifdef MAIDSAFE_LINUX
+void ProcessManager::WatchPidfd(ProcessId process_id) {
+  int pidfd{ static_cast<int>(syscall(SYS_pidfd_open, static_cast<pid_t>(process_id), 0)) };
+  if (pidfd < 0) {
+    // The child can still be reaped via SIGCHLD, so switch all subsequent children over too.
+    LOG(kError) << "pidfd_open failed for process ID " << process_id << ": "
+                << std::strerror(errno) << "  Falling back to SIGCHLD handler.";
+    FallBackToSigchld();
+    // In case the child has already exited.  Posted since the child's process ID isn't registered
+    // in vaults_ until StartProcess returns.
+    io_service_.post([this] { ReapExitedChildren(); });
+    return;
+  }
+
+  // The handler owns the descriptor so that it outlives the vault's entry in vaults_.  This ensures
+  // children which are terminated (and hence erased) before exiting still get reaped.
+  auto descriptor(std::make_shared<boost::asio::posix::stream_descriptor>(io_service_, pidfd));
+  descriptor->async_read_some(boost::asio::null_buffers(),
+      [this, process_id, descriptor](const boost::system::error_code& error_code, std::size_t) {
+        if (error_code && error_code == boost::asio::error::operation_aborted) {
+          LOG(kVerbose) << "Stopped waiting on pidfd for process ID " << process_id;
+          return;
+        }
+        OnPidfdReadable(process_id);
+      });
+}
+
+void ProcessManager::OnPidfdReadable(ProcessId process_id) {
+  // A pidfd becomes readable once its process has exited.  A child's process ID can't be reused
+  // until we reap it, but an orphan which isn't our child may already have had its ID reused by a
+  // new child.  In that case the orphan's exit has been handled by RegisterProcessId.
+  int exit_code{ 0 };
+  pid_t pid{ -1 };
+  do {
+    pid = waitpid(static_cast<pid_t>(process_id), &exit_code, WNOHANG);
+  } while (pid < 0 && errno == EINTR);
+  if (pid == 0)
+    return;
+  OnChildReaped(process_id, pid > 0 ? DecodeWaitStatus(exit_code) : ExitStatus());
+}
+
+void ProcessManager::ReapStrayDescendants() {
+  // Only the first exited child can be peeked at, so one which is ours is handled here rather than
+  // left for its pidfd.  Its pidfd then finds it already reaped, as after a handover.
+  for (;;) {
+    siginfo_t info;
+    info.si_pid = 0;
+    if (waitid(P_ALL, 0, &info, WEXITED | WNOHANG | WNOWAIT) != 0 || info.si_pid == 0)
+      return;
+    ProcessId process_id{ static_cast<ProcessId>(info.si_pid) };
+    if (vaults_.Find(process_id) || spares_.count(process_id) != 0U ||
+        terminated_children_.count(process_id) != 0U || process_id == HostProcessId()) {
+      OnPidfdReadable(process_id);
+      continue;
+    }
+    if (waitpid(info.si_pid, nullptr, WNOHANG) <= 0)
+      return;
+    LOG(kVerbose) << "Reaped orphaned descendant with process ID " << process_id;
+  }
+}
+#endif
+
+#ifndef MAIDSAFE_WIN32
+void ProcessManager::ReapExitedChildren() {
+  // SIGCHLD isn't queued, so a single delivery can stand for any number of exited children.  Reap
+  // all of ours without blocking the io_service thread, but not via waitpid(-1), which would also
+  // reap the children of any process hosting the ProcessManager.
+  std::set<ProcessId> children(terminated_children_);
+  vaults_.ForEach([&](const Child& vault) {
+    if (vault.instance_id == 0 && GetProcessId(vault) != 0)
+      children.insert(GetProcessId(vault));
+  });
+  for (const auto& spare : spares_)
+    children.insert(spare.first);
+  if (HostProcessId() != 0)
+    children.insert(HostProcessId());
+
+  // Reaped before any are handled, since handling an exit can start or drop other children.
+  std::vector<std::pair<ProcessId, ExitStatus>> exited;
+  for (ProcessId process_id : children) {
+    int exit_code{ 0 };
+    pid_t pid{ -1 };
+    do {
+      pid = waitpid(static_cast<pid_t>(process_id), &exit_code, WNOHANG);
+    } while (pid < 0 && errno == EINTR);
+    if (pid > 0)
+      exited.emplace_back(process_id, DecodeWaitStatus(exit_code));
+    else if (pid < 0)  // Not our child, e.g. an orphan, or already reaped.
+      terminated_children_.erase(process_id);
+  }
+  for (const auto& child : exited)
+    OnChildReaped(child.first, child.second);
+
+#ifdef MAIDSAFE_LINUX
+  if (subreaper_)
+    ReapStrayDescendants();
+#endif
+}
+
+void ProcessManager::OnChildReaped(ProcessId process_id, const ExitStatus& exit_status) {
+  terminated_children_.erase(process_id);
+  if (process_id == HostProcessId())
+    return OnHostExit(exit_status);
+  const Child* vault(vaults_.Find(process_id));
+  if (!vault) {  // Either a spare, or already handled, e.g. terminated after a timeout.
+    OnSpareExit(process_id, false);
+    return;
+  }
+  LOG(kWarning) << "Process ID " << process::GetProcessId() << " reaped child pid: "
+                << process_id;
+  OnProcessExit(vault->info.label, exit_status);
+}
+
+void ProcessManager::RememberTerminated(ProcessId process_id) {
+  // A pidfd watch reaps its child regardless.
+  if (exit_detection_ == ExitDetection::kSigchld && process_id != 0)
+    terminated_children_.insert(process_id);
+}
+#endif
+
+void ProcessManager::StopProcess(tcp::ConnectionPtr connection, OnExitFunctor on_exit_functor) {
+  Child* vault(vaults_.Find(connection));
+  if (!vault) {
+    LOG(kError) << "Vault process doesn't exist.";
+    return;
+  }
+  vault->on_exit = on_exit_functor;
+  vault->status = ProcessStatus::kStopping;
+  vault->restarting = false;
+  vault->restart_when_stopped = false;
+  SendVaultShutdownRequest(vault->info.tcp_connection);
+  NonEmptyString label{ vault->info.label };
+  vault->timer->expires_from_now(kVaultStopTimeout);
+  vault->timer->async_wait([this, label](const boost::system::error_code& error_code) {
+    if (error_code && error_code == boost::asio::error::operation_aborted) {
+      LOG(kVerbose) << "Vault termination timer cancelled OK.";
+      return;
+    }
+    LOG(kWarning) << "Timed out waiting for Vault to stop; terminating now.";
+    OnProcessExit(label, ExitStatus(), true);
+  });
+}
+
+bool ProcessManager::HandleConnectionClosed(tcp::ConnectionPtr connection) {
+  Child* vault(vaults_.Find(connection));
+  if (!vault) {
+#ifndef MAIDSAFE_WIN32
+    auto itr(std::find_if(std::begin(spares_), std::end(spares_),
+        [&](const std::pair<const ProcessId, Spare>& spare) {
+          return spare.second.connection == connection;
+        }));
+    if (itr != std::end(spares_)) {
+      OnSpareExit(itr->first, true);
+      return true;
+    }
+    if (host_ && host_->connection && host_->connection == connection) {
+      // The host only closes its connection if it's failing, so is killed rather than left to run
+      // vaults which can no longer be started or stopped.
+      host_->connection.reset();
+      if (!host_->stopping) {
+        LOG(kWarning) << "Vault host closed its connection.";
+        KillHost();
+      }
+      return true;
+    }
+#endif
+    return false;
+  }
+  // A vault's connection closes when its process exits, usually before the exit is detected.  One
+  // which is being stopped is still subject to its stop timeout.
+  if (vault->status == ProcessStatus::kStopping)
+    DetachConnection(*vault);
+  else
+    AwaitExitAfterClose(*vault);
+  return true;
+}
+
+void ProcessManager::DetachConnection(Child& vault) {
+  vaults_.SetConnection(vault.info.label, nullptr);
+  vault.info.tcp_connection.reset();
+  vault.heartbeat.awaiting_reply = false;
+}
+
+void ProcessManager::AwaitExitAfterClose(Child& vault) {
+  NonEmptyString label{ vault.info.label };
+  DetachConnection(vault);
+  vault.timer->expires_from_now(kConnectionClosedGracePeriod);
+  vault.timer->async_wait([this, label](const boost::system::error_code& error_code) {
+    if (error_code && error_code == boost::asio::error::operation_aborted)
+      return;
+    LOG(kWarning) << "Vault " << label.string() << " closed its connection but hasn't exited; "
+                  << "terminating it.";
+    OnProcessExit(label, ExitStatus(), true);
+  });
+}
+
+VaultInfo ProcessManager::Find(const NonEmptyString& label) const {
+  return DoFind(label).info;
+}
+
+const ProcessManager::Child& ProcessManager::DoFind(const NonEmptyString& label) const {
+  const Child* vault(vaults_.Find(label));
+  if (!vault) {
+    LOG(kError) << "Vault process with label " << label.string() << " doesn't exist.";
+    BOOST_THROW_EXCEPTION(MakeError(CommonErrors::no_such_element));
+  }
+  return *vault;
+}
+
+ProcessManager::Child& ProcessManager::DoFind(const NonEmptyString& label) {
+  return const_cast<Child&>(static_cast<const ProcessManager&>(*this).DoFind(label));
+}
+
+VaultInfo ProcessManager::Find(tcp::ConnectionPtr connection) const {
+  return DoFind(connection).info;
+}
+
+const ProcessManager::Child& ProcessManager::DoFind(tcp::ConnectionPtr connection) const {
+  const Child* vault(vaults_.Find(connection));
+  if (!vault)
+    BOOST_THROW_EXCEPTION(MakeError(CommonErrors::no_such_element));
+  return *vault;
+}
+
+ProcessManager::Child& ProcessManager::DoFind(tcp::ConnectionPtr connection) {
+  return const_cast<Child&>(static_cast<const ProcessManager&>(*this).DoFind(connection));
+}
+
+ProcessId ProcessManager::GetProcessId(const Child& vault) const {
+  if (vault.instance_id != 0)
+    return vault.instance_id;
+#ifdef MAIDSAFE_WIN32
+  return static_cast<ProcessId>(vault.process.proc_info.dwProcessId);
+#else
+  return static_cast<ProcessId>(vault.process.pid);
 #endif
 }
 
 bool ProcessManager::IsRunning(const Child& vault) const {
+#ifndef MAIDSAFE_WIN32
+  // Until its host reports otherwise, a hosted vault which the host has been told to start is
+  // assumed to be running.
+  if (vault.instance_id != 0)
+    return host_ && !IsQueuedInstance(vault.instance_id);
+#endif
   try {
 #ifdef MAIDSAFE_WIN32
     return process::IsRunning(vault.process.process_handle());
@@ -449,51 +2656,137 @@ bool ProcessManager::IsRunning(const Child& vault) const {
   }
 }
 
-void ProcessManager::OnProcessExit(const NonEmptyString& label, int exit_code, bool terminate) {
-  auto child_itr(std::find_if(std::begin(vaults_), std::end(vaults_),
-                  [this, &label](const Child& vault) { return vault.info.label == label; }));
-  if (child_itr == std::end(vaults_))
+void ProcessManager::OnProcessExit(NonEmptyString label, const ExitStatus& exit_status,
+                                   bool terminate) {
+  Child* vault(vaults_.Find(label));
+  if (!vault)
     return;
 
-  VaultInfo vault_info;
-  int restart_count{ -1 };
-  if (child_itr->status != ProcessStatus::kStopping) {  // Unexpected exit - try to restart.
-    restart_count = child_itr->restart_count;
-    vault_info = child_itr->info;
-    LOG(kError) << "Vault " << DebugId(vault_info.pmid_and_signer->first.name().value)
-                << " stopped unexpectedly";
+#ifndef MAIDSAFE_WIN32
+  // A hosted vault's thread can't be killed, so one which is running is asked to stop and kept
+  // until its host reports that it has exited.  One which the host hasn't yet started is dropped.
+  if (vault->instance_id != 0) {
+    if (IsRunning(*vault)) {
+      if (!vault->terminating)
+        TerminateInstance(*vault);
+      else if (stopping_all_)
+        KillHost();
+      return;
+    }
+    TerminateProcess(*vault);
+    vaults_.SetProcessId(label, 0);
+    vault->instance_id = 0;
+  }
+#endif
+
+  const bool kRestarting{ vault->restarting };
+  const bool kUnexpected{ vault->terminating ? vault->restart_when_stopped && !stopping_all_ :
+                                               vault->status != ProcessStatus::kStopping };
+  const ExitClass kExitClass(kUnexpected ? ClassifyExit(*vault, exit_status, terminate) :
+                                           ExitClass::kStopped);
+  vault->exit_history.Push(ExitRecord(std::chrono::system_clock::now(), kExitClass, exit_status));
+  if (kUnexpected) {
+    LOG(kError) << "Vault " << DebugId(vault->info.pmid_and_signer->first.name().value)
+                << " stopped unexpectedly (" << kExitClass << ")";
 #ifdef USE_VLOGGING
     log::VisualiserLogMessage::SendVaultStoppedMessage(
-        DebugId(vault_info.pmid_and_signer->first.name().value),
-        vault_info.vlog_session_id, exit_code);
+        DebugId(vault->info.pmid_and_signer->first.name().value),
+        vault->info.vlog_session_id, exit_status.exit_code);
 #endif
-    if (vault_info.tcp_connection) {
-      vault_info.tcp_connection->Close();
-      vault_info.tcp_connection.reset();
-    }
   }
 
-  bool is_running{ IsRunning(*child_itr) };
+  // A vault still queued by AddProcesses has never been started.
+  bool is_running{ GetProcessId(*vault) != 0 && IsRunning(*vault) };
   LOG(kVerbose) << "On exit for Vault " << label.string() << std::boolalpha << "  Is running: "
-      << is_running << "   Exit code: " << exit_code << "   Terminate requested: " << terminate;
+      << is_running << "   Exit code: " << exit_status.exit_code << "   Signal: "
+      << exit_status.signal << "   Core dumped: " << exit_status.core_dumped
+      << "   Terminate requested: " << terminate << "   Class: " << kExitClass;
   if (terminate && is_running)
-    TerminateProcess(child_itr);
+    TerminateProcess(*vault);
+
+  if (vault->info.tcp_connection)
+    vault->info.tcp_connection->Close();
+
+  CompleteAdmission(*vault, MakeError(terminate ? VaultManagerErrors::vault_terminated :
+                                                  VaultManagerErrors::vault_exited_with_error));
+  OnExitFunctor on_exit{ vault->on_exit };
+  ReleaseCpus(label);
+  if (kRestarting) {
+    vault->restarting = false;
+    DetachProcess(*vault);
+    vault->status = ProcessStatus::kBeforeStarted;
+    LOG(kInfo) << "Restarting vault " << label.string() << " onto " << vault->executable;
+    ScheduleStart(*vault, std::chrono::milliseconds(0), false);
+  } else if (kUnexpected) {
+    SettleUpgrade(label, MakeError(terminate ? VaultManagerErrors::vault_terminated :
+                                               VaultManagerErrors::vault_exited_with_error));
+    ScheduleRestart(*vault, kExitClass);
+  } else {
+    if (cgroups_)
+      cgroups_->Remove(label);
+    EraseVault(label);
+    SettleUpgrade(label, MakeError(CommonErrors::no_such_element));
+  }
 
-  if (child_itr->info.tcp_connection)
-    child_itr->info.tcp_connection->Close();
+  NotifyAttachedVaultsChanged();
+  InvokeOnExitFunctor(on_exit, exit_status.exit_code, terminate);
+  StopSignalHandlerWhenIdle();
+}
 
-  OnExitFunctor on_exit{ child_itr->on_exit };
-  vaults_.erase(child_itr);
+ExitClass ProcessManager::ClassifyExit(const Child& vault, const ExitStatus& exit_status,
+                                       bool terminate) const {
+  // The OOM killer uses SIGKILL, and an exit status can't show who sent it.
+  const bool kOomKilled(
+#ifdef MAIDSAFE_LINUX
+      exit_status.signal == SIGKILL && ReadOomKills(vault) > vault.oom_kills_at_launch);
+#else
+      false);
+#endif
+  // A vault which had connected got past reading its configuration.
+  const bool kConnected(vault.info.tcp_connection != nullptr ||
+                        vault.status == ProcessStatus::kRunning);
+  return vault_manager::ClassifyExit(exit_status, terminate, kOomKilled, kConnected);
+}
+
+uint64_t ProcessManager::ReadOomKills(const Child& vault) const {
+  // Without its own cgroup, an OOM kill of any process while the vault ran is taken to be the
+  // vault's.
+  return cgroups_ ? cgroups_->OomKills(vault.info.label) : ReadHostOomKills();
+}
 
-  InvokeOnExitFunctor(on_exit, exit_code, terminate);
-  RestartIfRequired(restart_count, std::move(vault_info));
+bool ProcessManager::HasFreeDiskSpace(const Child& vault) const {
+  boost::system::error_code error_code;
+  fs::space_info space(fs::space(vault.info.vault_dir, error_code));
+  if (error_code) {
+    // Better to try the vault again than to wait indefinitely.
+    LOG(kWarning) << "Failed to read the free space for " << vault.info.vault_dir << ": "
+                  << error_code.message();
+    return true;
+  }
+  return space.available >= kMinFreeDiskSpace;
 }
 
-void ProcessManager::TerminateProcess(std::vector<Child>::iterator itr) {
+void ProcessManager::TerminateProcess(Child& vault) {
+#ifndef MAIDSAFE_WIN32
+  // A thread can't be killed, only asked to stop.
+  if (vault.instance_id != 0) {
+    if (IsQueuedInstance(vault.instance_id)) {
+      host_->queued.erase(std::remove(std::begin(host_->queued), std::end(host_->queued),
+                                      vault.instance_id),
+                          std::end(host_->queued));
+    } else if (host_ && host_->connection) {
+      SendStopInstanceRequest(host_->connection, vault.instance_id);
+    }
+    return;
+  }
+#endif
   boost::system::error_code ec;
-  bp::terminate(itr->process, ec);
+  bp::terminate(vault.process, ec);
   if (ec)
     LOG(kWarning) << "Error while terminating vault: " << ec.message();
+#ifndef MAIDSAFE_WIN32
+  RememberTerminated(GetProcessId(vault));
+#endif
 }
 
 void ProcessManager::InvokeOnExitFunctor(OnExitFunctor on_exit, int exit_code, bool terminate) {
@@ -516,21 +2809,144 @@ void ProcessManager::InvokeOnExitFunctor(OnExitFunctor on_exit, int exit_code, b
   }
 }
 
-void ProcessManager::RestartIfRequired(int restart_count, VaultInfo vault_info) {
-  if (restart_count < 0 || restart_count >= kMaxVaultRestarts)
+void ProcessManager::DetachProcess(Child& vault) {
+  NonEmptyString label{ vault.info.label };
+  vaults_.SetConnection(label, nullptr);
+  vaults_.SetProcessId(label, 0);
+  vault.info.tcp_connection.reset();
+  vault.on_exit = nullptr;
+  vault.instance_id = 0;
+  vault.terminating = false;
+  vault.restart_when_stopped = false;
+  vault.awaiting_reattach = false;
+  vault.orphaned = false;
+  vault.heartbeat.awaiting_reply = false;
+  vault.heartbeat.consecutive_missed = 0;
+  vault.initial_rss = 0;
+  vault.latest_rss = 0;
+  ReleaseProcessHandle(vault);
+}
+
+void ProcessManager::ReleaseProcessHandle(Child& vault) {
+#ifdef MAIDSAFE_WIN32
+  boost::system::error_code ignored_ec;
+  vault.handle.close(ignored_ec);
+  vault.process = bp::child{ PROCESS_INFORMATION() };
+#else
+  vault.process = bp::child{ 0 };
+#endif
+}
+
+void ProcessManager::ScheduleRestart(Child& vault, ExitClass exit_class) {
+  DetachProcess(vault);
+  NonEmptyString label{ vault.info.label };
+  std::chrono::steady_clock::duration uptime{ std::chrono::steady_clock::now() - vault.start_time };
+  RestartDecision decision{ RecordUnexpectedExit(vault.info.restart_history, uptime,
+                                                 std::chrono::system_clock::now(),
+                                                 exit_class == ExitClass::kBadConfig) };
+  const RestartAction kAction(GetRestartAction(exit_class));
+  if (decision.give_up) {
+    vault.status = ProcessStatus::kFailed;
+    LOG(kError) << "Not restarting vault " << label.string() << " after " << exit_class
+                << " exit, since restarting it won't help.";
+    if (on_vault_failed_) {
+      try {
+        on_vault_failed_(vault.info);
+      }
+      catch (const std::exception& e) {
+        LOG(kError) << "Error executing on_vault_failed functor: "
+                    << boost::diagnostic_information(e);
+      }
+    }
+  } else if (decision.quarantined) {
+    vault.status = ProcessStatus::kQuarantined;
+    LOG(kWarning) << "Quarantining vault " << label.string() << " after " << exit_class
+                  << " exit - will start in " << decision.delay.count() << " ms.";
+    ScheduleStart(vault, decision.delay);
+  } else if (kAction == RestartAction::kAwaitDiskSpace && !HasFreeDiskSpace(vault)) {
+    vault.status = ProcessStatus::kAwaitingDiskSpace;
+    LOG(kWarning) << "Vault " << label.string() << " will be restarted once "
+                  << vault.info.vault_dir << " has " << (kMinFreeDiskSpace >> 20) << " MiB free.";
+    ScheduleStart(vault, std::chrono::duration_cast<std::chrono::milliseconds>(
+                             kDiskSpacePollInterval));
+  } else {
+    const std::chrono::milliseconds kDelay(kAction == RestartAction::kRestartNow ?
+                                           std::chrono::milliseconds(0) : decision.delay);
+    vault.status = ProcessStatus::kBeforeStarted;
+    LOG(kWarning) << "Restarting vault " << label.string() << " after " << exit_class
+                  << " exit - will start in " << kDelay.count() << " ms.";
+    ScheduleStart(vault, kDelay);
+  }
+
+  if (!on_restart_history_changed_)
     return;
+  try {
+    on_restart_history_changed_();
+  }
+  catch (const std::exception& e) {
+    LOG(kError) << "Error executing on_restart_history_changed functor: "
+                << boost::diagnostic_information(e);
+  }
+}
 
-  LOG(kWarning) << "Restarting vault " << vault_info.label.string();
-  io_service_.post([vault_info, restart_count, this] {
-    try {
-      AddProcess(std::move(vault_info), restart_count + 1);
+void ProcessManager::ScheduleStart(Child& vault, std::chrono::milliseconds delay,
+                                   bool throttled) {
+  NonEmptyString label{ vault.info.label };
+  vault.timer->expires_from_now(delay);
+  vault.timer->async_wait([this, label, throttled](const boost::system::error_code& error_code) {
+    if (error_code && error_code == boost::asio::error::operation_aborted) {
+      LOG(kVerbose) << "Restart timer cancelled OK.";
+      return;
     }
-    catch (const std::exception& e) {
-      LOG(kError) << "Failed restarting vault: " << boost::diagnostic_information(e);
+    Child* vault(vaults_.Find(label));
+    if (!vault)
+      return;
+    if (vault->status == ProcessStatus::kQuarantined) {
+      LOG(kInfo) << "Quarantine of vault " << label.string() << " has ended.";
+      vault->status = ProcessStatus::kBeforeStarted;
+    } else if (vault->status == ProcessStatus::kAwaitingDiskSpace) {
+      if (!HasFreeDiskSpace(*vault)) {
+        ScheduleStart(*vault, std::chrono::duration_cast<std::chrono::milliseconds>(
+                                  kDiskSpacePollInterval));
+        return;
+      }
+      LOG(kInfo) << "Disk space is available again for vault " << label.string() << '.';
+      vault->status = ProcessStatus::kBeforeStarted;
     }
+    if (vault->status != ProcessStatus::kBeforeStarted)
+      return;
+    if (throttled)
+      AdmitRestart(*vault);
+    else
+      StartDueVault(*vault);
   });
 }
 
+void ProcessManager::StartDueVault(Child& vault) {
+  try {
+    StartProcess(vault);
+    RegisterProcessId(vault);
+  }
+  catch (const std::exception& e) {
+    LOG(kError) << "Failed restarting vault: " << boost::diagnostic_information(e);
+    if (GetProcessId(vault) != 0)
+      TerminateProcess(vault);
+    ScheduleRestart(vault, ExitClass::kFailed);
+  }
+}
+
+void ProcessManager::NotifyAttachedVaultsChanged() {
+  if (!on_attached_vaults_changed_)
+    return;
+  try {
+    on_attached_vaults_changed_();
+  }
+  catch (const std::exception& e) {
+    LOG(kError) << "Error executing on_attached_vaults_changed functor: "
+                << boost::diagnostic_information(e);
+  }
+}
+
 }  // namespace vault_manager
 
 }  // namespace maidsafe
@@ -19,10 +19,14 @@
 #ifndef MAIDSAFE_VAULT_MANAGER_PROCESS_MANAGER_H_
 #define MAIDSAFE_VAULT_MANAGER_PROCESS_MANAGER_H_
 
+#include <chrono>
+#include <deque>
 #include <functional>
 #include <future>
+#include <map>
 #include <memory>
 #include <mutex>
+#include <set>
 #include <string>
 #include <vector>
 
@@ -40,57 +44,490 @@
 #include "maidsafe/common/tcp/connection.h"
 #include "maidsafe/passport/types.h"
 
+#include "maidsafe/vault_manager/adaptive_timeout.h"
 #include "maidsafe/vault_manager/config.h"
+#include "maidsafe/vault_manager/exit_classification.h"
+#include "maidsafe/vault_manager/handover.h"
+#include "maidsafe/vault_manager/latency_histogram.h"
+#include "maidsafe/vault_manager/launch_profile.h"
+#include "maidsafe/vault_manager/placement.h"
+#include "maidsafe/vault_manager/resource_sampler.h"
+#include "maidsafe/vault_manager/restart_queue_stats.h"
+#include "maidsafe/vault_manager/token_bucket.h"
+#include "maidsafe/vault_manager/upgrade_progress.h"
 #include "maidsafe/vault_manager/vault_info.h"
+#include "maidsafe/vault_manager/vault_registry.h"
 
 namespace maidsafe {
 
 namespace vault_manager {
 
+class Cgroups;
+class VaultOutput;
+
 typedef uint64_t ProcessId;
 
-enum class ProcessStatus { kBeforeStarted, kStarting, kRunning, kStopping };
+// 'kBeforeStarted' also covers a vault awaiting its restart after an unexpected exit, and
+// 'kQuarantined' one which has exited too often recently to be restarted yet, or a hosted vault
+// which didn't stop when terminated.  'kAwaitingDiskSpace' is a vault which exited because its disk
+// was full, and 'kFailed' one which has been given up on (see RecordUnexpectedExit); the latter is
+// never started again, even by a new VaultManager, since its restart history records the failure.
+enum class ProcessStatus {
+  kBeforeStarted, kStarting, kRunning, kStopping, kQuarantined, kAwaitingDiskSpace, kFailed
+};
+
+// How vault process exits are detected on POSIX systems.  'kPidfd' (Linux 5.3 or later) waits on a
+// per-child pidfd and leaves SIGCHLD untouched for any hosting process.  Where pidfds aren't
+// available, 'kSigchld' (a process-wide SIGCHLD handler) is used instead.  Either way only the
+// ProcessManager's own children are reaped (plus, once it's a subreaper, re-parented descendants),
+// so a hosting process's children are left to it.  Ignored on Windows.
+enum class ExitDetection { kPidfd, kSigchld };
+
+// How vault processes are launched on POSIX systems.  'kPosixSpawn' uses posix_spawn (vfork-style
+// on Linux) and closes every descriptor in the child other than those explicitly allowed via
+// AllowInheritance.  'kForkExec' is the original boost::process fork and exec, under which the
+// child inherits every open descriptor.  Ignored on Windows.
+enum class SpawnMethod { kPosixSpawn, kForkExec };
+
+// The result of adding a single vault via ProcessManager::AddProcesses.  'error' is
+// CommonErrors::success if the vault started and sent its VaultStarted message.
+struct AddProcessOutcome {
+  AddProcessOutcome(NonEmptyString label_in, maidsafe_error error_in)
+      : label(std::move(label_in)), error(std::move(error_in)) {}
+  NonEmptyString label;
+  maidsafe_error error;
+};
+
+// Progress of a ProcessManager::StopAllRolling call.  'stopped' counts vaults which exited by
+// themselves, and 'terminated' those which had to be killed.
+struct ShutdownProgress {
+  ShutdownProgress() : total(0), stopped(0), terminated(0) {}
+  size_t Remaining() const { return total - stopped - terminated; }
+  size_t total, stopped, terminated;
+};
+
+// Heartbeat round-trip times of a vault, along with the lag of the vault's io thread which it last
+// reported.  'smoothed_round_trip' is an exponentially weighted moving average.  'clock_offset'
+// estimates how far the vault's system clock is ahead of ours.  'missed' counts every heartbeat
+// left unanswered, not only consecutive ones.
+struct HeartbeatStats {
+  HeartbeatStats()
+      : answered(0), missed(0), last_round_trip(0), smoothed_round_trip(0), max_round_trip(0),
+        loop_lag(0), clock_offset(0) {}
+  uint64_t answered, missed;
+  std::chrono::microseconds last_round_trip, smoothed_round_trip, max_round_trip, loop_lag;
+  std::chrono::milliseconds clock_offset;
+};
+
+// How ProcessManager::Upgrade restarts vaults onto a new executable.  Vaults are restarted
+// 'wave_size' at a time, and the next wave isn't started until every vault in the current one has
+// sent JoinedNetwork or failed.  A vault fails if it exits, or hasn't rejoined within
+// 'join_timeout' of its wave starting.  Once more than 'failure_threshold' of the vaults restarted
+// so far have failed, the upgrade halts and every vault already on the new executable is rolled
+// back to the old one.
+struct UpgradeOptions {
+  UpgradeOptions()
+      : wave_size(kDefaultUpgradeWaveSize), failure_threshold(kDefaultUpgradeFailureThreshold),
+        join_timeout(kUpgradeJoinTimeout) {}
+  size_t wave_size;
+  double failure_threshold;
+  std::chrono::steady_clock::duration join_timeout;
+};
+
+// A running vault is restarted once its RSS exceeds 'max_rss', or has grown by more than
+// 'max_rss_growth' since it was first sampled after starting.  While the host's memory pressure is
+// at or above 'pressure_threshold', the vault whose RSS has grown the most is also restarted, at
+// most once per 'pressure_restart_interval'.  Zero disables the corresponding check.
+struct MemoryWatchdogOptions {
+  MemoryWatchdogOptions()
+      : max_rss(0), max_rss_growth(0), pressure_threshold(kMemoryPressureThreshold),
+        pressure_restart_interval(kMemoryPressureRestartInterval) {}
+  uint64_t max_rss, max_rss_growth;
+  double pressure_threshold;
+  std::chrono::steady_clock::duration pressure_restart_interval;
+};
 
 // All functions provide the strong exception guarantee.
 class ProcessManager {
  public:
   typedef std::function<void(maidsafe_error, int)> OnExitFunctor;
+  typedef std::function<void(std::vector<AddProcessOutcome>)> OnProcessesAddedFunctor;
+  typedef std::function<void()> OnRestartHistoryChangedFunctor;
+  typedef std::function<void(VaultInfo)> OnVaultFailedFunctor;
+  typedef std::function<void(NonEmptyString)> OnVaultRemovedFunctor;
+  typedef std::function<void()> OnAttachedVaultsChangedFunctor;
+  typedef std::function<void(ShutdownProgress)> OnShutdownProgressFunctor;
+  typedef std::function<void(VaultInfo, ProcessId)> OnSpareAssignedFunctor;
+  typedef std::function<void(UpgradeProgress)> OnUpgradeProgressFunctor;
+  typedef std::function<void(maidsafe_error, UpgradeProgress)> OnUpgradedFunctor;
 
   ProcessManager(const ProcessManager&) = delete;
   ProcessManager(ProcessManager&&) = delete;
   ProcessManager& operator=(ProcessManager) = delete;
 
-  static std::shared_ptr<ProcessManager> MakeShared(boost::asio::io_service& io_service,
-                                                    boost::filesystem::path vault_executable_path,
-                                                    tcp::Port listening_port);
+  static std::shared_ptr<ProcessManager> MakeShared(
+      boost::asio::io_service& io_service, boost::filesystem::path vault_executable_path,
+      tcp::Port listening_port, ExitDetection preferred_exit_detection = ExitDetection::kPidfd,
+      SpawnMethod spawn_method = SpawnMethod::kPosixSpawn);
   ~ProcessManager();
   void StopAll();
-  void StopAllWithInterval();
+  // Must be called on the io_service thread.  Asks at most 'max_concurrent_stops' vaults at a time
+  // to stop, starting the next as each exits.  Any vault still running once 'deadline' has passed
+  // is terminated.  'on_progress' is invoked each time a vault exits, and 'on_stopped' once all
+  // have.  As with StopAll, only the first call of either has any effect.
+  void StopAllRolling(int max_concurrent_stops, std::chrono::steady_clock::duration deadline,
+                      OnShutdownProgressFunctor on_progress, std::function<void()> on_stopped);
   std::vector<VaultInfo> GetAll() const;
-  void AddProcess(VaultInfo info, int restart_count = 0);
+  // If 'info.restart_history' shows the vault to be quarantined, it isn't started until the
+  // quarantine ends, and if it shows the vault to have failed, it isn't started at all.
+  void AddProcess(VaultInfo info);
+  // Checks the whole batch for invalid or conflicting vaults in a single pass, then starts the
+  // remainder with at most 'max_concurrent_starts' of them awaiting their VaultStarted message at
+  // any time.  'on_added' is invoked once every vault has either connected or failed, with one
+  // outcome per entry of 'infos' (in the same order); that of a failed vault (see AddProcess) is
+  // VaultManagerErrors::vault_exited_with_error.  Unlike the other functions, this doesn't
+  // provide the strong exception guarantee for the batch as a whole.
+  void AddProcesses(std::vector<VaultInfo> infos, OnProcessesAddedFunctor on_added,
+                    int max_concurrent_starts = kMaxConcurrentVaultStarts);
   VaultInfo HandleVaultStarted(tcp::ConnectionPtr connection, ProcessId process_id);
+  // Throws if 'process_id' isn't that of an adopted vault awaiting reconnection (see AdoptProcess),
+  // or if 'pmid_name' isn't that vault's.
+  VaultInfo HandleVaultReattached(tcp::ConnectionPtr connection, ProcessId process_id,
+                                  const Identity& pmid_name);
+  // Keeps 'pool_size' spare vault processes running and connected, each waiting for the
+  // VaultStartedResponse which gives it an identity.  Starting or restarting a vault takes a spare
+  // if one is ready, in which case 'on_assigned' is invoked (asynchronously) with the vault's info
+  // and process ID in place of the vault sending VaultStarted, and the pool is refilled in the
+  // background.  A size of 0 (the default) disables the pool.  Ignored on Windows.
+  void SetSparePool(size_t pool_size, OnSpareAssignedFunctor on_assigned);
+  // Returns false if 'process_id' isn't that of a spare vault awaiting its VaultStarted message.
+  bool HandleSpareStarted(tcp::ConnectionPtr connection, ProcessId process_id);
+  // Places each vault started from now on in its own cgroup below 'cgroup_root' (see Cgroups),
+  // limited according to its 'resource_limits'.
+  void EnableCgroups(const boost::filesystem::path& cgroup_root);
+  // Applies the new limits immediately if cgroups are enabled and the vault is running.
+  void SetResourceLimits(const NonEmptyString& label, const ResourceLimits& limits);
+  // Records the vault's new scheduling class and, if it's running, applies it immediately.  Returns
+  // false if the class couldn't be applied in full, e.g. if raising the vault's priority isn't
+  // permitted, or if the vault runs in-process.  Each vault's class is also applied whenever it's
+  // started or adopted.
+  bool SetSchedulingClass(const NonEmptyString& label, SchedulingClass scheduling_class);
+  // Replaces the launch profiles which vaults can refer to by name.  A vault's profile is applied
+  // whenever it's started, so changes take effect as each vault restarts.  A vault with a profile
+  // is never given a spare, since spares are launched before their vault is known.
+  void SetLaunchProfiles(std::map<std::string, LaunchProfile> launch_profiles);
+  bool HasLaunchProfile(const std::string& name) const;
+  // Runs vaults whose VaultInfo has 'in_process' set as threads of a single vault host process
+  // (see VaultHost), launched from the vault executable with 'host_args' when first needed and
+  // logging to 'host_dir'.  The hosted vaults share the host's cgroup, CPUs, scheduling class and
+  // limits, so none of those settings are applied to them, nor are they sampled, upgraded, given
+  // spares or handed over.  If the host exits, each of its vaults is handled as having exited with
+  // it.  Until this is called, such vaults are run as processes.  Throws if already enabled.
+  // Ignored on Windows.
+  void EnableInProcessHosting(const boost::filesystem::path& host_dir,
+                              std::vector<std::string> host_args = std::vector<std::string>());
+  bool InProcessHostingEnabled() const;
+  // Returns false if 'process_id' isn't that of the vault host awaiting its connection.
+  bool HandleVaultHostStarted(tcp::ConnectionPtr connection, ProcessId process_id);
+  // Returns false if 'connection' isn't the vault host's.
+  bool HandleInstanceExited(tcp::ConnectionPtr connection, ProcessId instance_id, int exit_code);
+  // Pins each vault started from now on to CPUs chosen according to 'policy', and re-pins running
+  // vaults whenever a vault's exit leaves the load uneven.  Tests can supply their own 'topology'.
+  void EnablePlacement(PlacementPolicy policy, const Topology& topology = ReadTopology());
+  // Samples the resource usage of every running vault each 'interval', keeping the latest
+  // 'history_size' samples per vault.  Each pass reads kResourceSampleBatchSize vaults at a time,
+  // yielding to other work on the io_service between batches.  Only supported on Linux.
+  void EnableResourceSampling(std::chrono::milliseconds interval,
+                              size_t history_size = kResourceHistorySize);
+  // Returns the vault's samples, oldest first.  Throws if the vault doesn't exist.
+  std::vector<ResourceSample> GetResourceUsage(const NonEmptyString& label) const;
+  // Restarts vaults which have grown too large, or which are the likeliest cause of host memory
+  // pressure, before the kernel's OOM killer picks a victim of its own (see MemoryWatchdogOptions).
+  // Each restart is orderly: the vault is asked to stop, then started again as soon as it exits.
+  // The checks are made as each vault is sampled, so resource sampling must already be enabled.
+  // Only supported on Linux.
+  void EnableMemoryWatchdog(const MemoryWatchdogOptions& options);
+  // Sends each running vault a heartbeat every 'interval'.  A vault which leaves
+  // 'missed_threshold' consecutive heartbeats unanswered is assumed to have hung, and is
+  // terminated and restarted as though it had crashed.  A reply arriving after the next heartbeat
+  // has been sent counts as missed.
+  void EnableHeartbeats(std::chrono::milliseconds interval,
+                        int missed_threshold = kMissedHeartbeatThreshold);
+  void HandleHeartbeatResponse(tcp::ConnectionPtr connection, uint64_t sequence_number,
+                               std::chrono::microseconds loop_lag,
+                               std::chrono::system_clock::time_point vault_time);
+  // Throws if the vault doesn't exist.
+  HeartbeatStats GetHeartbeatStats(const NonEmptyString& label) const;
+  // Record the ends of the Credentials and NetworkJoin phases of a vault's start (see
+  // LifecyclePhase).  The Spawn phase is recorded by HandleVaultStarted.
+  void MarkCredentialsSent(const NonEmptyString& label);
+  void MarkJoinedNetwork(tcp::ConnectionPtr connection);
+  // Returns the latencies of the vault's own starts.  Throws if the vault doesn't exist.
+  std::vector<PhaseLatency> GetLifecycleLatencies(const NonEmptyString& label) const;
+  // Returns the latencies of every vault start on this host.  Safe to call from any thread.
+  std::vector<PhaseLatency> GetLifecycleLatencies() const;
+  // The deadline for a new vault or spare to connect back, adapted to the observed Spawn latency.
+  TimeoutMetric GetConnectTimeoutMetric() const { return connect_timeout_.Metric(); }
   void AssignOwner(const NonEmptyString& label, const passport::PublicMaid::Name& owner_name,
                    DiskUsage max_disk_usage);
   void StopProcess(tcp::ConnectionPtr connection, OnExitFunctor on_exit_functor = nullptr);
-  // Returns false if the process doesn't exist.
+  // Returns false if the process doesn't exist.  A running vault is only detached from the
+  // connection, and given kConnectionClosedGracePeriod to exit before it's terminated.
   bool HandleConnectionClosed(tcp::ConnectionPtr connection);
   VaultInfo Find(const NonEmptyString& label) const;
   VaultInfo Find(tcp::ConnectionPtr connection) const;
+  // Sets a functor to be invoked whenever a vault's restart history changes, so that the history
+  // can be persisted.
+  void SetOnRestartHistoryChanged(OnRestartHistoryChangedFunctor functor);
+  // Sets a functor to be invoked with a vault's info whenever the vault is given up on, before the
+  // restart history recording it is persisted.
+  void SetOnVaultFailed(OnVaultFailedFunctor functor);
+  // Sets a functor to be invoked with a vault's label whenever the vault is removed, including when
+  // adding it fails, so that anything held for it can be dropped.
+  void SetOnVaultRemoved(OnVaultRemovedFunctor functor);
+  // Returns the vault's latest kExitHistorySize exits, oldest first.  Throws if the vault doesn't
+  // exist.
+  std::vector<ExitRecord> GetExitHistory(const NonEmptyString& label) const;
+  // Must be called on the io_service thread.  Limits restarts across the whole host to 'burst' at
+  // once, then one per 'refill_interval', so that vaults which all exited together (e.g. when the
+  // network or a mount went away) don't all rejoin the network together.  Restarts waiting for
+  // their turn are started in the order they became due.  This applies to restarts after an
+  // unexpected exit, and to starts following a quarantine or a wait for disk space, but not to
+  // orderly restarts such as those of an upgrade.  Defaults to kRestartBurst and
+  // kRestartRefillInterval.  Throws if 'burst' is zero or 'refill_interval' isn't positive.
+  void SetRestartThrottle(size_t burst, std::chrono::milliseconds refill_interval);
+  RestartQueueStats GetRestartQueueStats() const;
+  // Sets a functor to be invoked whenever a vault starts or stops running, so that the output of
+  // GetAttachedVaults can be persisted for a successor to adopt should this process crash.
+  void SetOnAttachedVaultsChanged(OnAttachedVaultsChangedFunctor functor);
+  // Must be called on the io_service thread.  Checks that 'new_executable_path' is an executable
+  // regular file, then restarts every vault onto it as described by 'options'.  Vaults added or
+  // restarted from now on use the new executable too, unless the upgrade is rolled back.  The old
+  // executable must remain in place until the upgrade finishes, so the new one must be at a
+  // different path.  'on_progress' is invoked each time a vault's restart succeeds or fails, and
+  // 'on_upgraded' once the upgrade has finished.  Its error is success unless the upgrade was
+  // rolled back (in which case it's the first failure) or interrupted by StopAll.  Throws if an
+  // upgrade is already in progress.
+  void Upgrade(const boost::filesystem::path& new_executable_path, UpgradeOptions options,
+               OnUpgradeProgressFunctor on_progress, OnUpgradedFunctor on_upgraded);
+  bool UpgradeInProgress() const { return !!rollout_; }
+  boost::filesystem::path GetVaultExecutablePath() const { return vault_executable_path_; }
+  // Returns the exit detection method actually in use.
+  ExitDetection GetExitDetection() const { return exit_detection_; }
+#ifndef MAIDSAFE_WIN32
+  // Allows vaults started after this call to inherit 'file_descriptor' when using
+  // SpawnMethod::kPosixSpawn.  stdin, stdout and stderr are always inherited.
+  void AllowInheritance(int file_descriptor);
+  // Gives each vault or spare started from now on its own pipe as stdout and stderr, instead of
+  // ours, and collects its output into rotating files in its vault_dir's "logs" folder (see
+  // VaultOutput).  Only applies to SpawnMethod::kPosixSpawn.
+  void EnableOutputCapture(uint64_t max_file_size = kVaultOutputMaxFileSize,
+                           int max_rotated_files = kVaultOutputRotatedFiles);
+  // Must be called on the io_service thread, just before the VaultManager re-executes itself.
+  // Forgets every running vault without stopping it, closing its connection so that it starts
+  // trying to reconnect, and returns what the successor needs to re-attach it via AdoptProcess.
+  // Vaults which aren't running are terminated instead, to be started afresh by the successor, and
+  // any of those which haven't exited yet are returned for it to pass to AdoptTerminated.  The
+  // returned listening port is left for the caller to fill in.  As with StopAll, only the first
+  // call of either has any effect.
+  Handover HandOver();
+  // Describes every running vault (including adopted ones yet to reconnect) as HandOver would, but
+  // without detaching any of them.
+  std::vector<AttachedVault> GetAttachedVaults() const;
+  // Registers a vault left running by a predecessor, either via HandOver or because the
+  // predecessor crashed.  The vault counts as starting until HandleVaultReattached is called for
+  // it, and is terminated and restarted if that hasn't happened within kVaultReattachTimeout.
+  // Throws if the process is no longer running, or if its start token shows the process ID to have
+  // been reused.  A crashed predecessor's vaults aren't our children, so under
+  // ExitDetection::kSigchld their exits are polled for every kOrphanPollInterval instead.
+  void AdoptProcess(VaultInfo info, const AttachedVault& attached_vault);
+  // Reaps the vaults which a predecessor terminated during its HandOver once they exit.
+  void AdoptTerminated(const std::vector<uint64_t>& process_ids);
+  // Marks this process as a child subreaper, so that processes started by vaults which then exit
+  // are re-parented to (and reaped by) us rather than init.  Only supported on Linux; elsewhere
+  // does nothing.
+  void BecomeSubreaper();
+#endif
 
  private:
   ProcessManager(boost::asio::io_service &io_service, boost::filesystem::path vault_executable_path,
-                 tcp::Port listening_port);
+                 tcp::Port listening_port, ExitDetection preferred_exit_detection,
+                 SpawnMethod spawn_method);
+
+  // The state of a single AddProcesses call.
+  struct Admission {
+    Admission(OnProcessesAddedFunctor on_added_in, int max_concurrent_starts_in)
+        : outcomes(), queued(), starting(), pending(0),
+          max_concurrent_starts(max_concurrent_starts_in), on_added(std::move(on_added_in)) {}
+    std::vector<AddProcessOutcome> outcomes;
+    std::deque<NonEmptyString> queued;
+    std::set<NonEmptyString> starting;
+    size_t pending;
+    const int max_concurrent_starts;
+    OnProcessesAddedFunctor on_added;
+  };
+
+  // The state of a StopAllRolling call.
+  struct Shutdown {
+    Shutdown(boost::asio::io_service& io_service, int max_concurrent_stops_in,
+             OnShutdownProgressFunctor on_progress_in, std::function<void()> on_stopped_in)
+        : queued(), stopping(), progress(), max_concurrent_stops(max_concurrent_stops_in),
+          deadline_timer(io_service), on_progress(std::move(on_progress_in)),
+          on_stopped(std::move(on_stopped_in)) {}
+    std::deque<NonEmptyString> queued;
+    std::set<NonEmptyString> stopping;
+    ShutdownProgress progress;
+    const int max_concurrent_stops;
+    Timer deadline_timer;
+    OnShutdownProgressFunctor on_progress;
+    std::function<void()> on_stopped;
+  };
+
+  // The state of resource sampling.  'pending' holds the process IDs still to be read in the
+  // current pass, and is reused from one pass to the next.
+  struct Sampler {
+    Sampler(boost::asio::io_service& io_service, std::chrono::milliseconds interval_in,
+            size_t history_size_in)
+        : timer(io_service), interval(interval_in), history_size(history_size_in), reader(),
+          pending(), next(0) {}
+    Timer timer;
+    const std::chrono::milliseconds interval;
+    const size_t history_size;
+    ResourceReader reader;
+    std::vector<ProcessId> pending;
+    size_t next;
+  };
+
+  // The state of an Upgrade call.  'from' and 'to' are swapped if it's rolled back.
+  struct Rollout {
+    Rollout(boost::asio::io_service& io_service, boost::filesystem::path from_in,
+            boost::filesystem::path to_in, UpgradeOptions options_in,
+            OnUpgradeProgressFunctor on_progress_in, OnUpgradedFunctor on_upgraded_in)
+        : from(std::move(from_in)), to(std::move(to_in)), options(std::move(options_in)),
+          queued(), wave(), progress(), first_error(MakeError(CommonErrors::success)),
+          wave_timer(io_service), on_progress(std::move(on_progress_in)),
+          on_upgraded(std::move(on_upgraded_in)) {}
+    boost::filesystem::path from, to;
+    const UpgradeOptions options;
+    std::deque<NonEmptyString> queued;
+    std::set<NonEmptyString> wave;
+    UpgradeProgress progress;
+    maidsafe_error first_error;
+    Timer wave_timer;
+    OnUpgradeProgressFunctor on_progress;
+    OnUpgradedFunctor on_upgraded;
+  };
+
+  // Restarts waiting for a token from 'bucket', each with the time it was queued.
+  struct RestartThrottle {
+    RestartThrottle(boost::asio::io_service& io_service, size_t burst,
+                    std::chrono::milliseconds refill_interval)
+        : bucket(burst, refill_interval, std::chrono::steady_clock::now()), queued(),
+          timer(io_service), stats() {}
+    TokenBucket bucket;
+    std::deque<std::pair<NonEmptyString, std::chrono::steady_clock::time_point>> queued;
+    Timer timer;
+    RestartQueueStats stats;
+  };
+
+  struct MemoryWatchdog {
+    explicit MemoryWatchdog(MemoryWatchdogOptions options_in)
+        : options(std::move(options_in)), under_pressure(false), last_pressure_restart() {}
+    const MemoryWatchdogOptions options;
+    bool under_pressure;
+    std::chrono::steady_clock::time_point last_pressure_restart;
+  };
+
+  struct Heartbeats {
+    Heartbeats(boost::asio::io_service& io_service, std::chrono::milliseconds interval_in,
+               int missed_threshold_in)
+        : timer(io_service), interval(interval_in), missed_threshold(missed_threshold_in) {}
+    Timer timer;
+    const std::chrono::milliseconds interval;
+    const int missed_threshold;
+  };
+
+  // The heartbeat most recently sent to a vault.  All but 'stats' is reset when the vault restarts.
+  struct HeartbeatState {
+    HeartbeatState() : sequence_number(0), awaiting_reply(false), consecutive_missed(0), sent(),
+                       stats() {}
+    uint64_t sequence_number;
+    bool awaiting_reply;
+    int consecutive_missed;
+    std::chrono::steady_clock::time_point sent;
+    HeartbeatStats stats;
+  };
+
+#ifndef MAIDSAFE_WIN32
+  // The process running the hosted vaults.  Their starts are held in 'queued' until it connects.
+  struct Host {
+    Host(boost::asio::io_service& io_service, boost::filesystem::path executable_in);
+    boost::filesystem::path executable;
+    boost::process::child process;
+    tcp::ConnectionPtr connection;
+    std::vector<ProcessId> queued;
+    Timer timer;
+    std::chrono::steady_clock::time_point launch_time;
+    std::shared_ptr<VaultOutput> output;
+    // Set once the host has been asked to exit.
+    bool stopping;
+  };
+
+  // A vault process which hasn't yet been assigned an identity.
+  struct Spare {
+    Spare(boost::asio::io_service& io_service, boost::filesystem::path executable_in);
+    boost::filesystem::path executable;
+    boost::process::child process;
+    tcp::ConnectionPtr connection;
+    std::unique_ptr<Timer> timer;
+    std::chrono::steady_clock::time_point launch_time;
+    // Not attached until the spare is given an identity.
+    std::shared_ptr<VaultOutput> output;
+  };
+#endif
 
   struct Child {
-    Child(VaultInfo info, boost::asio::io_service &io_service, int restarts);
+    Child(VaultInfo info, boost::filesystem::path executable, boost::asio::io_service &io_service);
     Child(Child&& other);
     Child& operator=(Child other);
     VaultInfo info;
+    // The executable the vault runs, which changes when the vault is upgraded.
+    boost::filesystem::path executable;
+    // Set while the vault is being stopped so that it can be restarted, either onto a new
+    // executable or to release memory it has leaked.
+    bool restarting;
+    // Set while a vault adopted from a predecessor hasn't yet reconnected.
+    bool awaiting_reattach;
+    // Set while the vault's process isn't our child, having been adopted from a predecessor which
+    // crashed.
+    bool orphaned;
     OnExitFunctor on_exit;
+    // Non-zero while the vault runs as a thread of the vault host rather than as 'process'.
+    ProcessId instance_id;
+    // Set while a hosted vault which has been terminated is still running.  Its thread can only be
+    // asked to stop, so the vault isn't restarted (if 'restart_when_stopped' is set) until then.
+    bool terminating, restart_when_stopped;
     std::unique_ptr<Timer> timer;
-    int restart_count;
+    std::chrono::steady_clock::time_point start_time;
     std::vector<std::string> process_args;
     ProcessStatus status;
+    std::shared_ptr<Admission> admission;
+    size_t admission_index;
+    RingBuffer<ResourceSample> resource_history;
+    // The RSS of the vault's current run when it was first sampled after starting, and when last
+    // sampled.  Zero until then.
+    uint64_t initial_rss, latest_rss;
+    RingBuffer<ExitRecord> exit_history;
+    // The OOM kill count of the vault's cgroup (or of the host if cgroups aren't enabled) when the
+    // vault was launched.
+    uint64_t oom_kills_at_launch;
+    HeartbeatState heartbeat;
+    // When the current start's VaultStarted was received and its credentials were sent.
+    std::chrono::steady_clock::time_point connected_time, credentials_time;
+    std::unique_ptr<LifecycleHistograms> latencies;
+    // Kept after the process exits so that its final output is still collected, and only replaced
+    // when the vault is next started.
+    std::shared_ptr<VaultOutput> output;
 #ifdef MAIDSAFE_WIN32
     boost::asio::windows::object_handle handle;
 #endif
@@ -100,28 +537,183 @@ class ProcessManager {
   };
   friend void swap(Child& lhs, Child& rhs);
 
-  void StartProcess(std::vector<Child>::iterator itr);
+  void CheckCanAdd(const VaultInfo& info) const;
+  void StartProcess(Child& vault);
+  // Indexes the vault under its new process ID, first evicting any vault still registered under
+  // that ID.  Such a vault's process must have exited unnoticed, so its exit is handled too.
+  void RegisterProcessId(Child& vault);
+  // Treats the vault as failed unless it sends VaultStarted within the connect timeout.
+  void AwaitConnection(Child& vault);
+  // Returns null if the vault has no launch profile, or if its profile isn't known.
+  const LaunchProfile* FindLaunchProfile(const Child& vault) const;
+  // Sets 'output' to the unattached reader of the process's stdout and stderr if output capture is
+  // enabled, or to null otherwise.  If 'launch_profile' isn't null, its environment is applied.
+  boost::process::child LaunchProcess(const boost::filesystem::path& executable,
+                                     const std::vector<std::string>& args,
+                                     const LaunchProfile* launch_profile,
+                                     std::shared_ptr<VaultOutput>& output);
+  void PlaceInCgroup(const Child& vault);
+  void PinToCpus(const Child& vault);
+  void Prioritise(const Child& vault);
+  void ReleaseCpus(const NonEmptyString& label);
+  void AdmitNext(const std::shared_ptr<Admission>& admission);
+  void CompleteAdmission(Child& vault, maidsafe_error error);
+  // Removes the vault from vaults_ and invokes on_vault_removed_.  Doesn't throw.
+  void EraseVault(const NonEmptyString& label);
+  void StopNext(const std::shared_ptr<Shutdown>& shutdown);
+  void OnVaultStopped(const std::shared_ptr<Shutdown>& shutdown, const NonEmptyString& label,
+                      const maidsafe_error& error);
+  void OnShutdownDeadline(const std::shared_ptr<Shutdown>& shutdown);
+  void ScheduleSampling();
+  void StartSamplingPass();
+  void SampleNextBatch();
+  void StopSampling();
+  void CheckRss(Child& vault, uint64_t rss);
+  void CheckMemoryPressure();
+  void RestartToReleaseMemory(Child& vault, const std::string& reason);
+  void ScheduleHeartbeats();
+  void SendHeartbeats();
+  void StopHeartbeats();
+  void RecordLatency(Child& vault, LifecyclePhase phase,
+                     std::chrono::steady_clock::duration duration);
+  void LogLifecycleLatencies() const;
+  void QueueForRollout(Rollout& rollout);
+  void StartWave(const std::shared_ptr<Rollout>& rollout);
+  // Returns false if the vault wasn't running, so there's nothing to wait for.
+  bool RestartOnto(Child& vault, const boost::filesystem::path& executable);
+  // Records the outcome of a vault's restart in the current wave.  'result' is success once the
+  // vault has rejoined the network, and CommonErrors::no_such_element if it has been removed.
+  void SettleUpgrade(const NonEmptyString& label, const maidsafe_error& result);
+  void OnWaveTimeout(const std::shared_ptr<Rollout>& rollout);
+  void EndWave(const std::shared_ptr<Rollout>& rollout);
+  void FinishUpgrade(const maidsafe_error& error);
+  void StopUpgrade();
+  // Starts the vault now if the restart throttle allows, or else queues it.
+  void AdmitRestart(Child& vault);
+  void ScheduleRestartQueue();
+  void ServeRestartQueue();
+  void StopRestartThrottle();
+#ifndef MAIDSAFE_WIN32
+  bool TakeSpare(Child& vault);
+  // Starts collecting the vault's output into its vault_dir.  Closes any previous output first.
+  void AttachOutput(Child& vault, std::shared_ptr<VaultOutput> output);
+  void OnSpareAssigned(const NonEmptyString& label);
+  void RefillSpares();
+  void OnSpareExit(ProcessId process_id, bool terminate);
+  void DrainSparePool();
+  void ReplaceSpares();
+  void StartInstance(Child& vault);
+  // Asks the hosted vault to stop, and quarantines it if it hasn't within kVaultStopTimeout.
+  void TerminateInstance(Child& vault);
+  void OnInstanceExit(ProcessId instance_id, int exit_code);
+  void LaunchHost();
+  ProcessId HostProcessId() const;
+  bool IsQueuedInstance(ProcessId instance_id) const;
+  // Closes the host's connection, which tells it to exit, and kills it if it hasn't within
+  // kVaultStopTimeout.
+  void StopHost();
+  void KillHost();
+  void OnHostExit(const ExitStatus& exit_status);
+#endif
   void InitSignalHandler();
+  // Once StopAll or StopAllRolling has been called and every vault has gone, the SIGCHLD handler is
+  // no longer needed.  Until then, it's kept so that vaults which stop are still reaped.
+  void StopSignalHandlerWhenIdle();
+#ifndef MAIDSAFE_WIN32
+  // Reaps every exited child which is a vault, spare or host, or was one when it was terminated.
+  void ReapExitedChildren();
+  void OnChildReaped(ProcessId process_id, const ExitStatus& exit_status);
+  // Under ExitDetection::kSigchld, remembers a terminated child so that it's reaped even once it
+  // has been dropped from vaults_ or spares_.
+  void RememberTerminated(ProcessId process_id);
+  void FallBackToSigchld();
+  AttachedVault Describe(const Child& vault, ResourceReader& reader) const;
+  void ScheduleOrphanPoll();
+  void PollOrphans();
+#endif
+#ifdef MAIDSAFE_LINUX
+  void WatchPidfd(ProcessId process_id);
+  void OnPidfdReadable(ProcessId process_id);
+  // Reaps every exited child which isn't a vault, spare or host, handling any which are along the
+  // way, since those behind them can't otherwise be seen.
+  void ReapStrayDescendants();
+#endif
 
-  std::vector<Child>::const_iterator DoFind(const NonEmptyString& label) const;
-  std::vector<Child>::iterator DoFind(const NonEmptyString& label);
-  std::vector<Child>::const_iterator DoFind(tcp::ConnectionPtr connection) const;
-  std::vector<Child>::iterator DoFind(tcp::ConnectionPtr connection);
+  const Child& DoFind(const NonEmptyString& label) const;
+  Child& DoFind(const NonEmptyString& label);
+  const Child& DoFind(tcp::ConnectionPtr connection) const;
+  Child& DoFind(tcp::ConnectionPtr connection);
   ProcessId GetProcessId(const Child& vault) const;
   bool IsRunning(const Child& vault) const;
-  void OnProcessExit(const NonEmptyString& label, int exit_code, bool terminate = false);
-  void TerminateProcess(std::vector<Child>::iterator itr);
+  void OnProcessExit(NonEmptyString label, const ExitStatus& exit_status,
+                     bool terminate = false);
+  // 'terminate' is true if the VaultManager is killing the vault itself.
+  ExitClass ClassifyExit(const Child& vault, const ExitStatus& exit_status, bool terminate) const;
+  uint64_t ReadOomKills(const Child& vault) const;
+  bool HasFreeDiskSpace(const Child& vault) const;
+  void TerminateProcess(Child& vault);
   void InvokeOnExitFunctor(OnExitFunctor on_exit, int exit_code, bool terminate);
-  void RestartIfRequired(int restart_count, VaultInfo vault_info);
+  // Keeps the vault registered, but detaches it from its old process and connection.
+  void DetachProcess(Child& vault);
+  void ReleaseProcessHandle(Child& vault);
+  void DetachConnection(Child& vault);
+  // Detaches the vault from its closed connection and waits for its process to exit.
+  void AwaitExitAfterClose(Child& vault);
+  void ScheduleRestart(Child& vault, ExitClass exit_class);
+  // Unless 'throttled' is false, the start is subject to the restart throttle once 'delay' has
+  // passed.
+  void ScheduleStart(Child& vault, std::chrono::milliseconds delay, bool throttled = true);
+  // Starts a vault whose restart is due, scheduling a further restart if that fails.
+  void StartDueVault(Child& vault);
+  void NotifyAttachedVaultsChanged();
 
   boost::asio::io_service &io_service_;
 #ifndef MAIDSAFE_WIN32
   boost::asio::signal_set signal_set_;
 #endif
+  ExitDetection exit_detection_;
   std::once_flag stop_all_flag_;
+  bool stopping_all_, stopped_all_;
   const tcp::Port kListeningPort_;
-  const boost::filesystem::path kVaultExecutablePath_;
-  std::vector<Child> vaults_;
+  // The executable for new vaults and spares.
+  boost::filesystem::path vault_executable_path_;
+  const SpawnMethod kSpawnMethod_;
+#ifndef MAIDSAFE_WIN32
+  std::set<int> inheritable_descriptors_;
+  // Output capture is disabled while 'output_max_file_size_' is 0.
+  uint64_t output_max_file_size_;
+  int output_rotated_files_;
+#endif
+  OnRestartHistoryChangedFunctor on_restart_history_changed_;
+  OnVaultFailedFunctor on_vault_failed_;
+  OnVaultRemovedFunctor on_vault_removed_;
+  OnAttachedVaultsChangedFunctor on_attached_vaults_changed_;
+  std::unique_ptr<Cgroups> cgroups_;
+  std::unique_ptr<Placement> placement_;
+  std::map<std::string, LaunchProfile> launch_profiles_;
+  std::shared_ptr<Sampler> sampler_;
+  std::shared_ptr<MemoryWatchdog> memory_watchdog_;
+  std::shared_ptr<Heartbeats> heartbeats_;
+  std::shared_ptr<RestartThrottle> restart_throttle_;
+  LifecycleHistograms host_latencies_;
+  AdaptiveTimeout connect_timeout_;
+  std::shared_ptr<Rollout> rollout_;
+#ifndef MAIDSAFE_WIN32
+  size_t spare_pool_size_;
+  int consecutive_spare_failures_;
+  OnSpareAssignedFunctor on_spare_assigned_;
+  Timer spare_refill_timer_;
+  std::map<ProcessId, Spare> spares_;
+  std::set<ProcessId> terminated_children_;
+  bool subreaper_, orphan_poll_scheduled_;
+  Timer orphan_timer_;
+  // In-process hosting is disabled while 'host_dir_' is empty.
+  boost::filesystem::path host_dir_;
+  std::vector<std::string> host_args_;
+  std::unique_ptr<Host> host_;
+  ProcessId next_instance_id_;
+#endif
+  VaultRegistry<Child> vaults_;
 };
 
 }  // namespace vault_manager
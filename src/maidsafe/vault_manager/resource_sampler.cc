@@ -0,0 +1,254 @@
+/*  Copyright 2014 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include "maidsafe/vault_manager/resource_sampler.h"
+
+#ifdef MAIDSAFE_LINUX
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/types.h>
+#include <unistd.h>
+#endif
+
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+namespace maidsafe {
+
+namespace vault_manager {
+
+namespace {
+
+// Advances 'position' past the executable name in parentheses (which may itself contain spaces or
+// parentheses) and the state field of /proc/<pid>/stat.
+bool SkipToPpid(const char*& position, char& state) {
+  position = std::strrchr(position, ')');
+  if (!position)
+    return false;
+  ++position;
+  while (*position == ' ')
+    ++position;
+  state = *position;
+  while (*position != ' ' && *position != '\0')
+    ++position;
+  return true;
+}
+
+// Parses the integer following any whitespace at 'position' and advances 'position' past it.
+bool NextInteger(const char*& position, long long& value) {  // NOLINT (Fraser)
+  char* end(nullptr);
+  errno = 0;
+  value = std::strtoll(position, &end, 10);
+  if (end == position || errno != 0)
+    return false;
+  position = end;
+  return true;
+}
+
+// Finds 'key' (which must include the leading newline, since some keys are suffixes of others)
+// and parses the integer following it.
+bool FindInteger(const char* contents, const char* key, long long& value) {  // NOLINT (Fraser)
+  const char* position(std::strstr(contents, key));
+  if (!position)
+    return false;
+  position += std::strlen(key);
+  return NextInteger(position, value) && value >= 0;
+}
+
+}  // unnamed namespace
+
+bool ParseProcStat(const char* contents, long ticks_per_second,  // NOLINT (Fraser)
+                   ResourceSample& sample) {
+  // The fields following the state are ppid, pgrp, session, tty_nr, tpgid, flags, minflt,
+  // cminflt, majflt, cmajflt, utime and stime.
+  const char* position(contents);
+  char state(0);
+  if (!SkipToPpid(position, state) || ticks_per_second <= 0)
+    return false;
+  long long value(0);  // NOLINT (Fraser)
+  for (int i(0); i != 10; ++i) {
+    if (!NextInteger(position, value))
+      return false;
+  }
+  long long user_ticks(0), system_ticks(0);  // NOLINT (Fraser)
+  if (!NextInteger(position, user_ticks) || !NextInteger(position, system_ticks) ||
+      user_ticks < 0 || system_ticks < 0) {
+    return false;
+  }
+  sample.cpu_time = std::chrono::milliseconds{ (user_ticks + system_ticks) * 1000 /
+                                               ticks_per_second };
+  return true;
+}
+
+bool ParseProcStartTime(const char* contents, uint64_t& start_time) {
+  // Start time is the 19th field after the state.  A zombie ('Z') or dead ('X') process has exited.
+  const char* position(contents);
+  char state(0);
+  if (!SkipToPpid(position, state) || state == 'Z' || state == 'X')
+    return false;
+  long long value(0);  // NOLINT (Fraser)
+  for (int i(0); i != 19; ++i) {
+    if (!NextInteger(position, value))
+      return false;
+  }
+  if (value < 0)
+    return false;
+  start_time = static_cast<uint64_t>(value);
+  return true;
+}
+
+bool ParseProcStatus(const char* contents, ResourceSample& sample) {
+  long long threads(0), rss_kilobytes(0);  // NOLINT (Fraser)
+  if (!FindInteger(contents, "\nThreads:", threads))
+    return false;
+  sample.threads = static_cast<uint32_t>(threads);
+  // Kernel threads and zombies have no VmRSS entry.
+  sample.rss = FindInteger(contents, "\nVmRSS:", rss_kilobytes) ?
+               static_cast<uint64_t>(rss_kilobytes) * 1024 : 0;
+  return true;
+}
+
+bool ParseProcIo(const char* contents, ResourceSample& sample) {
+  long long read_bytes(0), write_bytes(0);  // NOLINT (Fraser)
+  if (!FindInteger(contents, "\nread_bytes:", read_bytes) ||
+      !FindInteger(contents, "\nwrite_bytes:", write_bytes)) {
+    return false;
+  }
+  sample.read_bytes = static_cast<uint64_t>(read_bytes);
+  sample.write_bytes = static_cast<uint64_t>(write_bytes);
+  return true;
+}
+
+bool ParseMemoryPressure(const char* contents, MemoryPressure& pressure) {
+  // Each line reads e.g. "some avg10=1.53 avg60=0.87 avg300=0.21 total=123456".
+  auto find_average([contents](const char* key, double& value) {
+    const char* position(std::strstr(contents, key));
+    if (!position)
+      return false;
+    position += std::strlen(key);
+    char* end(nullptr);
+    errno = 0;
+    value = std::strtod(position, &end);
+    return end != position && errno == 0 && value >= 0.0;
+  });
+  return find_average("some avg10=", pressure.some_avg10) &&
+         find_average("full avg10=", pressure.full_avg10);
+}
+
+ResourceReader::ResourceReader()
+    : buffer_(),
+      path_(),
+#ifdef MAIDSAFE_LINUX
+      ticks_per_second_(sysconf(_SC_CLK_TCK)) {}
+#else
+      ticks_per_second_(0) {}
+#endif
+
+bool ResourceReader::Read(uint64_t process_id, ResourceSample& sample) {
+#ifdef MAIDSAFE_LINUX
+  sample = ResourceSample();
+  sample.time = std::chrono::steady_clock::now();
+  if (!ReadProcFile(process_id, "stat") ||
+      !ParseProcStat(buffer_.data(), ticks_per_second_, sample) ||
+      !ReadProcFile(process_id, "status") || !ParseProcStatus(buffer_.data(), sample)) {
+    return false;
+  }
+  // The io file is missing if the kernel was built without task I/O accounting.
+  if (ReadProcFile(process_id, "io"))
+    ParseProcIo(buffer_.data(), sample);
+  sample.file_descriptors = CountFileDescriptors(process_id);
+  return true;
+#else
+  static_cast<void>(process_id);
+  static_cast<void>(sample);
+  return false;
+#endif
+}
+
+uint64_t ResourceReader::ReadStartTime(uint64_t process_id) {
+  uint64_t start_time(0);
+  if (!ReadProcFile(process_id, "stat") || !ParseProcStartTime(buffer_.data(), start_time))
+    return 0;
+  return start_time;
+}
+
+bool ResourceReader::ReadMemoryPressure(MemoryPressure& pressure) {
+  return ReadIntoBuffer("/proc/pressure/memory") && ParseMemoryPressure(buffer_.data(), pressure);
+}
+
+bool ResourceReader::ReadProcFile(uint64_t process_id, const char* name) {
+#ifdef MAIDSAFE_LINUX
+  std::snprintf(path_.data(), path_.size(), "/proc/%llu/%s",
+                static_cast<unsigned long long>(process_id), name);  // NOLINT (Fraser)
+  return ReadIntoBuffer(path_.data());
+#else
+  static_cast<void>(process_id);
+  static_cast<void>(name);
+  return false;
+#endif
+}
+
+bool ResourceReader::ReadIntoBuffer(const char* path) {
+#ifdef MAIDSAFE_LINUX
+  int fd(open(path, O_RDONLY | O_CLOEXEC));
+  if (fd == -1)
+    return false;
+  size_t size(0);
+  while (size < buffer_.size() - 1) {
+    ssize_t result(read(fd, buffer_.data() + size, buffer_.size() - 1 - size));
+    if (result == -1 && errno == EINTR)
+      continue;
+    if (result <= 0)
+      break;
+    size += static_cast<size_t>(result);
+  }
+  close(fd);
+  buffer_[size] = '\0';
+  return size != 0;
+#else
+  static_cast<void>(path);
+  return false;
+#endif
+}
+
+uint32_t ResourceReader::CountFileDescriptors(uint64_t process_id) {
+#ifdef MAIDSAFE_LINUX
+  std::snprintf(path_.data(), path_.size(), "/proc/%llu/fd",
+                static_cast<unsigned long long>(process_id));  // NOLINT (Fraser)
+  DIR* directory(opendir(path_.data()));
+  if (!directory)
+    return 0;
+  uint32_t count(0);
+  while (dirent* entry = readdir(directory)) {
+    if (entry->d_name[0] != '.')
+      ++count;
+  }
+  closedir(directory);
+  return count;
+#else
+  static_cast<void>(process_id);
+  return 0;
+#endif
+}
+
+}  // namespace vault_manager
+
+}  // namespace maidsafe
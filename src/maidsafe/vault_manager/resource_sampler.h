@@ -0,0 +1,122 @@
+/*  Copyright 2014 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#ifndef MAIDSAFE_VAULT_MANAGER_RESOURCE_SAMPLER_H_
+#define MAIDSAFE_VAULT_MANAGER_RESOURCE_SAMPLER_H_
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "maidsafe/vault_manager/resource_usage.h"
+
+namespace maidsafe {
+
+namespace vault_manager {
+
+// A fixed-capacity buffer which overwrites its oldest element once full.  Only construction
+// allocates.
+template <typename T>
+class RingBuffer {
+ public:
+  explicit RingBuffer(size_t capacity = 0) : buffer_(capacity), next_(0), size_(0) {}
+  void Push(const T& value);
+  // Returns the elements oldest first.
+  std::vector<T> Contents() const;
+  size_t Size() const { return size_; }
+  size_t Capacity() const { return buffer_.size(); }
+
+ private:
+  std::vector<T> buffer_;
+  size_t next_, size_;
+};
+
+// The host's memory pressure, as reported by the kernel's pressure stall information.  Each is the
+// percentage of the last ten seconds during which some (or all) non-idle tasks were stalled waiting
+// for memory.
+struct MemoryPressure {
+  MemoryPressure() : some_avg10(0.0), full_avg10(0.0) {}
+  double some_avg10, full_avg10;
+};
+
+// Each parses the contents of the corresponding /proc/<pid> file into 'sample', returning false if
+// the contents are malformed.  'contents' must be null-terminated.
+bool ParseProcStat(const char* contents, long ticks_per_second,  // NOLINT (Fraser)
+                   ResourceSample& sample);
+bool ParseProcStatus(const char* contents, ResourceSample& sample);
+bool ParseProcIo(const char* contents, ResourceSample& sample);
+// Parses the process's start time (in clock ticks since boot) from the contents of its
+// /proc/<pid>/stat.  Together with the process ID, this identifies a process even once its ID has
+// been reused.  Fails if the process has exited, even if it hasn't yet been reaped.
+bool ParseProcStartTime(const char* contents, uint64_t& start_time);
+// Parses the contents of /proc/pressure/memory.  'contents' must be null-terminated.
+bool ParseMemoryPressure(const char* contents, MemoryPressure& pressure);
+
+// Reads the resource usage of processes from /proc/<pid>/stat, status and io, and counts the
+// entries of /proc/<pid>/fd.  A single buffer is reused for every read.
+class ResourceReader {
+ public:
+  ResourceReader();
+  // Returns false if the process doesn't exist (or isn't readable), and always on systems other
+  // than Linux.
+  bool Read(uint64_t process_id, ResourceSample& sample);
+  // Returns 0 if the process doesn't exist, has exited or isn't readable, and always on systems
+  // other than Linux.
+  uint64_t ReadStartTime(uint64_t process_id);
+  // Returns false if the kernel doesn't provide pressure stall information (it needs Linux 4.20 or
+  // later, built with CONFIG_PSI), and always on systems other than Linux.
+  bool ReadMemoryPressure(MemoryPressure& pressure);
+
+ private:
+  bool ReadProcFile(uint64_t process_id, const char* name);
+  bool ReadIntoBuffer(const char* path);
+  uint32_t CountFileDescriptors(uint64_t process_id);
+
+  std::array<char, 4096> buffer_;
+  std::array<char, 64> path_;
+  long ticks_per_second_;  // NOLINT (Fraser)
+};
+
+template <typename T>
+void RingBuffer<T>::Push(const T& value) {
+  if (buffer_.empty())
+    return;
+  buffer_[next_] = value;
+  next_ = (next_ + 1) % buffer_.size();
+  size_ = std::min(size_ + 1, buffer_.size());
+}
+
+template <typename T>
+std::vector<T> RingBuffer<T>::Contents() const {
+  std::vector<T> contents;
+  if (size_ == 0)
+    return contents;
+  contents.reserve(size_);
+  size_t index((next_ + buffer_.size() - size_) % buffer_.size());
+  for (size_t i(0); i < size_; ++i, index = (index + 1) % buffer_.size())
+    contents.push_back(buffer_[index]);
+  return contents;
+}
+
+}  // namespace vault_manager
+
+}  // namespace maidsafe
+
+#endif  // MAIDSAFE_VAULT_MANAGER_RESOURCE_SAMPLER_H_
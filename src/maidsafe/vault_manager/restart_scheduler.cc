@@ -0,0 +1,94 @@
+/*  Copyright 2014 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include "maidsafe/vault_manager/restart_scheduler.h"
+
+#include <algorithm>
+
+#include "maidsafe/common/log.h"
+#include "maidsafe/common/utils.h"
+
+#include "maidsafe/vault_manager/config.h"
+
+namespace maidsafe {
+
+namespace vault_manager {
+
+RestartDecision RecordUnexpectedExit(RestartHistory& history,
+                                     std::chrono::steady_clock::duration uptime,
+                                     std::chrono::system_clock::time_point now,
+                                     bool bad_config) {
+  int forgiven{ static_cast<int>(uptime / kRestartDecayPeriod) };
+  history.failure_count = std::max(0, history.failure_count - forgiven) + 1;
+  if (forgiven != 0)
+    history.consecutive_quarantines = 0;
+  history.consecutive_bad_configs = bad_config ? history.consecutive_bad_configs + 1 : 0;
+  if (history.consecutive_bad_configs >= kMaxConsecutiveBadConfigs) {
+    LOG(kError) << history.consecutive_bad_configs << " consecutive exits with a bad "
+                << "configuration - giving up on vault.";
+    history.failed = true;
+    return RestartDecision{ false, std::chrono::milliseconds(0), true };
+  }
+
+  history.recent_exits.erase(
+      std::remove_if(std::begin(history.recent_exits), std::end(history.recent_exits),
+                     [now](std::chrono::system_clock::time_point exit_time) {
+                       return exit_time + kCrashLoopWindow < now;
+                     }),
+      std::end(history.recent_exits));
+  history.recent_exits.push_back(now);
+
+  if (static_cast<int>(history.recent_exits.size()) >= kCrashLoopThreshold) {
+    if (history.consecutive_quarantines >= kMaxConsecutiveQuarantines) {
+      LOG(kError) << "Still crash-looping after " << history.consecutive_quarantines
+                  << " consecutive quarantines - giving up on vault.";
+      history.recent_exits.clear();
+      history.failed = true;
+      return RestartDecision{ false, std::chrono::milliseconds(0), true };
+    }
+    ++history.consecutive_quarantines;
+    LOG(kError) << history.recent_exits.size() << " exits within " << kCrashLoopWindow.count()
+                << " minutes - quarantining vault for " << kQuarantineDuration.count() << " hours.";
+    history.recent_exits.clear();
+    history.quarantined_until = now + kQuarantineDuration;
+    return RestartDecision{ true, QuarantineRemaining(history, now) };
+  }
+  return RestartDecision{ false, BackoffDelay(history.failure_count) };
+}
+
+std::chrono::milliseconds BackoffDelay(int failure_count) {
+  if (failure_count <= 1)
+    return std::chrono::milliseconds(0);
+  std::chrono::milliseconds delay{ kRestartBackoffBase };
+  for (int i(2); i < failure_count && delay < kRestartBackoffCeiling; ++i)
+    delay *= 2;
+  delay = std::min(delay, kRestartBackoffCeiling);
+  std::chrono::milliseconds half{ delay / 2 };
+  return half + std::chrono::milliseconds(RandomUint32() % (half.count() + 1));
+}
+
+std::chrono::milliseconds QuarantineRemaining(const RestartHistory& history,
+                                              std::chrono::system_clock::time_point now) {
+  if (history.quarantined_until <= now)
+    return std::chrono::milliseconds(0);
+  return std::chrono::duration_cast<std::chrono::milliseconds>(history.quarantined_until - now);
+}
+
+}  // namespace vault_manager
+
+}  // namespace maidsafe
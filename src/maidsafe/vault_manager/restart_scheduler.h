@@ -0,0 +1,64 @@
+/*  Copyright 2014 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#ifndef MAIDSAFE_VAULT_MANAGER_RESTART_SCHEDULER_H_
+#define MAIDSAFE_VAULT_MANAGER_RESTART_SCHEDULER_H_
+
+#include <chrono>
+
+#include "maidsafe/vault_manager/vault_info.h"
+
+namespace maidsafe {
+
+namespace vault_manager {
+
+struct RestartDecision {
+  RestartDecision(bool quarantined_in, std::chrono::milliseconds delay_in, bool give_up_in = false)
+      : quarantined(quarantined_in), delay(delay_in), give_up(give_up_in) {}
+  bool quarantined;
+  std::chrono::milliseconds delay;
+  // If set, the vault shouldn't be restarted at all and 'delay' is meaningless.
+  bool give_up;
+};
+
+// Records an unexpected exit of a vault which had been up for 'uptime' and decides when it should
+// be restarted.  Each kRestartDecayPeriod of uptime forgives one earlier failure.  The first
+// failure is restarted immediately, and each subsequent one doubles the delay from
+// kRestartBackoffBase up to kRestartBackoffCeiling.  kCrashLoopThreshold exits within
+// kCrashLoopWindow quarantine the vault for kQuarantineDuration instead.  The vault is given up on
+// (and 'history.failed' set) only on a confirmed signal that restarting won't help:
+// kMaxConsecutiveBadConfigs consecutive exits with 'bad_config' set, or a further crash loop after
+// kMaxConsecutiveQuarantines consecutive quarantines.
+RestartDecision RecordUnexpectedExit(RestartHistory& history,
+                                     std::chrono::steady_clock::duration uptime,
+                                     std::chrono::system_clock::time_point now,
+                                     bool bad_config = false);
+
+// Returns the delay before restarting after 'failure_count' consecutive failures.  Up to half of
+// the delay is random so that vaults which failed together aren't all restarted together.
+std::chrono::milliseconds BackoffDelay(int failure_count);
+
+// Returns zero if the vault isn't quarantined.
+std::chrono::milliseconds QuarantineRemaining(const RestartHistory& history,
+                                              std::chrono::system_clock::time_point now);
+
+}  // namespace vault_manager
+
+}  // namespace maidsafe
+
+#endif  // MAIDSAFE_VAULT_MANAGER_RESTART_SCHEDULER_H_
@@ -0,0 +1,127 @@
+/*  Copyright 2014 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include "maidsafe/vault_manager/scheduling.h"
+
+#ifdef MAIDSAFE_LINUX
+#include <sched.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <sys/types.h>
+#include <unistd.h>
+#endif
+
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "boost/filesystem/operations.hpp"
+
+#include "maidsafe/common/error.h"
+#include "maidsafe/common/log.h"
+
+namespace fs = boost::filesystem;
+
+namespace maidsafe {
+
+namespace vault_manager {
+
+namespace {
+
+#ifdef MAIDSAFE_LINUX
+// From linux/ioprio.h, which glibc doesn't wrap.
+const int kIoprioWhoProcess(1);
+const int kIoprioClassShift(13);
+const int kIoprioClassNone(0);
+const int kIoprioClassBestEffort(2);
+
+bool Apply(pid_t thread_id, const SchedulingParameters& parameters) {
+  bool applied(true);
+  auto failed([&](const char* const call) {
+    // The thread may have exited since the task directory was read.
+    if (errno == ESRCH)
+      return;
+    LOG(kWarning) << call << " failed for thread " << thread_id << ": " << std::strerror(errno);
+    applied = false;
+  });
+  sched_param param;
+  param.sched_priority = 0;
+  if (sched_setscheduler(thread_id, parameters.batch ? SCHED_BATCH : SCHED_OTHER, &param) != 0)
+    failed("sched_setscheduler");
+  if (setpriority(PRIO_PROCESS, static_cast<id_t>(thread_id), parameters.nice) != 0)
+    failed("setpriority");
+  const int kIoPriority(parameters.io_priority < 0 ?
+      (kIoprioClassNone << kIoprioClassShift) :
+      ((kIoprioClassBestEffort << kIoprioClassShift) | parameters.io_priority));
+  if (syscall(SYS_ioprio_set, kIoprioWhoProcess, thread_id, kIoPriority) != 0)
+    failed("ioprio_set");
+  return applied;
+}
+#endif
+
+}  // unnamed namespace
+
+SchedulingParameters GetSchedulingParameters(SchedulingClass scheduling_class) {
+  switch (scheduling_class) {
+    case SchedulingClass::kInteractive:
+      return SchedulingParameters{ -5, 2, false };
+    case SchedulingClass::kBatch:
+      return SchedulingParameters{ 10, 7, true };
+    default:
+      return SchedulingParameters{ 0, -1, false };
+  }
+}
+
+SchedulingClass ParseSchedulingClass(int32_t value) {
+  if (value < static_cast<int32_t>(SchedulingClass::kNormal) ||
+      value > static_cast<int32_t>(SchedulingClass::kBatch)) {
+    LOG(kError) << value << " isn't a valid scheduling class.";
+    BOOST_THROW_EXCEPTION(MakeError(CommonErrors::invalid_parameter));
+  }
+  return static_cast<SchedulingClass>(value);
+}
+
+bool ApplySchedulingClass(uint64_t process_id, SchedulingClass scheduling_class) {
+#ifdef MAIDSAFE_LINUX
+  // Each of the settings only applies to a single thread, so set each of the process's threads.
+  // Threads started later inherit the settings of the thread which starts them.
+  std::vector<pid_t> thread_ids;
+  boost::system::error_code error_code;
+  fs::directory_iterator itr(fs::path("/proc") / std::to_string(process_id) / "task", error_code);
+  for (; !error_code && itr != fs::directory_iterator(); itr.increment(error_code))
+    thread_ids.push_back(static_cast<pid_t>(std::atoi(itr->path().filename().c_str())));
+  if (thread_ids.empty())
+    thread_ids.push_back(static_cast<pid_t>(process_id));
+
+  const SchedulingParameters kParameters(GetSchedulingParameters(scheduling_class));
+  bool applied(true);
+  for (pid_t thread_id : thread_ids)
+    applied = Apply(thread_id, kParameters) && applied;
+  return applied;
+#else
+  static_cast<void>(process_id);
+  static_cast<void>(scheduling_class);
+  return false;
+#endif
+}
+
+}  // namespace vault_manager
+
+}  // namespace maidsafe
@@ -0,0 +1,53 @@
+/*  Copyright 2014 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#ifndef MAIDSAFE_VAULT_MANAGER_SCHEDULING_H_
+#define MAIDSAFE_VAULT_MANAGER_SCHEDULING_H_
+
+#include <cstdint>
+
+#include "maidsafe/vault_manager/scheduling_class.h"
+
+namespace maidsafe {
+
+namespace vault_manager {
+
+// The kernel settings which a SchedulingClass stands for.  'io_priority' is a best-effort I/O
+// priority from 0 (highest) to 7, or -1 to have the I/O priority follow 'nice' as it does by
+// default.
+struct SchedulingParameters {
+  int nice;
+  int io_priority;
+  bool batch;
+};
+
+SchedulingParameters GetSchedulingParameters(SchedulingClass scheduling_class);
+
+// Throws if 'value' isn't a SchedulingClass, e.g. one read from a message or the config file.
+SchedulingClass ParseSchedulingClass(int32_t value);
+
+// Applies 'scheduling_class' to every thread of the process using setpriority, ioprio_set and
+// sched_setscheduler.  Returns false if any setting couldn't be applied (always on non-Linux
+// systems), in which case the rest are still applied.
+bool ApplySchedulingClass(uint64_t process_id, SchedulingClass scheduling_class);
+
+}  // namespace vault_manager
+
+}  // namespace maidsafe
+
+#endif  // MAIDSAFE_VAULT_MANAGER_SCHEDULING_H_
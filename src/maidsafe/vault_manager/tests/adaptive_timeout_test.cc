@@ -0,0 +1,120 @@
+/*  Copyright 2014 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include "maidsafe/vault_manager/adaptive_timeout.h"
+
+#include <chrono>
+#include <thread>
+
+#include "maidsafe/common/error.h"
+#include "maidsafe/common/test.h"
+
+namespace maidsafe {
+
+namespace vault_manager {
+
+namespace test {
+
+namespace {
+
+const std::chrono::milliseconds kInitial(2000), kFloor(1000), kCeiling(60000);
+
+}  // unnamed namespace
+
+TEST(AdaptiveTimeoutTest, BEH_Construct) {
+  EXPECT_THROW(AdaptiveTimeout(TimeoutKind::kVaultConnect, kInitial, std::chrono::milliseconds(0),
+                               kCeiling), maidsafe_error);
+  EXPECT_THROW(AdaptiveTimeout(TimeoutKind::kVaultConnect, kInitial, kCeiling, kFloor),
+               maidsafe_error);
+  AdaptiveTimeout timeout(TimeoutKind::kNewConnection, kInitial, kFloor, kCeiling);
+  EXPECT_EQ(kInitial, timeout.Value());
+  auto metric(timeout.Metric());
+  EXPECT_EQ(TimeoutKind::kNewConnection, metric.kind);
+  EXPECT_EQ(kInitial, metric.current);
+  EXPECT_EQ(0U, metric.samples);
+  EXPECT_EQ(0U, metric.expiries);
+}
+
+TEST(AdaptiveTimeoutTest, BEH_FollowsLatency) {
+  AdaptiveTimeout timeout(TimeoutKind::kVaultConnect, kInitial, kFloor, kCeiling);
+  // Fast operations pull the deadline down to the floor.
+  for (int i(0); i < 100; ++i)
+    timeout.Sample(std::chrono::milliseconds(20));
+  EXPECT_EQ(kFloor, timeout.Value());
+
+  // A loaded host raises it above the new latency.
+  for (int i(0); i < 100; ++i)
+    timeout.Sample(std::chrono::milliseconds(5000));
+  EXPECT_GE(timeout.Value(), std::chrono::milliseconds(5000));
+  EXPECT_LE(timeout.Value(), std::chrono::milliseconds(5000 * 9 / 8 + 1));
+  auto metric(timeout.Metric());
+  EXPECT_EQ(200U, metric.samples);
+  EXPECT_GT(metric.smoothed, std::chrono::milliseconds(4500));
+  EXPECT_GE(metric.p99, std::chrono::milliseconds(5000));
+
+  // Jittery latency widens the margin beyond the smoothed value.
+  AdaptiveTimeout jittery(TimeoutKind::kVaultConnect, kInitial, kFloor, kCeiling);
+  for (int i(0); i < 100; ++i)
+    jittery.Sample(std::chrono::milliseconds(i % 2 ? 1000 : 3000));
+  auto jittery_metric(jittery.Metric());
+  EXPECT_GT(jittery_metric.variation, std::chrono::milliseconds(500));
+  EXPECT_GE(jittery.Value(), jittery_metric.smoothed + 4 * jittery_metric.variation -
+                             std::chrono::milliseconds(1));
+
+  // Nothing exceeds the ceiling.
+  timeout.Sample(std::chrono::hours(1));
+  EXPECT_EQ(kCeiling, timeout.Value());
+}
+
+TEST(AdaptiveTimeoutTest, BEH_BacksOffOnExpiry) {
+  AdaptiveTimeout timeout(TimeoutKind::kClientValidation, kInitial, kFloor, kCeiling);
+  EXPECT_EQ(2 * kInitial, timeout.OnExpiry());
+  EXPECT_EQ(4 * kInitial, timeout.OnExpiry());
+  EXPECT_EQ(4 * kInitial, timeout.Value());
+  for (int i(0); i < 10; ++i)
+    timeout.OnExpiry();
+  EXPECT_EQ(kCeiling, timeout.Value());
+  EXPECT_EQ(12U, timeout.Metric().expiries);
+
+  // A completed operation ends the backoff.
+  timeout.Sample(std::chrono::milliseconds(1500));
+  EXPECT_LT(timeout.Value(), kCeiling);
+  EXPECT_GE(timeout.Value(), std::chrono::milliseconds(1500));
+}
+
+TEST(AdaptiveTimeoutTest, BEH_ForgetsOldLatency) {
+  const std::chrono::milliseconds kWindow(50);
+  AdaptiveTimeout timeout(TimeoutKind::kVaultConnect, kInitial, kFloor, kCeiling, kWindow);
+  for (int i(0); i < 100; ++i)
+    timeout.Sample(std::chrono::milliseconds(5000));
+  EXPECT_GE(timeout.Metric().p99, std::chrono::milliseconds(5000));
+
+  // Once the slow samples' window has passed, only the smoothed value holds the deadline up.
+  std::this_thread::sleep_for(2 * kWindow + std::chrono::milliseconds(10));
+  EXPECT_EQ(std::chrono::milliseconds(0), timeout.Metric().p99);
+  for (int i(0); i < 100; ++i)
+    timeout.Sample(std::chrono::milliseconds(20));
+  EXPECT_EQ(kFloor, timeout.Value());
+  EXPECT_EQ(200U, timeout.Metric().samples);
+}
+
+}  // namespace test
+
+}  // namespace vault_manager
+
+}  // namespace maidsafe
@@ -0,0 +1,126 @@
+/*  Copyright 2014 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include "maidsafe/vault_manager/cgroups.h"
+
+#include <memory>
+#include <string>
+
+#include "boost/filesystem/operations.hpp"
+#include "boost/filesystem/path.hpp"
+
+#include "maidsafe/common/process.h"
+#include "maidsafe/common/test.h"
+#include "maidsafe/common/utils.h"
+
+#include "maidsafe/vault_manager/utils.h"
+
+namespace fs = boost::filesystem;
+
+namespace maidsafe {
+
+namespace vault_manager {
+
+namespace test {
+
+namespace {
+
+// Returns the contents of a fake cgroup interface file.
+std::string Read(const fs::path& path) {
+  return ReadFile(path).string();
+}
+
+// Creates a fake cgroup v2 directory offering 'controllers'.
+std::shared_ptr<fs::path> CreateFakeRoot(const std::string& controllers) {
+  std::shared_ptr<fs::path> root{ maidsafe::test::CreateTestPath("MaidSafe_TestCgroups") };
+  WriteFile(*root / "cgroup.controllers", controllers);
+  return root;
+}
+
+}  // unnamed namespace
+
+TEST(CgroupsTest, BEH_Construct) {
+  std::shared_ptr<fs::path> test_root{ maidsafe::test::CreateTestPath("MaidSafe_TestCgroups") };
+  EXPECT_THROW(Cgroups{ *test_root }, maidsafe_error);
+
+  // The VaultManager is moved into a leaf, and only the controllers it uses are enabled.
+  std::shared_ptr<fs::path> root(CreateFakeRoot("cpuset cpu io memory hugetlb pids\n"));
+  fs::create_directory(*root / "vault_STALE");
+  Cgroups cgroups{ *root };
+  EXPECT_EQ(std::to_string(process::GetProcessId()), Read(*root / "manager" / "cgroup.procs"));
+  EXPECT_EQ("+cpu +io +memory", Read(*root / "cgroup.subtree_control"));
+  EXPECT_FALSE(fs::exists(*root / "vault_STALE"));
+}
+
+TEST(CgroupsTest, BEH_AddProcessAndSetLimits) {
+  std::shared_ptr<fs::path> root(CreateFakeRoot("cpu io memory"));
+  Cgroups cgroups{ *root };
+  const NonEmptyString kLabel(GenerateLabel());
+  const fs::path kGroup(*root / ("vault_" + kLabel.string()));
+  EXPECT_EQ(kGroup, cgroups.GroupPath(kLabel));
+
+  // Unset limits leave the kernel defaults.
+  cgroups.AddProcess(kLabel, ResourceLimits(), 1234);
+  EXPECT_EQ("1234", Read(kGroup / "cgroup.procs"));
+  EXPECT_EQ("100", Read(kGroup / "cpu.weight"));
+  EXPECT_EQ("max", Read(kGroup / "memory.high"));
+  EXPECT_EQ("max", Read(kGroup / "memory.max"));
+  EXPECT_EQ("default 100", Read(kGroup / "io.weight"));
+
+  ResourceLimits limits;
+  limits.cpu_weight = 50;
+  limits.memory_high = 512 * 1024 * 1024;
+  limits.memory_max = 1024 * 1024 * 1024;
+  limits.io_weight = 400;
+  cgroups.SetLimits(kLabel, limits);
+  EXPECT_EQ("50", Read(kGroup / "cpu.weight"));
+  EXPECT_EQ("536870912", Read(kGroup / "memory.high"));
+  EXPECT_EQ("1073741824", Read(kGroup / "memory.max"));
+  EXPECT_EQ("default 400", Read(kGroup / "io.weight"));
+
+  limits.cpu_weight = 10001;
+  EXPECT_THROW(cgroups.SetLimits(kLabel, limits), maidsafe_error);
+  EXPECT_EQ("50", Read(kGroup / "cpu.weight"));
+
+  // The fake group still holds its interface files, so can't be removed as a real one would be.
+  EXPECT_NO_THROW(cgroups.Remove(kLabel));
+}
+
+TEST(CgroupsTest, BEH_UnavailableControllers) {
+  std::shared_ptr<fs::path> root(CreateFakeRoot("pids"));
+  Cgroups cgroups{ *root };
+  EXPECT_FALSE(fs::exists(*root / "cgroup.subtree_control"));
+
+  const NonEmptyString kLabel(GenerateLabel());
+  ResourceLimits limits;
+  limits.memory_max = 1024 * 1024 * 1024;
+  cgroups.AddProcess(kLabel, limits, 1234);
+  EXPECT_EQ("1234", Read(cgroups.GroupPath(kLabel) / "cgroup.procs"));
+  EXPECT_FALSE(fs::exists(cgroups.GroupPath(kLabel) / "memory.max"));
+
+  // Once empty, the group is removed.
+  fs::remove(cgroups.GroupPath(kLabel) / "cgroup.procs");
+  cgroups.Remove(kLabel);
+  EXPECT_FALSE(fs::exists(cgroups.GroupPath(kLabel)));
+}
+
+}  // namespace test
+
+}  // namespace vault_manager
+
+}  // namespace maidsafe
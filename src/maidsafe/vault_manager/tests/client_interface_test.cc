@@ -18,17 +18,23 @@
 
 #include "maidsafe/vault_manager/client_interface.h"
 
+#include <chrono>
+#include <future>
 #include <memory>
+#include <vector>
 
 #include "boost/filesystem/path.hpp"
 
+#include "maidsafe/common/error.h"
 #include "maidsafe/common/process.h"
 #include "maidsafe/common/test.h"
 #include "maidsafe/common/utils.h"
 #include "maidsafe/passport/passport.h"
 
 #include "maidsafe/vault_manager/config.h"
+#include "maidsafe/vault_manager/config_file_handler.h"
 #include "maidsafe/vault_manager/utils.h"
+#include "maidsafe/vault_manager/vault_info.h"
 #include "maidsafe/vault_manager/vault_manager.h"
 #include "maidsafe/vault_manager/tests/test_utils.h"
 
@@ -56,6 +62,98 @@ TEST(ClientInterfaceTest, BEH_Basic) {
   }
 }
 
+TEST(ClientInterfaceTest, FUNC_StartVaultWithSchedulingClass) {
+  std::shared_ptr<fs::path> test_env_root_dir{
+      maidsafe::test::CreateTestPath("MaidSafe_TestClientInterface") };
+  fs::path path_to_vault{ process::GetOtherExecutablePath("dummy_vault") };
+  SetEnvironment(tcp::Port{ 8888 }, *test_env_root_dir, path_to_vault);
+
+  VaultManager vault_manager;
+  passport::MaidAndSigner maid_and_signer{ passport::CreateMaidAndSigner() };
+  ClientInterface client_interface{ maid_and_signer.first };
+#ifdef USE_VLOGGING
+  auto vault_future(client_interface.StartVault(fs::path(), DiskUsage{ 10000000 }, "",
+                                                SchedulingClass::kBatch));
+#else
+  auto vault_future(client_interface.StartVault(fs::path(), DiskUsage{ 10000000 },
+                                                SchedulingClass::kBatch));
+#endif
+  ASSERT_EQ(std::future_status::ready, vault_future.wait_for(std::chrono::seconds(10)));
+  EXPECT_NO_THROW(vault_future.get());
+
+  // The class is recorded in the VaultManager's config file as soon as the vault is added.
+  std::vector<VaultInfo> vaults{
+      ConfigFileHandler(*test_env_root_dir / kConfigFilename).ReadConfigFile() };
+  ASSERT_EQ(1U, vaults.size());
+  EXPECT_EQ(SchedulingClass::kBatch, vaults.front().scheduling_class);
+}
+
+TEST(ClientInterfaceTest, FUNC_StartVaultWithResourceLimits) {
+  std::shared_ptr<fs::path> test_env_root_dir{
+      maidsafe::test::CreateTestPath("MaidSafe_TestClientInterface") };
+  fs::path path_to_vault{ process::GetOtherExecutablePath("dummy_vault") };
+  SetEnvironment(tcp::Port{ 8888 }, *test_env_root_dir, path_to_vault);
+
+  VaultManagerOptions options;
+  options.default_resource_limits.cpu_weight = 50;
+  options.default_resource_limits.io_weight = 50;
+  VaultManager vault_manager{ options };
+  passport::MaidAndSigner maid_and_signer{ passport::CreateMaidAndSigner() };
+  ClientInterface client_interface{ maid_and_signer.first };
+  ResourceLimits limits;
+  limits.cpu_weight = 200;
+  limits.memory_max = 512 * 1024 * 1024;
+  auto start_vault([&](bool in_process) {
+#ifdef USE_VLOGGING
+    return client_interface.StartVault(fs::path(), DiskUsage{ 10000000 }, "",
+                                       SchedulingClass::kNormal, "", limits, in_process);
+#else
+    return client_interface.StartVault(fs::path(), DiskUsage{ 10000000 },
+                                       SchedulingClass::kNormal, "", limits, in_process);
+#endif
+  });
+
+  // In-process hosting isn't enabled for this VaultManager.
+  auto in_process_future(start_vault(true));
+  ASSERT_EQ(std::future_status::ready, in_process_future.wait_for(std::chrono::seconds(10)));
+  EXPECT_THROW(in_process_future.get(), maidsafe_error);
+
+  auto vault_future(start_vault(false));
+  ASSERT_EQ(std::future_status::ready, vault_future.wait_for(std::chrono::seconds(10)));
+  EXPECT_NO_THROW(vault_future.get());
+
+  // The limits given override the VaultManager's defaults; the rest are left in place.
+  std::vector<VaultInfo> vaults{
+      ConfigFileHandler(*test_env_root_dir / kConfigFilename).ReadConfigFile() };
+  ASSERT_EQ(1U, vaults.size());
+  EXPECT_EQ(200U, vaults.front().resource_limits.cpu_weight);
+  EXPECT_EQ(0U, vaults.front().resource_limits.memory_high);
+  EXPECT_EQ(512U * 1024 * 1024, vaults.front().resource_limits.memory_max);
+  EXPECT_EQ(50U, vaults.front().resource_limits.io_weight);
+  EXPECT_FALSE(vaults.front().in_process);
+}
+
+TEST(ClientInterfaceTest, FUNC_StartVaultWithUndefinedLaunchProfile) {
+  std::shared_ptr<fs::path> test_env_root_dir{
+      maidsafe::test::CreateTestPath("MaidSafe_TestClientInterface") };
+  fs::path path_to_vault{ process::GetOtherExecutablePath("dummy_vault") };
+  SetEnvironment(tcp::Port{ 8888 }, *test_env_root_dir, path_to_vault);
+
+  // This VaultManager has no launch profiles file, so no profile is defined.
+  VaultManager vault_manager;
+  passport::MaidAndSigner maid_and_signer{ passport::CreateMaidAndSigner() };
+  ClientInterface client_interface{ maid_and_signer.first };
+#ifdef USE_VLOGGING
+  auto vault_future(client_interface.StartVault(fs::path(), DiskUsage{ 10000000 }, "",
+                                                SchedulingClass::kNormal, "undefined"));
+#else
+  auto vault_future(client_interface.StartVault(fs::path(), DiskUsage{ 10000000 },
+                                                SchedulingClass::kNormal, "undefined"));
+#endif
+  ASSERT_EQ(std::future_status::ready, vault_future.wait_for(std::chrono::seconds(10)));
+  EXPECT_THROW(vault_future.get(), maidsafe_error);
+}
+
 }  // namespace test
 
 }  // namespace vault_manager
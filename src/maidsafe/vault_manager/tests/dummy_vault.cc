@@ -19,48 +19,77 @@
 #include <chrono>
 #include <cstdint>
 #include <future>
+#include <string>
 
 #include "maidsafe/common/error.h"
 #include "maidsafe/common/log.h"
 #include "maidsafe/common/utils.h"
 
 #include "maidsafe/vault_manager/vault_config.h"
+#include "maidsafe/vault_manager/vault_host.h"
 #include "maidsafe/vault_manager/vault_interface.h"
 
-int main(int argc, char* argv[]) {
+namespace {
+
+// If 'ignore_stop_requests' is set, the vault carries on running after being asked to stop.
+int RunVault(maidsafe::vault_manager::VaultInterface& vault_interface,
+             bool ignore_stop_requests) {
   using maidsafe::vault_manager::VaultConfig;
-  bool connected_to_vault_manager{ false }, should_hang{ false };
+  bool should_hang{ ignore_stop_requests };
+  std::future<void> worker;
+  VaultConfig config{ vault_interface.GetConfiguration() };
+  switch (config.test_config.test_type) {
+    case VaultConfig::TestType::kNone:
+      break;
+    case VaultConfig::TestType::kKillConnection:
+      worker = std::async(std::launch::async, [&] { vault_interface.KillConnection(); });
+      break;
+    case VaultConfig::TestType::kSendInvalidMessage:
+      worker = std::async(std::launch::async, [&] { vault_interface.SendInvalidMessage(); });
+      break;
+    case VaultConfig::TestType::kStopProcess:
+      worker = std::async(std::launch::async, [&] { vault_interface.StopProcess(); });
+      break;
+    case VaultConfig::TestType::kIgnoreStopRequest:
+      should_hang = true;
+      break;
+    default:
+      BOOST_THROW_EXCEPTION(maidsafe::MakeError(maidsafe::CommonErrors::invalid_parameter));
+  }
+  int exit_code{ vault_interface.WaitForExit() };
+  if (should_hang)
+    maidsafe::Sleep(std::chrono::hours(6));
+  worker.get();
+  return exit_code;
+}
+
+}  // unnamed namespace
+
+int main(int argc, char* argv[]) {
+  bool connected_to_vault_manager{ false };
   int exit_code{ 0 };
   try {
     auto unuseds(maidsafe::log::Logging::Instance().Initialise(argc, argv));
-    if (unuseds.size() != 2U)
+    if (unuseds.size() < 2U || unuseds.size() > 4U)
       BOOST_THROW_EXCEPTION(maidsafe::MakeError(maidsafe::CommonErrors::invalid_parameter));
     uint16_t port{ static_cast<uint16_t>(std::stoi(std::string{ &unuseds[1][0] })) };
-    maidsafe::vault_manager::VaultInterface vault_interface{ port };
-    connected_to_vault_manager = true;
-
-    std::future<void> worker;
-    VaultConfig config{ vault_interface.GetConfiguration() };
-    switch (config.test_config.test_type) {
-      case VaultConfig::TestType::kNone:
-        break;
-      case VaultConfig::TestType::kKillConnection:
-        worker = std::async(std::launch::async, [&] { vault_interface.KillConnection(); });
-        break;
-      case VaultConfig::TestType::kSendInvalidMessage:
-        worker = std::async(std::launch::async, [&] { vault_interface.SendInvalidMessage(); });
-        break;
-      case VaultConfig::TestType::kStopProcess:
-        worker = std::async(std::launch::async, [&] { vault_interface.StopProcess(); });
-        break;
-      case VaultConfig::TestType::kIgnoreStopRequest:
-        should_hang = true;
-        break;
-      default:
+    if (unuseds.size() > 2U) {
+      // Launched to host vaults in-process, optionally followed by "--ignore_stop_requests".
+      if (std::string{ &unuseds[2][0] } != maidsafe::vault_manager::kVaultHostArgument ||
+          (unuseds.size() == 4U && std::string{ &unuseds[3][0] } != "--ignore_stop_requests")) {
         BOOST_THROW_EXCEPTION(maidsafe::MakeError(maidsafe::CommonErrors::invalid_parameter));
+      }
+      const bool kIgnoreStopRequests(unuseds.size() == 4U);
+      maidsafe::vault_manager::VaultHost vault_host{ port,
+          [kIgnoreStopRequests](maidsafe::vault_manager::VaultInterface& vault_interface) {
+            return RunVault(vault_interface, kIgnoreStopRequests);
+          } };
+      connected_to_vault_manager = true;
+      return vault_host.WaitForExit();
     }
-    exit_code = vault_interface.WaitForExit();
-    worker.get();
+    maidsafe::vault_manager::VaultInterface vault_interface{ port };
+    connected_to_vault_manager = true;
+    exit_code = RunVault(vault_interface, false);
   }
   catch (const maidsafe::maidsafe_error& error) {
     if (connected_to_vault_manager)
@@ -77,7 +106,5 @@ int main(int argc, char* argv[]) {
     exit_code =
         maidsafe::ErrorToInt(maidsafe::MakeError(maidsafe::CommonErrors::invalid_parameter));
   }
-  if (should_hang)
-    maidsafe::Sleep(std::chrono::hours(6));
   return exit_code;
 }
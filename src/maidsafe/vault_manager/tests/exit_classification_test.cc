@@ -0,0 +1,158 @@
+/*  Copyright 2014 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include "maidsafe/vault_manager/exit_classification.h"
+
+#ifndef MAIDSAFE_WIN32
+#include <signal.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+#include "maidsafe/common/error.h"
+#include "maidsafe/common/test.h"
+
+namespace maidsafe {
+
+namespace vault_manager {
+
+namespace test {
+
+namespace {
+
+ExitStatus Exited(int exit_code) { return ExitStatus(exit_code); }
+
+ExitStatus Signalled(int signal, bool core_dumped) {
+  ExitStatus exit_status;
+  exit_status.signal = signal;
+  exit_status.core_dumped = core_dumped;
+  return exit_status;
+}
+
+}  // unnamed namespace
+
+#ifndef MAIDSAFE_WIN32
+TEST(ExitClassificationTest, BEH_DecodeWaitStatus) {
+  auto wait_for([](pid_t child) {
+    int status(0);
+    EXPECT_EQ(child, waitpid(child, &status, 0));
+    return DecodeWaitStatus(status);
+  });
+
+  pid_t child(fork());
+  ASSERT_NE(-1, child);
+  if (child == 0)
+    _exit(42);
+  ExitStatus exit_status(wait_for(child));
+  EXPECT_EQ(42, exit_status.exit_code);
+  EXPECT_EQ(0, exit_status.signal);
+  EXPECT_FALSE(exit_status.core_dumped);
+
+  child = fork();
+  ASSERT_NE(-1, child);
+  if (child == 0) {
+    pause();
+    _exit(0);
+  }
+  kill(child, SIGKILL);
+  exit_status = wait_for(child);
+  EXPECT_EQ(-1, exit_status.exit_code);
+  EXPECT_EQ(SIGKILL, exit_status.signal);
+  EXPECT_FALSE(exit_status.core_dumped);
+}
+#endif
+
+TEST(ExitClassificationTest, BEH_ClassifyExit) {
+  EXPECT_EQ(ExitClass::kClean, ClassifyExit(Exited(0), false, false, true));
+  EXPECT_EQ(ExitClass::kFailed, ClassifyExit(Exited(1), false, false, true));
+  EXPECT_EQ(ExitClass::kFailed, ClassifyExit(ExitStatus(), false, false, true));
+  // Being terminated by the VaultManager, or killed by the OOM killer, explains any status.
+  EXPECT_EQ(ExitClass::kTerminated, ClassifyExit(Exited(0), true, true, true));
+  EXPECT_EQ(ExitClass::kOutOfMemory, ClassifyExit(Exited(1), false, true, true));
+
+  const int kDiskFull(ExitCode(MakeError(CommonErrors::cannot_exceed_limit)));
+  EXPECT_EQ(ExitClass::kDiskFull, ClassifyExit(Exited(kDiskFull), false, false, true));
+  EXPECT_EQ(ExitClass::kDiskFull, ClassifyExit(Exited(kDiskFull), false, false, false));
+
+  // Bad parameters only indicate a bad configuration before the vault has connected.
+  for (const auto& error : { MakeError(CommonErrors::invalid_parameter),
+                             MakeError(CommonErrors::parsing_error) }) {
+    EXPECT_EQ(ExitClass::kBadConfig, ClassifyExit(Exited(ExitCode(error)), false, false, false));
+    EXPECT_EQ(ExitClass::kFailed, ClassifyExit(Exited(ExitCode(error)), false, false, true));
+  }
+
+#ifndef MAIDSAFE_WIN32
+  EXPECT_EQ(ExitClass::kCrashed, ClassifyExit(Signalled(SIGSEGV, false), false, false, true));
+  EXPECT_EQ(ExitClass::kCrashed, ClassifyExit(Signalled(SIGABRT, true), false, false, true));
+  EXPECT_EQ(ExitClass::kCrashed, ClassifyExit(Signalled(SIGQUIT, true), false, false, true));
+  EXPECT_EQ(ExitClass::kKilled, ClassifyExit(Signalled(SIGTERM, false), false, false, true));
+  EXPECT_EQ(ExitClass::kKilled, ClassifyExit(Signalled(SIGKILL, false), false, false, false));
+  EXPECT_EQ(ExitClass::kOutOfMemory, ClassifyExit(Signalled(SIGKILL, false), false, true, true));
+#endif
+}
+
+#ifndef MAIDSAFE_WIN32
+TEST(ExitClassificationTest, BEH_ExitCodes) {
+  const int kDiskFull(ErrorToInt(MakeError(CommonErrors::cannot_exceed_limit)) & 0xff);
+  const int kInvalidParameter(ErrorToInt(MakeError(CommonErrors::invalid_parameter)) & 0xff);
+  const int kParsingError(ErrorToInt(MakeError(CommonErrors::parsing_error)) & 0xff);
+  EXPECT_EQ(kDiskFull, ExitCode(MakeError(CommonErrors::cannot_exceed_limit)));
+  EXPECT_EQ(kInvalidParameter, ExitCode(MakeError(CommonErrors::invalid_parameter)));
+  EXPECT_EQ(kParsingError, ExitCode(MakeError(CommonErrors::parsing_error)));
+
+  // Only these exact exit codes are recognised; every other one is an unexplained failure.
+  for (int exit_code(1); exit_code != 256; ++exit_code) {
+    SCOPED_TRACE("Exit code " + std::to_string(exit_code));
+    ExitClass expected(ExitClass::kFailed);
+    if (exit_code == kDiskFull)
+      expected = ExitClass::kDiskFull;
+    else if (exit_code == kInvalidParameter || exit_code == kParsingError)
+      expected = ExitClass::kBadConfig;
+    EXPECT_EQ(expected, ClassifyExit(Exited(exit_code), false, false, false));
+  }
+}
+#endif
+
+TEST(ExitClassificationTest, BEH_RestartPolicy) {
+  EXPECT_EQ(RestartAction::kRestartNow, GetRestartAction(ExitClass::kClean));
+  EXPECT_EQ(RestartAction::kRestartAfterBackoff, GetRestartAction(ExitClass::kKilled));
+  EXPECT_EQ(RestartAction::kRestartAfterBackoff, GetRestartAction(ExitClass::kCrashed));
+  EXPECT_EQ(RestartAction::kRestartAfterBackoff, GetRestartAction(ExitClass::kTerminated));
+  EXPECT_EQ(RestartAction::kRestartAfterBackoff, GetRestartAction(ExitClass::kOutOfMemory));
+  EXPECT_EQ(RestartAction::kRestartAfterBackoff, GetRestartAction(ExitClass::kFailed));
+  EXPECT_EQ(RestartAction::kAwaitDiskSpace, GetRestartAction(ExitClass::kDiskFull));
+  EXPECT_EQ(RestartAction::kRestartAfterBackoff, GetRestartAction(ExitClass::kBadConfig));
+}
+
+TEST(ExitClassificationTest, BEH_ParseOomKills) {
+  uint64_t oom_kills(0);
+  EXPECT_TRUE(ParseOomKills("low 0\nhigh 12\nmax 40\noom 4\noom_kill 3\noom_group_kill 0\n",
+                            oom_kills));
+  EXPECT_EQ(3U, oom_kills);
+  EXPECT_TRUE(ParseOomKills("nr_free_pages 123456\npgfault 987654321\noom_kill 17\n", oom_kills));
+  EXPECT_EQ(17U, oom_kills);
+  EXPECT_FALSE(ParseOomKills("low 0\nhigh 0\n", oom_kills));
+  EXPECT_FALSE(ParseOomKills("garbage", oom_kills));
+}
+
+}  // namespace test
+
+}  // namespace vault_manager
+
+}  // namespace maidsafe
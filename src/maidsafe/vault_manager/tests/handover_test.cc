@@ -0,0 +1,84 @@
+/*  Copyright 2014 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+
+#include "maidsafe/vault_manager/handover.h"
+
+#include <chrono>
+#include <memory>
+#include <string>
+
+#include "boost/filesystem/operations.hpp"
+
+#include "maidsafe/common/test.h"
+#include "maidsafe/common/utils.h"
+
+#include "maidsafe/vault_manager/utils.h"
+
+namespace fs = boost::filesystem;
+
+namespace maidsafe {
+
+namespace vault_manager {
+
+namespace test {
+
+TEST(HandoverTest, BEH_WriteAndRead) {
+  std::shared_ptr<fs::path> test_root{ maidsafe::test::CreateTestPath("MaidSafe_TestHandover") };
+  const fs::path kHandoverFile(*test_root / "handover");
+  Handover handover;
+  handover.listening_port = 7777;
+  for (int i(0); i < 3; ++i) {
+    handover.vaults.emplace_back();
+    handover.vaults.back().label = GenerateLabel();
+    handover.vaults.back().process_id = 1000 + i;
+    handover.vaults.back().executable = *test_root / ("vault_" + std::to_string(i));
+    handover.vaults.back().uptime = std::chrono::milliseconds(60000 * i);
+    handover.vaults.back().start_token = 123456789 + i;
+    handover.vaults.back().output_descriptor = i - 1;
+  }
+  handover.terminated_process_ids.push_back(2000);
+  handover.terminated_process_ids.push_back(2001);
+  WriteHandoverFile(kHandoverFile, handover);
+
+  Handover read{ ReadHandoverFile(kHandoverFile) };
+  EXPECT_EQ(handover.listening_port, read.listening_port);
+  ASSERT_EQ(handover.vaults.size(), read.vaults.size());
+  for (size_t i(0); i < handover.vaults.size(); ++i) {
+    EXPECT_EQ(handover.vaults[i].label, read.vaults[i].label);
+    EXPECT_EQ(handover.vaults[i].process_id, read.vaults[i].process_id);
+    EXPECT_EQ(handover.vaults[i].executable, read.vaults[i].executable);
+    EXPECT_EQ(handover.vaults[i].uptime, read.vaults[i].uptime);
+    EXPECT_EQ(handover.vaults[i].start_token, read.vaults[i].start_token);
+    EXPECT_EQ(handover.vaults[i].output_descriptor, read.vaults[i].output_descriptor);
+  }
+  EXPECT_EQ(handover.terminated_process_ids, read.terminated_process_ids);
+
+  // The file is only good for one successor.
+  EXPECT_FALSE(fs::exists(kHandoverFile));
+  EXPECT_THROW(ReadHandoverFile(kHandoverFile), std::exception);
+
+  ASSERT_TRUE(WriteFile(kHandoverFile, "Rubbish"));
+  EXPECT_THROW(ReadHandoverFile(kHandoverFile), maidsafe_error);
+}
+
+}  // namespace test
+
+}  // namespace vault_manager
+
+}  // namespace maidsafe
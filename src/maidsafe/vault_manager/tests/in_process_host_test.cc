@@ -0,0 +1,96 @@
+/*  Copyright 2014 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include "maidsafe/vault_manager/in_process_host.h"
+
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <memory>
+#include <utility>
+
+#include "maidsafe/common/asio_service.h"
+#include "maidsafe/common/error.h"
+#include "maidsafe/common/test.h"
+#include "maidsafe/common/tcp/connection.h"
+#include "maidsafe/common/tcp/listener.h"
+
+#include "maidsafe/vault_manager/vault_interface.h"
+
+namespace maidsafe {
+
+namespace vault_manager {
+
+namespace test {
+
+TEST(InProcessHostTest, BEH_InvalidParameters) {
+  AsioService asio_service(1);
+  auto vault_main([](VaultInterface& vault_interface) { return vault_interface.WaitForExit(); });
+  auto on_exit([](InProcessHost::InstanceId, int) {});
+  EXPECT_THROW(InProcessHost(asio_service.service(), tcp::Port{ 7777 }, nullptr, on_exit),
+               maidsafe_error);
+  EXPECT_THROW(InProcessHost(asio_service.service(), tcp::Port{ 7777 }, vault_main, nullptr),
+               maidsafe_error);
+  asio_service.Stop();
+}
+
+TEST(InProcessHostTest, FUNC_FailureToConnectIsReported) {
+  AsioService asio_service(1);
+  // Nothing is listening on this port once the listener has gone.
+  tcp::Port port(0);
+  {
+    auto listener(tcp::Listener::MakeShared(asio_service, [](tcp::ConnectionPtr) {},
+                                            tcp::Port{ 7777 }));
+    port = listener->ListeningPort();
+    listener->StopListening();
+  }
+
+  std::atomic<bool> vault_main_ran(false);
+  std::promise<std::pair<InProcessHost::InstanceId, int>> exited;
+  std::unique_ptr<InProcessHost> host(new InProcessHost(asio_service.service(), port,
+      [&](VaultInterface& vault_interface) {
+        vault_main_ran = true;
+        return vault_interface.WaitForExit();
+      },
+      [&](InProcessHost::InstanceId instance_id, int exit_code) {
+        exited.set_value(std::make_pair(instance_id, exit_code));
+      }));
+  // Process IDs can't be used as instance IDs.
+  EXPECT_THROW(host->Start(InProcessHost::kFirstInstanceId - 1), maidsafe_error);
+  const InProcessHost::InstanceId kInstanceId(InProcessHost::kFirstInstanceId);
+  host->Start(kInstanceId);
+  auto exit_future(exited.get_future());
+  ASSERT_EQ(std::future_status::ready, exit_future.wait_for(std::chrono::seconds(10)));
+  auto result(exit_future.get());
+  EXPECT_EQ(kInstanceId, result.first);
+  EXPECT_NE(0, result.second);
+  EXPECT_FALSE(vault_main_ran);
+  EXPECT_FALSE(host->IsRunning(kInstanceId));
+  EXPECT_EQ(0U, host->RunningCount());
+  // Stopping an instance which has finished, or was never started, does nothing.
+  host->Stop(kInstanceId);
+  host->Stop(kInstanceId + 1);
+  host.reset();
+  asio_service.Stop();
+}
+
+}  // namespace test
+
+}  // namespace vault_manager
+
+}  // namespace maidsafe
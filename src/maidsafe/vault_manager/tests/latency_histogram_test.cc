@@ -0,0 +1,116 @@
+/*  Copyright 2014 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include "maidsafe/vault_manager/latency_histogram.h"
+
+#include <chrono>
+#include <cstdint>
+#include <limits>
+#include <thread>
+#include <vector>
+
+#include "maidsafe/common/error.h"
+#include "maidsafe/common/test.h"
+
+namespace maidsafe {
+
+namespace vault_manager {
+
+namespace test {
+
+TEST(LatencyHistogramTest, BEH_BucketBounds) {
+  for (uint64_t value(0); value < 100000; value += 1 + value / 64) {
+    size_t index(LatencyHistogram::BucketIndex(value));
+    EXPECT_LE(value, LatencyHistogram::BucketUpperBound(index));
+    if (index > 0) {
+      EXPECT_GT(value, LatencyHistogram::BucketUpperBound(index - 1));
+    }
+  }
+  for (size_t index(LatencyHistogram::kSubBuckets); index < LatencyHistogram::kBucketCount - 1;
+       ++index) {
+    uint64_t lower(LatencyHistogram::BucketUpperBound(index - 1) + 1);
+    uint64_t upper(LatencyHistogram::BucketUpperBound(index));
+    EXPECT_LE(upper - lower, lower / LatencyHistogram::kSubBuckets);
+  }
+  EXPECT_EQ(LatencyHistogram::kBucketCount - 1,
+            LatencyHistogram::BucketIndex(std::numeric_limits<uint64_t>::max()));
+}
+
+TEST(LatencyHistogramTest, BEH_Percentiles) {
+  LatencyHistogram histogram;
+  EXPECT_EQ(0U, histogram.Count());
+  EXPECT_EQ(std::chrono::microseconds(0), histogram.Percentile(0.5));
+  EXPECT_THROW(histogram.Percentile(-0.1), maidsafe_error);
+  EXPECT_THROW(histogram.Percentile(1.1), maidsafe_error);
+
+  for (int i(1); i <= 1000; ++i)
+    histogram.Record(std::chrono::milliseconds(i));
+  EXPECT_EQ(1000U, histogram.Count());
+  EXPECT_EQ(std::chrono::microseconds(1000000), histogram.Max());
+  EXPECT_EQ(histogram.Max(), histogram.Percentile(1.0));
+  auto within_bucket([&](double quantile, int64_t expected_ms) {
+    int64_t actual(histogram.Percentile(quantile).count());
+    EXPECT_GE(actual, expected_ms * 1000);
+    EXPECT_LE(actual, expected_ms * 1000 * 9 / 8);
+  });
+  within_bucket(0.5, 500);
+  within_bucket(0.9, 900);
+  within_bucket(0.99, 990);
+
+  // Negative durations, e.g. from an adjusted clock, are recorded as zero.
+  LatencyHistogram skewed;
+  skewed.Record(std::chrono::milliseconds(-5));
+  EXPECT_EQ(std::chrono::microseconds(0), skewed.Percentile(0.5));
+}
+
+TEST(LatencyHistogramTest, BEH_ConcurrentRecording) {
+  const int kThreads(8), kRecordsPerThread(100000);
+  LifecycleHistograms histograms;
+  std::vector<std::thread> threads;
+  for (int i(0); i < kThreads; ++i) {
+    threads.emplace_back([&, i] {
+      for (int j(0); j < kRecordsPerThread; ++j) {
+        histograms.Record(LifecyclePhase::kSpawn, std::chrono::microseconds(j));
+        histograms.Record(LifecyclePhase::kTotal, std::chrono::microseconds(i));
+      }
+    });
+  }
+  // Reading while recording must be safe.
+  for (int i(0); i < 100; ++i)
+    histograms.Summarise();
+  for (auto& thread : threads)
+    thread.join();
+
+  auto summary(histograms.Summarise());
+  ASSERT_EQ(kLifecyclePhaseCount, summary.size());
+  const uint64_t kTotal(static_cast<uint64_t>(kThreads) * kRecordsPerThread);
+  EXPECT_EQ(LifecyclePhase::kSpawn, summary[0].phase);
+  EXPECT_EQ(kTotal, summary[0].count);
+  EXPECT_EQ(std::chrono::microseconds(kRecordsPerThread - 1), summary[0].max);
+  EXPECT_EQ(0U, summary[1].count);
+  EXPECT_EQ(0U, summary[2].count);
+  EXPECT_EQ(LifecyclePhase::kTotal, summary[3].phase);
+  EXPECT_EQ(kTotal, summary[3].count);
+  EXPECT_EQ(std::chrono::microseconds(kThreads - 1), summary[3].max);
+}
+
+}  // namespace test
+
+}  // namespace vault_manager
+
+}  // namespace maidsafe
@@ -0,0 +1,151 @@
+/*  Copyright 2014 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include "maidsafe/vault_manager/launch_profile.h"
+
+#ifdef MAIDSAFE_LINUX
+#include <signal.h>
+#include <sys/resource.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+#include <algorithm>
+#include <cstdlib>
+
+#include "maidsafe/common/test.h"
+
+namespace maidsafe {
+
+namespace vault_manager {
+
+namespace test {
+
+TEST(LaunchProfileTest, BEH_ParseLaunchProfiles) {
+  std::map<std::string, LaunchProfile> profiles(ParseLaunchProfiles(
+      "# Allocator trials\n"
+      "[jemalloc]\n"
+      "preload = /usr/lib/libjemalloc.so.2\n"
+      "environment = MALLOC_CONF=background_thread:true\n"
+      "  max_open_files =  65536  \n"
+      "max_core_size = unlimited\n"
+      "arg = --first\n"
+      "arg = --second\n"
+      "\n"
+      "[ glibc ]\n"
+      "environment = MALLOC_ARENA_MAX=2\n"
+      "max_core_size = 0\n"
+      "[empty]\n"));
+  ASSERT_EQ(3U, profiles.size());
+
+  const LaunchProfile& jemalloc(profiles.at("jemalloc"));
+  EXPECT_EQ("/usr/lib/libjemalloc.so.2", jemalloc.preload);
+  ASSERT_EQ(1U, jemalloc.environment.size());
+  EXPECT_EQ("background_thread:true", jemalloc.environment.at("MALLOC_CONF"));
+  EXPECT_EQ(65536, jemalloc.max_open_files);
+  EXPECT_EQ(LaunchProfile::kUnlimited, jemalloc.max_core_size);
+  EXPECT_EQ(std::vector<std::string>({ "--first", "--second" }), jemalloc.args);
+
+  const LaunchProfile& glibc(profiles.at("glibc"));
+  EXPECT_TRUE(glibc.preload.empty());
+  EXPECT_EQ("2", glibc.environment.at("MALLOC_ARENA_MAX"));
+  EXPECT_EQ(LaunchProfile::kInheritLimit, glibc.max_open_files);
+  EXPECT_EQ(0, glibc.max_core_size);
+
+  const LaunchProfile& empty(profiles.at("empty"));
+  EXPECT_TRUE(empty.environment.empty());
+  EXPECT_TRUE(empty.args.empty());
+  EXPECT_TRUE(ParseLaunchProfiles("").empty());
+
+  const std::vector<std::string> kMalformed{ "preload = x\n", "[a]\n[a]\n", "[]\n", "[a\n",
+                                             "[a]\npreload\n", "[a]\nunknown = x\n",
+                                             "[a]\nenvironment = x\n", "[a]\nenvironment = =x\n",
+                                             "[a]\nmax_open_files = -2\n",
+                                             "[a]\nmax_core_size = lots\n", "[a]\narg =\n" };
+  for (const auto& contents : kMalformed)
+    EXPECT_THROW(ParseLaunchProfiles(contents), maidsafe_error) << contents;
+}
+
+#ifndef MAIDSAFE_WIN32
+TEST(LaunchProfileTest, BEH_MakeEnvironment) {
+  ASSERT_EQ(0, setenv("MAIDSAFE_LAUNCH_PROFILE_TEST", "inherited", 1));
+  ASSERT_EQ(0, setenv("LD_PRELOAD", "/lib/existing.so", 1));
+  LaunchProfile profile;
+  std::vector<std::string> environment(MakeEnvironment(profile));
+  auto contains([&](const std::string& variable) {
+    return std::find(std::begin(environment), std::end(environment), variable) !=
+           std::end(environment);
+  });
+  EXPECT_TRUE(contains("MAIDSAFE_LAUNCH_PROFILE_TEST=inherited"));
+  EXPECT_TRUE(contains("LD_PRELOAD=/lib/existing.so"));
+
+  profile.preload = "/lib/allocator.so";
+  profile.environment["MAIDSAFE_LAUNCH_PROFILE_TEST"] = "overridden";
+  profile.environment["MALLOC_ARENA_MAX"] = "2";
+  environment = MakeEnvironment(profile);
+  EXPECT_TRUE(contains("MAIDSAFE_LAUNCH_PROFILE_TEST=overridden"));
+  EXPECT_FALSE(contains("MAIDSAFE_LAUNCH_PROFILE_TEST=inherited"));
+  EXPECT_TRUE(contains("MALLOC_ARENA_MAX=2"));
+  EXPECT_TRUE(contains("LD_PRELOAD=/lib/allocator.so:/lib/existing.so"));
+
+  ASSERT_EQ(0, unsetenv("LD_PRELOAD"));
+  environment = MakeEnvironment(profile);
+  EXPECT_TRUE(contains("LD_PRELOAD=/lib/allocator.so"));
+  ASSERT_EQ(0, unsetenv("MAIDSAFE_LAUNCH_PROFILE_TEST"));
+}
+#endif
+
+#ifdef MAIDSAFE_LINUX
+TEST(LaunchProfileTest, FUNC_ApplyLaunchLimits) {
+  pid_t child(fork());
+  ASSERT_NE(-1, child);
+  if (child == 0) {
+    pause();
+    _exit(0);
+  }
+
+  rlimit original;
+  ASSERT_EQ(0, prlimit(child, RLIMIT_NOFILE, nullptr, &original));
+  // Lowering limits is always permitted.
+  LaunchProfile profile;
+  profile.max_open_files = 100;
+  profile.max_core_size = 0;
+  EXPECT_TRUE(ApplyLaunchLimits(static_cast<uint64_t>(child), profile));
+  rlimit applied;
+  ASSERT_EQ(0, prlimit(child, RLIMIT_NOFILE, nullptr, &applied));
+  EXPECT_EQ(100U, applied.rlim_cur);
+  ASSERT_EQ(0, prlimit(child, RLIMIT_CORE, nullptr, &applied));
+  EXPECT_EQ(0U, applied.rlim_cur);
+
+  // Inherited limits are left alone.
+  EXPECT_TRUE(ApplyLaunchLimits(static_cast<uint64_t>(child), LaunchProfile()));
+  ASSERT_EQ(0, prlimit(child, RLIMIT_NOFILE, nullptr, &applied));
+  EXPECT_EQ(100U, applied.rlim_cur);
+
+  kill(child, SIGKILL);
+  waitpid(child, nullptr, 0);
+  EXPECT_FALSE(ApplyLaunchLimits(static_cast<uint64_t>(child), profile));
+}
+#endif
+
+}  // namespace test
+
+}  // namespace vault_manager
+
+}  // namespace maidsafe
@@ -0,0 +1,140 @@
+/*  Copyright 2014 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include "maidsafe/vault_manager/placement.h"
+
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "boost/filesystem/operations.hpp"
+#include "boost/filesystem/path.hpp"
+
+#include "maidsafe/common/test.h"
+#include "maidsafe/common/utils.h"
+
+#include "maidsafe/vault_manager/utils.h"
+
+namespace fs = boost::filesystem;
+
+namespace maidsafe {
+
+namespace vault_manager {
+
+namespace test {
+
+namespace {
+
+// Two nodes of four CPUs each.
+Topology TwoNodes() {
+  return Topology{ NumaNode{ 0, { 0, 1, 2, 3 } }, NumaNode{ 1, { 4, 5, 6, 7 } } };
+}
+
+}  // unnamed namespace
+
+TEST(PlacementTest, BEH_ParseCpuList) {
+  EXPECT_TRUE(ParseCpuList("").empty());
+  EXPECT_TRUE(ParseCpuList("\n").empty());
+  EXPECT_EQ(std::vector<int>({ 0 }), ParseCpuList("0"));
+  EXPECT_EQ(std::vector<int>({ 0, 1, 2, 3, 8, 10, 11 }), ParseCpuList("0-3,8,10-11\n"));
+  EXPECT_THROW(ParseCpuList("3-1"), maidsafe_error);
+  EXPECT_THROW(ParseCpuList("a"), maidsafe_error);
+  EXPECT_THROW(ParseCpuList("1-"), maidsafe_error);
+}
+
+TEST(PlacementTest, BEH_ReadTopology) {
+  std::shared_ptr<fs::path> node_dir{ maidsafe::test::CreateTestPath("MaidSafe_TestPlacement") };
+  // An empty directory is treated as a single node.
+  Topology topology(ReadTopology(*node_dir));
+  ASSERT_EQ(1U, topology.size());
+  EXPECT_FALSE(topology[0].cpus.empty());
+
+  for (const auto& node : std::map<std::string, std::string>{ { "node1", "4-7,12\n" },
+                                                              { "node0", "0-3\n" },
+                                                              { "node2", "\n" } }) {
+    fs::create_directory(*node_dir / node.first);
+    WriteFile(*node_dir / node.first / "cpulist", node.second);
+  }
+  WriteFile(*node_dir / "possible", "0-2\n");
+  topology = ReadTopology(*node_dir);
+  ASSERT_EQ(2U, topology.size());  // node2 has memory but no CPUs.
+  EXPECT_EQ(0, topology[0].id);
+  EXPECT_EQ(std::vector<int>({ 0, 1, 2, 3 }), topology[0].cpus);
+  EXPECT_EQ(1, topology[1].id);
+  EXPECT_EQ(std::vector<int>({ 4, 5, 6, 7, 12 }), topology[1].cpus);
+}
+
+TEST(PlacementTest, BEH_SpreadNodes) {
+  EXPECT_THROW(Placement(TwoNodes(), PlacementPolicy::kNone), maidsafe_error);
+  EXPECT_THROW(Placement(Topology(), PlacementPolicy::kSpreadNodes), maidsafe_error);
+
+  Placement placement(TwoNodes(), PlacementPolicy::kSpreadNodes);
+  std::vector<NonEmptyString> labels;
+  for (int i(0); i < 4; ++i) {
+    labels.push_back(GenerateLabel());
+    EXPECT_EQ(TwoNodes()[i % 2].cpus, placement.Assign(labels.back()));
+  }
+  // Reassigning moves a vault to the least busy node.
+  EXPECT_EQ(TwoNodes()[0].cpus, placement.Assign(labels[0]));
+  EXPECT_TRUE(placement.Rebalance().empty());
+
+  // Leaves node 0 with no vaults and node 1 with two.
+  placement.Release(labels[0]);
+  placement.Release(labels[2]);
+  EXPECT_TRUE(placement.Cpus(labels[0]).empty());
+  auto moved(placement.Rebalance());
+  ASSERT_EQ(1U, moved.size());
+  EXPECT_EQ(TwoNodes()[0].cpus, moved.begin()->second);
+  EXPECT_EQ(TwoNodes()[0].cpus, placement.Cpus(moved.begin()->first));
+  EXPECT_TRUE(placement.Rebalance().empty());
+}
+
+TEST(PlacementTest, BEH_SpreadCores) {
+  Placement placement(TwoNodes(), PlacementPolicy::kSpreadCores);
+  // Alternates between nodes, then wraps around once every CPU has a vault.
+  const std::vector<int> kExpected{ 0, 4, 1, 5, 2, 6, 3, 7, 0, 4 };
+  std::vector<NonEmptyString> labels;
+  for (int expected : kExpected) {
+    labels.push_back(GenerateLabel());
+    EXPECT_EQ(std::vector<int>(1, expected), placement.Assign(labels.back()));
+  }
+
+  // Emptying node 1 leaves CPU 0 with two vaults, one of which moves to node 1.
+  for (size_t i(1); i < labels.size(); i += 2)
+    placement.Release(labels[i]);
+  auto moved(placement.Rebalance());
+  ASSERT_EQ(1U, moved.size());
+  EXPECT_EQ(std::vector<int>(1, 4), moved.begin()->second);
+  std::map<int, int> vaults_per_cpu;
+  for (size_t i(0); i < labels.size(); i += 2) {
+    ASSERT_EQ(1U, placement.Cpus(labels[i]).size());
+    ++vaults_per_cpu[placement.Cpus(labels[i]).front()];
+  }
+  EXPECT_EQ(5U, vaults_per_cpu.size());
+  for (const auto& cpu : vaults_per_cpu)
+    EXPECT_EQ(1, cpu.second);
+  // The least busy node is preferred.
+  EXPECT_EQ(std::vector<int>(1, 5), placement.Assign(GenerateLabel()));
+}
+
+}  // namespace test
+
+}  // namespace vault_manager
+
+}  // namespace maidsafe
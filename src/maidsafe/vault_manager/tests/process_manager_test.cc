@@ -18,20 +18,53 @@
 
 #include "maidsafe/vault_manager/process_manager.h"
 
+#ifndef MAIDSAFE_WIN32
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+#ifdef MAIDSAFE_LINUX
+#include <sched.h>
+#include <sys/resource.h>
+#endif
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <cstdlib>
+#include <functional>
+#include <future>
+#include <map>
+#include <mutex>
 #include <thread>
 #include <string>
 #include <vector>
 
+#include "boost/filesystem/operations.hpp"
 #include "boost/filesystem/path.hpp"
 
 #include "maidsafe/common/asio_service.h"
 #include "maidsafe/common/make_unique.h"
+#include "maidsafe/common/on_scope_exit.h"
 #include "maidsafe/common/process.h"
 #include "maidsafe/common/test.h"
 #include "maidsafe/common/utils.h"
+#include "maidsafe/common/tcp/connection.h"
+#include "maidsafe/common/tcp/listener.h"
+#include "maidsafe/passport/passport.h"
 
 #include "maidsafe/vault_manager/config.h"
+#include "maidsafe/vault_manager/dispatcher.h"
+#include "maidsafe/vault_manager/in_process_host.h"
+#include "maidsafe/vault_manager/interprocess_messages.pb.h"
+#include "maidsafe/vault_manager/restart_scheduler.h"
 #include "maidsafe/vault_manager/utils.h"
+#include "maidsafe/vault_manager/vault_info.h"
+#include "maidsafe/vault_manager/vault_interface.h"
+#include "maidsafe/vault_manager/vault_started_response_cache.h"
 #include "maidsafe/vault_manager/tests/test_utils.h"
 
 namespace fs = boost::filesystem;
@@ -52,6 +85,1311 @@ TEST(ProcessManagerTest, BEH_Constructor) {
   asio_service.reset();
 }
 
+#ifndef MAIDSAFE_WIN32
+namespace {
+
+// Plays the part of the VaultManager in the handshake with each vault.  By default, closed
+// connections are deliberately not passed to the ProcessManager so that only the exit detection
+// mechanism under test can trigger restarts.  ForwardConnectionClosures passes them on, as the
+// VaultManager does.
+class VaultHarness {
+ public:
+  struct Start {
+    ProcessId process_id;
+    std::chrono::steady_clock::time_point time;
+  };
+
+  explicit VaultHarness(ExitDetection exit_detection,
+                        SpawnMethod spawn_method = SpawnMethod::kPosixSpawn)
+      : test_root_(maidsafe::test::CreateTestPath("MaidSafe_TestProcessManager")),
+        vault_started_responses_(crypto::AES256Key(RandomString(crypto::AES256_KeySize)),
+                                 crypto::AES256InitialisationVector(
+                                     RandomString(crypto::AES256_IVSize))),
+        mutex_(),
+        cond_var_(),
+        started_(),
+        spares_started_(0),
+        reattached_(0),
+        host_process_id_(0),
+        forward_closures_(false),
+        kExitDetection_(exit_detection),
+        kSpawnMethod_(spawn_method),
+        asio_service_(1),
+        listener_(),
+        process_manager_(),
+        retired_process_manager_() {
+    listener_ = tcp::Listener::MakeShared(asio_service_, [this](tcp::ConnectionPtr connection) {
+      connection->Start([=](const std::string& message) { HandleMessage(connection, message); },
+                        [=] {
+                          if (forward_closures_)
+                            process_manager_->HandleConnectionClosed(connection);
+                        });
+    }, tcp::Port{ 7777 });
+    process_manager_ = ProcessManager::MakeShared(asio_service_.service(),
+        process::GetOtherExecutablePath("dummy_vault"), listener_->ListeningPort(),
+        exit_detection, spawn_method);
+  }
+
+  ~VaultHarness() {
+    try {
+      std::vector<VaultInfo> all_vaults;
+      RunOnIoThread([&] { process_manager_->StopAll(); });
+      do {
+        Sleep(std::chrono::milliseconds(100));
+        RunOnIoThread([&] { all_vaults = process_manager_->GetAll(); });
+      } while (!all_vaults.empty());
+      RunOnIoThread([&] { listener_->StopListening(); });
+    }
+    catch (const std::exception& e) {
+      LOG(kError) << boost::diagnostic_information(e);
+    }
+    asio_service_.Stop();
+  }
+
+  ProcessManager& process_manager() { return *process_manager_; }
+  void ForwardConnectionClosures() { forward_closures_ = true; }
+  fs::path TestRoot() const { return *test_root_; }
+
+  void RunOnIoThread(std::function<void()> functor) {
+    std::promise<void> done;
+    asio_service_.service().post([&] {
+      try {
+        functor();
+        done.set_value();
+      }
+      catch (...) {
+        done.set_exception(std::current_exception());
+      }
+    });
+    done.get_future().get();
+  }
+
+  std::vector<VaultInfo> CreateVaultInfos(int count) {
+    LOG(kInfo) << "Creating " << count << " Pmids (this may take a while)";
+    std::vector<VaultInfo> vault_infos;
+    for (int i(0); i < count; ++i) {
+      VaultInfo vault_info;
+      vault_info.pmid_and_signer =
+          std::make_shared<passport::PmidAndSigner>(passport::CreatePmidAndSigner());
+      vault_info.vault_dir = *test_root_ / ("vault_" + RandomAlphaNumericString(8));
+      fs::create_directories(vault_info.vault_dir);
+      vault_info.label = GenerateLabel();
+      vault_infos.push_back(std::move(vault_info));
+    }
+    return vault_infos;
+  }
+
+  // Creates and adds 'count' vaults in batches to avoid the start-up RPC timeout firing on slow
+  // machines.  Returns false if any vault fails to connect.
+  bool AddVaults(int count, int batch_size) {
+    return AddVaults(CreateVaultInfos(count), batch_size);
+  }
+
+  bool AddVaults(const std::vector<VaultInfo>& vault_infos, int batch_size) {
+    const int kCount(static_cast<int>(vault_infos.size()));
+    std::map<NonEmptyString, size_t> required_starts;
+    for (int i(0); i < kCount; i += batch_size) {
+      RunOnIoThread([&] {
+        for (int j(i); j < std::min(i + batch_size, kCount); ++j) {
+          required_starts[vault_infos[j].label] = 1;
+          process_manager_->AddProcess(vault_infos[j]);
+        }
+      });
+      if (!WaitForStarts(required_starts))
+        return false;
+    }
+    return true;
+  }
+
+  bool WaitForStarts(const std::map<NonEmptyString, size_t>& required_starts,
+                     std::chrono::steady_clock::duration timeout = std::chrono::minutes(5)) {
+    std::unique_lock<std::mutex> lock{ mutex_ };
+    return cond_var_.wait_for(lock, timeout, [&] {
+      for (const auto& required : required_starts) {
+        auto itr(started_.find(required.first));
+        if (itr == std::end(started_) || itr->second.size() < required.second)
+          return false;
+      }
+      return true;
+    });
+  }
+
+  void EnableSparePool(size_t pool_size) {
+    RunOnIoThread([&] {
+      process_manager_->SetSparePool(pool_size,
+          [this](VaultInfo vault_info, ProcessId process_id) {
+            RecordStart(vault_info, Start{ process_id, std::chrono::steady_clock::now() });
+          });
+    });
+  }
+
+  // Vaults added with 'in_process' set run in a dummy vault launched as a host with 'host_args'.
+  void EnableInProcessHosting(std::vector<std::string> host_args = std::vector<std::string>()) {
+    RunOnIoThread([&] {
+      process_manager_->EnableInProcessHosting(*test_root_ / "vault_host", host_args);
+    });
+  }
+
+  // The process ID of the vault host which most recently connected, or 0 if none has.
+  ProcessId HostProcessId() {
+    std::lock_guard<std::mutex> lock{ mutex_ };
+    return host_process_id_;
+  }
+
+  // Waits until a total of 'count' spare vaults have connected.
+  bool WaitForSpares(size_t count) {
+    std::unique_lock<std::mutex> lock{ mutex_ };
+    return cond_var_.wait_for(lock, std::chrono::minutes(1),
+                              [&] { return spares_started_ >= count; });
+  }
+
+  // Starts of each vault, in the order in which they connected to us.
+  std::map<NonEmptyString, std::vector<Start>> Started() {
+    std::lock_guard<std::mutex> lock{ mutex_ };
+    return started_;
+  }
+
+  // Plays the part of a VaultManager re-executing itself: the current ProcessManager hands its
+  // vaults over to a new one, which adopts them.  The old one is kept alive since, unlike after an
+  // exec, its pending handlers are still queued on our io_service.  Returns the number adopted.
+  size_t HandOver() {
+    size_t adopted(0);
+    RunOnIoThread([&] {
+      std::vector<VaultInfo> vault_infos{ process_manager_->GetAll() };
+      Handover handover{ process_manager_->HandOver() };
+      retired_process_manager_ = process_manager_;
+      process_manager_ = ProcessManager::MakeShared(asio_service_.service(),
+          process::GetOtherExecutablePath("dummy_vault"), listener_->ListeningPort(),
+          kExitDetection_, kSpawnMethod_);
+      process_manager_->AdoptTerminated(handover.terminated_process_ids);
+      for (const auto& attached_vault : handover.vaults) {
+        for (const auto& vault_info : vault_infos) {
+          if (vault_info.label == attached_vault.label) {
+            process_manager_->AdoptProcess(vault_info, attached_vault);
+            ++adopted;
+          }
+        }
+      }
+    });
+    return adopted;
+  }
+
+  bool WaitForReattached(size_t count) {
+    std::unique_lock<std::mutex> lock{ mutex_ };
+    return cond_var_.wait_for(lock, kVaultReattachTimeout, [&] { return reattached_ >= count; });
+  }
+
+ private:
+  void HandleMessage(tcp::ConnectionPtr connection, const std::string& wrapped_message) {
+    try {
+      MessageAndType message_and_type{ UnwrapMessage(wrapped_message) };
+      if (message_and_type.second == MessageType::kHeartbeatResponse) {
+        auto response(ParseProto<protobuf::HeartbeatResponse>(message_and_type.first));
+        process_manager_->HandleHeartbeatResponse(connection, response.sequence_number(),
+            std::chrono::microseconds(response.loop_lag_us()),
+            std::chrono::system_clock::time_point(
+                std::chrono::milliseconds(response.timestamp_ms())));
+        return;
+      }
+      if (message_and_type.second == MessageType::kVaultReattached) {
+        auto vault_reattached(ParseProto<protobuf::VaultReattached>(message_and_type.first));
+        process_manager_->HandleVaultReattached(connection, vault_reattached.process_id(),
+                                                Identity{ vault_reattached.pmid_name() });
+        SendVaultReattachedResponse(connection);
+        {
+          std::lock_guard<std::mutex> lock{ mutex_ };
+          ++reattached_;
+        }
+        cond_var_.notify_all();
+        return;
+      }
+      if (message_and_type.second == MessageType::kVaultHostStarted) {
+        auto host_started(ParseProto<protobuf::VaultHostStarted>(message_and_type.first));
+        if (process_manager_->HandleVaultHostStarted(connection, host_started.process_id())) {
+          std::lock_guard<std::mutex> lock{ mutex_ };
+          host_process_id_ = host_started.process_id();
+        }
+        return;
+      }
+      if (message_and_type.second == MessageType::kInstanceExited) {
+        auto instance_exited(ParseProto<protobuf::InstanceExited>(message_and_type.first));
+        process_manager_->HandleInstanceExited(connection, instance_exited.instance_id(),
+                                               instance_exited.exit_code());
+        return;
+      }
+      if (message_and_type.second != MessageType::kVaultStarted)
+        return;
+      Start start{ ParseProto<protobuf::VaultStarted>(message_and_type.first).process_id(),
+                   std::chrono::steady_clock::now() };
+      if (process_manager_->HandleSpareStarted(connection, start.process_id)) {
+        {
+          std::lock_guard<std::mutex> lock{ mutex_ };
+          ++spares_started_;
+        }
+        cond_var_.notify_all();
+        return;
+      }
+      RecordStart(process_manager_->HandleVaultStarted(connection, start.process_id), start);
+      // The dummy vault never joins a network, so report it as having done so straight away.
+      process_manager_->MarkJoinedNetwork(connection);
+    }
+    catch (const std::exception& e) {
+      LOG(kError) << boost::diagnostic_information(e);
+    }
+  }
+
+  void RecordStart(VaultInfo vault_info, Start start) {
+    SendVaultStartedResponse(vault_info.tcp_connection, vault_started_responses_.Get(vault_info));
+    {
+      std::lock_guard<std::mutex> lock{ mutex_ };
+      started_[vault_info.label].push_back(start);
+    }
+    cond_var_.notify_all();
+  }
+
+  std::shared_ptr<fs::path> test_root_;
+  VaultStartedResponseCache vault_started_responses_;
+  std::mutex mutex_;
+  std::condition_variable cond_var_;
+  std::map<NonEmptyString, std::vector<Start>> started_;
+  size_t spares_started_, reattached_;
+  ProcessId host_process_id_;
+  std::atomic<bool> forward_closures_;
+  const ExitDetection kExitDetection_;
+  const SpawnMethod kSpawnMethod_;
+  AsioService asio_service_;
+  std::shared_ptr<tcp::Listener> listener_;
+  std::shared_ptr<ProcessManager> process_manager_, retired_process_manager_;
+};
+
+#ifdef MAIDSAFE_LINUX
+// Starts a process which isn't our child, standing in for a vault left behind by a VaultManager
+// which crashed.  Returns -1 on failure.
+pid_t StartOrphan() {
+  int fds[2];
+  if (pipe(fds) != 0)
+    return -1;
+  pid_t child(fork());
+  if (child == 0) {
+    pid_t grandchild(fork());
+    if (grandchild == 0) {
+      close(fds[0]);
+      close(fds[1]);
+      for (;;)
+        pause();
+    }
+    _exit(write(fds[1], &grandchild, sizeof(grandchild)) == sizeof(grandchild) ? 0 : 1);
+  }
+  close(fds[1]);
+  pid_t orphan(-1);
+  if (child < 0 || read(fds[0], &orphan, sizeof(orphan)) != sizeof(orphan))
+    orphan = -1;
+  close(fds[0]);
+  if (child > 0)
+    waitpid(child, nullptr, 0);
+  return orphan;
+}
+#endif
+
+}  // unnamed namespace
+
+TEST(ProcessManagerTest, FUNC_RestartAllAfterSimultaneousExit) {
+  const int kVaultCount(500);
+  // Force the SIGCHLD backend, since Linux coalesces the SIGCHLDs from a simultaneous exit.
+  VaultHarness harness{ ExitDetection::kSigchld };
+  ASSERT_TRUE(harness.AddVaults(kVaultCount, 50));
+  // This measures reaping, so the restart throttle mustn't spread the restarts out.  At the default
+  // rate, restarting every vault would take around four minutes.
+  harness.RunOnIoThread([&] {
+    harness.process_manager().SetRestartThrottle(kVaultCount, std::chrono::milliseconds(1));
+  });
+
+  // Kill every vault at the same moment.
+  std::vector<ProcessId> killed_pids;
+  std::map<NonEmptyString, size_t> required_starts;
+  auto started(harness.Started());
+  ASSERT_EQ(static_cast<size_t>(kVaultCount), started.size());
+  for (const auto& vault : started) {
+    killed_pids.push_back(vault.second.back().process_id);
+    required_starts[vault.first] = vault.second.size() + 1;
+  }
+  for (auto pid : killed_pids)
+    EXPECT_EQ(0, kill(static_cast<pid_t>(pid), SIGKILL));
+
+  // Every vault must be reaped and restarted.
+  EXPECT_TRUE(harness.WaitForStarts(required_starts));
+  std::vector<ProcessId> running_pids;
+  for (const auto& vault : harness.Started())
+    running_pids.push_back(vault.second.back().process_id);
+  for (auto pid : killed_pids) {
+    if (std::find(std::begin(running_pids), std::end(running_pids), pid) != std::end(running_pids))
+      continue;  // The pid has been reused by a restarted vault.
+    errno = 0;
+    EXPECT_EQ(-1, kill(static_cast<pid_t>(pid), 0)) << "Process " << pid << " wasn't reaped.";
+    EXPECT_EQ(ESRCH, errno);
+  }
+
+  std::vector<VaultInfo> all_vaults;
+  harness.RunOnIoThread([&] { all_vaults = harness.process_manager().GetAll(); });
+  EXPECT_EQ(static_cast<size_t>(kVaultCount), all_vaults.size());
+}
+
+TEST(ProcessManagerTest, FUNC_SigchldLeavesForeignChildren) {
+  // A process hosting the ProcessManager may have children of its own to wait for.
+  VaultHarness harness{ ExitDetection::kSigchld };
+  ASSERT_TRUE(harness.AddVaults(1, 1));
+  auto started(harness.Started());
+  ASSERT_EQ(1U, started.size());
+  pid_t foreign_pid(fork());
+  ASSERT_NE(-1, foreign_pid);
+  if (foreign_pid == 0)
+    _exit(7);
+
+  // Both exits are seen by the SIGCHLD handler, but only the vault's is reaped by it.
+  std::map<NonEmptyString, size_t> required_starts;
+  required_starts[started.begin()->first] = 2;
+  EXPECT_EQ(0, kill(static_cast<pid_t>(started.begin()->second.back().process_id), SIGKILL));
+  EXPECT_TRUE(harness.WaitForStarts(required_starts));
+  int status(0);
+  ASSERT_EQ(foreign_pid, waitpid(foreign_pid, &status, 0));
+  ASSERT_TRUE(WIFEXITED(status));
+  EXPECT_EQ(7, WEXITSTATUS(status));
+}
+
+TEST(ProcessManagerTest, FUNC_ExitToRestartLatency) {
+  const int kVaultCount(20);
+  for (auto exit_detection : { ExitDetection::kSigchld, ExitDetection::kPidfd }) {
+    VaultHarness harness{ exit_detection };
+    ASSERT_TRUE(harness.AddVaults(kVaultCount, kVaultCount));
+    const ExitDetection kInUse(harness.process_manager().GetExitDetection());
+    const char* const kName(kInUse == ExitDetection::kPidfd ? "pidfd" : "SIGCHLD");
+    if (exit_detection != kInUse)
+      TLOG(kYellow) << "pidfds unsupported here; measuring the SIGCHLD fallback instead.\n";
+
+    // Kill the vaults one at a time, timing from the kill until the replacement connects to us.
+    std::vector<std::chrono::microseconds> latencies;
+    for (const auto& vault : harness.Started()) {
+      std::map<NonEmptyString, size_t> required_starts{ { vault.first, vault.second.size() + 1 } };
+      auto kill_time(std::chrono::steady_clock::now());
+      ASSERT_EQ(0, kill(static_cast<pid_t>(vault.second.back().process_id), SIGKILL));
+      ASSERT_TRUE(harness.WaitForStarts(required_starts));
+      latencies.push_back(std::chrono::duration_cast<std::chrono::microseconds>(
+          harness.Started()[vault.first].back().time - kill_time));
+    }
+
+    std::sort(std::begin(latencies), std::end(latencies));
+    TLOG(kDefaultColour) << kName << " exit-to-restart latency over " << latencies.size()
+                         << " restarts:  min " << latencies.front().count() << " us,  median "
+                         << latencies[latencies.size() / 2].count() << " us,  max "
+                         << latencies.back().count() << " us\n";
+  }
+}
+
+TEST(ProcessManagerTest, FUNC_CrashLoopQuarantine) {
+  std::atomic<int> history_changes(0);
+  VaultHarness harness{ ExitDetection::kPidfd };
+  harness.RunOnIoThread([&] {
+    harness.process_manager().SetOnRestartHistoryChanged([&] { ++history_changes; });
+  });
+  ASSERT_TRUE(harness.AddVaults(1, 1));
+  const NonEmptyString kLabel(harness.Started().begin()->first);
+
+  // Each of the first kCrashLoopThreshold - 1 exits is followed by a (backed off) restart.
+  for (int i(1); i < kCrashLoopThreshold; ++i) {
+    auto starts(harness.Started()[kLabel]);
+    auto kill_time(std::chrono::steady_clock::now());
+    ASSERT_EQ(0, kill(static_cast<pid_t>(starts.back().process_id), SIGKILL));
+    std::map<NonEmptyString, size_t> required_starts{ { kLabel, starts.size() + 1 } };
+    ASSERT_TRUE(harness.WaitForStarts(required_starts));
+    auto delay(harness.Started()[kLabel].back().time - kill_time);
+    if (i > 1)
+      EXPECT_GE(delay, BackoffDelay(i) / 2 - std::chrono::milliseconds(1)) << i;
+    EXPECT_EQ(i, history_changes.load());
+  }
+
+  // The next exit quarantines the vault, which remains registered but isn't restarted.
+  const size_t kStartCount(harness.Started()[kLabel].size());
+  ASSERT_EQ(0, kill(static_cast<pid_t>(harness.Started()[kLabel].back().process_id), SIGKILL));
+  std::map<NonEmptyString, size_t> required_starts{ { kLabel, kStartCount + 1 } };
+  EXPECT_FALSE(harness.WaitForStarts(required_starts, std::chrono::seconds(10)));
+  EXPECT_EQ(kCrashLoopThreshold, history_changes.load());
+  VaultInfo vault_info;
+  harness.RunOnIoThread([&] { vault_info = harness.process_manager().Find(kLabel); });
+  EXPECT_LT(0, QuarantineRemaining(vault_info.restart_history,
+                                   std::chrono::system_clock::now()).count());
+}
+
+TEST(ProcessManagerTest, FUNC_RestartThrottle) {
+  const std::chrono::milliseconds kRefillInterval(500);
+  VaultHarness harness{ ExitDetection::kPidfd };
+  harness.RunOnIoThread([&] {
+    EXPECT_THROW(harness.process_manager().SetRestartThrottle(0, kRefillInterval), maidsafe_error);
+    harness.process_manager().SetRestartThrottle(1, kRefillInterval);
+  });
+  const int kVaultCount(4);
+  ASSERT_TRUE(harness.AddVaults(kVaultCount, kVaultCount));
+
+  // Kill every vault at once, as a shared dependency failing would.
+  std::map<NonEmptyString, size_t> required_starts;
+  for (const auto& vault : harness.Started()) {
+    required_starts[vault.first] = vault.second.size() + 1;
+    ASSERT_EQ(0, kill(static_cast<pid_t>(vault.second.back().process_id), SIGKILL));
+  }
+  ASSERT_TRUE(harness.WaitForStarts(required_starts, std::chrono::seconds(30)));
+
+  // Only one restart is allowed at once, and the rest follow at the refill rate (allowing for the
+  // variation in how long each takes to connect).
+  std::vector<std::chrono::steady_clock::time_point> restarts;
+  for (const auto& vault : harness.Started())
+    restarts.push_back(vault.second.back().time);
+  std::sort(std::begin(restarts), std::end(restarts));
+  for (size_t i(1); i < restarts.size(); ++i)
+    EXPECT_GE(restarts[i] - restarts[i - 1], kRefillInterval / 2) << i;
+
+  RestartQueueStats stats;
+  harness.RunOnIoThread([&] { stats = harness.process_manager().GetRestartQueueStats(); });
+  EXPECT_EQ(0U, stats.queued);
+  EXPECT_EQ(static_cast<size_t>(kVaultCount - 1), stats.peak_queued);
+  EXPECT_EQ(static_cast<uint64_t>(kVaultCount), stats.admitted);
+  EXPECT_EQ(static_cast<uint64_t>(kVaultCount - 1), stats.throttled);
+  EXPECT_GE(stats.longest_wait, (kVaultCount - 2) * kRefillInterval);
+}
+
+TEST(ProcessManagerTest, FUNC_ExitHistory) {
+  VaultHarness harness{ ExitDetection::kPidfd };
+  ASSERT_TRUE(harness.AddVaults(1, 1));
+  const NonEmptyString kLabel(harness.Started().begin()->first);
+
+  const std::vector<int> kSignals{ SIGSEGV, SIGTERM };
+  for (int signal : kSignals) {
+    const size_t kStartCount(harness.Started()[kLabel].size());
+    ASSERT_EQ(0, kill(static_cast<pid_t>(harness.Started()[kLabel].back().process_id), signal));
+    std::map<NonEmptyString, size_t> required_starts{ { kLabel, kStartCount + 1 } };
+    ASSERT_TRUE(harness.WaitForStarts(required_starts));
+  }
+
+  std::vector<ExitRecord> exits;
+  harness.RunOnIoThread([&] {
+    exits = harness.process_manager().GetExitHistory(kLabel);
+    EXPECT_THROW(harness.process_manager().GetExitHistory(GenerateLabel()), maidsafe_error);
+  });
+  ASSERT_EQ(kSignals.size(), exits.size());
+  EXPECT_EQ(ExitClass::kCrashed, exits[0].exit_class);
+  EXPECT_EQ(SIGSEGV, exits[0].exit_status.signal);
+  EXPECT_EQ(ExitClass::kKilled, exits[1].exit_class);
+  EXPECT_EQ(SIGTERM, exits[1].exit_status.signal);
+  EXPECT_TRUE(exits[0].time <= exits[1].time);
+}
+
+TEST(ProcessManagerTest, FUNC_SpawnLatency) {
+  const int kVaultCount(20);
+  // Emulate a large VaultManager.  fork copies the page tables covering this; posix_spawn doesn't.
+  const size_t kBallastSize(256 * 1024 * 1024);
+  std::vector<char> ballast(kBallastSize);
+  for (size_t i(0); i < kBallastSize; i += 4096)
+    ballast[i] = static_cast<char>(i);
+
+  for (auto spawn_method : { SpawnMethod::kForkExec, SpawnMethod::kPosixSpawn }) {
+    VaultHarness harness{ ExitDetection::kPidfd, spawn_method };
+    std::vector<VaultInfo> vault_infos(harness.CreateVaultInfos(kVaultCount));
+    std::map<NonEmptyString, size_t> required_starts;
+    std::vector<std::chrono::microseconds> latencies;
+    for (const auto& vault_info : vault_infos) {
+      required_starts[vault_info.label] = 1;
+      harness.RunOnIoThread([&] {
+        auto start(std::chrono::steady_clock::now());
+        harness.process_manager().AddProcess(vault_info);
+        latencies.push_back(std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - start));
+      });
+    }
+    EXPECT_TRUE(harness.WaitForStarts(required_starts));
+
+    std::sort(std::begin(latencies), std::end(latencies));
+    TLOG(kDefaultColour) << (spawn_method == SpawnMethod::kPosixSpawn ? "posix_spawn" : "fork/exec")
+                         << " spawn latency over " << latencies.size() << " vaults:  min "
+                         << latencies.front().count() << " us,  median "
+                         << latencies[latencies.size() / 2].count() << " us,  max "
+                         << latencies.back().count() << " us\n";
+
+    // Every start should have been recorded both against its vault and host-wide.
+    auto host_latencies(harness.process_manager().GetLifecycleLatencies());
+    ASSERT_EQ(kLifecyclePhaseCount, host_latencies.size());
+    EXPECT_EQ(static_cast<uint64_t>(kVaultCount), host_latencies[0].count);
+    EXPECT_LE(host_latencies[0].p50, host_latencies[0].max);
+    harness.RunOnIoThread([&] {
+      for (const auto& vault_info : vault_infos) {
+        auto vault_latencies(harness.process_manager().GetLifecycleLatencies(vault_info.label));
+        EXPECT_EQ(1U, vault_latencies[0].count);
+        EXPECT_EQ(0U, vault_latencies[3].count);
+      }
+    });
+  }
+}
+
+TEST(ProcessManagerTest, FUNC_AddProcesses) {
+  const int kVaultCount(100);
+  VaultHarness harness{ ExitDetection::kPidfd };
+  std::vector<VaultInfo> vault_infos(harness.CreateVaultInfos(kVaultCount));
+  // Append a duplicate label, a duplicate vault_dir and an invalid vault.
+  vault_infos.push_back(harness.CreateVaultInfos(1).front());
+  vault_infos.back().label = vault_infos.front().label;
+  vault_infos.push_back(harness.CreateVaultInfos(1).front());
+  vault_infos.back().vault_dir = vault_infos.front().vault_dir;
+  vault_infos.push_back(harness.CreateVaultInfos(1).front());
+  vault_infos.back().pmid_and_signer.reset();
+
+  std::promise<std::vector<AddProcessOutcome>> added;
+  auto start_time(std::chrono::steady_clock::now());
+  harness.RunOnIoThread([&] {
+    harness.process_manager().AddProcesses(vault_infos,
+        [&](std::vector<AddProcessOutcome> outcomes) { added.set_value(std::move(outcomes)); }, 8);
+  });
+  auto added_future(added.get_future());
+  ASSERT_EQ(std::future_status::ready, added_future.wait_for(std::chrono::minutes(5)));
+  std::vector<AddProcessOutcome> outcomes(added_future.get());
+  TLOG(kDefaultColour) << "Started " << kVaultCount << " vaults in "
+                       << std::chrono::duration_cast<std::chrono::milliseconds>(
+                              std::chrono::steady_clock::now() - start_time).count() << " ms\n";
+
+  ASSERT_EQ(vault_infos.size(), outcomes.size());
+  for (int i(0); i < kVaultCount; ++i) {
+    EXPECT_EQ(vault_infos[i].label, outcomes[i].label);
+    EXPECT_EQ(make_error_code(CommonErrors::success), outcomes[i].error.code());
+  }
+  EXPECT_EQ(make_error_code(CommonErrors::already_initialised), outcomes[kVaultCount].error.code());
+  EXPECT_EQ(make_error_code(CommonErrors::already_initialised),
+            outcomes[kVaultCount + 1].error.code());
+  EXPECT_EQ(make_error_code(CommonErrors::invalid_parameter),
+            outcomes[kVaultCount + 2].error.code());
+  EXPECT_EQ(static_cast<size_t>(kVaultCount), harness.Started().size());
+  std::vector<VaultInfo> all_vaults;
+  harness.RunOnIoThread([&] { all_vaults = harness.process_manager().GetAll(); });
+  EXPECT_EQ(static_cast<size_t>(kVaultCount), all_vaults.size());
+
+  // A bad limit is rejected outright.
+  std::vector<VaultInfo> rejected(harness.CreateVaultInfos(1));
+  harness.RunOnIoThread([&] {
+    EXPECT_THROW(harness.process_manager().AddProcesses(rejected, nullptr, 0), maidsafe_error);
+  });
+}
+
+TEST(ProcessManagerTest, FUNC_RollingShutdown) {
+  const int kVaultCount(40), kMaxConcurrentStops(8), kStragglerCount(2);
+  // Connection closes are forwarded, since a vault closes its connection as it exits, and must
+  // still be counted as having stopped rather than been terminated.
+  for (auto exit_detection : { ExitDetection::kPidfd, ExitDetection::kSigchld }) {
+    SCOPED_TRACE(exit_detection == ExitDetection::kPidfd ? "pidfd" : "SIGCHLD");
+    VaultHarness harness{ exit_detection };
+    harness.ForwardConnectionClosures();
+    ASSERT_TRUE(harness.AddVaults(kVaultCount, 20));
+
+    // Suspended vaults can't answer the shutdown request, so must be terminated at the deadline,
+    // which is set well inside the per-vault stop timeout.
+    auto started(harness.Started());
+    auto itr(started.begin());
+    for (int i(0); i < kStragglerCount; ++i, ++itr)
+      EXPECT_EQ(0, kill(static_cast<pid_t>(itr->second.back().process_id), SIGSTOP));
+    const auto kDeadline(kVaultStopTimeout / 2);
+
+    std::mutex mutex;
+    std::vector<ShutdownProgress> progress_events;
+    std::promise<void> all_stopped;
+    auto start_time(std::chrono::steady_clock::now());
+    harness.RunOnIoThread([&] {
+      EXPECT_THROW(harness.process_manager().StopAllRolling(0, kDeadline, nullptr, nullptr),
+                   maidsafe_error);
+      harness.process_manager().StopAllRolling(kMaxConcurrentStops, kDeadline,
+          [&](ShutdownProgress progress) {
+            std::lock_guard<std::mutex> lock{ mutex };
+            progress_events.push_back(progress);
+          },
+          [&] { all_stopped.set_value(); });
+    });
+    auto future(all_stopped.get_future());
+    ASSERT_EQ(std::future_status::ready, future.wait_for(kVaultStopTimeout));
+    auto duration(std::chrono::steady_clock::now() - start_time);
+    TLOG(kDefaultColour) << "Stopped " << kVaultCount << " vaults in "
+                         << std::chrono::duration_cast<std::chrono::milliseconds>(duration).count()
+                         << " ms\n";
+    EXPECT_GE(duration, kDeadline);
+
+    std::lock_guard<std::mutex> lock{ mutex };
+    ASSERT_EQ(static_cast<size_t>(kVaultCount), progress_events.size());
+    for (size_t i(0); i < progress_events.size(); ++i) {
+      EXPECT_EQ(static_cast<size_t>(kVaultCount), progress_events[i].total);
+      EXPECT_EQ(kVaultCount - i - 1, progress_events[i].Remaining());
+    }
+    EXPECT_EQ(static_cast<size_t>(kVaultCount - kStragglerCount), progress_events.back().stopped);
+    EXPECT_EQ(static_cast<size_t>(kStragglerCount), progress_events.back().terminated);
+    // Every vault which stopped by itself has been reaped.
+    for (; itr != started.end(); ++itr) {
+      EXPECT_EQ(-1, waitpid(static_cast<pid_t>(itr->second.back().process_id), nullptr,
+                            WNOHANG));
+    }
+    std::vector<VaultInfo> all_vaults;
+    harness.RunOnIoThread([&] { all_vaults = harness.process_manager().GetAll(); });
+    EXPECT_TRUE(all_vaults.empty());
+  }
+}
+
+TEST(ProcessManagerTest, FUNC_VaultRemoved) {
+  VaultHarness harness{ ExitDetection::kPidfd };
+  harness.ForwardConnectionClosures();
+  std::vector<VaultInfo> vault_infos(harness.CreateVaultInfos(2));
+  std::vector<NonEmptyString> removed;
+  harness.RunOnIoThread([&] {
+    harness.process_manager().SetOnVaultRemoved([&](NonEmptyString label) {
+      removed.push_back(label);
+    });
+  });
+  ASSERT_TRUE(harness.AddVaults(vault_infos, 2));
+
+  std::promise<void> all_stopped;
+  harness.RunOnIoThread([&] {
+    harness.process_manager().StopAllRolling(2, kVaultStopTimeout / 2, nullptr,
+                                             [&] { all_stopped.set_value(); });
+  });
+  ASSERT_EQ(std::future_status::ready, all_stopped.get_future().wait_for(kVaultStopTimeout));
+  harness.RunOnIoThread([&] {
+    ASSERT_EQ(2U, removed.size());
+    for (const auto& vault_info : vault_infos)
+      EXPECT_NE(std::end(removed), std::find(std::begin(removed), std::end(removed),
+                                             vault_info.label));
+  });
+}
+
+TEST(ProcessManagerTest, FUNC_SparePoolStartLatency) {
+  const int kVaultCount(20);
+  VaultHarness harness{ ExitDetection::kPidfd };
+  std::vector<VaultInfo> vault_infos(harness.CreateVaultInfos(2 * kVaultCount));
+  // Time from adding the vault until it has been sent its VaultStartedResponse.
+  auto start_vault([&](const VaultInfo& vault_info) -> std::chrono::microseconds {
+    auto start_time(std::chrono::steady_clock::now());
+    harness.RunOnIoThread([&] { harness.process_manager().AddProcess(vault_info); });
+    std::map<NonEmptyString, size_t> required_starts;
+    required_starts[vault_info.label] = 1;
+    EXPECT_TRUE(harness.WaitForStarts(required_starts, std::chrono::seconds(10)));
+    auto started(harness.Started());
+    EXPECT_NE(0U, started[vault_info.label].back().process_id);
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        started[vault_info.label].back().time - start_time);
+  });
+
+  std::chrono::microseconds cold(0), warm(0);
+  for (int i(0); i < kVaultCount; ++i)
+    cold += start_vault(vault_infos[i]);
+
+  harness.EnableSparePool(1);
+  for (int i(0); i < kVaultCount; ++i) {
+    ASSERT_TRUE(harness.WaitForSpares(i + 1));
+    warm += start_vault(vault_infos[kVaultCount + i]);
+  }
+
+  TLOG(kDefaultColour) << "Mean cold start: " << cold.count() / kVaultCount << " us\n"
+                       << "Mean warm start: " << warm.count() / kVaultCount << " us\n";
+  EXPECT_LT(warm, cold);
+  std::vector<VaultInfo> all_vaults;
+  harness.RunOnIoThread([&] { all_vaults = harness.process_manager().GetAll(); });
+  EXPECT_EQ(static_cast<size_t>(2 * kVaultCount), all_vaults.size());
+}
+
+TEST(ProcessManagerTest, FUNC_RollingUpgrade) {
+  const int kVaultCount(6);
+  VaultHarness harness{ ExitDetection::kPidfd };
+  ASSERT_TRUE(harness.AddVaults(kVaultCount, kVaultCount));
+  fs::path old_executable;
+  harness.RunOnIoThread([&] {
+    old_executable = harness.process_manager().GetVaultExecutablePath();
+  });
+  fs::path new_executable{ harness.TestRoot() / "dummy_vault_upgraded" };
+  fs::copy_file(old_executable, new_executable);
+  fs::permissions(new_executable, fs::add_perms | fs::owner_exe);
+
+  UpgradeOptions options;
+  options.wave_size = 2;
+  options.failure_threshold = 0.0;
+  std::promise<std::pair<maidsafe_error, UpgradeProgress>> upgraded;
+  std::vector<UpgradeProgress> progress_reports;
+  harness.RunOnIoThread([&] {
+    EXPECT_THROW(harness.process_manager().Upgrade(old_executable, options, nullptr, nullptr),
+                 maidsafe_error);
+    EXPECT_THROW(harness.process_manager().Upgrade(harness.TestRoot() / "missing", options,
+                                                   nullptr, nullptr), maidsafe_error);
+    harness.process_manager().Upgrade(new_executable, options,
+        [&](UpgradeProgress progress) { progress_reports.push_back(progress); },
+        [&](maidsafe_error error, UpgradeProgress progress) {
+          upgraded.set_value(std::make_pair(error, progress));
+        });
+    EXPECT_TRUE(harness.process_manager().UpgradeInProgress());
+    EXPECT_THROW(harness.process_manager().Upgrade(new_executable, options, nullptr, nullptr),
+                 maidsafe_error);
+  });
+
+  auto future(upgraded.get_future());
+  ASSERT_EQ(std::future_status::ready, future.wait_for(std::chrono::minutes(2)));
+  auto result(future.get());
+  EXPECT_EQ(make_error_code(CommonErrors::success), result.first.code());
+  EXPECT_EQ(static_cast<size_t>(kVaultCount), result.second.total);
+  EXPECT_EQ(static_cast<size_t>(kVaultCount), result.second.upgraded);
+  EXPECT_EQ(0U, result.second.failed);
+  EXPECT_FALSE(result.second.rolling_back);
+  harness.RunOnIoThread([&] {
+    EXPECT_FALSE(harness.process_manager().UpgradeInProgress());
+    EXPECT_EQ(new_executable, harness.process_manager().GetVaultExecutablePath());
+    // One report per vault, each once it has rejoined.
+    ASSERT_EQ(static_cast<size_t>(kVaultCount), progress_reports.size());
+    for (size_t i(0); i < progress_reports.size(); ++i)
+      EXPECT_EQ(i + 1, progress_reports[i].upgraded);
+  });
+
+  // Every vault was restarted exactly once.
+  for (const auto& vault : harness.Started())
+    EXPECT_EQ(2U, vault.second.size());
+}
+
+TEST(ProcessManagerTest, FUNC_UpgradeRollsBack) {
+  const int kVaultCount(4);
+  VaultHarness harness{ ExitDetection::kPidfd };
+  ASSERT_TRUE(harness.AddVaults(kVaultCount, kVaultCount));
+  fs::path old_executable;
+  harness.RunOnIoThread([&] {
+    old_executable = harness.process_manager().GetVaultExecutablePath();
+  });
+  // A "vault" which exits as soon as it starts.
+  fs::path broken_executable{ harness.TestRoot() / "broken_vault" };
+  ASSERT_TRUE(WriteFile(broken_executable, "#!/bin/sh\nexit 1\n"));
+  fs::permissions(broken_executable, fs::add_perms | fs::owner_exe);
+
+  UpgradeOptions options;
+  options.wave_size = 2;
+  options.failure_threshold = 0.25;
+  std::promise<std::pair<maidsafe_error, UpgradeProgress>> upgraded;
+  harness.RunOnIoThread([&] {
+    harness.process_manager().Upgrade(broken_executable, options, nullptr,
+        [&](maidsafe_error error, UpgradeProgress progress) {
+          upgraded.set_value(std::make_pair(error, progress));
+        });
+  });
+
+  auto future(upgraded.get_future());
+  ASSERT_EQ(std::future_status::ready, future.wait_for(std::chrono::minutes(1)));
+  auto result(future.get());
+  EXPECT_EQ(make_error_code(VaultManagerErrors::vault_exited_with_error), result.first.code());
+  EXPECT_TRUE(result.second.rolling_back);
+  // Only the first wave was restarted, so only it needs rolling back.
+  EXPECT_EQ(options.wave_size, result.second.total);
+  harness.RunOnIoThread([&] {
+    EXPECT_EQ(old_executable, harness.process_manager().GetVaultExecutablePath());
+  });
+
+  // The failed wave comes back on the old executable once its restart backoff has passed.
+  size_t restarted(0);
+  auto deadline(std::chrono::steady_clock::now() + std::chrono::seconds(30));
+  while (restarted < options.wave_size && std::chrono::steady_clock::now() < deadline) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    restarted = 0;
+    for (const auto& vault : harness.Started())
+      restarted += (vault.second.size() > 1U);
+  }
+  EXPECT_EQ(options.wave_size, restarted);
+}
+
+TEST(ProcessManagerTest, FUNC_HandOver) {
+  const size_t kVaultCount(4);
+  VaultHarness harness{ ExitDetection::kPidfd };
+  ASSERT_TRUE(harness.AddVaults(static_cast<int>(kVaultCount), static_cast<int>(kVaultCount)));
+  EXPECT_EQ(kVaultCount, harness.HandOver());
+  ASSERT_TRUE(harness.WaitForReattached(kVaultCount));
+
+  // Every vault kept its original process and is connected to the new ProcessManager.
+  auto started(harness.Started());
+  for (const auto& vault : started)
+    EXPECT_EQ(1U, vault.second.size());
+  harness.RunOnIoThread([&] {
+    std::vector<VaultInfo> vault_infos{ harness.process_manager().GetAll() };
+    EXPECT_EQ(kVaultCount, vault_infos.size());
+    for (const auto& vault_info : vault_infos)
+      EXPECT_TRUE(vault_info.tcp_connection != nullptr);
+  });
+
+  // The new ProcessManager detects an adopted vault's exit and restarts it.
+  const NonEmptyString kLabel(started.begin()->first);
+  ASSERT_EQ(0, kill(static_cast<pid_t>(started[kLabel].back().process_id), SIGKILL));
+  std::map<NonEmptyString, size_t> required_starts;
+  required_starts[kLabel] = 2;
+  EXPECT_TRUE(harness.WaitForStarts(required_starts, std::chrono::seconds(30)));
+}
+
+TEST(ProcessManagerTest, FUNC_HungVaultRestarted) {
+  const std::chrono::milliseconds kInterval(100);
+  const int kMissedThreshold(3);
+  VaultHarness harness{ ExitDetection::kPidfd };
+  harness.RunOnIoThread([&] {
+    EXPECT_THROW(harness.process_manager().EnableHeartbeats(kInterval, 0), maidsafe_error);
+    harness.process_manager().EnableHeartbeats(kInterval, kMissedThreshold);
+  });
+  ASSERT_TRUE(harness.AddVaults(1, 1));
+  const NonEmptyString kLabel(harness.Started().begin()->first);
+
+  Sleep(kInterval * 10);
+  HeartbeatStats stats;
+  harness.RunOnIoThread([&] { stats = harness.process_manager().GetHeartbeatStats(kLabel); });
+  EXPECT_GT(stats.answered, 0U);
+  EXPECT_GT(stats.last_round_trip.count(), 0);
+  EXPECT_LE(stats.last_round_trip, stats.max_round_trip);
+  EXPECT_LT(std::abs(stats.clock_offset.count()), 1000);
+
+  // A stopped vault keeps its connection open but can't answer heartbeats.
+  auto stop_time(std::chrono::steady_clock::now());
+  ASSERT_EQ(0, kill(static_cast<pid_t>(harness.Started()[kLabel].back().process_id), SIGSTOP));
+  std::map<NonEmptyString, size_t> required_starts;
+  required_starts[kLabel] = 2;
+  ASSERT_TRUE(harness.WaitForStarts(required_starts, std::chrono::seconds(30)));
+  auto detection_time(harness.Started()[kLabel].back().time - stop_time);
+  TLOG(kDefaultColour) << "Hung vault restarted after "
+      << std::chrono::duration_cast<std::chrono::milliseconds>(detection_time).count() << " ms\n";
+  EXPECT_GE(detection_time, kInterval * (kMissedThreshold - 1));
+  harness.RunOnIoThread([&] {
+    EXPECT_GE(harness.process_manager().GetHeartbeatStats(kLabel).missed,
+              static_cast<uint64_t>(kMissedThreshold));
+  });
+}
+
+TEST(ProcessManagerTest, FUNC_Cgroups) {
+  std::shared_ptr<fs::path> cgroup_root{
+      maidsafe::test::CreateTestPath("MaidSafe_TestProcessManager") };
+  WriteFile(*cgroup_root / "cgroup.controllers", "cpu memory");
+  VaultHarness harness{ ExitDetection::kPidfd };
+  harness.RunOnIoThread([&] { harness.process_manager().EnableCgroups(*cgroup_root); });
+  std::vector<VaultInfo> vault_infos(harness.CreateVaultInfos(1));
+  vault_infos[0].resource_limits.memory_max = 1 << 30;
+  harness.RunOnIoThread([&] { harness.process_manager().AddProcess(vault_infos[0]); });
+  std::map<NonEmptyString, size_t> required_starts;
+  required_starts[vault_infos[0].label] = 1;
+  ASSERT_TRUE(harness.WaitForStarts(required_starts));
+
+  const fs::path kGroup(*cgroup_root / ("vault_" + vault_infos[0].label.string()));
+  ProcessId process_id(harness.Started().begin()->second.back().process_id);
+  EXPECT_EQ(std::to_string(process_id), ReadFile(kGroup / "cgroup.procs").string());
+  EXPECT_EQ("1073741824", ReadFile(kGroup / "memory.max").string());
+
+  ResourceLimits limits;
+  limits.cpu_weight = 20;
+  harness.RunOnIoThread([&] {
+    harness.process_manager().SetResourceLimits(vault_infos[0].label, limits);
+    EXPECT_EQ(20U, harness.process_manager().Find(vault_infos[0].label).resource_limits.cpu_weight);
+  });
+  EXPECT_EQ("20", ReadFile(kGroup / "cpu.weight").string());
+  EXPECT_EQ("max", ReadFile(kGroup / "memory.max").string());
+}
+
+TEST(ProcessManagerTest, FUNC_InProcessVaults) {
+  VaultHarness harness{ ExitDetection::kPidfd };
+  harness.EnableInProcessHosting();
+  std::vector<VaultInfo> vault_infos(harness.CreateVaultInfos(2));
+  vault_infos[0].in_process = true;
+  const NonEmptyString kInProcess(vault_infos[0].label), kSeparate(vault_infos[1].label);
+  ASSERT_TRUE(harness.AddVaults(vault_infos, 2));
+
+  const ProcessId kHostProcessId(harness.HostProcessId());
+  ASSERT_NE(0U, kHostProcessId);
+  EXPECT_NE(static_cast<ProcessId>(getpid()), kHostProcessId);
+  auto started(harness.Started());
+  EXPECT_TRUE(InProcessHost::IsInstanceId(started[kInProcess][0].process_id));
+  EXPECT_FALSE(InProcessHost::IsInstanceId(started[kSeparate][0].process_id));
+  EXPECT_NE(kHostProcessId, started[kSeparate][0].process_id);
+
+  harness.RunOnIoThread([&] {
+    EXPECT_TRUE(harness.process_manager().Find(kInProcess).in_process);
+    // It shares the host's priority, so can't be given one of its own.
+    EXPECT_FALSE(harness.process_manager().SetSchedulingClass(kInProcess,
+                                                              SchedulingClass::kBatch));
+    // Only the separate vault could outlive us.
+    std::vector<AttachedVault> attached(harness.process_manager().GetAttachedVaults());
+    ASSERT_EQ(1U, attached.size());
+    EXPECT_EQ(kSeparate, attached[0].label);
+  });
+
+  // A crash of the host takes its vaults down with it, but neither us nor the separate vault.
+  ASSERT_EQ(0, kill(static_cast<pid_t>(kHostProcessId), SIGKILL));
+  std::map<NonEmptyString, size_t> required_starts{ { kInProcess, 2 } };
+  ASSERT_TRUE(harness.WaitForStarts(required_starts));
+  started = harness.Started();
+  EXPECT_TRUE(InProcessHost::IsInstanceId(started[kInProcess][1].process_id));
+  EXPECT_NE(started[kInProcess][0].process_id, started[kInProcess][1].process_id);
+  EXPECT_NE(kHostProcessId, harness.HostProcessId());
+  EXPECT_EQ(1U, started[kSeparate].size());
+  harness.RunOnIoThread([&] {
+    std::vector<ExitRecord> exits(harness.process_manager().GetExitHistory(kInProcess));
+    ASSERT_EQ(1U, exits.size());
+    EXPECT_EQ(SIGKILL, exits[0].exit_status.signal);
+    EXPECT_TRUE(harness.process_manager().GetExitHistory(kSeparate).empty());
+  });
+}
+
+TEST(ProcessManagerTest, FUNC_HungInProcessVaultIsQuarantined) {
+  VaultHarness harness{ ExitDetection::kPidfd };
+  harness.ForwardConnectionClosures();
+  // Each hosted vault carries on running after being asked to stop.
+  harness.EnableInProcessHosting(std::vector<std::string>{ "--ignore_stop_requests" });
+  std::vector<VaultInfo> vault_infos(harness.CreateVaultInfos(1));
+  vault_infos[0].in_process = true;
+  const NonEmptyString kLabel(vault_infos[0].label);
+  ASSERT_TRUE(harness.AddVaults(vault_infos, 1));
+
+  // Standing in for the vault closing its connection, after which it's terminated.
+  harness.RunOnIoThread([&] {
+    harness.process_manager().HandleConnectionClosed(
+        harness.process_manager().Find(kLabel).tcp_connection);
+  });
+  Sleep(kConnectionClosedGracePeriod + kVaultStopTimeout + std::chrono::seconds(2));
+
+  // Its thread can't be killed, so rather than a second copy being started alongside it, it's
+  // quarantined until it exits.
+  harness.RunOnIoThread([&] {
+    EXPECT_NO_THROW(harness.process_manager().Find(kLabel));
+    EXPECT_TRUE(harness.process_manager().GetExitHistory(kLabel).empty());
+  });
+  EXPECT_EQ(1U, harness.Started()[kLabel].size());
+
+  // Once it has gone along with its host, it's started again.
+  ASSERT_EQ(0, kill(static_cast<pid_t>(harness.HostProcessId()), SIGKILL));
+  std::map<NonEmptyString, size_t> required_starts{ { kLabel, 2 } };
+  ASSERT_TRUE(harness.WaitForStarts(required_starts));
+  harness.RunOnIoThread([&] {
+    std::vector<ExitRecord> exits(harness.process_manager().GetExitHistory(kLabel));
+    ASSERT_EQ(1U, exits.size());
+    EXPECT_EQ(ExitClass::kTerminated, exits[0].exit_class);
+  });
+}
+
+#ifdef MAIDSAFE_LINUX
+TEST(ProcessManagerTest, FUNC_ExitClassWithConnectionClosures) {
+  // A vault's connection closes as its process exits, usually before the exit is detected, but it's
+  // the exit status which decides the class.
+  std::shared_ptr<fs::path> cgroup_root{
+      maidsafe::test::CreateTestPath("MaidSafe_TestProcessManager") };
+  WriteFile(*cgroup_root / "cgroup.controllers", "cpu memory");
+  VaultHarness harness{ ExitDetection::kPidfd };
+  harness.ForwardConnectionClosures();
+  harness.RunOnIoThread([&] { harness.process_manager().EnableCgroups(*cgroup_root); });
+  ASSERT_TRUE(harness.AddVaults(1, 1));
+  const NonEmptyString kLabel(harness.Started().begin()->first);
+
+  ASSERT_EQ(0, kill(static_cast<pid_t>(harness.Started()[kLabel].back().process_id), SIGSEGV));
+  std::map<NonEmptyString, size_t> required_starts{ { kLabel, 2 } };
+  ASSERT_TRUE(harness.WaitForStarts(required_starts));
+
+  // Stand in for the OOM killer, which raises the cgroup's count before sending SIGKILL.
+  WriteFile(*cgroup_root / ("vault_" + kLabel.string()) / "memory.events", "oom 1\noom_kill 1\n");
+  ASSERT_EQ(0, kill(static_cast<pid_t>(harness.Started()[kLabel].back().process_id), SIGKILL));
+  required_starts[kLabel] = 3;
+  ASSERT_TRUE(harness.WaitForStarts(required_starts));
+
+  std::vector<ExitRecord> exits;
+  harness.RunOnIoThread([&] { exits = harness.process_manager().GetExitHistory(kLabel); });
+  ASSERT_EQ(2U, exits.size());
+  EXPECT_EQ(ExitClass::kCrashed, exits[0].exit_class);
+  EXPECT_EQ(SIGSEGV, exits[0].exit_status.signal);
+  EXPECT_EQ(ExitClass::kOutOfMemory, exits[1].exit_class);
+  EXPECT_EQ(SIGKILL, exits[1].exit_status.signal);
+}
+
+TEST(ProcessManagerTest, FUNC_AdoptOrphan) {
+  // Started before the harness, so that its SIGCHLD handler can't reap the intermediate child.
+  const pid_t kOrphan(StartOrphan());
+  ASSERT_GT(kOrphan, 0);
+  on_scope_exit kill_orphan([kOrphan] { kill(kOrphan, SIGKILL); });
+  VaultHarness harness{ ExitDetection::kSigchld };
+  VaultInfo vault_info(harness.CreateVaultInfos(1).front());
+  AttachedVault attached_vault;
+  attached_vault.label = vault_info.label;
+  attached_vault.process_id = static_cast<uint64_t>(kOrphan);
+  attached_vault.executable = process::GetOtherExecutablePath("dummy_vault");
+  attached_vault.start_token = ResourceReader().ReadStartTime(attached_vault.process_id);
+  ASSERT_NE(0U, attached_vault.start_token);
+
+  harness.RunOnIoThread([&] {
+    // A start token which doesn't match shows the process ID to have been reused.
+    AttachedVault reused(attached_vault);
+    ++reused.start_token;
+    EXPECT_THROW(harness.process_manager().AdoptProcess(vault_info, reused), maidsafe_error);
+    EXPECT_TRUE(harness.process_manager().GetAll().empty());
+
+    harness.process_manager().AdoptProcess(vault_info, attached_vault);
+    std::vector<AttachedVault> attached_vaults{ harness.process_manager().GetAttachedVaults() };
+    ASSERT_EQ(1U, attached_vaults.size());
+    EXPECT_EQ(attached_vault.process_id, attached_vaults.front().process_id);
+    EXPECT_EQ(attached_vault.start_token, attached_vaults.front().start_token);
+  });
+
+  // The orphan's exit raises no SIGCHLD, but is still detected and the vault restarted.
+  ASSERT_EQ(0, kill(kOrphan, SIGKILL));
+  std::map<NonEmptyString, size_t> required_starts;
+  required_starts[vault_info.label] = 1;
+  EXPECT_TRUE(harness.WaitForStarts(required_starts, std::chrono::seconds(30)));
+}
+
+TEST(ProcessManagerTest, FUNC_ResourceSampling) {
+  const size_t kHistorySize(3);
+  VaultHarness harness{ ExitDetection::kPidfd };
+  harness.RunOnIoThread([&] {
+    harness.process_manager().EnableResourceSampling(std::chrono::milliseconds(50), kHistorySize);
+  });
+  ASSERT_TRUE(harness.AddVaults(2, 2));
+
+  // Wait for the histories to fill, after which they shouldn't grow any further.
+  std::this_thread::sleep_for(std::chrono::milliseconds(50 * (kHistorySize + 20)));
+  for (const auto& vault : harness.Started()) {
+    std::vector<ResourceSample> samples;
+    harness.RunOnIoThread([&] {
+      samples = harness.process_manager().GetResourceUsage(vault.first);
+    });
+    ASSERT_EQ(kHistorySize, samples.size());
+    for (size_t i(0); i < samples.size(); ++i) {
+      EXPECT_GT(samples[i].rss, 0U);
+      EXPECT_GT(samples[i].threads, 0U);
+      EXPECT_GT(samples[i].file_descriptors, 0U);
+      if (i != 0) {
+        EXPECT_TRUE(samples[i - 1].time < samples[i].time);
+        EXPECT_TRUE(samples[i - 1].cpu_time <= samples[i].cpu_time);
+      }
+    }
+  }
+  harness.RunOnIoThread([&] {
+    EXPECT_THROW(harness.process_manager().GetResourceUsage(GenerateLabel()), maidsafe_error);
+  });
+}
+
+TEST(ProcessManagerTest, FUNC_MemoryWatchdog) {
+  std::atomic<int> history_changes(0);
+  VaultHarness harness{ ExitDetection::kPidfd };
+  MemoryWatchdogOptions options;
+  // Any running vault exceeds this, so should be restarted once it has been sampled twice.
+  options.max_rss = 1;
+  options.pressure_threshold = 0.0;
+  harness.RunOnIoThread([&] {
+    EXPECT_THROW(harness.process_manager().EnableMemoryWatchdog(options), maidsafe_error);
+    harness.process_manager().EnableResourceSampling(std::chrono::milliseconds(50));
+    MemoryWatchdogOptions invalid_options;
+    invalid_options.pressure_threshold = 101.0;
+    EXPECT_THROW(harness.process_manager().EnableMemoryWatchdog(invalid_options),
+                 maidsafe_error);
+    harness.process_manager().EnableMemoryWatchdog(options);
+    harness.process_manager().SetOnRestartHistoryChanged([&] { ++history_changes; });
+  });
+  ASSERT_TRUE(harness.AddVaults(2, 2));
+
+  // The restarts are orderly, so aren't recorded as exits, and don't lead to quarantine.
+  std::map<NonEmptyString, size_t> required_starts;
+  for (const auto& vault : harness.Started())
+    required_starts[vault.first] = kCrashLoopThreshold + 1;
+  EXPECT_TRUE(harness.WaitForStarts(required_starts, std::chrono::seconds(60)));
+  EXPECT_EQ(0, history_changes.load());
+}
+
+TEST(ProcessManagerTest, FUNC_Placement) {
+  cpu_set_t allowed;
+  CPU_ZERO(&allowed);
+  ASSERT_EQ(0, sched_getaffinity(0, sizeof(allowed), &allowed));
+  std::vector<int> cpus;
+  for (int cpu(0); cpu < CPU_SETSIZE && cpus.size() < 2U; ++cpu) {
+    if (CPU_ISSET(cpu, &allowed))
+      cpus.push_back(cpu);
+  }
+  if (cpus.size() < 2U) {
+    LOG(kWarning) << "Skipping test since it needs at least two CPUs.";
+    return;
+  }
+  auto get_cpu([](ProcessId process_id) {
+    cpu_set_t cpu_set;
+    CPU_ZERO(&cpu_set);
+    EXPECT_EQ(0, sched_getaffinity(static_cast<pid_t>(process_id), sizeof(cpu_set), &cpu_set));
+    EXPECT_EQ(1, CPU_COUNT(&cpu_set));
+    for (int cpu(0); cpu < CPU_SETSIZE; ++cpu) {
+      if (CPU_ISSET(cpu, &cpu_set))
+        return cpu;
+    }
+    return -1;
+  });
+
+  // Pretend each of the two CPUs is a NUMA node of its own.
+  VaultHarness harness{ ExitDetection::kPidfd };
+  harness.RunOnIoThread([&] {
+    harness.process_manager().EnablePlacement(PlacementPolicy::kSpreadCores,
+        Topology{ NumaNode{ 0, { cpus[0] } }, NumaNode{ 1, { cpus[1] } } });
+  });
+  ASSERT_TRUE(harness.AddVaults(3, 3));
+  std::vector<NonEmptyString> on_first_cpu;
+  NonEmptyString on_second_cpu;
+  for (const auto& vault : harness.Started()) {
+    if (get_cpu(vault.second.back().process_id) == cpus[0])
+      on_first_cpu.push_back(vault.first);
+    else
+      on_second_cpu = vault.first;
+  }
+  ASSERT_EQ(2U, on_first_cpu.size());
+  ASSERT_TRUE(on_second_cpu.IsInitialised());
+
+  // Killing the vault on the second CPU moves one of the others there.
+  std::map<NonEmptyString, size_t> required_starts;
+  required_starts[on_second_cpu] = 2;
+  EXPECT_EQ(0, kill(static_cast<pid_t>(harness.Started()[on_second_cpu].back().process_id),
+                    SIGKILL));
+  ASSERT_TRUE(harness.WaitForStarts(required_starts));
+  auto started(harness.Started());
+  EXPECT_NE(get_cpu(started[on_first_cpu[0]].back().process_id),
+            get_cpu(started[on_first_cpu[1]].back().process_id));
+}
+
+TEST(ProcessManagerTest, FUNC_SchedulingClass) {
+  auto is_batch([](ProcessId process_id) {
+    errno = 0;
+    return sched_getscheduler(static_cast<pid_t>(process_id)) == SCHED_BATCH &&
+           getpriority(PRIO_PROCESS, static_cast<id_t>(process_id)) == 10 && errno == 0;
+  });
+  VaultHarness harness{ ExitDetection::kPidfd };
+  std::vector<VaultInfo> vault_infos(harness.CreateVaultInfos(2));
+  vault_infos[0].scheduling_class = SchedulingClass::kBatch;
+  harness.RunOnIoThread([&] {
+    harness.process_manager().AddProcess(vault_infos[0]);
+    harness.process_manager().AddProcess(vault_infos[1]);
+  });
+  std::map<NonEmptyString, size_t> required_starts;
+  required_starts[vault_infos[0].label] = 1;
+  required_starts[vault_infos[1].label] = 1;
+  ASSERT_TRUE(harness.WaitForStarts(required_starts));
+  auto started(harness.Started());
+  EXPECT_TRUE(is_batch(started[vault_infos[0].label].back().process_id));
+  EXPECT_FALSE(is_batch(started[vault_infos[1].label].back().process_id));
+
+  // Lowering a running vault's priority is always permitted.
+  harness.RunOnIoThread([&] {
+    EXPECT_TRUE(harness.process_manager().SetSchedulingClass(vault_infos[1].label,
+                                                             SchedulingClass::kBatch));
+    EXPECT_EQ(SchedulingClass::kBatch,
+              harness.process_manager().Find(vault_infos[1].label).scheduling_class);
+    EXPECT_THROW(harness.process_manager().SetSchedulingClass(GenerateLabel(),
+                                                              SchedulingClass::kBatch),
+                 maidsafe_error);
+  });
+  EXPECT_TRUE(is_batch(started[vault_infos[1].label].back().process_id));
+}
+
+TEST(ProcessManagerTest, FUNC_LaunchProfile) {
+  LaunchProfile profile;
+  profile.environment["MAIDSAFE_LAUNCH_PROFILE_TEST"] = "applied";
+  profile.max_open_files = 200;
+  std::map<std::string, LaunchProfile> profiles;
+  profiles["test"] = profile;
+  VaultHarness harness{ ExitDetection::kPidfd };
+  std::vector<VaultInfo> vault_infos(harness.CreateVaultInfos(2));
+  vault_infos[0].launch_profile = "test";
+  // An unknown profile is ignored, rather than stopping the vault from starting.
+  vault_infos[1].launch_profile = "unknown";
+  harness.RunOnIoThread([&] {
+    harness.process_manager().SetLaunchProfiles(profiles);
+    EXPECT_TRUE(harness.process_manager().HasLaunchProfile("test"));
+    EXPECT_FALSE(harness.process_manager().HasLaunchProfile("unknown"));
+    harness.process_manager().AddProcess(vault_infos[0]);
+    harness.process_manager().AddProcess(vault_infos[1]);
+  });
+  std::map<NonEmptyString, size_t> required_starts;
+  required_starts[vault_infos[0].label] = 1;
+  required_starts[vault_infos[1].label] = 1;
+  ASSERT_TRUE(harness.WaitForStarts(required_starts));
+
+  auto started(harness.Started());
+  auto check_profile([&](const NonEmptyString& label, bool applied) {
+    const pid_t kProcessId(static_cast<pid_t>(started[label].back().process_id));
+    std::string environment(
+        ReadFile(fs::path("/proc") / std::to_string(kProcessId) / "environ").string());
+    EXPECT_EQ(applied, environment.find("MAIDSAFE_LAUNCH_PROFILE_TEST=applied") !=
+                       std::string::npos);
+    rlimit open_files;
+    ASSERT_EQ(0, prlimit(kProcessId, RLIMIT_NOFILE, nullptr, &open_files));
+    EXPECT_EQ(applied, open_files.rlim_cur == 200U);
+  });
+  check_profile(vault_infos[0].label, true);
+  check_profile(vault_infos[1].label, false);
+}
+
+TEST(ProcessManagerTest, FUNC_DescriptorInheritance) {
+  std::shared_ptr<fs::path> test_root{
+      maidsafe::test::CreateTestPath("MaidSafe_TestProcessManager") };
+  // Opened without O_CLOEXEC, so only the spawn backend can stop the vaults inheriting these.
+  const fs::path kLeakedPath(*test_root / "leaked"), kAllowedPath(*test_root / "allowed");
+  int leaked_fd(open(kLeakedPath.c_str(), O_CREAT | O_RDWR, 0600));
+  int allowed_fd(open(kAllowedPath.c_str(), O_CREAT | O_RDWR, 0600));
+  ASSERT_NE(-1, leaked_fd);
+  ASSERT_NE(-1, allowed_fd);
+  on_scope_exit close_fds{ [&] {
+    close(leaked_fd);
+    close(allowed_fd);
+  } };
+
+  VaultHarness harness{ ExitDetection::kPidfd, SpawnMethod::kPosixSpawn };
+  harness.RunOnIoThread([&] { harness.process_manager().AllowInheritance(allowed_fd); });
+  ASSERT_TRUE(harness.AddVaults(1, 1));
+  ProcessId process_id(harness.Started().begin()->second.back().process_id);
+
+  bool has_leaked_fd(false), has_allowed_fd(false);
+  fs::path fd_dir{ "/proc/" + std::to_string(process_id) + "/fd" };
+  for (fs::directory_iterator itr(fd_dir); itr != fs::directory_iterator(); ++itr) {
+    boost::system::error_code error_code;
+    fs::path target(fs::read_symlink(itr->path(), error_code));
+    if (error_code)
+      continue;
+    has_leaked_fd |= (target == fs::canonical(kLeakedPath));
+    has_allowed_fd |= (target == fs::canonical(kAllowedPath));
+  }
+  EXPECT_FALSE(has_leaked_fd);
+  EXPECT_TRUE(has_allowed_fd);
+}
+
+TEST(ProcessManagerTest, FUNC_MemoryFootprint) {
+  // The dummy vaults are idle, so this compares the cost of hosting each vault rather than of the
+  // work a real vault does.  RSS counts a process's shared libraries in full, so overstates the
+  // cost of a separate process somewhat.
+  const int kVaultCount(20);
+  ResourceReader reader;
+  ResourceSample sample;
+  uint64_t separate_rss(0);
+  {
+    VaultHarness harness{ ExitDetection::kPidfd };
+    ASSERT_TRUE(harness.AddVaults(kVaultCount, 10));
+    for (const auto& vault : harness.Started()) {
+      ASSERT_TRUE(reader.Read(vault.second.back().process_id, sample));
+      separate_rss += sample.rss;
+    }
+  }
+
+  uint64_t in_process_rss(0);
+  {
+    VaultHarness harness{ ExitDetection::kPidfd };
+    harness.EnableInProcessHosting();
+    std::vector<VaultInfo> vault_infos(harness.CreateVaultInfos(kVaultCount));
+    for (auto& vault_info : vault_infos)
+      vault_info.in_process = true;
+    ASSERT_TRUE(harness.AddVaults(vault_infos, 10));
+    // The whole of the host's RSS, including what it would need for a single vault.
+    ASSERT_TRUE(reader.Read(harness.HostProcessId(), sample));
+    in_process_rss = sample.rss;
+    for (const auto& vault : harness.Started())
+      EXPECT_TRUE(InProcessHost::IsInstanceId(vault.second.back().process_id));
+  }
+
+  const double kSeparatePerVault(static_cast<double>(separate_rss) / (kVaultCount * 1024));
+  const double kInProcessPerVault(static_cast<double>(in_process_rss) / (kVaultCount * 1024));
+  TLOG(kDefaultColour) << "Memory per idle vault: " << kSeparatePerVault
+                       << " KiB as a separate process, " << kInProcessPerVault
+                       << " KiB in-process\n";
+  EXPECT_LT(kInProcessPerVault, kSeparatePerVault);
+}
+#endif
+#endif
+
 }  // namespace test
 
 }  // namespace vault_manager
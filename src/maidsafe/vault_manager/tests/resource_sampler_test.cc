@@ -0,0 +1,187 @@
+/*  Copyright 2014 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include "maidsafe/vault_manager/resource_sampler.h"
+
+#ifdef MAIDSAFE_LINUX
+#include <signal.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+#include <chrono>
+#include <vector>
+
+#include "maidsafe/common/log.h"
+#include "maidsafe/common/test.h"
+
+#include "maidsafe/vault_manager/config.h"
+
+namespace maidsafe {
+
+namespace vault_manager {
+
+namespace test {
+
+TEST(ResourceSamplerTest, BEH_RingBuffer) {
+  RingBuffer<int> empty;
+  empty.Push(1);
+  EXPECT_EQ(0U, empty.Size());
+  EXPECT_TRUE(empty.Contents().empty());
+
+  RingBuffer<int> ring(3);
+  EXPECT_EQ(3U, ring.Capacity());
+  EXPECT_TRUE(ring.Contents().empty());
+  ring.Push(1);
+  ring.Push(2);
+  EXPECT_EQ(std::vector<int>({ 1, 2 }), ring.Contents());
+  ring.Push(3);
+  ring.Push(4);
+  ring.Push(5);
+  EXPECT_EQ(3U, ring.Size());
+  EXPECT_EQ(std::vector<int>({ 3, 4, 5 }), ring.Contents());
+}
+
+TEST(ResourceSamplerTest, BEH_ParseProcFiles) {
+  ResourceSample sample;
+  // The executable name can contain spaces and parentheses, and tpgid is -1 without a terminal.
+  EXPECT_TRUE(ParseProcStat("1234 (a) b (c)) S 1 1234 1234 0 -1 4194560 2500 0 0 0 250 50 0 0 20 "
+                            "0 4 0 12345 123456789 2000 18446744073709551615", 100, sample));
+  EXPECT_EQ(3000, sample.cpu_time.count());
+  EXPECT_FALSE(ParseProcStat("1234 (a) S 1 2 3", 100, sample));
+  EXPECT_FALSE(ParseProcStat("garbage", 100, sample));
+
+  uint64_t start_time(0);
+  EXPECT_TRUE(ParseProcStartTime("1234 (a) b (c)) S 1 1234 1234 0 -1 4194560 2500 0 0 0 250 50 0 "
+                                 "0 20 0 4 0 12345 123456789 2000", start_time));
+  EXPECT_EQ(12345U, start_time);
+  EXPECT_FALSE(ParseProcStartTime("1234 (a) Z 1 1234 1234 0 -1 4194560 2500 0 0 0 250 50 0 0 20 "
+                                  "0 4 0 12345 123456789 2000", start_time));
+  EXPECT_FALSE(ParseProcStartTime("1234 (a) S 1 2 3", start_time));
+  EXPECT_FALSE(ParseProcStartTime("garbage", start_time));
+
+  EXPECT_TRUE(ParseProcStatus("Name:\tvault\nState:\tS (sleeping)\nVmHWM:\t    9000 kB\n"
+                              "VmRSS:\t    8000 kB\nRssAnon:\t    4000 kB\nThreads:\t7\n", sample));
+  EXPECT_EQ(8000U * 1024, sample.rss);
+  EXPECT_EQ(7U, sample.threads);
+  EXPECT_TRUE(ParseProcStatus("Name:\tkthreadd\nThreads:\t1\n", sample));
+  EXPECT_EQ(0U, sample.rss);
+  EXPECT_FALSE(ParseProcStatus("Name:\tvault\n", sample));
+
+  EXPECT_TRUE(ParseProcIo("rchar: 100\nwchar: 200\nsyscr: 3\nsyscw: 4\nread_bytes: 4096\n"
+                          "write_bytes: 8192\ncancelled_write_bytes: 1024\n", sample));
+  EXPECT_EQ(4096U, sample.read_bytes);
+  EXPECT_EQ(8192U, sample.write_bytes);
+  EXPECT_FALSE(ParseProcIo("rchar: 100\nwchar: 200\n", sample));
+
+  MemoryPressure pressure;
+  EXPECT_TRUE(ParseMemoryPressure("some avg10=12.50 avg60=3.20 avg300=0.80 total=1234567\n"
+                                  "full avg10=4.25 avg60=1.00 avg300=0.25 total=456789\n",
+                                  pressure));
+  EXPECT_DOUBLE_EQ(12.5, pressure.some_avg10);
+  EXPECT_DOUBLE_EQ(4.25, pressure.full_avg10);
+  EXPECT_FALSE(ParseMemoryPressure("some avg10=12.50 avg60=3.20 avg300=0.80 total=1234567\n",
+                                   pressure));
+  EXPECT_FALSE(ParseMemoryPressure("garbage", pressure));
+}
+
+#ifdef MAIDSAFE_LINUX
+TEST(ResourceSamplerTest, FUNC_ReadOwnProcess) {
+  ResourceReader reader;
+  ResourceSample sample;
+  ASSERT_TRUE(reader.Read(static_cast<uint64_t>(getpid()), sample));
+  EXPECT_GT(sample.rss, 0U);
+  EXPECT_GT(sample.threads, 0U);
+  EXPECT_GT(sample.file_descriptors, 2U);
+  EXPECT_TRUE(sample.time <= std::chrono::steady_clock::now());
+  // Beyond the kernel's maximum PID.
+  EXPECT_FALSE(reader.Read(1U << 23, sample));
+
+  const uint64_t kStartTime(reader.ReadStartTime(static_cast<uint64_t>(getpid())));
+  EXPECT_NE(0U, kStartTime);
+  EXPECT_EQ(kStartTime, reader.ReadStartTime(static_cast<uint64_t>(getpid())));
+  EXPECT_EQ(0U, reader.ReadStartTime(1U << 23));
+
+  // Pressure stall information may not be available.
+  MemoryPressure pressure;
+  if (reader.ReadMemoryPressure(pressure)) {
+    EXPECT_LE(pressure.full_avg10, pressure.some_avg10);
+    EXPECT_LE(pressure.some_avg10, 100.0);
+  }
+}
+
+TEST(ResourceSamplerTest, FUNC_SamplingCostAt1000Vaults) {
+  // Idle child processes stand in for the vaults, since it's the /proc reads which are measured.
+  const int kVaultCount(1000);
+  std::vector<pid_t> children;
+  for (int i(0); i < kVaultCount; ++i) {
+    pid_t child(fork());
+    if (child == 0) {
+      pause();
+      _exit(0);
+    }
+    if (child == -1) {
+      LOG(kWarning) << "Only managed to start " << children.size() << " processes.";
+      break;
+    }
+    children.push_back(child);
+  }
+  ASSERT_FALSE(children.empty());
+
+  ResourceReader reader;
+  std::vector<RingBuffer<ResourceSample>> histories(
+      children.size(), RingBuffer<ResourceSample>(kResourceHistorySize));
+  const int kPasses(5);
+  size_t sampled(0);
+  ResourceSample sample;
+  auto start(std::chrono::steady_clock::now());
+  for (int pass(0); pass < kPasses; ++pass) {
+    for (size_t i(0); i < children.size(); ++i) {
+      if (reader.Read(static_cast<uint64_t>(children[i]), sample)) {
+        histories[i].Push(sample);
+        ++sampled;
+      }
+    }
+  }
+  auto per_pass(std::chrono::duration_cast<std::chrono::microseconds>(
+      std::chrono::steady_clock::now() - start) / kPasses);
+
+  for (pid_t child : children) {
+    kill(child, SIGKILL);
+    waitpid(child, nullptr, 0);
+  }
+
+  EXPECT_EQ(kPasses * children.size(), sampled);
+  const double kShareOfInterval(static_cast<double>(per_pass.count()) /
+      std::chrono::duration_cast<std::chrono::microseconds>(kResourceSampleInterval).count());
+  TLOG(kDefaultColour) << "Sampling " << children.size() << " processes takes "
+                       << per_pass.count() << " us per pass ("
+                       << static_cast<double>(per_pass.count()) / children.size()
+                       << " us per process), " << 100.0 * kShareOfInterval
+                       << "% of the default sampling interval\n";
+  // Allow generous headroom for noisy test machines.
+  EXPECT_LT(kShareOfInterval, 0.1);
+}
+#endif
+
+}  // namespace test
+
+}  // namespace vault_manager
+
+}  // namespace maidsafe
@@ -0,0 +1,160 @@
+/*  Copyright 2014 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include "maidsafe/vault_manager/restart_scheduler.h"
+
+#include <algorithm>
+#include <chrono>
+
+#include "maidsafe/common/test.h"
+
+#include "maidsafe/vault_manager/config.h"
+#include "maidsafe/vault_manager/vault_info.h"
+
+namespace maidsafe {
+
+namespace vault_manager {
+
+namespace test {
+
+TEST(RestartSchedulerTest, BEH_BackoffDelay) {
+  EXPECT_EQ(0, BackoffDelay(0).count());
+  EXPECT_EQ(0, BackoffDelay(1).count());
+  std::chrono::milliseconds expected{ kRestartBackoffBase };
+  for (int failure_count(2); failure_count < 30; ++failure_count) {
+    for (int i(0); i < 20; ++i) {
+      std::chrono::milliseconds delay{ BackoffDelay(failure_count) };
+      EXPECT_GE(delay, expected / 2) << failure_count;
+      EXPECT_LE(delay, expected) << failure_count;
+    }
+    expected = std::min(expected * 2, kRestartBackoffCeiling);
+  }
+}
+
+TEST(RestartSchedulerTest, BEH_DecayAfterStableUptime) {
+  RestartHistory history;
+  auto now(std::chrono::system_clock::now());
+  const std::chrono::seconds kShortUptime(1);
+  for (int i(1); i < kCrashLoopThreshold; ++i) {
+    RestartDecision decision{ RecordUnexpectedExit(history, kShortUptime, now) };
+    EXPECT_FALSE(decision.quarantined);
+    EXPECT_EQ(i, history.failure_count);
+    // Spread the exits out so they don't count as a crash loop.
+    now += kCrashLoopWindow;
+  }
+
+  // Two decay periods of uptime forgive two failures before counting the new one.
+  const int kFailuresBefore(history.failure_count);
+  RestartDecision decision{ RecordUnexpectedExit(history, 2 * kRestartDecayPeriod, now) };
+  EXPECT_FALSE(decision.quarantined);
+  EXPECT_EQ(kFailuresBefore - 1, history.failure_count);
+
+  // A long uptime clears the history entirely.
+  now += kCrashLoopWindow;
+  decision = RecordUnexpectedExit(history, 100 * kRestartDecayPeriod, now);
+  EXPECT_FALSE(decision.quarantined);
+  EXPECT_EQ(1, history.failure_count);
+  EXPECT_EQ(0, decision.delay.count());
+}
+
+TEST(RestartSchedulerTest, BEH_CrashLoopQuarantine) {
+  RestartHistory history;
+  auto now(std::chrono::system_clock::now());
+  for (int i(1); i < kCrashLoopThreshold; ++i) {
+    EXPECT_FALSE(RecordUnexpectedExit(history, std::chrono::seconds(1), now).quarantined);
+    now += std::chrono::seconds(1);
+  }
+  EXPECT_EQ(0, QuarantineRemaining(history, now).count());
+
+  RestartDecision decision{ RecordUnexpectedExit(history, std::chrono::seconds(1), now) };
+  EXPECT_TRUE(decision.quarantined);
+  EXPECT_EQ(std::chrono::duration_cast<std::chrono::milliseconds>(kQuarantineDuration),
+            decision.delay);
+  EXPECT_EQ(decision.delay, QuarantineRemaining(history, now));
+  EXPECT_TRUE(history.recent_exits.empty());
+  EXPECT_EQ(0, QuarantineRemaining(history, now + kQuarantineDuration).count());
+
+  // Old exits fall out of the window, so a slow trickle of failures never quarantines.
+  RestartHistory slow_history;
+  now = std::chrono::system_clock::now();
+  for (int i(0); i < 3 * kCrashLoopThreshold; ++i) {
+    EXPECT_FALSE(RecordUnexpectedExit(slow_history, std::chrono::seconds(1), now).quarantined);
+    now += kCrashLoopWindow / (kCrashLoopThreshold - 2);
+  }
+  EXPECT_LT(static_cast<int>(slow_history.recent_exits.size()), kCrashLoopThreshold);
+}
+
+TEST(RestartSchedulerTest, BEH_GiveUpAfterConsecutiveBadConfigs) {
+  RestartHistory history;
+  auto now(std::chrono::system_clock::now());
+  for (int i(1); i < kMaxConsecutiveBadConfigs; ++i) {
+    EXPECT_FALSE(RecordUnexpectedExit(history, std::chrono::seconds(1), now, true).give_up);
+    now += kCrashLoopWindow;
+  }
+  // Any other exit in between breaks the run.
+  EXPECT_FALSE(RecordUnexpectedExit(history, std::chrono::seconds(1), now, false).give_up);
+  EXPECT_EQ(0, history.consecutive_bad_configs);
+  for (int i(1); i < kMaxConsecutiveBadConfigs; ++i) {
+    now += kCrashLoopWindow;
+    EXPECT_FALSE(RecordUnexpectedExit(history, std::chrono::seconds(1), now, true).give_up);
+  }
+  EXPECT_FALSE(history.failed);
+
+  now += kCrashLoopWindow;
+  RestartDecision decision{ RecordUnexpectedExit(history, std::chrono::seconds(1), now, true) };
+  EXPECT_TRUE(decision.give_up);
+  EXPECT_FALSE(decision.quarantined);
+  EXPECT_TRUE(history.failed);
+}
+
+TEST(RestartSchedulerTest, BEH_GiveUpAfterConsecutiveQuarantines) {
+  RestartHistory history;
+  auto now(std::chrono::system_clock::now());
+  auto crash_loop([&]()->RestartDecision {
+    for (int i(1); i < kCrashLoopThreshold; ++i) {
+      EXPECT_FALSE(RecordUnexpectedExit(history, std::chrono::seconds(1), now).quarantined);
+      now += std::chrono::seconds(1);
+    }
+    RestartDecision decision{ RecordUnexpectedExit(history, std::chrono::seconds(1), now) };
+    now += kQuarantineDuration;
+    return decision;
+  });
+
+  for (int i(1); i <= kMaxConsecutiveQuarantines; ++i) {
+    RestartDecision decision{ crash_loop() };
+    EXPECT_TRUE(decision.quarantined);
+    EXPECT_FALSE(decision.give_up);
+    EXPECT_EQ(i, history.consecutive_quarantines);
+  }
+
+  // A decay period of stable uptime forgives the earlier quarantines.
+  RestartHistory forgiven_history(history);
+  RecordUnexpectedExit(forgiven_history, kRestartDecayPeriod, now);
+  EXPECT_EQ(0, forgiven_history.consecutive_quarantines);
+
+  RestartDecision decision{ crash_loop() };
+  EXPECT_TRUE(decision.give_up);
+  EXPECT_FALSE(decision.quarantined);
+  EXPECT_TRUE(history.failed);
+}
+
+}  // namespace test
+
+}  // namespace vault_manager
+
+}  // namespace maidsafe
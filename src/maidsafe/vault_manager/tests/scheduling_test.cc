@@ -0,0 +1,93 @@
+/*  Copyright 2014 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+
+#include "maidsafe/vault_manager/scheduling.h"
+
+#ifdef MAIDSAFE_LINUX
+#include <sched.h>
+#include <signal.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+#include <cerrno>
+
+#include "maidsafe/common/test.h"
+
+namespace maidsafe {
+
+namespace vault_manager {
+
+namespace test {
+
+TEST(SchedulingTest, BEH_ParseSchedulingClass) {
+  EXPECT_EQ(SchedulingClass::kNormal, ParseSchedulingClass(0));
+  EXPECT_EQ(SchedulingClass::kInteractive, ParseSchedulingClass(1));
+  EXPECT_EQ(SchedulingClass::kBatch, ParseSchedulingClass(2));
+  EXPECT_THROW(ParseSchedulingClass(-1), maidsafe_error);
+  EXPECT_THROW(ParseSchedulingClass(3), maidsafe_error);
+
+  // Interactive vaults are favoured over Normal ones, and Normal over Batch.
+  const SchedulingParameters kInteractive(GetSchedulingParameters(SchedulingClass::kInteractive));
+  const SchedulingParameters kNormal(GetSchedulingParameters(SchedulingClass::kNormal));
+  const SchedulingParameters kBatch(GetSchedulingParameters(SchedulingClass::kBatch));
+  EXPECT_LT(kInteractive.nice, kNormal.nice);
+  EXPECT_LT(kNormal.nice, kBatch.nice);
+  EXPECT_GT(kBatch.io_priority, kInteractive.io_priority);
+  EXPECT_TRUE(kBatch.batch);
+  EXPECT_FALSE(kNormal.batch);
+}
+
+#ifdef MAIDSAFE_LINUX
+TEST(SchedulingTest, FUNC_ApplyToProcess) {
+  pid_t child(fork());
+  if (child == 0) {
+    pause();
+    _exit(0);
+  }
+  ASSERT_GT(child, 0);
+
+  EXPECT_TRUE(ApplySchedulingClass(static_cast<uint64_t>(child), SchedulingClass::kBatch));
+  EXPECT_EQ(SCHED_BATCH, sched_getscheduler(child));
+  errno = 0;
+  EXPECT_EQ(10, getpriority(PRIO_PROCESS, static_cast<id_t>(child)));
+  EXPECT_EQ(0, errno);
+  // Best-effort class (2) at the lowest priority (7).
+  EXPECT_EQ((2 << 13) | 7, syscall(SYS_ioprio_get, 1, child));
+
+  // Raising the priority again needs CAP_SYS_NICE.
+  if (geteuid() == 0) {
+    EXPECT_TRUE(ApplySchedulingClass(static_cast<uint64_t>(child), SchedulingClass::kNormal));
+    EXPECT_EQ(SCHED_OTHER, sched_getscheduler(child));
+    EXPECT_EQ(0, getpriority(PRIO_PROCESS, static_cast<id_t>(child)));
+  }
+
+  kill(child, SIGKILL);
+  waitpid(child, nullptr, 0);
+}
+#endif
+
+}  // namespace test
+
+}  // namespace vault_manager
+
+}  // namespace maidsafe
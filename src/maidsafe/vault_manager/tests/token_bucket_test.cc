@@ -0,0 +1,73 @@
+/*  Copyright 2014 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+#include "maidsafe/vault_manager/token_bucket.h"
+
+#include <chrono>
+
+#include "maidsafe/common/error.h"
+#include "maidsafe/common/test.h"
+
+namespace maidsafe {
+
+namespace vault_manager {
+
+namespace test {
+
+TEST(TokenBucketTest, BEH_BurstThenRefill) {
+  const std::chrono::steady_clock::time_point kStart(std::chrono::steady_clock::now());
+  const std::chrono::milliseconds kInterval(100);
+  TokenBucket bucket(3, kInterval, kStart);
+  EXPECT_EQ(3U, bucket.Available(kStart));
+
+  // The whole burst is available at once, after which the bucket is empty.
+  for (int i(0); i < 3; ++i)
+    EXPECT_TRUE(bucket.TryTake(kStart));
+  EXPECT_FALSE(bucket.TryTake(kStart));
+  EXPECT_EQ(0U, bucket.Available(kStart));
+  EXPECT_TRUE(bucket.TimeUntilAvailable(kStart) == kInterval);
+  EXPECT_TRUE(bucket.TimeUntilAvailable(kStart + kInterval / 4) == kInterval * 3 / 4);
+
+  // One token per interval, keeping any partial interval.
+  EXPECT_FALSE(bucket.TryTake(kStart + kInterval / 2));
+  EXPECT_TRUE(bucket.TryTake(kStart + kInterval * 3 / 2));
+  EXPECT_FALSE(bucket.TryTake(kStart + kInterval * 3 / 2));
+  EXPECT_TRUE(bucket.TimeUntilAvailable(kStart + kInterval * 3 / 2) == kInterval / 2);
+  EXPECT_TRUE(bucket.TryTake(kStart + kInterval * 2));
+  EXPECT_TRUE(bucket.TimeUntilAvailable(kStart + kInterval * 4).count() == 0);
+
+  // The bucket never holds more than the burst, however long it's idle.
+  const std::chrono::steady_clock::time_point kLater(kStart + kInterval * 100);
+  EXPECT_EQ(3U, bucket.Available(kLater));
+  for (int i(0); i < 3; ++i)
+    EXPECT_TRUE(bucket.TryTake(kLater));
+  EXPECT_FALSE(bucket.TryTake(kLater));
+  EXPECT_EQ(1U, bucket.Available(kLater + kInterval));
+}
+
+TEST(TokenBucketTest, BEH_InvalidParameters) {
+  const std::chrono::steady_clock::time_point kNow(std::chrono::steady_clock::now());
+  EXPECT_THROW(TokenBucket(0, std::chrono::seconds(1), kNow), maidsafe_error);
+  EXPECT_THROW(TokenBucket(1, std::chrono::seconds(0), kNow), maidsafe_error);
+  EXPECT_THROW(TokenBucket(1, std::chrono::seconds(-1), kNow), maidsafe_error);
+}
+
+}  // namespace test
+
+}  // namespace vault_manager
+
+}  // namespace maidsafe
@@ -18,13 +18,18 @@
 
 #include "maidsafe/vault_manager/utils.h"
 
+#include <chrono>
+#include <memory>
 #include <utility>
 
 #include "maidsafe/common/test.h"
 #include "maidsafe/common/utils.h"
+#include "maidsafe/passport/passport.h"
 
 #include "maidsafe/vault_manager/config.h"
 #include "maidsafe/vault_manager/interprocess_messages.pb.h"
+#include "maidsafe/vault_manager/vault_info.h"
+#include "maidsafe/vault_manager/vault_info.pb.h"
 
 namespace maidsafe {
 
@@ -59,6 +64,92 @@ TEST(UtilsTest, BEH_WrapAndUnwrapMessage) {
   EXPECT_EQ(kPlainText, ParseProto<protobuf::Challenge>(message_and_type.first).plaintext());
 }
 
+TEST(UtilsTest, BEH_RestartHistoryRoundTrip) {
+  const crypto::AES256Key kSymmKey{ RandomString(crypto::AES256_KeySize) };
+  const crypto::AES256InitialisationVector kSymmIv{ RandomString(crypto::AES256_IVSize) };
+  VaultInfo vault_info;
+  vault_info.pmid_and_signer =
+      std::make_shared<passport::PmidAndSigner>(passport::CreatePmidAndSigner());
+  vault_info.vault_dir = "vault_dir";
+  vault_info.label = GenerateLabel();
+
+  // An empty history isn't written.
+  protobuf::VaultInfo protobuf_vault_info;
+  ToProtobuf(kSymmKey, kSymmIv, vault_info, &protobuf_vault_info);
+  EXPECT_FALSE(protobuf_vault_info.has_restart_history());
+
+  // Times are only persisted to millisecond precision.
+  std::chrono::system_clock::time_point now{ std::chrono::system_clock::time_point{} +
+      std::chrono::duration_cast<std::chrono::milliseconds>(
+          std::chrono::system_clock::now().time_since_epoch()) };
+  vault_info.restart_history.failure_count = 3;
+  vault_info.restart_history.recent_exits.push_back(now - std::chrono::seconds(5));
+  vault_info.restart_history.recent_exits.push_back(now);
+  vault_info.restart_history.quarantined_until = now + std::chrono::hours(1);
+  vault_info.restart_history.consecutive_bad_configs = 1;
+  vault_info.restart_history.consecutive_quarantines = 2;
+  ToProtobuf(kSymmKey, kSymmIv, vault_info, &protobuf_vault_info);
+  ASSERT_TRUE(protobuf_vault_info.has_restart_history());
+
+  VaultInfo parsed;
+  FromProtobuf(kSymmKey, kSymmIv, protobuf_vault_info, parsed);
+  EXPECT_EQ(3, parsed.restart_history.failure_count);
+  EXPECT_TRUE(vault_info.restart_history.recent_exits == parsed.restart_history.recent_exits);
+  EXPECT_TRUE(vault_info.restart_history.quarantined_until ==
+              parsed.restart_history.quarantined_until);
+  EXPECT_EQ(1, parsed.restart_history.consecutive_bad_configs);
+  EXPECT_EQ(2, parsed.restart_history.consecutive_quarantines);
+  EXPECT_FALSE(parsed.restart_history.failed);
+
+  // A failure alone is enough for the history to be written.
+  VaultInfo failed_vault_info(vault_info);
+  failed_vault_info.restart_history = RestartHistory();
+  failed_vault_info.restart_history.failed = true;
+  protobuf::VaultInfo protobuf_failed_vault_info;
+  ToProtobuf(kSymmKey, kSymmIv, failed_vault_info, &protobuf_failed_vault_info);
+  ASSERT_TRUE(protobuf_failed_vault_info.has_restart_history());
+  FromProtobuf(kSymmKey, kSymmIv, protobuf_failed_vault_info, parsed);
+  EXPECT_TRUE(parsed.restart_history.failed);
+}
+
+TEST(UtilsTest, BEH_ResourceLimitsRoundTrip) {
+  const crypto::AES256Key kSymmKey{ RandomString(crypto::AES256_KeySize) };
+  const crypto::AES256InitialisationVector kSymmIv{ RandomString(crypto::AES256_IVSize) };
+  VaultInfo vault_info;
+  vault_info.pmid_and_signer =
+      std::make_shared<passport::PmidAndSigner>(passport::CreatePmidAndSigner());
+  vault_info.vault_dir = "vault_dir";
+  vault_info.label = GenerateLabel();
+
+  // Default limits aren't written.
+  protobuf::VaultInfo protobuf_vault_info;
+  ToProtobuf(kSymmKey, kSymmIv, vault_info, &protobuf_vault_info);
+  EXPECT_FALSE(protobuf_vault_info.has_resource_limits());
+  EXPECT_FALSE(protobuf_vault_info.has_scheduling_class());
+  EXPECT_FALSE(protobuf_vault_info.has_launch_profile());
+
+  vault_info.resource_limits.cpu_weight = 50;
+  vault_info.resource_limits.memory_high = 1 << 30;
+  vault_info.resource_limits.memory_max = 3ULL << 30;
+  vault_info.resource_limits.io_weight = 200;
+  vault_info.scheduling_class = SchedulingClass::kBatch;
+  vault_info.launch_profile = "jemalloc";
+  ToProtobuf(kSymmKey, kSymmIv, vault_info, &protobuf_vault_info);
+  ASSERT_TRUE(protobuf_vault_info.has_resource_limits());
+
+  VaultInfo parsed;
+  FromProtobuf(kSymmKey, kSymmIv, protobuf_vault_info, parsed);
+  EXPECT_EQ(50U, parsed.resource_limits.cpu_weight);
+  EXPECT_EQ(1U << 30, parsed.resource_limits.memory_high);
+  EXPECT_EQ(3ULL << 30, parsed.resource_limits.memory_max);
+  EXPECT_EQ(200U, parsed.resource_limits.io_weight);
+  EXPECT_EQ(SchedulingClass::kBatch, parsed.scheduling_class);
+  EXPECT_EQ("jemalloc", parsed.launch_profile);
+
+  protobuf_vault_info.set_scheduling_class(99);
+  EXPECT_THROW(FromProtobuf(kSymmKey, kSymmIv, protobuf_vault_info, parsed), maidsafe_error);
+}
+
 }  // namespace test
 
 }  // namespace vault_manager
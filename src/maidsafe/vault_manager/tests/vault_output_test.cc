@@ -0,0 +1,170 @@
+/*  Copyright 2014 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+
+#include "maidsafe/vault_manager/vault_output.h"
+
+#ifndef MAIDSAFE_WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#include <chrono>
+#include <functional>
+#include <future>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "boost/filesystem/operations.hpp"
+
+#include "maidsafe/common/asio_service.h"
+#include "maidsafe/common/crypto.h"
+#include "maidsafe/common/test.h"
+#include "maidsafe/common/utils.h"
+
+#include "maidsafe/vault_manager/config.h"
+
+namespace fs = boost::filesystem;
+
+namespace maidsafe {
+
+namespace vault_manager {
+
+namespace test {
+
+#ifndef MAIDSAFE_WIN32
+namespace {
+
+// VaultOutput must only be used on the io_service thread.
+void RunOnService(AsioService& asio_service, const std::function<void()>& functor) {
+  std::promise<void> done;
+  asio_service.service().post([&] {
+    functor();
+    done.set_value();
+  });
+  done.get_future().get();
+}
+
+bool WaitFor(const std::function<bool()>& predicate) {
+  const auto kDeadline(std::chrono::steady_clock::now() + std::chrono::seconds(10));
+  while (!predicate()) {
+    if (std::chrono::steady_clock::now() > kDeadline)
+      return false;
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+  return true;
+}
+
+void WriteToPipe(int write_descriptor, const std::string& data) {
+  ASSERT_EQ(static_cast<ssize_t>(data.size()), write(write_descriptor, data.data(), data.size()));
+}
+
+std::string Decompress(const fs::path& file) {
+  return crypto::Uncompress(crypto::CompressedText{ ReadFile(file) }).data.string();
+}
+
+}  // unnamed namespace
+
+TEST(VaultOutputTest, BEH_RotateAndCompress) {
+  std::shared_ptr<fs::path> test_root{ maidsafe::test::CreateTestPath("MaidSafe_TestVaultOutput") };
+  const fs::path kFile(*test_root / "logs" / kVaultOutputFilename);
+  AsioService asio_service(1);
+  int read_descriptor(-1), write_descriptor(-1);
+  MakeOutputPipe(read_descriptor, write_descriptor);
+  std::shared_ptr<VaultOutput> output{ VaultOutput::MakeShared(asio_service.service(),
+                                                               read_descriptor) };
+  RunOnService(asio_service, [&] { output->Attach(*test_root / "logs", 1000, 2); });
+
+  // Compression runs in the background, and each full file is removed once compressed.
+  auto rotated([&] {
+    boost::system::error_code error_code;
+    if (fs::file_size(kFile, error_code) != 0U)
+      return false;
+    for (fs::directory_iterator itr(kFile.parent_path()); itr != fs::directory_iterator(); ++itr) {
+      if (itr->path().filename().string().find(".segment") != std::string::npos)
+        return false;
+    }
+    return true;
+  });
+
+  // Each chunk fills the file, so each is rotated in turn.  Only the last two are kept.
+  std::vector<std::string> chunks;
+  for (int i(0); i < 4; ++i) {
+    chunks.push_back(RandomAlphaNumericString(1000));
+    WriteToPipe(write_descriptor, chunks.back());
+    EXPECT_TRUE(WaitFor([&] { return output->BytesWritten() == 1000U * (i + 1); }));
+    EXPECT_TRUE(WaitFor(rotated));
+  }
+  close(write_descriptor);
+  output.reset();
+
+  ASSERT_TRUE(fs::exists(kFile.string() + ".1.gz"));
+  ASSERT_TRUE(fs::exists(kFile.string() + ".2.gz"));
+  EXPECT_FALSE(fs::exists(kFile.string() + ".3.gz"));
+  EXPECT_EQ(chunks[3], Decompress(kFile.string() + ".1.gz"));
+  EXPECT_EQ(chunks[2], Decompress(kFile.string() + ".2.gz"));
+  EXPECT_EQ(0U, fs::file_size(kFile));
+}
+
+TEST(VaultOutputTest, BEH_AttachAndRelease) {
+  std::shared_ptr<fs::path> test_root{ maidsafe::test::CreateTestPath("MaidSafe_TestVaultOutput") };
+  const fs::path kFile(*test_root / kVaultOutputFilename);
+  AsioService asio_service(1);
+  int read_descriptor(-1), write_descriptor(-1);
+  MakeOutputPipe(read_descriptor, write_descriptor);
+  std::shared_ptr<VaultOutput> output{ VaultOutput::MakeShared(asio_service.service(),
+                                                               read_descriptor) };
+
+  // Output written before the VaultOutput is attached waits in the pipe.
+  const std::string kFirst(RandomAlphaNumericString(100));
+  WriteToPipe(write_descriptor, kFirst);
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  EXPECT_FALSE(fs::exists(kFile));
+  RunOnService(asio_service, [&] { output->Attach(*test_root, kVaultOutputMaxFileSize, 1); });
+  EXPECT_TRUE(WaitFor([&] { return output->BytesWritten() == kFirst.size(); }));
+  EXPECT_THROW(output->Attach(*test_root, kVaultOutputMaxFileSize, 1), maidsafe_error);
+
+  // A released descriptor survives an exec and can be picked up again, appending to the file.
+  RunOnService(asio_service, [&] { read_descriptor = output->Release(); });
+  ASSERT_NE(-1, read_descriptor);
+  EXPECT_EQ(0, fcntl(read_descriptor, F_GETFD) & FD_CLOEXEC);
+  EXPECT_EQ(-1, output->Release());
+  output = VaultOutput::MakeShared(asio_service.service(), read_descriptor);
+  const std::string kSecond(RandomAlphaNumericString(100));
+  WriteToPipe(write_descriptor, kSecond);
+  RunOnService(asio_service, [&] { output->Attach(*test_root, kVaultOutputMaxFileSize, 1); });
+  EXPECT_TRUE(WaitFor([&] { return output->BytesWritten() == kSecond.size(); }));
+  close(write_descriptor);
+  RunOnService(asio_service, [&] { output->Close(); });
+  EXPECT_EQ(kFirst + kSecond, ReadFile(kFile).string());
+
+  // Anything other than a pipe is rejected.
+  int file_descriptor(open(kFile.c_str(), O_RDONLY));
+  ASSERT_NE(-1, file_descriptor);
+  EXPECT_THROW(VaultOutput::MakeShared(asio_service.service(), file_descriptor), maidsafe_error);
+  close(file_descriptor);
+}
+#endif
+
+}  // namespace test
+
+}  // namespace vault_manager
+
+}  // namespace maidsafe
@@ -0,0 +1,148 @@
+/*  Copyright 2014 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include "maidsafe/vault_manager/vault_registry.h"
+
+#include <chrono>
+#include <string>
+#include <vector>
+
+#include "boost/filesystem/path.hpp"
+
+#include "maidsafe/common/log.h"
+#include "maidsafe/common/test.h"
+#include "maidsafe/common/utils.h"
+
+#include "maidsafe/vault_manager/utils.h"
+
+namespace fs = boost::filesystem;
+
+namespace maidsafe {
+
+namespace vault_manager {
+
+namespace test {
+
+namespace {
+
+struct Keys {
+  Keys()
+      : label(GenerateLabel()),
+        pmid_name(RandomString(64)),
+        vault_dir(RandomAlphaNumericString(16)) {}
+  NonEmptyString label;
+  Identity pmid_name;
+  fs::path vault_dir;
+};
+
+}  // unnamed namespace
+
+TEST(VaultRegistryTest, BEH_InsertFindAndErase) {
+  VaultRegistry<int> registry;
+  std::vector<Keys> keys(10);
+  for (int i(0); i < 10; ++i)
+    EXPECT_EQ(i, registry.Insert(i, keys[i].label, keys[i].pmid_name, keys[i].vault_dir));
+  EXPECT_EQ(10U, registry.Size());
+
+  for (int i(0); i < 10; ++i) {
+    ASSERT_TRUE(registry.Find(keys[i].label) != nullptr);
+    EXPECT_EQ(i, *registry.Find(keys[i].label));
+    EXPECT_TRUE(registry.Find(static_cast<process::ProcessId>(i + 1000)) == nullptr);
+    registry.SetProcessId(keys[i].label, i + 1000);
+    ASSERT_TRUE(registry.Find(static_cast<process::ProcessId>(i + 1000)) != nullptr);
+    EXPECT_EQ(i, *registry.Find(static_cast<process::ProcessId>(i + 1000)));
+  }
+
+  // Re-registering a process ID for a different vault must fail.
+  EXPECT_THROW(registry.SetProcessId(keys[0].label, 1001), maidsafe_error);
+  EXPECT_EQ(0, *registry.Find(static_cast<process::ProcessId>(1000)));
+  EXPECT_THROW(registry.SetProcessId(GenerateLabel(), 2000), maidsafe_error);
+
+  // Erased slots are reused without disturbing the remaining values.
+  registry.Erase(keys[3].label);
+  EXPECT_TRUE(registry.Find(keys[3].label) == nullptr);
+  EXPECT_TRUE(registry.Find(static_cast<process::ProcessId>(1003)) == nullptr);
+  EXPECT_EQ(9U, registry.Size());
+  const int* const kFourth(registry.Find(keys[4].label));
+  Keys new_keys;
+  EXPECT_EQ(99, registry.Insert(99, new_keys.label, new_keys.pmid_name, new_keys.vault_dir));
+  EXPECT_EQ(kFourth, registry.Find(keys[4].label));
+  EXPECT_EQ(10U, registry.Size());
+
+  int sum(0);
+  registry.ForEach([&](const int& value) { sum += value; });
+  EXPECT_EQ(45 - 3 + 99, sum);
+
+  for (const auto& key : keys)
+    registry.Erase(key.label);
+  registry.Erase(new_keys.label);
+  EXPECT_TRUE(registry.Empty());
+}
+
+TEST(VaultRegistryTest, BEH_Conflicts) {
+  VaultRegistry<int> registry;
+  Keys keys;
+  registry.Insert(0, keys.label, keys.pmid_name, keys.vault_dir);
+
+  Keys other;
+  EXPECT_THROW(registry.Insert(1, keys.label, other.pmid_name, other.vault_dir), maidsafe_error);
+  EXPECT_THROW(registry.Insert(1, other.label, keys.pmid_name, other.vault_dir), maidsafe_error);
+  EXPECT_THROW(registry.Insert(1, other.label, other.pmid_name, keys.vault_dir), maidsafe_error);
+  EXPECT_EQ(1U, registry.Size());
+  EXPECT_TRUE(registry.Find(other.label) == nullptr);
+
+  // The failed attempts mustn't have left any keys behind.
+  EXPECT_EQ(1, registry.Insert(1, other.label, other.pmid_name, other.vault_dir));
+  EXPECT_EQ(2U, registry.Size());
+}
+
+TEST(VaultRegistryTest, FUNC_LookupCostIsFlat) {
+  const std::vector<int> kSizes{ 10, 100, 1000, 10000 };
+  const int kLookups(100000);
+  std::vector<double> nanoseconds_per_lookup;
+  for (int size : kSizes) {
+    VaultRegistry<int> registry;
+    std::vector<Keys> keys(size);
+    for (int i(0); i < size; ++i) {
+      registry.Insert(i, keys[i].label, keys[i].pmid_name, keys[i].vault_dir);
+      registry.SetProcessId(keys[i].label, i + 1);
+    }
+
+    int found(0);
+    auto start(std::chrono::steady_clock::now());
+    for (int i(0); i < kLookups; ++i) {
+      found += (registry.Find(keys[i % size].label) != nullptr);
+      found += (registry.Find(static_cast<process::ProcessId>((i % size) + 1)) != nullptr);
+    }
+    auto duration(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - start));
+    EXPECT_EQ(2 * kLookups, found);
+    nanoseconds_per_lookup.push_back(static_cast<double>(duration.count()) / (2 * kLookups));
+    TLOG(kDefaultColour) << size << " vaults: " << nanoseconds_per_lookup.back()
+                         << " ns per lookup\n";
+  }
+  // A linear scan would be ~1000 times slower at 10,000 vaults than at 10.  Allow generous headroom
+  // for cache effects and noisy test machines.
+  EXPECT_LT(nanoseconds_per_lookup.back(), 20 * nanoseconds_per_lookup.front());
+}
+
+}  // namespace test
+
+}  // namespace vault_manager
+
+}  // namespace maidsafe
@@ -0,0 +1,149 @@
+/*  Copyright 2014 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include "maidsafe/vault_manager/vault_started_response_cache.h"
+
+#include <chrono>
+#include <memory>
+#include <string>
+
+#include "maidsafe/common/log.h"
+#include "maidsafe/common/test.h"
+#include "maidsafe/common/utils.h"
+#include "maidsafe/passport/passport.h"
+
+#include "maidsafe/vault_manager/dispatcher.h"
+#include "maidsafe/vault_manager/utils.h"
+#include "maidsafe/vault_manager/vault_config.h"
+#include "maidsafe/vault_manager/vault_info.h"
+
+namespace maidsafe {
+
+namespace vault_manager {
+
+namespace test {
+
+namespace {
+
+VaultInfo MakeVaultInfo() {
+  VaultInfo vault_info;
+  vault_info.pmid_and_signer =
+      std::make_shared<passport::PmidAndSigner>(passport::CreatePmidAndSigner());
+  vault_info.vault_dir = "vault_dir";
+  vault_info.max_disk_usage = DiskUsage(1000);
+  vault_info.label = GenerateLabel();
+  return vault_info;
+}
+
+std::unique_ptr<VaultConfig> ParseResponse(const std::string& wrapped_message) {
+  MessageAndType message_and_type(UnwrapMessage(wrapped_message));
+  EXPECT_EQ(MessageType::kVaultStartedResponse, message_and_type.second);
+  return detail::Parse<std::unique_ptr<VaultConfig>>(message_and_type.first);
+}
+
+}  // unnamed namespace
+
+TEST(VaultStartedResponseCacheTest, BEH_Get) {
+  VaultStartedResponseCache cache{ crypto::AES256Key{ RandomString(crypto::AES256_KeySize) },
+      crypto::AES256InitialisationVector{ RandomString(crypto::AES256_IVSize) } };
+  VaultInfo vault_info(MakeVaultInfo());
+  const std::string& kMessage(cache.Get(vault_info));
+  std::unique_ptr<VaultConfig> vault_config(ParseResponse(kMessage));
+  EXPECT_EQ(vault_info.pmid_and_signer->first.name(), vault_config->pmid.name());
+  EXPECT_EQ(vault_info.vault_dir, vault_config->vault_dir);
+  EXPECT_EQ(vault_info.max_disk_usage, vault_config->max_disk_usage);
+
+  // Unchanged settings reuse the cached message, even when given a copy of the vault's info.
+  const std::string kCopy(kMessage);
+  VaultInfo copy(vault_info);
+  EXPECT_EQ(&kMessage, &cache.Get(copy));
+  EXPECT_EQ(kCopy, cache.Get(copy));
+
+  // Changing vault_dir or max_disk_usage rebuilds the message.
+  vault_info.vault_dir = "new_vault_dir";
+  vault_config = ParseResponse(cache.Get(vault_info));
+  EXPECT_EQ(vault_info.vault_dir, vault_config->vault_dir);
+  vault_info.max_disk_usage = DiskUsage(2000);
+  vault_config = ParseResponse(cache.Get(vault_info));
+  EXPECT_EQ(vault_info.max_disk_usage, vault_config->max_disk_usage);
+  EXPECT_EQ(vault_info.pmid_and_signer->first.name(), vault_config->pmid.name());
+
+  // A different vault gets its own message.
+  VaultInfo other(MakeVaultInfo());
+  vault_config = ParseResponse(cache.Get(other));
+  EXPECT_EQ(other.pmid_and_signer->first.name(), vault_config->pmid.name());
+  vault_config = ParseResponse(cache.Get(vault_info));
+  EXPECT_EQ(vault_info.pmid_and_signer->first.name(), vault_config->pmid.name());
+}
+
+TEST(VaultStartedResponseCacheTest, BEH_Erase) {
+  VaultStartedResponseCache cache{ crypto::AES256Key{ RandomString(crypto::AES256_KeySize) },
+      crypto::AES256InitialisationVector{ RandomString(crypto::AES256_IVSize) } };
+  const VaultInfo kVaultInfo(MakeVaultInfo()), kOther(MakeVaultInfo());
+  cache.Get(kVaultInfo);
+  cache.Get(kOther);
+  EXPECT_EQ(2U, cache.Size());
+
+  cache.Erase(kVaultInfo.label);
+  EXPECT_EQ(1U, cache.Size());
+  cache.Erase(kVaultInfo.label);
+  EXPECT_EQ(1U, cache.Size());
+
+  // An erased vault's message is rebuilt if it's needed again.
+  std::unique_ptr<VaultConfig> vault_config(ParseResponse(cache.Get(kVaultInfo)));
+  EXPECT_EQ(kVaultInfo.pmid_and_signer->first.name(), vault_config->pmid.name());
+  EXPECT_EQ(2U, cache.Size());
+  cache.Erase(kOther.label);
+  cache.Erase(kVaultInfo.label);
+  EXPECT_EQ(0U, cache.Size());
+}
+
+TEST(VaultStartedResponseCacheTest, FUNC_RestartCost) {
+  const crypto::AES256Key kSymmKey{ RandomString(crypto::AES256_KeySize) };
+  const crypto::AES256InitialisationVector kSymmIv{ RandomString(crypto::AES256_IVSize) };
+  VaultStartedResponseCache cache{ kSymmKey, kSymmIv };
+  const VaultInfo kVaultInfo(MakeVaultInfo());
+  const int kRestarts(1000);
+
+  size_t size(0);
+  auto start(std::chrono::steady_clock::now());
+  for (int i(0); i < kRestarts; ++i) {
+    size += MakeVaultStartedResponse(kVaultInfo, passport::EncryptPmid(
+        kVaultInfo.pmid_and_signer->first, kSymmKey, kSymmIv)->string(), kSymmKey, kSymmIv).size();
+  }
+  auto uncached(std::chrono::steady_clock::now() - start);
+
+  start = std::chrono::steady_clock::now();
+  for (int i(0); i < kRestarts; ++i)
+    size -= cache.Get(kVaultInfo).size();
+  auto cached(std::chrono::steady_clock::now() - start);
+
+  EXPECT_EQ(0U, size);
+  TLOG(kDefaultColour) << "Building a VaultStartedResponse takes "
+      << std::chrono::duration_cast<std::chrono::microseconds>(uncached).count() / kRestarts
+      << " us; fetching a cached one takes "
+      << std::chrono::duration_cast<std::chrono::nanoseconds>(cached).count() / kRestarts
+      << " ns\n";
+  EXPECT_LT(cached, uncached);
+}
+
+}  // namespace test
+
+}  // namespace vault_manager
+
+}  // namespace maidsafe
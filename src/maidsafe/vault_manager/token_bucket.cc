@@ -0,0 +1,78 @@
+/*  Copyright 2014 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+#include "maidsafe/vault_manager/token_bucket.h"
+
+#include <algorithm>
+#include <cstdint>
+
+#include "maidsafe/common/error.h"
+
+namespace maidsafe {
+
+namespace vault_manager {
+
+TokenBucket::TokenBucket(size_t burst, std::chrono::steady_clock::duration refill_interval,
+                         std::chrono::steady_clock::time_point now)
+    : burst_(burst), refill_interval_(refill_interval), tokens_(burst), last_refill_(now) {
+  if (burst == 0 || refill_interval.count() <= 0)
+    BOOST_THROW_EXCEPTION(MakeError(CommonErrors::invalid_parameter));
+}
+
+bool TokenBucket::TryTake(std::chrono::steady_clock::time_point now) {
+  Refill(now);
+  if (tokens_ == 0)
+    return false;
+  // Refilling only starts once the bucket isn't full.
+  if (tokens_ == burst_)
+    last_refill_ = now;
+  --tokens_;
+  return true;
+}
+
+size_t TokenBucket::Available(std::chrono::steady_clock::time_point now) const {
+  if (now <= last_refill_)
+    return tokens_;
+  const uint64_t kRefills((now - last_refill_) / refill_interval_);
+  return static_cast<size_t>(std::min<uint64_t>(burst_, tokens_ + kRefills));
+}
+
+std::chrono::steady_clock::duration TokenBucket::TimeUntilAvailable(
+    std::chrono::steady_clock::time_point now) const {
+  if (Available(now) != 0)
+    return std::chrono::steady_clock::duration(0);
+  return last_refill_ + refill_interval_ - now;
+}
+
+void TokenBucket::Refill(std::chrono::steady_clock::time_point now) {
+  if (tokens_ == burst_ || now <= last_refill_)
+    return;
+  const auto kRefills((now - last_refill_) / refill_interval_);
+  if (kRefills == 0)
+    return;
+  if (static_cast<uint64_t>(kRefills) >= burst_ - tokens_) {
+    tokens_ = burst_;
+    last_refill_ = now;
+  } else {
+    tokens_ += static_cast<size_t>(kRefills);
+    last_refill_ += kRefills * refill_interval_;
+  }
+}
+
+}  // namespace vault_manager
+
+}  // namespace maidsafe
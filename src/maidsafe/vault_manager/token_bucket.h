@@ -0,0 +1,61 @@
+/*  Copyright 2014 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+#ifndef MAIDSAFE_VAULT_MANAGER_TOKEN_BUCKET_H_
+#define MAIDSAFE_VAULT_MANAGER_TOKEN_BUCKET_H_
+
+#include <chrono>
+#include <cstddef>
+
+namespace maidsafe {
+
+namespace vault_manager {
+
+// Holds up to 'burst' tokens, and gains one each 'refill_interval' until full.  It starts full, so
+// up to 'burst' operations can proceed at once, after which they're limited to the refill rate.
+//
+// Not thread-safe; each instance is used on its owner's io_service thread.
+class TokenBucket {
+ public:
+  // Throws if 'burst' is zero or 'refill_interval' isn't positive.
+  TokenBucket(size_t burst, std::chrono::steady_clock::duration refill_interval,
+              std::chrono::steady_clock::time_point now);
+
+  // Takes a token if one is available at 'now'.
+  bool TryTake(std::chrono::steady_clock::time_point now);
+  size_t Available(std::chrono::steady_clock::time_point now) const;
+  // Returns zero if a token is already available.
+  std::chrono::steady_clock::duration TimeUntilAvailable(
+      std::chrono::steady_clock::time_point now) const;
+  size_t Burst() const { return burst_; }
+  std::chrono::steady_clock::duration RefillInterval() const { return refill_interval_; }
+
+ private:
+  void Refill(std::chrono::steady_clock::time_point now);
+
+  size_t burst_;
+  std::chrono::steady_clock::duration refill_interval_;
+  size_t tokens_;
+  // Partial refills are kept by only advancing this by whole intervals.
+  std::chrono::steady_clock::time_point last_refill_;
+};
+
+}  // namespace vault_manager
+
+}  // namespace maidsafe
+
+#endif  // MAIDSAFE_VAULT_MANAGER_TOKEN_BUCKET_H_
@@ -17,6 +17,9 @@
     use of the MaidSafe Software.                                                                 */
 
 #include "maidsafe/vault_manager/tools/utils.h"
+
+#include <chrono>
+
 #include "maidsafe/common/make_unique.h"
 
 #include "maidsafe/vault_manager/tools/local_network_controller.h"
@@ -27,9 +30,20 @@ namespace vault_manager {
 
 namespace tools {
 
+int64_t MillisecondsSince(std::chrono::steady_clock::time_point start_time) {
+  return std::chrono::duration_cast<std::chrono::milliseconds>(
+      std::chrono::steady_clock::now() - start_time).count();
+}
+
 void StartVaultManagerAndClientInterface(LocalNetworkController* local_network_controller) {
   TLOG(kDefaultColour) << "Creating VaultManager and ClientInterface\n";
+  auto start_time(std::chrono::steady_clock::now());
   local_network_controller->vault_manager = maidsafe::make_unique<VaultManager>();
+  // The vaults in a pre-populated config file are admitted as one batch, in the background.
+  size_t started(local_network_controller->vault_manager->WaitForConfigVaults());
+  TLOG(kDefaultColour) << "Created VaultManager and started " << started
+                       << " vaults from its config file in " << MillisecondsSince(start_time)
+                       << " ms\n";
   passport::MaidAndSigner maid_and_signer{ passport::CreateMaidAndSigner() };
   local_network_controller->client_interface =
       maidsafe::make_unique<ClientInterface>(maid_and_signer.first);
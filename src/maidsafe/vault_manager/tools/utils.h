@@ -19,6 +19,8 @@
 #ifndef MAIDSAFE_VAULT_MANAGER_TOOLS_UTILS_H_
 #define MAIDSAFE_VAULT_MANAGER_TOOLS_UTILS_H_
 
+#include <chrono>
+#include <cstdint>
 
 namespace maidsafe {
 
@@ -28,6 +30,8 @@ namespace tools {
 
 struct LocalNetworkController;
 
+int64_t MillisecondsSince(std::chrono::steady_clock::time_point start_time);
+
 void StartVaultManagerAndClientInterface(LocalNetworkController* local_network_controller);
 
 }  // namespace tools
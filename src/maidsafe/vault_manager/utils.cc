@@ -20,6 +20,8 @@
 
 #include <algorithm>
 #include <cctype>
+#include <chrono>
+#include <cstdint>
 #include <functional>
 #include <iterator>
 #include <limits>
@@ -34,6 +36,7 @@
 #include "maidsafe/passport/passport.h"
 
 #include "maidsafe/vault_manager/interprocess_messages.pb.h"
+#include "maidsafe/vault_manager/scheduling.h"
 #include "maidsafe/vault_manager/vault_info.pb.h"
 #include "maidsafe/vault_manager/vault_info.h"
 
@@ -69,6 +72,15 @@ std::vector<passport::PublicPmid> ParsePublicPmidList(const std::string& seriali
 }
 #endif
 
+uint64_t ToMillisecondsSinceEpoch(std::chrono::system_clock::time_point time) {
+  return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::milliseconds>(
+      time.time_since_epoch()).count());
+}
+
+std::chrono::system_clock::time_point FromMillisecondsSinceEpoch(uint64_t milliseconds) {
+  return std::chrono::system_clock::time_point{} + std::chrono::milliseconds(milliseconds);
+}
+
 }  // unnamed namespace
 
 
@@ -122,6 +134,41 @@ void ToProtobuf(crypto::AES256Key symm_key, crypto::AES256InitialisationVector s
     protobuf_vault_info->set_max_disk_usage(vault_info.max_disk_usage.data);
   if (vault_info.owner_name->IsInitialised())
     protobuf_vault_info->set_owner_name(vault_info.owner_name->string());
+  const RestartHistory& history(vault_info.restart_history);
+  if (history.failure_count != 0 || !history.recent_exits.empty() ||
+      history.quarantined_until != std::chrono::system_clock::time_point{} ||
+      history.consecutive_bad_configs != 0 || history.consecutive_quarantines != 0 ||
+      history.failed) {
+    protobuf::RestartHistory* protobuf_history(protobuf_vault_info->mutable_restart_history());
+    protobuf_history->set_failure_count(history.failure_count);
+    for (const auto& exit_time : history.recent_exits)
+      protobuf_history->add_recent_exits(ToMillisecondsSinceEpoch(exit_time));
+    if (history.quarantined_until != std::chrono::system_clock::time_point{}) {
+      protobuf_history->set_quarantined_until(
+          ToMillisecondsSinceEpoch(history.quarantined_until));
+    }
+    if (history.consecutive_bad_configs != 0)
+      protobuf_history->set_consecutive_bad_configs(history.consecutive_bad_configs);
+    if (history.consecutive_quarantines != 0)
+      protobuf_history->set_consecutive_quarantines(history.consecutive_quarantines);
+    if (history.failed)
+      protobuf_history->set_failed(true);
+  }
+  const ResourceLimits& limits(vault_info.resource_limits);
+  if (limits.cpu_weight != 0 || limits.memory_high != 0 || limits.memory_max != 0 ||
+      limits.io_weight != 0) {
+    protobuf::ResourceLimits* protobuf_limits(protobuf_vault_info->mutable_resource_limits());
+    protobuf_limits->set_cpu_weight(limits.cpu_weight);
+    protobuf_limits->set_memory_high(limits.memory_high);
+    protobuf_limits->set_memory_max(limits.memory_max);
+    protobuf_limits->set_io_weight(limits.io_weight);
+  }
+  if (vault_info.scheduling_class != SchedulingClass::kNormal)
+    protobuf_vault_info->set_scheduling_class(static_cast<int32_t>(vault_info.scheduling_class));
+  if (!vault_info.launch_profile.empty())
+    protobuf_vault_info->set_launch_profile(vault_info.launch_profile);
+  if (vault_info.in_process)
+    protobuf_vault_info->set_in_process(true);
 }
 
 void FromProtobuf(crypto::AES256Key symm_key, crypto::AES256InitialisationVector symm_iv,
@@ -139,6 +186,32 @@ void FromProtobuf(crypto::AES256Key symm_key, crypto::AES256InitialisationVector
     vault_info.owner_name =
         passport::PublicMaid::Name{ Identity{ protobuf_vault_info.owner_name() } };
   }
+  if (protobuf_vault_info.has_restart_history()) {
+    const protobuf::RestartHistory& protobuf_history(protobuf_vault_info.restart_history());
+    RestartHistory& history(vault_info.restart_history);
+    history.failure_count = protobuf_history.failure_count();
+    history.recent_exits.clear();
+    for (int i(0); i != protobuf_history.recent_exits_size(); ++i)
+      history.recent_exits.push_back(FromMillisecondsSinceEpoch(protobuf_history.recent_exits(i)));
+    if (protobuf_history.has_quarantined_until()) {
+      history.quarantined_until =
+          FromMillisecondsSinceEpoch(protobuf_history.quarantined_until());
+    }
+    history.consecutive_bad_configs = protobuf_history.consecutive_bad_configs();
+    history.consecutive_quarantines = protobuf_history.consecutive_quarantines();
+    history.failed = protobuf_history.failed();
+  }
+  if (protobuf_vault_info.has_resource_limits()) {
+    const protobuf::ResourceLimits& protobuf_limits(protobuf_vault_info.resource_limits());
+    vault_info.resource_limits.cpu_weight = protobuf_limits.cpu_weight();
+    vault_info.resource_limits.memory_high = protobuf_limits.memory_high();
+    vault_info.resource_limits.memory_max = protobuf_limits.memory_max();
+    vault_info.resource_limits.io_weight = protobuf_limits.io_weight();
+  }
+  if (protobuf_vault_info.has_scheduling_class())
+    vault_info.scheduling_class = ParseSchedulingClass(protobuf_vault_info.scheduling_class());
+  vault_info.launch_profile = protobuf_vault_info.launch_profile();
+  vault_info.in_process = protobuf_vault_info.in_process();
 }
 
 std::string WrapMessage(MessageAndType message_and_type) {
@@ -0,0 +1,100 @@
+/*  Copyright 2014 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include "maidsafe/vault_manager/vault_host.h"
+
+#include <utility>
+
+#include "boost/exception/diagnostic_information.hpp"
+
+#include "maidsafe/common/error.h"
+#include "maidsafe/common/log.h"
+#include "maidsafe/common/make_unique.h"
+#include "maidsafe/common/process.h"
+
+#include "maidsafe/vault_manager/config.h"
+#include "maidsafe/vault_manager/dispatcher.h"
+#include "maidsafe/vault_manager/in_process_host.h"
+#include "maidsafe/vault_manager/interprocess_messages.pb.h"
+#include "maidsafe/vault_manager/utils.h"
+
+namespace maidsafe {
+
+namespace vault_manager {
+
+const char kVaultHostArgument[] = "--vault_host";
+
+VaultHost::VaultHost(tcp::Port vault_manager_port, VaultMain vault_main)
+    : exit_code_promise_(),
+      exit_code_flag_(),
+      asio_service_(1),
+      tcp_connection_(),
+      in_process_host_() {
+  in_process_host_ = maidsafe::make_unique<InProcessHost>(asio_service_.service(),
+      vault_manager_port, std::move(vault_main),
+      [this](InProcessHost::InstanceId instance_id, int exit_code) {
+        SendInstanceExited(tcp_connection_, instance_id, exit_code);
+      });
+  tcp_connection_ = tcp::Connection::MakeShared(asio_service_, vault_manager_port);
+  tcp_connection_->Start([this](std::string message) { HandleReceivedMessage(message); },
+                         [this] { SetExitCode(0); });
+  SendVaultHostStarted(tcp_connection_, process::GetProcessId());
+  LOG(kSuccess) << "Hosting vaults for VaultManager listening on port " << vault_manager_port;
+}
+
+VaultHost::~VaultHost() {
+  // Instances which are still running report their exits via the connection, so it's closed last.
+  in_process_host_.reset();
+  tcp_connection_->Close();
+  asio_service_.Stop();
+}
+
+int VaultHost::WaitForExit() {
+  return exit_code_promise_.get_future().get();
+}
+
+void VaultHost::HandleReceivedMessage(const std::string& wrapped_message) {
+  try {
+    MessageAndType message_and_type{ UnwrapMessage(wrapped_message) };
+    LOG(kVerbose) << "Received " << message_and_type.second;
+    switch (message_and_type.second) {
+      case MessageType::kStartInstanceRequest:
+        in_process_host_->Start(
+            ParseProto<protobuf::StartInstanceRequest>(message_and_type.first).instance_id());
+        break;
+      case MessageType::kStopInstanceRequest:
+        in_process_host_->Stop(
+            ParseProto<protobuf::StopInstanceRequest>(message_and_type.first).instance_id());
+        break;
+      default:
+        return;
+    }
+  }
+  catch (const std::exception& e) {
+    LOG(kError) << "Failed to handle incoming message: " << boost::diagnostic_information(e);
+  }
+}
+
+void VaultHost::SetExitCode(int exit_code) {
+  LOG(kInfo) << "VaultManager closed the vault host's connection.";
+  std::call_once(exit_code_flag_, [this, exit_code] { exit_code_promise_.set_value(exit_code); });
+}
+
+}  // namespace vault_manager
+
+}  // namespace maidsafe
@@ -30,6 +30,11 @@ VaultInfo::VaultInfo()
       max_disk_usage(0),
       owner_name(),
       label(),
+      restart_history(),
+      resource_limits(),
+      scheduling_class(SchedulingClass::kNormal),
+      launch_profile(),
+      in_process(false),
 #ifdef USE_VLOGGING
       vlog_session_id(),
       send_hostname_to_visualiser_server(false),
@@ -42,6 +47,11 @@ VaultInfo::VaultInfo(const VaultInfo& other)
       max_disk_usage(other.max_disk_usage),
       owner_name(other.owner_name),
       label(other.label),
+      restart_history(other.restart_history),
+      resource_limits(other.resource_limits),
+      scheduling_class(other.scheduling_class),
+      launch_profile(other.launch_profile),
+      in_process(other.in_process),
 #ifdef USE_VLOGGING
       vlog_session_id(other.vlog_session_id),
       send_hostname_to_visualiser_server(other.send_hostname_to_visualiser_server),
@@ -54,6 +64,11 @@ VaultInfo::VaultInfo(VaultInfo&& other)
       max_disk_usage(std::move(other.max_disk_usage)),
       owner_name(std::move(other.owner_name)),
       label(std::move(other.label)),
+      restart_history(std::move(other.restart_history)),
+      resource_limits(std::move(other.resource_limits)),
+      scheduling_class(std::move(other.scheduling_class)),
+      launch_profile(std::move(other.launch_profile)),
+      in_process(std::move(other.in_process)),
 #ifdef USE_VLOGGING
       vlog_session_id(std::move(other.vlog_session_id)),
       send_hostname_to_visualiser_server(std::move(other.send_hostname_to_visualiser_server)),
@@ -72,6 +87,11 @@ void swap(VaultInfo& lhs, VaultInfo& rhs) {
   swap(lhs.max_disk_usage, rhs.max_disk_usage);
   swap(lhs.owner_name, rhs.owner_name);
   swap(lhs.label, rhs.label);
+  swap(lhs.restart_history, rhs.restart_history);
+  swap(lhs.resource_limits, rhs.resource_limits);
+  swap(lhs.scheduling_class, rhs.scheduling_class);
+  swap(lhs.launch_profile, rhs.launch_profile);
+  swap(lhs.in_process, rhs.in_process);
 #ifdef USE_VLOGGING
   swap(lhs.vlog_session_id, rhs.vlog_session_id);
   swap(lhs.send_hostname_to_visualiser_server, rhs.send_hostname_to_visualiser_server);
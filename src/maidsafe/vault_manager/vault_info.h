@@ -19,6 +19,7 @@
 #ifndef MAIDSAFE_VAULT_MANAGER_VAULT_INFO_H_
 #define MAIDSAFE_VAULT_MANAGER_VAULT_INFO_H_
 
+#include <chrono>
 #include <cstdint>
 #include <memory>
 #include <string>
@@ -30,11 +31,32 @@
 #include "maidsafe/passport/passport.h"
 
 #include "maidsafe/vault_manager/config.h"
+#include "maidsafe/vault_manager/resource_limits.h"
+#include "maidsafe/vault_manager/scheduling_class.h"
 
 namespace maidsafe {
 
 namespace vault_manager {
 
+// Unexpected exits of a vault, used to pace its restarts.  Persisted in the config file.
+struct RestartHistory {
+  RestartHistory()
+      : failure_count(0), recent_exits(), quarantined_until(), consecutive_bad_configs(0),
+        consecutive_quarantines(0), failed(false) {}
+  // Consecutive failures, less any forgiven due to stable uptime.
+  int failure_count;
+  // Times of the exits within the last kCrashLoopWindow.
+  std::vector<std::chrono::system_clock::time_point> recent_exits;
+  // The epoch unless the vault is quarantined.
+  std::chrono::system_clock::time_point quarantined_until;
+  // Consecutive exits classed as BadConfig, i.e. before the vault had connected.
+  int consecutive_bad_configs;
+  // Consecutive quarantines, not counting any followed by a decay period of stable uptime.
+  int consecutive_quarantines;
+  // Set once the vault has been given up on; it isn't started again while this is set.
+  bool failed;
+};
+
 struct VaultInfo {
   VaultInfo();
   VaultInfo(const VaultInfo&);
@@ -46,6 +68,16 @@ struct VaultInfo {
   DiskUsage max_disk_usage;
   passport::PublicMaid::Name owner_name;
   NonEmptyString label;
+  RestartHistory restart_history;
+  ResourceLimits resource_limits;
+  // Persisted in the config file.
+  SchedulingClass scheduling_class;
+  // The name of the LaunchProfile applied whenever the vault is started, or empty for none.
+  // Persisted in the config file.
+  std::string launch_profile;
+  // Whether the vault runs as a thread of an InProcessHost rather than as its own process.
+  // Persisted in the config file.
+  bool in_process;
 #ifdef USE_VLOGGING
   std::string vlog_session_id;
   bool send_hostname_to_visualiser_server;
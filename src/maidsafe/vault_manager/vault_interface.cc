@@ -18,12 +18,17 @@
 
 #include "maidsafe/vault_manager/vault_interface.h"
 
+#include <chrono>
+
 #include "maidsafe/common/make_unique.h"
 #include "maidsafe/common/on_scope_exit.h"
+#include "maidsafe/common/process.h"
 #include "maidsafe/common/utils.h"
 #include "maidsafe/common/tcp/connection.h"
 
+#include "maidsafe/vault_manager/config.h"
 #include "maidsafe/vault_manager/dispatcher.h"
+#include "maidsafe/vault_manager/interprocess_messages.pb.h"
 #include "maidsafe/vault_manager/rpc_helper.h"
 #include "maidsafe/vault_manager/utils.h"
 
@@ -34,22 +39,35 @@ namespace maidsafe {
 namespace vault_manager {
 
 VaultInterface::VaultInterface(tcp::Port vault_manager_port)
+    : VaultInterface(vault_manager_port, process::GetProcessId()) {}
+
+VaultInterface::VaultInterface(tcp::Port vault_manager_port, uint64_t instance_id)
     : exit_code_promise_(),
       exit_code_flag_(),
       vault_manager_port_(vault_manager_port),
+      process_id_(instance_id),
       on_vault_started_response_(),
       vault_config_(),
+      started_(false),
+      exiting_(false),
+      mutex_(),
+      reconnect_deadline_(),
       asio_service_(1),
+      reconnect_future_(),
       tcp_connection_(tcp::Connection::MakeShared(asio_service_, vault_manager_port_)),
-      connection_closer_([&] { tcp_connection_->Close(); }) {
+      connection_closer_([&] {
+        exiting_ = true;
+        Connection()->Close();
+      }) {
   tcp_connection_->Start([this](std::string message) { HandleReceivedMessage(message); },
                          [this] { OnConnectionClosed(); });
   LOG(kSuccess) << "Connected to VaultManager which is listening on port " << vault_manager_port_;
   std::mutex mutex;
   auto vault_config_future(SetResponseCallback<std::unique_ptr<VaultConfig>>(
       on_vault_started_response_, asio_service_.service(), mutex));
-  SendVaultStarted(tcp_connection_);
+  SendVaultStarted(tcp_connection_, process_id_);
   vault_config_ = vault_config_future.get();
+  started_ = true;
   LOG(kSuccess) << "Retrieved config info from VaultManager";
 }
 
@@ -62,14 +80,73 @@ int VaultInterface::WaitForExit() {
 }
 
 void VaultInterface::SendJoined() {
-  SendJoinedNetwork(tcp_connection_);
+  SendJoinedNetwork(Connection());
+}
+
+void VaultInterface::Stop() {
+  LOG(kInfo) << "Stopping vault";
+  SetExitCode(0);
+}
+
+std::shared_ptr<tcp::Connection> VaultInterface::Connection() {
+  std::lock_guard<std::mutex> lock{ mutex_ };
+  return tcp_connection_;
 }
 
 void VaultInterface::OnConnectionClosed() {
-  LOG(kError) << "Lost connection to Vault Manager";
-  std::call_once(exit_code_flag_, [this] {
-      exit_code_promise_.set_value(ErrorToInt(MakeError(VaultManagerErrors::connection_aborted)));
-  });
+  if (!started_ || exiting_) {
+    LOG(kError) << "Lost connection to Vault Manager";
+    return SetExitCode(ErrorToInt(MakeError(VaultManagerErrors::connection_aborted)));
+  }
+  // The VaultManager may be re-executing itself, in which case its successor will re-attach us.
+  LOG(kWarning) << "Lost connection to Vault Manager; trying to reconnect.";
+  {
+    std::lock_guard<std::mutex> lock{ mutex_ };
+    if (reconnect_deadline_ == std::chrono::steady_clock::time_point())
+      reconnect_deadline_ = std::chrono::steady_clock::now() + kVaultReattachTimeout;
+  }
+  // Connecting blocks, so mustn't be done on the io thread.
+  reconnect_future_ = std::async(std::launch::async, [this] { Reconnect(); });
+}
+
+void VaultInterface::Reconnect() {
+  while (!exiting_) {
+    try {
+      std::shared_ptr<tcp::Connection> connection{
+          tcp::Connection::MakeShared(asio_service_, vault_manager_port_) };
+      {
+        std::lock_guard<std::mutex> lock{ mutex_ };
+        if (exiting_) {
+          connection->Close();
+          break;
+        }
+        tcp_connection_ = connection;
+      }
+      connection->Start([this](std::string message) { HandleReceivedMessage(message); },
+                        [this] { OnConnectionClosed(); });
+      SendVaultReattached(connection, vault_config_->pmid.name().value, process_id_);
+      LOG(kInfo) << "Reconnected to VaultManager on port " << vault_manager_port_;
+      return;
+    }
+    catch (const std::exception& e) {
+      LOG(kVerbose) << "Failed to reconnect: " << boost::diagnostic_information(e);
+    }
+    {
+      std::lock_guard<std::mutex> lock{ mutex_ };
+      if (std::chrono::steady_clock::now() >= reconnect_deadline_)
+        break;
+    }
+    maidsafe::Sleep(kVaultReconnectInterval);
+  }
+  if (exiting_)
+    return;
+  LOG(kError) << "Gave up trying to reconnect to Vault Manager";
+  SetExitCode(ErrorToInt(MakeError(VaultManagerErrors::connection_aborted)));
+}
+
+void VaultInterface::SetExitCode(int exit_code) {
+  exiting_ = true;
+  std::call_once(exit_code_flag_, [this, exit_code] { exit_code_promise_.set_value(exit_code); });
 }
 
 void VaultInterface::HandleReceivedMessage(const std::string& wrapped_message) {
@@ -84,6 +161,13 @@ void VaultInterface::HandleReceivedMessage(const std::string& wrapped_message) {
         assert(message_and_type.first.empty());
         HandleVaultShutdownRequest();
         break;
+      case MessageType::kHeartbeat:
+        HandleHeartbeat(message_and_type.first);
+        break;
+      case MessageType::kVaultReattachedResponse:
+        assert(message_and_type.first.empty());
+        HandleVaultReattachedResponse();
+        break;
       default:
         return;
     }
@@ -103,17 +187,37 @@ void VaultInterface::HandleVaultStartedResponse(const std::string& message) {
 
 void VaultInterface::HandleVaultShutdownRequest() {
   LOG(kInfo) << "Received  ShutdownRequest from Vault Manager";
-  std::call_once(exit_code_flag_, [this] { exit_code_promise_.set_value(0); });
+  SetExitCode(0);
+}
+
+void VaultInterface::HandleHeartbeat(const std::string& message) {
+  uint64_t sequence_number{ ParseProto<protobuf::Heartbeat>(message).sequence_number() };
+  // The reply is queued behind any other work on this io thread, so the time it waits there shows
+  // how busy the thread is.
+  auto received(std::chrono::steady_clock::now());
+  auto connection(Connection());
+  asio_service_.service().post([connection, sequence_number, received] {
+    SendHeartbeatResponse(connection, sequence_number,
+        std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - received));
+  });
+}
+
+void VaultInterface::HandleVaultReattachedResponse() {
+  LOG(kSuccess) << "Re-attached to VaultManager";
+  std::lock_guard<std::mutex> lock{ mutex_ };
+  reconnect_deadline_ = std::chrono::steady_clock::time_point();
 }
 
 #ifdef TESTING
 void VaultInterface::KillConnection() {
   maidsafe::Sleep(std::chrono::seconds(1));
+  std::lock_guard<std::mutex> lock{ mutex_ };
   tcp_connection_.reset();
 }
 
 void VaultInterface::SendInvalidMessage() {
-  tcp_connection_->Send("Rubbish");
+  Connection()->Send("Rubbish");
 }
 
 void VaultInterface::StopProcess() {
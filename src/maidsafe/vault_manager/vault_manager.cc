@@ -18,7 +18,13 @@
 
 #include "maidsafe/vault_manager/vault_manager.h"
 
+#include <algorithm>
+#include <chrono>
+#include <exception>
+#include <future>
+#include <memory>
 #include <string>
+#include <utility>
 #include <vector>
 
 #include "boost/filesystem/operations.hpp"
@@ -26,6 +32,7 @@
 #include "maidsafe/common/application_support_directories.h"
 #include "maidsafe/common/error.h"
 #include "maidsafe/common/log.h"
+#include "maidsafe/common/make_unique.h"
 #include "maidsafe/common/process.h"
 #include "maidsafe/common/utils.h"
 #include "maidsafe/common/tcp/connection.h"
@@ -36,8 +43,10 @@
 #include "maidsafe/vault_manager/client_connections.h"
 #include "maidsafe/vault_manager/dispatcher.h"
 #include "maidsafe/vault_manager/interprocess_messages.pb.h"
+#include "maidsafe/vault_manager/launch_profile.h"
 #include "maidsafe/vault_manager/new_connections.h"
 #include "maidsafe/vault_manager/process_manager.h"
+#include "maidsafe/vault_manager/scheduling.h"
 #include "maidsafe/vault_manager/utils.h"
 #include "maidsafe/vault_manager/vault_info.pb.h"
 
@@ -84,20 +93,198 @@ void PutPmidAndSigner(const passport::PmidAndSigner& pmid_and_signer) {
   LOG(kVerbose) << "Stopped Nfs client";
 }
 
+Handover ReadHandover(const fs::path& handover_file, bool adopt_orphans) {
+#ifndef MAIDSAFE_WIN32
+  fs::path file{ handover_file };
+  // Without a handover file, a runtime state file means our predecessor didn't stop cleanly.
+  boost::system::error_code error_code;
+  if (file.empty() && adopt_orphans && fs::exists(GetPath(kRuntimeStateFilename), error_code)) {
+    file = GetPath(kRuntimeStateFilename);
+    LOG(kWarning) << "Found " << file << "; the previous VaultManager appears to have crashed.";
+  }
+  if (!file.empty()) {
+    try {
+      Handover handover{ ReadHandoverFile(file) };
+      LOG(kInfo) << "Re-attaching " << handover.vaults.size() << " vaults left running on port "
+                 << handover.listening_port;
+      return handover;
+    }
+    catch (const std::exception& e) {
+      LOG(kError) << "Failed to read " << file << "; vaults left running will be replaced: "
+                  << boost::diagnostic_information(e);
+    }
+  }
+#else
+  static_cast<void>(handover_file);
+  static_cast<void>(adopt_orphans);
+#endif
+  return Handover();
+}
+
+// Returns how many vaults started.
+size_t LogStartOutcomes(std::chrono::steady_clock::time_point start_time,
+                        const std::vector<AddProcessOutcome>& outcomes) {
+  size_t started(0);
+  for (const auto& outcome : outcomes) {
+    if (outcome.error.code() == make_error_code(CommonErrors::success)) {
+      ++started;
+    } else {
+      LOG(kError) << "Failed to start vault "
+                  << (outcome.label.IsInitialised() ? outcome.label.string() : "<no label>")
+                  << ": " << boost::diagnostic_information(outcome.error);
+    }
+  }
+  LOG(kInfo) << "Started " << started << " of " << outcomes.size() << " vaults in "
+             << std::chrono::duration_cast<std::chrono::milliseconds>(
+                    std::chrono::steady_clock::now() - start_time).count() << " ms";
+  return started;
+}
+
 }  // unnamed namespace
 
-VaultManager::VaultManager()
-    : config_file_handler_(GetConfigFilePath()),
+VaultManager::VaultManager(VaultManagerOptions options)
+    : kOptions_(std::move(options)),
+      config_file_handler_(GetConfigFilePath()),
+      vault_started_responses_(config_file_handler_.SymmKey(), config_file_handler_.SymmIv()),
       network_stable_(false),
       tear_down_with_interval_(false),
+      handed_over_(false),
+      handover_(ReadHandover(kOptions_.handover_file, kOptions_.adopt_orphans)),
+      config_vaults_promise_(),
+      config_vaults_started_(config_vaults_promise_.get_future().share()),
       asio_service_(1),
       listener_(tcp::Listener::MakeShared(asio_service_,
           [this](tcp::ConnectionPtr connection) { HandleNewConnection(connection); },
-          GetInitialListeningPort())),
+          handover_.listening_port != 0 ? handover_.listening_port : GetInitialListeningPort())),
       process_manager_(ProcessManager::MakeShared(asio_service_.service(),
                        GetVaultExecutablePath(), listener_->ListeningPort())),
       client_connections_(ClientConnections::MakeShared(asio_service_.service())),
-      new_connections_(NewConnections::MakeShared(asio_service_.service())) {
+      new_connections_(NewConnections::MakeShared(asio_service_.service())),
+      runtime_state_write_pending_(false),
+      runtime_state_timer_(asio_service_.service()) {
+  if (handover_.listening_port != 0 && listener_->ListeningPort() != handover_.listening_port) {
+    LOG(kError) << "Failed to listen on port " << handover_.listening_port
+                << "; vaults left running there won't be able to reconnect.";
+  }
+  process_manager_->SetOnRestartHistoryChanged([this] {
+    config_file_handler_.WriteConfigFile(process_manager_->GetAll());
+  });
+  process_manager_->SetOnVaultFailed([this](VaultInfo vault_info) {
+    // If the corresponding client is connected, tell it the vault won't be restarted.
+    if (!vault_info.owner_name->IsInitialised())
+      return;
+    try {
+      tcp::ConnectionPtr client{ client_connections_->FindValidated(vault_info.owner_name) };
+      maidsafe_error error{ MakeError(VaultManagerErrors::vault_exited_with_error) };
+      SendVaultRunningResponse(client, vault_info.label, nullptr, &error);
+    }
+    catch (const std::exception&) {}  // We don't care if the client isn't connected.
+  });
+  process_manager_->SetOnVaultRemoved([this](NonEmptyString label) {
+    vault_started_responses_.Erase(label);
+  });
+  asio_service_.service().post([this] {
+#ifndef MAIDSAFE_WIN32
+    process_manager_->AdoptTerminated(handover_.terminated_process_ids);
+    handover_.terminated_process_ids.clear();
+    if (kOptions_.adopt_orphans) {
+      process_manager_->SetOnAttachedVaultsChanged([this] { ScheduleRuntimeStateWrite(); });
+      try {
+        process_manager_->BecomeSubreaper();
+      }
+      catch (const std::exception& e) {
+        LOG(kError) << "Failed to become a child subreaper: " << boost::diagnostic_information(e);
+      }
+    }
+    if (kOptions_.vault_output_max_file_size != 0) {
+      try {
+        process_manager_->EnableOutputCapture(kOptions_.vault_output_max_file_size);
+      }
+      catch (const std::exception& e) {
+        LOG(kError) << "Failed to enable vault output capture: "
+                    << boost::diagnostic_information(e);
+      }
+    }
+#endif
+    if (!kOptions_.launch_profiles_file.empty()) {
+      try {
+        process_manager_->SetLaunchProfiles(
+            ParseLaunchProfiles(ReadFile(kOptions_.launch_profiles_file).string()));
+      }
+      catch (const std::exception& e) {
+        LOG(kError) << "Failed to read launch profiles from " << kOptions_.launch_profiles_file
+                    << "; vaults will be launched with the defaults: "
+                    << boost::diagnostic_information(e);
+      }
+    }
+    if (kOptions_.in_process_hosting)
+      process_manager_->EnableInProcessHosting(GetPath(kVaultHostDirname));
+    if (!kOptions_.cgroup_root.empty()) {
+      try {
+        process_manager_->EnableCgroups(kOptions_.cgroup_root);
+      }
+      catch (const std::exception& e) {
+        LOG(kError) << "Failed to enable cgroups; vaults will run unconstrained: "
+                    << boost::diagnostic_information(e);
+      }
+    }
+    if (kOptions_.placement_policy != PlacementPolicy::kNone) {
+      try {
+        process_manager_->EnablePlacement(kOptions_.placement_policy);
+      }
+      catch (const std::exception& e) {
+        LOG(kError) << "Failed to enable CPU placement: " << boost::diagnostic_information(e);
+      }
+    }
+    if (kOptions_.resource_sample_interval.count() != 0) {
+      try {
+        process_manager_->EnableResourceSampling(kOptions_.resource_sample_interval);
+      }
+      catch (const std::exception& e) {
+        LOG(kError) << "Failed to enable resource sampling: " << boost::diagnostic_information(e);
+      }
+      if (kOptions_.vault_max_rss != 0 || kOptions_.vault_max_rss_growth != 0 ||
+          kOptions_.memory_pressure_threshold != 0.0) {
+        try {
+          MemoryWatchdogOptions watchdog_options;
+          watchdog_options.max_rss = kOptions_.vault_max_rss;
+          watchdog_options.max_rss_growth = kOptions_.vault_max_rss_growth;
+          watchdog_options.pressure_threshold = kOptions_.memory_pressure_threshold;
+          process_manager_->EnableMemoryWatchdog(watchdog_options);
+        }
+        catch (const std::exception& e) {
+          LOG(kError) << "Failed to enable the memory watchdog: "
+                      << boost::diagnostic_information(e);
+        }
+      }
+    }
+    if (kOptions_.heartbeat_interval.count() != 0) {
+      try {
+        process_manager_->EnableHeartbeats(kOptions_.heartbeat_interval,
+                                           kOptions_.missed_heartbeat_threshold);
+      }
+      catch (const std::exception& e) {
+        LOG(kError) << "Failed to enable heartbeats: " << boost::diagnostic_information(e);
+      }
+    }
+    try {
+      process_manager_->SetRestartThrottle(kOptions_.restart_burst,
+                                           kOptions_.restart_refill_interval);
+    }
+    catch (const std::exception& e) {
+      LOG(kError) << "Failed to set the restart throttle; keeping the default: "
+                  << boost::diagnostic_information(e);
+    }
+    try {
+      process_manager_->SetSparePool(kOptions_.spare_pool_size,
+          [this](VaultInfo vault_info, ProcessId process_id) {
+            OnVaultStarted(std::move(vault_info), process_id);
+          });
+    }
+    catch (const std::exception& e) {
+      LOG(kError) << "Failed to start spare vaults: " << boost::diagnostic_information(e);
+    }
+  });
   std::vector<VaultInfo> vaults{ config_file_handler_.ReadConfigFile() };
   if (vaults.empty()) {
 #ifndef TESTING
@@ -113,31 +300,107 @@ VaultManager::VaultManager()
     vault_info.label = GenerateLabel();
     process_manager_->AddProcess(std::move(vault_info));
 #endif
+    config_vaults_promise_.set_value(0);
   } else {
-    for (auto& vault_info : vaults)
-      process_manager_->AddProcess(std::move(vault_info));
+    auto start_time(std::chrono::steady_clock::now());
+    asio_service_.service().post([this, vaults, start_time] {
+      std::vector<VaultInfo> unattached_vaults{ AdoptAttachedVaults(vaults) };
+      if (unattached_vaults.empty())
+        return config_vaults_promise_.set_value(0);
+      try {
+        process_manager_->AddProcesses(unattached_vaults,
+            [this, start_time](std::vector<AddProcessOutcome> outcomes) {
+              config_vaults_promise_.set_value(LogStartOutcomes(start_time, outcomes));
+            });
+      }
+      catch (const std::exception& e) {
+        LOG(kError) << "Failed to start vaults: " << boost::diagnostic_information(e);
+        config_vaults_promise_.set_value(0);
+      }
+    });
   }
   LOG(kInfo) << "VaultManager started";
 }
 
+size_t VaultManager::WaitForConfigVaults() const {
+  return config_vaults_started_.get();
+}
+
 void VaultManager::TearDownWithInterval() {
   tear_down_with_interval_ = true;
   auto listener(listener_);
   auto new_connections(new_connections_);
   auto client_connections(client_connections_);
   auto process_manager(process_manager_);
-  auto future(std::async(std::launch::async, [=] {
+  // Clients stay connected until all vaults have stopped so that they can follow the progress.
+  std::promise<void> all_stopped;
+  asio_service_.service().post([=, &all_stopped] {
     listener->StopListening();
     new_connections->CloseAll();
-    client_connections->CloseAll();
-    process_manager->StopAllWithInterval();
-  }));
-  future.get();
+    RemoveRuntimeState();
+    try {
+      process_manager->StopAllRolling(kMaxConcurrentVaultStops, kShutdownDeadline,
+          [client_connections](ShutdownProgress progress) {
+            for (const auto& connection : client_connections->GetAll()) {
+              SendShutdownProgress(connection, progress.total, progress.stopped,
+                                   progress.terminated);
+            }
+          },
+          [client_connections, &all_stopped] {
+            client_connections->CloseAll();
+            all_stopped.set_value();
+          });
+    }
+    catch (const std::exception& e) {
+      LOG(kError) << "Failed to stop vaults: " << boost::diagnostic_information(e);
+      client_connections->CloseAll();
+      all_stopped.set_value();
+    }
+  });
+  all_stopped.get_future().get();
   asio_service_.Stop();
 }
 
+#ifndef MAIDSAFE_WIN32
+fs::path VaultManager::HandOver() {
+  handed_over_ = true;
+  fs::path handover_file{ GetPath(kHandoverFilename) };
+  std::promise<void> handed_over;
+  asio_service_.service().post([this, &handover_file, &handed_over] {
+    try {
+      const tcp::Port kListeningPort(listener_->ListeningPort());
+      // The runtime state file stays as it is in case the exec fails, but the handover file takes
+      // precedence over it.
+      process_manager_->SetOnAttachedVaultsChanged(nullptr);
+      runtime_state_timer_.cancel();
+      listener_->StopListening();
+      new_connections_->CloseAll();
+      client_connections_->CloseAll();
+      // The successor restarts any vault which can't be handed over from the config file.
+      config_file_handler_.WriteConfigFile(process_manager_->GetAll());
+      Handover handover{ process_manager_->HandOver() };
+      handover.listening_port = kListeningPort;
+      WriteHandoverFile(handover_file, handover);
+      handed_over.set_value();
+    }
+    catch (const std::exception& e) {
+      LOG(kError) << "Failed to hand over vaults: " << boost::diagnostic_information(e);
+      // Does nothing if the vaults have already been handed over.
+      process_manager_->StopAll();
+      handed_over.set_exception(std::current_exception());
+    }
+  });
+  auto result(handed_over.get_future());
+  result.wait();
+  asio_service_.Stop();
+  result.get();
+  LOG(kInfo) << "Handed over to " << handover_file;
+  return handover_file;
+}
+#endif
+
 VaultManager::~VaultManager() {
-  if (!tear_down_with_interval_) {
+  if (!tear_down_with_interval_ && !handed_over_) {
     auto listener(listener_);
     auto new_connections(new_connections_);
     auto client_connections(client_connections_);
@@ -146,6 +409,7 @@ VaultManager::~VaultManager() {
       listener->StopListening();
       new_connections->CloseAll();
       client_connections->CloseAll();
+      RemoveRuntimeState();
       process_manager->StopAll();
     });
     asio_service_.Stop();
@@ -190,6 +454,9 @@ void VaultManager::HandleReceivedMessage(tcp::ConnectionPtr connection,
       case MessageType::kVaultStarted:
         HandleVaultStarted(connection, message_and_type.first);
         break;
+      case MessageType::kVaultReattached:
+        HandleVaultReattached(connection, message_and_type.first);
+        break;
       case MessageType::kJoinedNetwork:
         assert(message_and_type.first.empty());
         HandleJoinedNetwork(connection);
@@ -205,6 +472,35 @@ void VaultManager::HandleReceivedMessage(tcp::ConnectionPtr connection,
       case MessageType::kLogMessage:
         HandleLogMessage(connection, message_and_type.first);
         break;
+      case MessageType::kResourceUsageRequest:
+        HandleResourceUsageRequest(connection, message_and_type.first);
+        break;
+      case MessageType::kSchedulingClassRequest:
+        HandleSchedulingClassRequest(connection, message_and_type.first);
+        break;
+      case MessageType::kLifecycleLatencyRequest:
+        HandleLifecycleLatencyRequest(connection, message_and_type.first);
+        break;
+      case MessageType::kTimeoutMetricsRequest:
+        assert(message_and_type.first.empty());
+        HandleTimeoutMetricsRequest(connection);
+        break;
+      case MessageType::kRestartQueueRequest:
+        assert(message_and_type.first.empty());
+        HandleRestartQueueRequest(connection);
+        break;
+      case MessageType::kUpgradeRequest:
+        HandleUpgradeRequest(connection, message_and_type.first);
+        break;
+      case MessageType::kHeartbeatResponse:
+        HandleHeartbeatResponse(connection, message_and_type.first);
+        break;
+      case MessageType::kVaultHostStarted:
+        HandleVaultHostStarted(connection, message_and_type.first);
+        break;
+      case MessageType::kInstanceExited:
+        HandleInstanceExited(connection, message_and_type.first);
+        break;
       default:
         return;
     }
@@ -247,6 +543,34 @@ void VaultManager::HandleStartVaultRequest(tcp::ConnectionPtr connection,
     vault_info.label = NonEmptyString{ start_vault_message.label() };
     vault_info.max_disk_usage = DiskUsage{ start_vault_message.max_disk_usage() };
     vault_info.owner_name = client_name;
+    vault_info.resource_limits = kOptions_.default_resource_limits;
+    if (start_vault_message.has_cpu_weight())
+      vault_info.resource_limits.cpu_weight = start_vault_message.cpu_weight();
+    if (start_vault_message.has_memory_high())
+      vault_info.resource_limits.memory_high = start_vault_message.memory_high();
+    if (start_vault_message.has_memory_max())
+      vault_info.resource_limits.memory_max = start_vault_message.memory_max();
+    if (start_vault_message.has_io_weight())
+      vault_info.resource_limits.io_weight = start_vault_message.io_weight();
+    if (start_vault_message.has_scheduling_class()) {
+      vault_info.scheduling_class =
+          ParseSchedulingClass(start_vault_message.scheduling_class());
+    }
+    if (start_vault_message.has_launch_profile()) {
+      if (!process_manager_->HasLaunchProfile(start_vault_message.launch_profile())) {
+        LOG(kError) << "Launch profile " << start_vault_message.launch_profile()
+                    << " isn't defined.";
+        BOOST_THROW_EXCEPTION(MakeError(CommonErrors::invalid_parameter));
+      }
+      vault_info.launch_profile = start_vault_message.launch_profile();
+    }
+    if (start_vault_message.in_process()) {
+      if (!process_manager_->InProcessHostingEnabled()) {
+        LOG(kError) << "In-process hosting isn't enabled.";
+        BOOST_THROW_EXCEPTION(MakeError(CommonErrors::invalid_parameter));
+      }
+      vault_info.in_process = true;
+    }
 #ifdef TESTING
     if (start_vault_message.has_pmid_list_index()) {
       vault_info.pmid_and_signer = std::make_shared<passport::PmidAndSigner>(
@@ -305,6 +629,10 @@ void VaultManager::HandleTakeOwnershipRequest(tcp::ConnectionPtr connection,
     fs::path new_vault_dir{ take_ownership_request.vault_dir() };
     DiskUsage new_max_disk_usage{ take_ownership_request.max_disk_usage() };
     VaultInfo vault_info{ process_manager_->Find(label) };
+    if (vault_info.restart_history.failed) {
+      LOG(kWarning) << "Vault " << label.string() << " has failed and won't be restarted.";
+      BOOST_THROW_EXCEPTION(MakeError(VaultManagerErrors::vault_exited_with_error));
+    }
 
     if (vault_info.vault_dir != new_vault_dir) {
       vault_info.vault_dir = new_vault_dir;
@@ -352,18 +680,41 @@ void VaultManager::HandleVaultStarted(tcp::ConnectionPtr connection, const std::
   LOG(kVerbose) << "VaultManager::HandleVaultStarted";
   RemoveFromNewConnections(connection);
   protobuf::VaultStarted vault_started{ ParseProto<protobuf::VaultStarted>(message) };
-  VaultInfo vault_info{
-      process_manager_->HandleVaultStarted(connection, { vault_started.process_id() }) };
+  // A spare vault waits for its credentials until it's needed.
+  if (process_manager_->HandleSpareStarted(connection, { vault_started.process_id() }))
+    return;
+  OnVaultStarted(process_manager_->HandleVaultStarted(connection, { vault_started.process_id() }),
+                 vault_started.process_id());
+}
 
+void VaultManager::HandleVaultReattached(tcp::ConnectionPtr connection,
+                                         const std::string& message) {
+  RemoveFromNewConnections(connection);
+  protobuf::VaultReattached vault_reattached{ ParseProto<protobuf::VaultReattached>(message) };
+  try {
+    process_manager_->HandleVaultReattached(connection, { vault_reattached.process_id() },
+                                            Identity{ vault_reattached.pmid_name() });
+    SendVaultReattachedResponse(connection);
+  }
+  catch (const maidsafe_error& e) {
+    // Either not one of ours, or it took so long that it has already been replaced.
+    LOG(kWarning) << "Telling process " << vault_reattached.process_id() << " to stop: "
+                  << boost::diagnostic_information(e);
+    SendVaultShutdownRequest(connection);
+  }
+}
+
+void VaultManager::OnVaultStarted(VaultInfo vault_info, process::ProcessId process_id) {
   // Send vault its credentials
-  LOG(kVerbose) << "VaultManager::HandleVaultStarted Send vault its credentials";
-  SendVaultStartedResponse(vault_info, config_file_handler_.SymmKey(),
-                           config_file_handler_.SymmIv());
+  LOG(kVerbose) << "VaultManager::OnVaultStarted Send vault its credentials";
+  SendVaultStartedResponse(vault_info.tcp_connection,
+                           vault_started_responses_.Get(vault_info));
+  process_manager_->MarkCredentialsSent(vault_info.label);
 
   // If the corresponding client is connected, send it the credentials too
   if (vault_info.owner_name->IsInitialised()) {
     try {
-      LOG(kVerbose) << "VaultManager::HandleVaultStarted Send client its credentials";
+      LOG(kVerbose) << "VaultManager::OnVaultStarted Send client its credentials";
       tcp::ConnectionPtr client{ client_connections_->FindValidated(vault_info.owner_name) };
       SendVaultRunningResponse(client, vault_info.label, vault_info.pmid_and_signer.get());
     }
@@ -372,7 +723,7 @@ void VaultManager::HandleVaultStarted(tcp::ConnectionPtr connection, const std::
 
   LOG(kSuccess) << "Vault started.  Pmid ID: "
       << DebugId(vault_info.pmid_and_signer->first.name().value) << "  Process ID: "
-      << vault_started.process_id() << "  Label: " << vault_info.label.string();
+      << process_id << "  Label: " << vault_info.label.string();
 }
 
 void VaultManager::HandleMarkNetworkAsStable() {
@@ -393,8 +744,137 @@ void VaultManager::HandleNetworkStableRequest(tcp::ConnectionPtr connection) {
   });
 }
 
+void VaultManager::HandleResourceUsageRequest(tcp::ConnectionPtr connection,
+                                              const std::string& message) {
+  maidsafe_error error{ MakeError(CommonErrors::unknown) };
+  NonEmptyString label;
+  try {
+    client_connections_->FindValidated(connection);
+    protobuf::ResourceUsageRequest request{ ParseProto<protobuf::ResourceUsageRequest>(message) };
+    label = NonEmptyString{ request.label() };
+    SendResourceUsageResponse(connection, label, process_manager_->GetResourceUsage(label));
+    return;
+  }
+  catch (const maidsafe_error& e) {
+    LOG(kWarning) << boost::diagnostic_information(e);
+    error = e;
+  }
+  catch (const std::exception& e) {
+    LOG(kWarning) << boost::diagnostic_information(e);
+  }
+  if (label.IsInitialised())
+    SendResourceUsageResponse(connection, label, std::vector<ResourceSample>(), &error);
+}
+
+void VaultManager::HandleSchedulingClassRequest(tcp::ConnectionPtr connection,
+                                                const std::string& message) {
+  maidsafe_error error{ MakeError(CommonErrors::unknown) };
+  NonEmptyString label;
+  try {
+    client_connections_->FindValidated(connection);
+    protobuf::SchedulingClassRequest request{
+        ParseProto<protobuf::SchedulingClassRequest>(message) };
+    label = NonEmptyString{ request.label() };
+    SchedulingClass scheduling_class{ ParseSchedulingClass(request.scheduling_class()) };
+    bool applied(process_manager_->SetSchedulingClass(label, scheduling_class));
+    config_file_handler_.WriteConfigFile(process_manager_->GetAll());
+    if (applied) {
+      SendSchedulingClassResponse(connection, label, scheduling_class);
+      return;
+    }
+    error = MakeError(CommonErrors::unable_to_handle_request);
+  }
+  catch (const maidsafe_error& e) {
+    LOG(kWarning) << boost::diagnostic_information(e);
+    error = e;
+  }
+  catch (const std::exception& e) {
+    LOG(kWarning) << boost::diagnostic_information(e);
+  }
+  if (label.IsInitialised())
+    SendSchedulingClassResponse(connection, label, SchedulingClass::kNormal, &error);
+}
+
+void VaultManager::HandleLifecycleLatencyRequest(tcp::ConnectionPtr connection,
+                                                 const std::string& message) {
+  maidsafe_error error{ MakeError(CommonErrors::unknown) };
+  std::unique_ptr<NonEmptyString> label;
+  try {
+    client_connections_->FindValidated(connection);
+    protobuf::LifecycleLatencyRequest request{
+        ParseProto<protobuf::LifecycleLatencyRequest>(message) };
+    if (request.has_label())
+      label = maidsafe::make_unique<NonEmptyString>(request.label());
+    SendLifecycleLatencyResponse(connection, label.get(),
+        label ? process_manager_->GetLifecycleLatencies(*label) :
+                process_manager_->GetLifecycleLatencies());
+    return;
+  }
+  catch (const maidsafe_error& e) {
+    LOG(kWarning) << boost::diagnostic_information(e);
+    error = e;
+  }
+  catch (const std::exception& e) {
+    LOG(kWarning) << boost::diagnostic_information(e);
+  }
+  SendLifecycleLatencyResponse(connection, label.get(), std::vector<PhaseLatency>(), &error);
+}
+
+void VaultManager::HandleTimeoutMetricsRequest(tcp::ConnectionPtr connection) {
+  try {
+    client_connections_->FindValidated(connection);
+    std::vector<TimeoutMetric> metrics{ process_manager_->GetConnectTimeoutMetric(),
+                                        new_connections_->GetTimeoutMetric(),
+                                        client_connections_->GetTimeoutMetric() };
+    SendTimeoutMetricsResponse(connection, metrics);
+  }
+  catch (const maidsafe_error& e) {
+    LOG(kWarning) << boost::diagnostic_information(e);
+    SendTimeoutMetricsResponse(connection, std::vector<TimeoutMetric>(), &e);
+  }
+}
+
+void VaultManager::HandleRestartQueueRequest(tcp::ConnectionPtr connection) {
+  try {
+    client_connections_->FindValidated(connection);
+    SendRestartQueueResponse(connection, process_manager_->GetRestartQueueStats());
+  }
+  catch (const maidsafe_error& e) {
+    LOG(kWarning) << boost::diagnostic_information(e);
+    SendRestartQueueResponse(connection, RestartQueueStats(), &e);
+  }
+}
+
+void VaultManager::HandleUpgradeRequest(tcp::ConnectionPtr connection,
+                                        const std::string& message) {
+  try {
+    client_connections_->FindValidated(connection);
+    protobuf::UpgradeRequest request{ ParseProto<protobuf::UpgradeRequest>(message) };
+    UpgradeOptions options;
+    options.wave_size = request.wave_size();
+    options.failure_threshold = request.failure_threshold();
+    auto client_connections(client_connections_);
+    process_manager_->Upgrade(fs::path(request.vault_executable_path()), options,
+        [client_connections](UpgradeProgress progress) {
+          for (const auto& client : client_connections->GetAll())
+            SendUpgradeProgress(client, progress);
+        },
+        [connection](maidsafe_error error, UpgradeProgress progress) {
+          if (error.code() == make_error_code(CommonErrors::success))
+            SendUpgradeResponse(connection, progress);
+          else
+            SendUpgradeResponse(connection, progress, &error);
+        });
+  }
+  catch (const maidsafe_error& e) {
+    LOG(kWarning) << boost::diagnostic_information(e);
+    SendUpgradeResponse(connection, UpgradeProgress(), &e);
+  }
+}
+
 void VaultManager::HandleJoinedNetwork(tcp::ConnectionPtr connection) {
   try {
+    process_manager_->MarkJoinedNetwork(connection);
     VaultInfo vault_info(process_manager_->Find(connection));
     // TODO(Prakash) do vault_info need joined field
     std::string log_message("Vault running as " +
@@ -416,8 +896,102 @@ void VaultManager::HandleLogMessage(tcp::ConnectionPtr connection, const std::st
   catch (const std::exception&) {}  // We don't care if the client isn't connected.
 }
 
+void VaultManager::HandleHeartbeatResponse(tcp::ConnectionPtr connection,
+                                           const std::string& message) {
+  protobuf::HeartbeatResponse response{ ParseProto<protobuf::HeartbeatResponse>(message) };
+  process_manager_->HandleHeartbeatResponse(connection, response.sequence_number(),
+      std::chrono::microseconds(response.loop_lag_us()),
+      std::chrono::system_clock::time_point(std::chrono::milliseconds(response.timestamp_ms())));
+}
+
+void VaultManager::HandleVaultHostStarted(tcp::ConnectionPtr connection,
+                                          const std::string& message) {
+  RemoveFromNewConnections(connection);
+  protobuf::VaultHostStarted host_started{ ParseProto<protobuf::VaultHostStarted>(message) };
+  if (!process_manager_->HandleVaultHostStarted(connection, { host_started.process_id() })) {
+    LOG(kError) << "Process " << host_started.process_id() << " isn't the expected vault host.";
+    connection->Close();
+  }
+}
+
+void VaultManager::HandleInstanceExited(tcp::ConnectionPtr connection,
+                                        const std::string& message) {
+  protobuf::InstanceExited instance_exited{ ParseProto<protobuf::InstanceExited>(message) };
+  if (!process_manager_->HandleInstanceExited(connection, { instance_exited.instance_id() },
+                                              instance_exited.exit_code())) {
+    LOG(kWarning) << "Ignoring exit of instance " << instance_exited.instance_id()
+                  << " reported by a process which isn't the vault host.";
+  }
+}
+
+std::vector<VaultInfo> VaultManager::AdoptAttachedVaults(std::vector<VaultInfo> vaults) {
+#ifdef MAIDSAFE_WIN32
+  return vaults;
+#else
+  if (handover_.vaults.empty())
+    return vaults;
+  std::vector<VaultInfo> unattached_vaults;
+  for (auto& vault_info : vaults) {
+    auto itr(std::find_if(std::begin(handover_.vaults), std::end(handover_.vaults),
+                          [&](const AttachedVault& attached_vault) {
+                            return attached_vault.label == vault_info.label;
+                          }));
+    try {
+      if (itr != std::end(handover_.vaults)) {
+        process_manager_->AdoptProcess(vault_info, *itr);
+        continue;
+      }
+    }
+    catch (const std::exception& e) {
+      LOG(kWarning) << "Failed to adopt vault " << vault_info.label.string()
+                    << "; starting it afresh: " << boost::diagnostic_information(e);
+    }
+    unattached_vaults.push_back(std::move(vault_info));
+  }
+  handover_.vaults.clear();
+  return unattached_vaults;
+#endif
+}
+
+void VaultManager::ScheduleRuntimeStateWrite() {
+  if (runtime_state_write_pending_)
+    return;
+  runtime_state_write_pending_ = true;
+  runtime_state_timer_.expires_from_now(kRuntimeStateWriteDelay);
+  runtime_state_timer_.async_wait([this](const boost::system::error_code& error_code) {
+    if (error_code && error_code == boost::asio::error::operation_aborted)
+      return;
+    runtime_state_write_pending_ = false;
+    WriteRuntimeState();
+  });
+}
+
+void VaultManager::WriteRuntimeState() {
+#ifndef MAIDSAFE_WIN32
+  Handover runtime_state;
+  runtime_state.listening_port = listener_->ListeningPort();
+  runtime_state.vaults = process_manager_->GetAttachedVaults();
+  try {
+    WriteHandoverFile(GetPath(kRuntimeStateFilename), runtime_state);
+  }
+  catch (const std::exception& e) {
+    LOG(kError) << "Failed to write runtime state: " << boost::diagnostic_information(e);
+  }
+#endif
+}
+
+void VaultManager::RemoveRuntimeState() {
+  process_manager_->SetOnAttachedVaultsChanged(nullptr);
+  runtime_state_timer_.cancel();
+  runtime_state_write_pending_ = false;
+  boost::system::error_code error_code;
+  fs::remove(GetPath(kRuntimeStateFilename), error_code);
+  if (error_code)
+    LOG(kWarning) << "Failed to remove runtime state file: " << error_code.message();
+}
+
 void VaultManager::RemoveFromNewConnections(tcp::ConnectionPtr connection) {
-  if (!new_connections_->Remove(connection)) {
+  if (!new_connections_->Identified(connection)) {
     LOG(kWarning) << "Connection not found in new_connections_.";
     BOOST_THROW_EXCEPTION(MakeError(VaultManagerErrors::connection_not_found));
   }
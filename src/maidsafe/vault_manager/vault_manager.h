@@ -19,19 +19,27 @@
 #ifndef MAIDSAFE_VAULT_MANAGER_VAULT_MANAGER_H_
 #define MAIDSAFE_VAULT_MANAGER_VAULT_MANAGER_H_
 
+#include <chrono>
+#include <cstddef>
+#include <future>
 #include <memory>
 #include <string>
+#include <vector>
 
 #include "boost/filesystem/path.hpp"
 
 #include "maidsafe/common/asio_service.h"
 #include "maidsafe/common/crypto.h"
+#include "maidsafe/common/process.h"
 #include "maidsafe/common/types.h"
 #include "maidsafe/passport/types.h"
 
 #include "maidsafe/vault_manager/config.h"
 #include "maidsafe/vault_manager/config_file_handler.h"
+#include "maidsafe/vault_manager/handover.h"
+#include "maidsafe/vault_manager/placement.h"
 #include "maidsafe/vault_manager/vault_info.h"
+#include "maidsafe/vault_manager/vault_started_response_cache.h"
 
 namespace maidsafe {
 
@@ -41,6 +49,60 @@ class ClientConnections;
 class NewConnections;
 class ProcessManager;
 
+struct VaultManagerOptions {
+  VaultManagerOptions()
+      : spare_pool_size(kDefaultSparePoolSize), cgroup_root(), default_resource_limits(),
+        placement_policy(PlacementPolicy::kNone),
+        resource_sample_interval(kResourceSampleInterval), heartbeat_interval(kHeartbeatInterval),
+        missed_heartbeat_threshold(kMissedHeartbeatThreshold), handover_file(),
+        adopt_orphans(true), vault_output_max_file_size(kVaultOutputMaxFileSize), vault_max_rss(0),
+        vault_max_rss_growth(0), memory_pressure_threshold(kMemoryPressureThreshold),
+        launch_profiles_file(), restart_burst(kRestartBurst),
+        restart_refill_interval(kRestartRefillInterval), in_process_hosting(false) {}
+  // Vault processes kept ready to take on the identity of a new or restarted vault (see
+  // ProcessManager::SetSparePool).
+  size_t spare_pool_size;
+  // If not empty, each vault is given its own cgroup below this directory (see Cgroups).
+  boost::filesystem::path cgroup_root;
+  // Applied to new vaults whose StartVaultRequest doesn't specify limits of its own.
+  ResourceLimits default_resource_limits;
+  // How vaults are pinned to CPUs, using the NUMA topology in /sys/devices/system/node.
+  PlacementPolicy placement_policy;
+  // How often each vault's resource usage is sampled (Linux only).  Zero disables sampling.
+  std::chrono::milliseconds resource_sample_interval;
+  // How often each vault is sent a heartbeat.  Zero disables heartbeats.
+  std::chrono::milliseconds heartbeat_interval;
+  // Consecutive heartbeats a vault can miss before it's restarted.
+  int missed_heartbeat_threshold;
+  // If not empty, the file written by a predecessor's HandOver.  The vaults listed there are
+  // re-attached rather than started.  Ignored on Windows.
+  boost::filesystem::path handover_file;
+  // If true, the running vaults are kept listed in a runtime state file, and if a predecessor
+  // crashed leaving that file behind (and there's no 'handover_file'), the vaults it lists are
+  // re-adopted rather than started.  Also makes this process a child subreaper (see
+  // ProcessManager::BecomeSubreaper).  Ignored on Windows.
+  bool adopt_orphans;
+  // Size at which each vault's captured stdout and stderr is rotated (see
+  // ProcessManager::EnableOutputCapture).  Zero leaves the output going to the VaultManager's own
+  // stdout and stderr.  Ignored on Windows.
+  uint64_t vault_output_max_file_size;
+  // The memory watchdog's RSS ceiling, RSS growth ceiling and host memory pressure threshold (see
+  // ProcessManager::EnableMemoryWatchdog).  Zero disables each; the watchdog is only enabled if
+  // resource sampling is and at least one of these is non-zero.
+  uint64_t vault_max_rss, vault_max_rss_growth;
+  double memory_pressure_threshold;
+  // If not empty, the file defining the launch profiles which vaults can be started with (see
+  // ParseLaunchProfiles).  It's read once, at startup.
+  boost::filesystem::path launch_profiles_file;
+  // The host-wide restart throttle (see ProcessManager::SetRestartThrottle).
+  size_t restart_burst;
+  std::chrono::milliseconds restart_refill_interval;
+  // If set, vaults started with 'in_process' run as threads of a single vault host process rather
+  // than as separate processes (see ProcessManager::EnableInProcessHosting).  The vault executable
+  // must support being run as a host (see VaultHost).
+  bool in_process_hosting;
+};
+
 // The VaultManager has several responsibilities:
 // * Reads config file on startup and restarts vaults listed in file.
 // * Writes details of all vaults to config file.
@@ -51,10 +113,22 @@ class VaultManager {
   VaultManager(VaultManager&&) = delete;
   VaultManager operator=(VaultManager) = delete;
 
-  VaultManager();
+  explicit VaultManager(VaultManagerOptions options = VaultManagerOptions());
   ~VaultManager();
 
   void TearDownWithInterval();
+  // Blocks until each vault listed in the config file at startup, other than those re-attached
+  // from a predecessor, has either started or failed to (see ProcessManager::AddProcesses).
+  // Returns how many started.
+  size_t WaitForConfigVaults() const;
+#ifndef MAIDSAFE_WIN32
+  // Stops listening and disconnects all clients, but leaves every running vault in place, then
+  // returns the path of a handover file from which a re-executed VaultManager can re-attach them
+  // (see VaultManagerOptions::handover_file).  The vaults keep trying to reconnect for
+  // kVaultReattachTimeout, so the caller should destroy this object and exec the new binary
+  // straight away.
+  boost::filesystem::path HandOver();
+#endif
 
  private:
   void HandleNewConnection(tcp::ConnectionPtr connection);
@@ -68,22 +142,47 @@ class VaultManager {
   void HandleTakeOwnershipRequest(tcp::ConnectionPtr connection, const std::string& message);
   void HandleMarkNetworkAsStable();
   void HandleNetworkStableRequest(tcp::ConnectionPtr connection);
+  void HandleResourceUsageRequest(tcp::ConnectionPtr connection, const std::string& message);
+  void HandleSchedulingClassRequest(tcp::ConnectionPtr connection, const std::string& message);
+  void HandleLifecycleLatencyRequest(tcp::ConnectionPtr connection, const std::string& message);
+  void HandleTimeoutMetricsRequest(tcp::ConnectionPtr connection);
+  void HandleRestartQueueRequest(tcp::ConnectionPtr connection);
+  void HandleUpgradeRequest(tcp::ConnectionPtr connection, const std::string& message);
 
   // Messages from Vault
   void HandleVaultStarted(tcp::ConnectionPtr connection, const std::string& message);
+  void HandleVaultReattached(tcp::ConnectionPtr connection, const std::string& message);
   void HandleJoinedNetwork(tcp::ConnectionPtr connection);
   void HandleLogMessage(tcp::ConnectionPtr connection, const std::string& message);
-
+  void HandleHeartbeatResponse(tcp::ConnectionPtr connection, const std::string& message);
+  void HandleVaultHostStarted(tcp::ConnectionPtr connection, const std::string& message);
+  void HandleInstanceExited(tcp::ConnectionPtr connection, const std::string& message);
+  void OnVaultStarted(VaultInfo vault_info, process::ProcessId process_id);
+
+  // Returns those of 'vaults' which weren't left running by a predecessor, and so need starting.
+  std::vector<VaultInfo> AdoptAttachedVaults(std::vector<VaultInfo> vaults);
+  void ScheduleRuntimeStateWrite();
+  void WriteRuntimeState();
+  // Called on a clean shutdown, since no vaults will be left for a successor to adopt.
+  void RemoveRuntimeState();
   void RemoveFromNewConnections(tcp::ConnectionPtr connection);
   void ChangeChunkstorePath(VaultInfo vault_info);
 
+  const VaultManagerOptions kOptions_;
   ConfigFileHandler config_file_handler_;
-  bool network_stable_, tear_down_with_interval_;
+  // Only accessed on the asio_service_ thread.
+  VaultStartedResponseCache vault_started_responses_;
+  bool network_stable_, tear_down_with_interval_, handed_over_;
+  Handover handover_;
+  std::promise<size_t> config_vaults_promise_;
+  std::shared_future<size_t> config_vaults_started_;
   AsioService asio_service_;
   std::shared_ptr<tcp::Listener> listener_;
   std::shared_ptr<ProcessManager> process_manager_;
   std::shared_ptr<ClientConnections> client_connections_;
   std::shared_ptr<NewConnections> new_connections_;
+  bool runtime_state_write_pending_;
+  Timer runtime_state_timer_;
 };
 
 }  // namespace vault_manager
@@ -20,14 +20,21 @@
 #include <windows.h>
 #else
 #include <signal.h>
+#include <unistd.h>
 #endif
 
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <cstdint>
 #include <future>
 #include <iostream>
 #include <string>
 #include <thread>
 #include <vector>
 
+#include "boost/filesystem/operations.hpp"
 #include "boost/filesystem/path.hpp"
 #include "boost/program_options.hpp"
 #include "boost/regex.hpp"
@@ -46,12 +53,48 @@ namespace po = boost::program_options;
 namespace {
 
 std::promise<void> g_shutdown_promise;
+std::atomic_flag g_shutdown_requested = ATOMIC_FLAG_INIT;
 
 void ShutDownVaultManager(int /*signal*/) {
+  if (g_shutdown_requested.test_and_set())
+    return;
   std::cout << "Stopping vault_manager." << std::endl;
   g_shutdown_promise.set_value();
 }
 
+#ifndef MAIDSAFE_WIN32
+std::atomic<bool> g_hand_over(false);
+
+// SIGUSR2 re-executes the vault_manager binary (usually just replaced by a newer version), leaving
+// the vaults running.
+void HandOverVaultManager(int signal) {
+  g_hand_over = true;
+  ShutDownVaultManager(signal);
+}
+
+// Replaces this process with a new instance of 'executable', passing the original arguments along
+// with the handover file.  Only returns if the exec fails.
+void ReExecute(const fs::path& executable, int argc, char** argv, const fs::path& handover_file) {
+  std::vector<std::string> args{ executable.string() };
+  for (int i(1); i < argc; ++i) {
+    if (std::string(argv[i]) == "--handover_file") {
+      ++i;
+      continue;
+    }
+    args.emplace_back(argv[i]);
+  }
+  args.emplace_back("--handover_file");
+  args.emplace_back(handover_file.string());
+  std::vector<char*> exec_args;
+  for (auto& arg : args)
+    exec_args.push_back(&arg[0]);
+  exec_args.push_back(nullptr);
+  std::cout << "Re-executing " << executable << std::endl;
+  execv(executable.c_str(), exec_args.data());
+  LOG(kError) << "Failed to re-execute " << executable << ": " << std::strerror(errno);
+}
+#endif
+
 #ifdef MAIDSAFE_WIN32
 
 enum {
@@ -138,9 +181,46 @@ BOOL CtrlHandler(DWORD control_type) {
 
 #endif
 
-void HandleProgramOptions(int argc, char** argv) {
+maidsafe::vault_manager::VaultManagerOptions HandleProgramOptions(int argc, char** argv) {
   po::options_description options_description("Allowed options");
   options_description.add_options()
+      ("spare_vaults", po::value<int>(), "Number of spare vault processes to keep ready")
+      ("cgroup_root", po::value<std::string>(),
+       "Delegated cgroup v2 directory in which to give each vault its own cgroup")
+      ("vault_cpu_weight", po::value<uint32_t>(), "Default cpu.weight of each vault's cgroup")
+      ("vault_memory_high", po::value<uint64_t>(), "Default memory.high of each vault's cgroup")
+      ("vault_memory_max", po::value<uint64_t>(), "Default memory.max of each vault's cgroup")
+      ("vault_io_weight", po::value<uint32_t>(), "Default io.weight of each vault's cgroup")
+      ("placement", po::value<std::string>(),
+       "Pin vaults to CPUs: \"nodes\" spreads them across NUMA nodes, \"cores\" across CPUs")
+      ("sample_interval", po::value<int>(),
+       "Seconds between samples of each vault's resource usage (0 disables sampling)")
+      ("heartbeat_interval_ms", po::value<int>(),
+       "Milliseconds between heartbeats sent to each vault (0 disables heartbeats)")
+      ("missed_heartbeats", po::value<int>(),
+       "Consecutive heartbeats a vault can miss before it's assumed hung and restarted")
+      ("handover_file", po::value<std::string>(),
+       "File left by the previous instance on receiving SIGUSR2, listing vaults to re-attach")
+      ("adopt_orphans", po::value<bool>(),
+       "Re-adopt vaults left running if the previous instance crashed (default true)")
+      ("vault_output_max_size", po::value<uint64_t>(),
+       "Bytes of stdout and stderr kept per vault log file before rotating (0 disables capture)")
+      ("vault_max_rss", po::value<uint64_t>(),
+       "Bytes of RSS beyond which a vault is restarted (0, the default, disables the check)")
+      ("vault_max_rss_growth", po::value<uint64_t>(),
+       "Bytes a vault's RSS can grow by after starting before it's restarted (0 disables)")
+      ("launch_profiles", po::value<std::string>(),
+       "File defining the named launch profiles (environment, preload, limits and arguments) "
+       "which vaults can be started with")
+      ("memory_pressure_threshold", po::value<double>(),
+       "Host memory pressure (PSI full avg10 %) at which the vault which has grown most is "
+       "restarted (0 disables)")
+      ("restart_burst", po::value<int>(),
+       "Vault restarts allowed at once across the host before they're throttled")
+      ("restart_refill_ms", po::value<int>(),
+       "Milliseconds between further vault restarts once the burst has been used")
+      ("in_process_hosting", po::value<bool>(),
+       "Run vaults started with 'in_process' as threads of a single vault host process")
 #ifdef TESTING
       ("port", po::value<int>(), "Listening port")
       ("vault_path", po::value<std::string>(), "Path to the vault executable including name")
@@ -179,6 +259,97 @@ void HandleProgramOptions(int argc, char** argv) {
 
   maidsafe::vault_manager::test::SetEnvironment(port, root_dir, path_to_vault);
 #endif
+
+  maidsafe::vault_manager::VaultManagerOptions options;
+  if (variables_map.count("spare_vaults") != 0) {
+    if (variables_map.at("spare_vaults").as<int>() < 0) {
+      LOG(kError) << "spare_vaults can't be negative";
+      BOOST_THROW_EXCEPTION(maidsafe::MakeError(maidsafe::CommonErrors::invalid_parameter));
+    }
+    options.spare_pool_size = static_cast<size_t>(variables_map.at("spare_vaults").as<int>());
+  }
+  if (variables_map.count("cgroup_root") != 0)
+    options.cgroup_root = variables_map.at("cgroup_root").as<std::string>();
+  maidsafe::vault_manager::ResourceLimits& limits(options.default_resource_limits);
+  if (variables_map.count("vault_cpu_weight") != 0)
+    limits.cpu_weight = variables_map.at("vault_cpu_weight").as<uint32_t>();
+  if (variables_map.count("vault_memory_high") != 0)
+    limits.memory_high = variables_map.at("vault_memory_high").as<uint64_t>();
+  if (variables_map.count("vault_memory_max") != 0)
+    limits.memory_max = variables_map.at("vault_memory_max").as<uint64_t>();
+  if (variables_map.count("vault_io_weight") != 0)
+    limits.io_weight = variables_map.at("vault_io_weight").as<uint32_t>();
+  if (variables_map.count("placement") != 0) {
+    std::string placement(variables_map.at("placement").as<std::string>());
+    if (placement == "nodes") {
+      options.placement_policy = maidsafe::vault_manager::PlacementPolicy::kSpreadNodes;
+    } else if (placement == "cores") {
+      options.placement_policy = maidsafe::vault_manager::PlacementPolicy::kSpreadCores;
+    } else if (placement != "none") {
+      LOG(kError) << "placement must be one of \"none\", \"nodes\" or \"cores\"";
+      BOOST_THROW_EXCEPTION(maidsafe::MakeError(maidsafe::CommonErrors::invalid_parameter));
+    }
+  }
+  if (variables_map.count("sample_interval") != 0) {
+    if (variables_map.at("sample_interval").as<int>() < 0) {
+      LOG(kError) << "sample_interval can't be negative";
+      BOOST_THROW_EXCEPTION(maidsafe::MakeError(maidsafe::CommonErrors::invalid_parameter));
+    }
+    options.resource_sample_interval =
+        std::chrono::seconds(variables_map.at("sample_interval").as<int>());
+  }
+  if (variables_map.count("heartbeat_interval_ms") != 0) {
+    if (variables_map.at("heartbeat_interval_ms").as<int>() < 0) {
+      LOG(kError) << "heartbeat_interval_ms can't be negative";
+      BOOST_THROW_EXCEPTION(maidsafe::MakeError(maidsafe::CommonErrors::invalid_parameter));
+    }
+    options.heartbeat_interval =
+        std::chrono::milliseconds(variables_map.at("heartbeat_interval_ms").as<int>());
+  }
+  if (variables_map.count("missed_heartbeats") != 0) {
+    if (variables_map.at("missed_heartbeats").as<int>() < 1) {
+      LOG(kError) << "missed_heartbeats must be at least 1";
+      BOOST_THROW_EXCEPTION(maidsafe::MakeError(maidsafe::CommonErrors::invalid_parameter));
+    }
+    options.missed_heartbeat_threshold = variables_map.at("missed_heartbeats").as<int>();
+  }
+  if (variables_map.count("handover_file") != 0)
+    options.handover_file = variables_map.at("handover_file").as<std::string>();
+  if (variables_map.count("adopt_orphans") != 0)
+    options.adopt_orphans = variables_map.at("adopt_orphans").as<bool>();
+  if (variables_map.count("vault_output_max_size") != 0)
+    options.vault_output_max_file_size = variables_map.at("vault_output_max_size").as<uint64_t>();
+  if (variables_map.count("vault_max_rss") != 0)
+    options.vault_max_rss = variables_map.at("vault_max_rss").as<uint64_t>();
+  if (variables_map.count("vault_max_rss_growth") != 0)
+    options.vault_max_rss_growth = variables_map.at("vault_max_rss_growth").as<uint64_t>();
+  if (variables_map.count("launch_profiles") != 0)
+    options.launch_profiles_file = variables_map.at("launch_profiles").as<std::string>();
+  if (variables_map.count("memory_pressure_threshold") != 0) {
+    options.memory_pressure_threshold = variables_map.at("memory_pressure_threshold").as<double>();
+    if (options.memory_pressure_threshold < 0.0 || options.memory_pressure_threshold > 100.0) {
+      LOG(kError) << "memory_pressure_threshold must be a percentage";
+      BOOST_THROW_EXCEPTION(maidsafe::MakeError(maidsafe::CommonErrors::invalid_parameter));
+    }
+  }
+  if (variables_map.count("restart_burst") != 0) {
+    if (variables_map.at("restart_burst").as<int>() < 1) {
+      LOG(kError) << "restart_burst must be at least 1";
+      BOOST_THROW_EXCEPTION(maidsafe::MakeError(maidsafe::CommonErrors::invalid_parameter));
+    }
+    options.restart_burst = static_cast<size_t>(variables_map.at("restart_burst").as<int>());
+  }
+  if (variables_map.count("restart_refill_ms") != 0) {
+    if (variables_map.at("restart_refill_ms").as<int>() < 1) {
+      LOG(kError) << "restart_refill_ms must be at least 1";
+      BOOST_THROW_EXCEPTION(maidsafe::MakeError(maidsafe::CommonErrors::invalid_parameter));
+    }
+    options.restart_refill_interval =
+        std::chrono::milliseconds(variables_map.at("restart_refill_ms").as<int>());
+  }
+  if (variables_map.count("in_process_hosting") != 0)
+    options.in_process_hosting = variables_map.at("in_process_hosting").as<bool>();
+  return options;
 }
 
 }  // unnamed namespace
@@ -188,9 +359,9 @@ int main(int argc, char** argv) {
 #ifdef MAIDSAFE_WIN32
 #ifdef TESTING
   try {
-    HandleProgramOptions(argc, argv);
+    auto options(HandleProgramOptions(argc, argv));
     if (SetConsoleCtrlHandler(reinterpret_cast<PHANDLER_ROUTINE>(CtrlHandler), TRUE)) {
-      maidsafe::vault_manager::VaultManager vault_manager;
+      maidsafe::vault_manager::VaultManager vault_manager{ options };
       g_shutdown_promise.get_future().get();
     } else {
       LOG(kError) << "Failed to set control handler.";
@@ -212,12 +383,43 @@ int main(int argc, char** argv) {
 #endif
 #else
   //  try {
-  HandleProgramOptions(argc, argv);
-  maidsafe::vault_manager::VaultManager vault_manager;
-  std::cout << "Successfully started vault_manager" << std::endl;
-  signal(SIGINT, ShutDownVaultManager);
-  signal(SIGTERM, ShutDownVaultManager);
-  g_shutdown_promise.get_future().get();
+  // Resolved now, since a package upgrade replaces the binary at the same path.
+#ifdef MAIDSAFE_LINUX
+  const fs::path kExecutable{ fs::read_symlink("/proc/self/exe") };
+#else
+  const fs::path kExecutable{ fs::system_complete(argv[0]) };
+#endif
+  auto options(HandleProgramOptions(argc, argv));
+  for (;;) {
+    fs::path handover_file;
+    {
+      maidsafe::vault_manager::VaultManager vault_manager{ options };
+      std::cout << "Successfully started vault_manager" << std::endl;
+      signal(SIGINT, ShutDownVaultManager);
+      signal(SIGTERM, ShutDownVaultManager);
+      signal(SIGUSR2, HandOverVaultManager);
+      g_shutdown_promise.get_future().get();
+      if (g_hand_over) {
+        try {
+          handover_file = vault_manager.HandOver();
+        }
+        catch (const std::exception& e) {
+          LOG(kError) << "Failed to hand over: " << e.what();
+        }
+      }
+    }
+    if (handover_file.empty())
+      break;
+    ReExecute(kExecutable, argc, argv, handover_file);
+    // The vaults are still running, so rather than leave them unsupervised, take them back from
+    // the handover file as the successor would have.  The promise is replaced before the flag is
+    // cleared, so a signal can't reach the old one.
+    LOG(kError) << "Resuming from " << handover_file << " in this process instead.";
+    options.handover_file = handover_file;
+    g_shutdown_promise = std::promise<void>();
+    g_hand_over = false;
+    g_shutdown_requested.clear();
+  }
   std::cout << "Successfully stopped vault_manager" << std::endl;
   //  }
   //  catch(const std::exception& e) {
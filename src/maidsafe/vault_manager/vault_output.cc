@@ -0,0 +1,337 @@
+/*  Copyright 2014 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include "maidsafe/vault_manager/vault_output.h"
+
+#ifndef MAIDSAFE_WIN32
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include <cerrno>
+#include <cstring>
+#include <string>
+#include <system_error>
+#include <thread>
+
+#include "boost/filesystem/operations.hpp"
+
+#include "maidsafe/common/crypto.h"
+#include "maidsafe/common/error.h"
+#include "maidsafe/common/log.h"
+#include "maidsafe/common/utils.h"
+
+#include "maidsafe/vault_manager/config.h"
+
+namespace fs = boost::filesystem;
+
+namespace maidsafe {
+
+namespace vault_manager {
+
+#ifndef MAIDSAFE_WIN32
+
+namespace {
+
+// The most moved by a single splice, i.e. the default capacity of a pipe.
+const size_t kSpliceSize(64 * 1024);
+const size_t kCopyBufferSize(16 * 1024);
+// The most drained per wakeup, i.e. the largest capacity a pipe can be given by default.
+const uint64_t kMaxDrainSize(1024 * 1024);
+const int kCompressionLevel(6);
+const int kMaxPendingCompressions(2);
+
+fs::path RotatedPath(const fs::path& file, int index) {
+  return file.string() + "." + std::to_string(index) + ".gz";
+}
+
+void SetCloseOnExec(int descriptor, bool close_on_exec) {
+  int flags(fcntl(descriptor, F_GETFD));
+  if (flags != -1) {
+    flags = close_on_exec ? (flags | FD_CLOEXEC) : (flags & ~FD_CLOEXEC);
+    flags = fcntl(descriptor, F_SETFD, flags);
+  }
+  if (flags == -1) {
+    LOG(kWarning) << "Failed to set close-on-exec flag of file descriptor " << descriptor << ": "
+                  << std::strerror(errno);
+  }
+}
+
+// Shifts the rotated files along, then compresses 'segment' to become <file>.1.gz.  The segment is
+// removed even if it can't be compressed, since nothing else would remove it.
+void CompressSegment(const fs::path& file, const fs::path& segment, int max_rotated_files) {
+  boost::system::error_code error_code;
+  fs::remove(RotatedPath(file, max_rotated_files), error_code);
+  for (int index(max_rotated_files - 1); index > 0; --index)
+    fs::rename(RotatedPath(file, index), RotatedPath(file, index + 1), error_code);
+  const fs::path kCompressed(RotatedPath(file, 1));
+  try {
+    crypto::CompressedText compressed{ crypto::Compress(
+        crypto::UncompressedText{ ReadFile(segment) }, kCompressionLevel) };
+    if (!WriteFile(kCompressed, compressed.data.string()))
+      LOG(kError) << "Failed to write " << kCompressed;
+  }
+  catch (const std::exception& e) {
+    LOG(kError) << "Failed to compress " << segment << ": " << boost::diagnostic_information(e);
+  }
+  fs::remove(segment, error_code);
+}
+
+}  // unnamed namespace
+
+void MakeOutputPipe(int& read_descriptor, int& write_descriptor) {
+  int descriptors[2];
+#ifdef MAIDSAFE_LINUX
+  if (pipe2(descriptors, O_CLOEXEC) != 0) {
+#else
+  if (pipe(descriptors) != 0) {
+#endif
+    LOG(kError) << "Failed to create pipe: " << std::strerror(errno);
+    BOOST_THROW_EXCEPTION(MakeError(CommonErrors::unknown));
+  }
+#ifndef MAIDSAFE_LINUX
+  SetCloseOnExec(descriptors[0], true);
+  SetCloseOnExec(descriptors[1], true);
+#endif
+  read_descriptor = descriptors[0];
+  write_descriptor = descriptors[1];
+}
+
+VaultOutput::VaultOutput(boost::asio::io_service& io_service, int read_descriptor)
+    : pipe_(io_service, read_descriptor),
+      directory_(),
+      max_file_size_(0),
+      max_rotated_files_(0),
+      file_descriptor_(-1),
+      file_size_(0),
+      bytes_written_(0),
+#ifdef MAIDSAFE_LINUX
+      use_splice_(true),
+#else
+      use_splice_(false),
+#endif
+      segment_count_(0),
+      compression_(),
+      pending_compressions_(std::make_shared<std::atomic<int>>(0)) {
+  boost::system::error_code error_code;
+  pipe_.non_blocking(true, error_code);
+  if (error_code)
+    LOG(kWarning) << "Failed to make vault output pipe non-blocking: " << error_code.message();
+}
+
+std::shared_ptr<VaultOutput> VaultOutput::MakeShared(boost::asio::io_service& io_service,
+                                                     int read_descriptor) {
+  struct stat status;
+  if (fstat(read_descriptor, &status) != 0 || !S_ISFIFO(status.st_mode)) {
+    LOG(kError) << "File descriptor " << read_descriptor << " isn't a pipe.";
+    BOOST_THROW_EXCEPTION(MakeError(CommonErrors::invalid_parameter));
+  }
+  SetCloseOnExec(read_descriptor, true);
+  return std::shared_ptr<VaultOutput>{ new VaultOutput{ io_service, read_descriptor } };
+}
+
+VaultOutput::~VaultOutput() {
+  CloseFile();
+}
+
+void VaultOutput::Attach(const fs::path& directory, uint64_t max_file_size,
+                         int max_rotated_files) {
+  if (!directory_.empty()) {
+    LOG(kError) << "Vault output is already attached to " << directory_;
+    BOOST_THROW_EXCEPTION(MakeError(CommonErrors::already_initialised));
+  }
+  directory_ = directory;
+  max_file_size_ = max_file_size;
+  max_rotated_files_ = max_rotated_files;
+  OpenFile();
+  WaitForOutput();
+}
+
+void VaultOutput::Close() {
+  if (!pipe_.is_open())
+    return;
+  if (!directory_.empty())
+    Drain();
+  boost::system::error_code ignored_ec;
+  pipe_.close(ignored_ec);
+  CloseFile();
+}
+
+int VaultOutput::Release() {
+  if (!pipe_.is_open())
+    return -1;
+  if (!directory_.empty())
+    Drain();
+  CloseFile();
+  int descriptor(pipe_.release());
+  SetCloseOnExec(descriptor, false);
+  return descriptor;
+}
+
+void VaultOutput::OpenFile() {
+  boost::system::error_code error_code;
+  fs::create_directories(directory_, error_code);
+  const fs::path kFile(directory_ / kVaultOutputFilename);
+  // Not O_APPEND, since splice doesn't support it.  The offset is moved to the end instead.
+  file_descriptor_ = open(kFile.c_str(), O_WRONLY | O_CREAT | O_CLOEXEC, 0644);
+  if (file_descriptor_ < 0) {
+    LOG(kError) << "Failed to open " << kFile << ": " << std::strerror(errno)
+                << "  Vault output will be discarded.";
+    return;
+  }
+  off_t end(lseek(file_descriptor_, 0, SEEK_END));
+  file_size_ = end < 0 ? 0 : static_cast<uint64_t>(end);
+}
+
+void VaultOutput::CloseFile() {
+  if (file_descriptor_ < 0)
+    return;
+  close(file_descriptor_);
+  file_descriptor_ = -1;
+}
+
+void VaultOutput::WaitForOutput() {
+  auto self(shared_from_this());
+  pipe_.async_read_some(boost::asio::null_buffers(),
+      [self](const boost::system::error_code& error_code, std::size_t) {
+        if (error_code) {
+          if (error_code != boost::asio::error::operation_aborted)
+            LOG(kWarning) << "Error waiting for vault output: " << error_code.message();
+          return;
+        }
+        if (self->Drain())
+          self->WaitForOutput();
+        else
+          self->Close();
+      });
+}
+
+bool VaultOutput::Drain() {
+  for (uint64_t drained(0); drained < kMaxDrainSize;) {
+    const bool kDiscarding(file_descriptor_ < 0);
+    ssize_t moved(kDiscarding ? Discard() : Move());
+    if (moved == 0)
+      return false;
+    if (moved < 0) {
+      if (errno == EINTR)
+        continue;
+      if (errno == EAGAIN || errno == EWOULDBLOCK)
+        return true;
+      if (kDiscarding) {
+        LOG(kError) << "Failed to read vault output: " << std::strerror(errno);
+        return false;
+      }
+      if (use_splice_ && errno == EINVAL) {
+        LOG(kInfo) << "splice isn't supported for " << directory_ << "; copying vault output.";
+        use_splice_ = false;
+        continue;
+      }
+      // Most likely the disk is full.  Discard the output from now on rather than leave the vault
+      // blocked on a full pipe.
+      LOG(kError) << "Failed to write vault output to " << directory_ << ": "
+                  << std::strerror(errno);
+      CloseFile();
+      continue;
+    }
+    drained += static_cast<uint64_t>(moved);
+    if (kDiscarding)
+      continue;
+    file_size_ += static_cast<uint64_t>(moved);
+    bytes_written_ += static_cast<uint64_t>(moved);
+    if (file_size_ >= max_file_size_)
+      Rotate();
+  }
+  return true;
+}
+
+ssize_t VaultOutput::Move() {
+#ifdef MAIDSAFE_LINUX
+  if (use_splice_) {
+    return splice(pipe_.native_handle(), nullptr, file_descriptor_, nullptr, kSpliceSize,
+                  SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+  }
+#endif
+  char buffer[kCopyBufferSize];
+  ssize_t size(read(pipe_.native_handle(), buffer, sizeof(buffer)));
+  for (ssize_t written(0); written < size;) {
+    ssize_t result(write(file_descriptor_, buffer + written, static_cast<size_t>(size - written)));
+    if (result < 0) {
+      if (errno == EINTR)
+        continue;
+      return -1;
+    }
+    written += result;
+  }
+  return size;
+}
+
+ssize_t VaultOutput::Discard() {
+  char buffer[kCopyBufferSize];
+  return read(pipe_.native_handle(), buffer, sizeof(buffer));
+}
+
+void VaultOutput::Rotate() {
+  CloseFile();
+  const fs::path kFile(directory_ / kVaultOutputFilename);
+  const fs::path kSegment(kFile.string() + ".segment" + std::to_string(++segment_count_));
+  boost::system::error_code error_code;
+  fs::rename(kFile, kSegment, error_code);
+  if (error_code)
+    LOG(kWarning) << "Failed to rotate " << kFile << ": " << error_code.message();
+  OpenFile();
+  if (error_code)
+    return;
+  if (max_rotated_files_ < 1 || *pending_compressions_ >= kMaxPendingCompressions) {
+    if (max_rotated_files_ > 0)
+      LOG(kWarning) << "Compression of vault output is falling behind; discarding " << kSegment;
+    fs::remove(kSegment, error_code);
+    return;
+  }
+
+  // Detached rather than run via std::async, since the future returned by std::async would block
+  // the io_service thread when destroyed.  Each compression waits for the previous one, so the
+  // rotated files are shifted in order.
+  std::shared_ptr<std::promise<void>> done{ std::make_shared<std::promise<void>>() };
+  std::shared_future<void> previous{ compression_ }, next{ done->get_future().share() };
+  std::shared_ptr<std::atomic<int>> pending{ pending_compressions_ };
+  const int kMaxRotatedFiles(max_rotated_files_);
+  ++*pending;
+  try {
+    std::thread{ [=] {
+      if (previous.valid())
+        previous.wait();
+      CompressSegment(kFile, kSegment, kMaxRotatedFiles);
+      --*pending;
+      done->set_value();
+    } }.detach();
+  }
+  catch (const std::system_error& e) {
+    LOG(kError) << "Failed to start compressing " << kSegment << ": " << e.what();
+    --*pending;
+    fs::remove(kSegment, error_code);
+    return;
+  }
+  compression_ = next;
+}
+
+#endif
+
+}  // namespace vault_manager
+
+}  // namespace maidsafe
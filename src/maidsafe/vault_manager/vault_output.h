@@ -0,0 +1,118 @@
+/*  Copyright 2014 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#ifndef MAIDSAFE_VAULT_MANAGER_VAULT_OUTPUT_H_
+#define MAIDSAFE_VAULT_MANAGER_VAULT_OUTPUT_H_
+
+#ifndef MAIDSAFE_WIN32
+#include <sys/types.h>
+#endif
+
+#include <atomic>
+#include <cstdint>
+#include <future>
+#include <memory>
+
+#include "boost/asio/io_service.hpp"
+#ifndef MAIDSAFE_WIN32
+#include "boost/asio/posix/stream_descriptor.hpp"
+#endif
+#include "boost/filesystem/path.hpp"
+
+namespace maidsafe {
+
+namespace vault_manager {
+
+#ifndef MAIDSAFE_WIN32
+// Creates a pipe for a vault's stdout and stderr.  Both ends are close-on-exec; the write end is
+// made the vault's stdout and stderr when it's launched, and should then be closed.  Throws on
+// failure.
+void MakeOutputPipe(int& read_descriptor, int& write_descriptor);
+
+// Collects a vault's stdout and stderr from the read end of a pipe into
+// 'directory'/kVaultOutputFilename.  Once that file reaches 'max_file_size' bytes it's rotated: the
+// rotated files are renamed from <file>.1.gz (the newest) onwards, the one beyond
+// 'max_rotated_files' is removed, and the full file is compressed in the background to become the
+// new <file>.1.gz.  Rotations are chained in the background, so the io_service thread never waits
+// for a compression.  If kMaxPendingCompressions are already waiting, the full file is discarded.
+//
+// Nothing is read from the pipe until Attach is called, so the early output of a spare vault waits
+// in the pipe until the spare is given an identity.  On Linux the pipe is drained using splice, so
+// the output is moved into the file without being copied through the VaultManager.  If the file
+// can't be written, output is discarded rather than left to fill the pipe and block the vault.
+//
+// Must only be used on the io_service thread.  Once attached, the VaultOutput keeps itself alive
+// until every holder of the pipe's write end has closed it, or until Close or Release is called.
+class VaultOutput : public std::enable_shared_from_this<VaultOutput> {
+ public:
+  VaultOutput(const VaultOutput&) = delete;
+  VaultOutput(VaultOutput&&) = delete;
+  VaultOutput& operator=(VaultOutput) = delete;
+
+  // Takes ownership of 'read_descriptor', which may be a pipe kept open across an exec (see
+  // Release).  Throws (leaving the descriptor open) if it isn't a pipe.
+  static std::shared_ptr<VaultOutput> MakeShared(boost::asio::io_service& io_service,
+                                                 int read_descriptor);
+  ~VaultOutput();
+
+  void Attach(const boost::filesystem::path& directory, uint64_t max_file_size,
+              int max_rotated_files);
+  // Drains whatever is already in the pipe, then closes it.
+  void Close();
+  // Stops draining and gives up the pipe's read end, clearing its close-on-exec flag so that it
+  // survives the VaultManager re-executing itself.  Returns -1 if the pipe is already closed.
+  int Release();
+  // The number of bytes written to the output files so far.  Safe to call from any thread.
+  uint64_t BytesWritten() const { return bytes_written_; }
+
+ private:
+  VaultOutput(boost::asio::io_service& io_service, int read_descriptor);
+
+  void OpenFile();
+  void CloseFile();
+  void WaitForOutput();
+  // Moves at most kMaxDrainSize bytes, so that a vault writing continuously can't monopolise the
+  // io_service thread.  Returns false once the pipe's write end has been closed.
+  bool Drain();
+  // Each returns the number of bytes taken from the pipe, or 0 once the write end has been closed,
+  // or -1 with errno set, as read() does.
+  ssize_t Move();
+  ssize_t Discard();
+  void Rotate();
+
+  boost::asio::posix::stream_descriptor pipe_;
+  boost::filesystem::path directory_;
+  uint64_t max_file_size_;
+  int max_rotated_files_;
+  int file_descriptor_;
+  uint64_t file_size_;
+  std::atomic<uint64_t> bytes_written_;
+  // Cleared if the file system doesn't support splice, in which case output is copied instead.
+  bool use_splice_;
+  uint64_t segment_count_;
+  // The latest rotation's compression, which runs once the previous one has finished.
+  std::shared_future<void> compression_;
+  std::shared_ptr<std::atomic<int>> pending_compressions_;
+};
+#endif
+
+}  // namespace vault_manager
+
+}  // namespace maidsafe
+
+#endif  // MAIDSAFE_VAULT_MANAGER_VAULT_OUTPUT_H_
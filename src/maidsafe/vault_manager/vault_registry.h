@@ -0,0 +1,326 @@
+/*  Copyright 2014 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#ifndef MAIDSAFE_VAULT_MANAGER_VAULT_REGISTRY_H_
+#define MAIDSAFE_VAULT_MANAGER_VAULT_REGISTRY_H_
+
+#include <cstddef>
+#include <map>
+#include <memory>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "boost/filesystem/path.hpp"
+
+#include "maidsafe/common/error.h"
+#include "maidsafe/common/log.h"
+#include "maidsafe/common/make_unique.h"
+#include "maidsafe/common/on_scope_exit.h"
+#include "maidsafe/common/process.h"
+#include "maidsafe/common/types.h"
+#include "maidsafe/common/utils.h"
+
+#include "maidsafe/vault_manager/config.h"
+#include "maidsafe/vault_manager/vault_info.h"
+
+namespace maidsafe {
+
+namespace vault_manager {
+
+// Holds one 'Value' per vault in a stable slot (i.e. the address of a stored value doesn't change
+// until it is erased) and indexes each slot by the vault's label, Pmid name, vault_dir, process ID
+// and TCP connection.  The label is the primary key; the process ID and connection are only known
+// once the vault has been started and are therefore registered separately.
+//
+// Lookups by any key are logarithmic (or constant for process ID) in the number of vaults.  Lookups
+// return nullptr if the key isn't found.  Insert and Erase provide the strong exception guarantee.
+template <typename Value>
+class VaultRegistry {
+ public:
+  VaultRegistry();
+  VaultRegistry(const VaultRegistry&) = delete;
+  VaultRegistry(VaultRegistry&&) = delete;
+  VaultRegistry& operator=(VaultRegistry) = delete;
+
+  // Throws 'CommonErrors::already_initialised' if any of the label, Pmid name, vault_dir or (non-
+  // null) TCP connection are already registered.
+  Value& Insert(Value value, const VaultInfo& vault_info);
+  Value& Insert(Value value, const NonEmptyString& label, const Identity& pmid_name,
+                const boost::filesystem::path& vault_dir, tcp::ConnectionPtr connection = nullptr);
+  // No-op if 'label' isn't registered.
+  void Erase(const NonEmptyString& label);
+  // Throws 'CommonErrors::no_such_element' if 'label' isn't registered, or
+  // 'CommonErrors::already_initialised' if the new key is already registered to a different vault.
+  void SetProcessId(const NonEmptyString& label, process::ProcessId process_id);
+  void SetConnection(const NonEmptyString& label, tcp::ConnectionPtr connection);
+
+  Value* Find(const NonEmptyString& label);
+  const Value* Find(const NonEmptyString& label) const;
+  Value* Find(process::ProcessId process_id);
+  const Value* Find(process::ProcessId process_id) const;
+  Value* Find(const tcp::ConnectionPtr& connection);
+  const Value* Find(const tcp::ConnectionPtr& connection) const;
+
+  // Invokes 'functor(const Value&)' or 'functor(Value&)' for each registered value.  'functor'
+  // must not insert or erase values.
+  template <typename Functor>
+  void ForEach(Functor functor) const;
+  template <typename Functor>
+  void ForEach(Functor functor);
+
+  std::size_t Size() const { return labels_.size(); }
+  bool Empty() const { return labels_.empty(); }
+
+ private:
+  typedef std::size_t Slot;
+
+  struct Entry {
+    Entry(Value value_in, NonEmptyString label_in, Identity pmid_name_in,
+          boost::filesystem::path vault_dir_in, tcp::ConnectionPtr connection_in)
+        : value(std::move(value_in)),
+          label(std::move(label_in)),
+          pmid_name(std::move(pmid_name_in)),
+          vault_dir(std::move(vault_dir_in)),
+          process_id(0),
+          connection(std::move(connection_in)) {}
+    Value value;
+    NonEmptyString label;
+    Identity pmid_name;
+    boost::filesystem::path vault_dir;
+    process::ProcessId process_id;
+    tcp::ConnectionPtr connection;
+  };
+
+  void CheckDoesntConflict(const Entry& entry) const;
+  Entry& GetEntry(const NonEmptyString& label);
+
+  template <typename Index, typename Key>
+  static const Value* DoFind(const std::vector<std::unique_ptr<Entry>>& slots, const Index& index,
+                             const Key& key);
+
+  std::vector<std::unique_ptr<Entry>> slots_;
+  std::vector<Slot> free_slots_;
+  std::map<NonEmptyString, Slot> labels_;
+  std::map<Identity, Slot> pmid_names_;
+  std::map<boost::filesystem::path, Slot> vault_dirs_;
+  std::unordered_map<process::ProcessId, Slot> process_ids_;
+  std::map<tcp::ConnectionPtr, Slot, std::owner_less<tcp::ConnectionPtr>> connections_;
+};
+
+
+
+template <typename Value>
+VaultRegistry<Value>::VaultRegistry()
+    : slots_(),
+      free_slots_(),
+      labels_(),
+      pmid_names_(),
+      vault_dirs_(),
+      process_ids_(),
+      connections_() {}
+
+template <typename Value>
+void VaultRegistry<Value>::CheckDoesntConflict(const Entry& entry) const {
+  if (pmid_names_.count(entry.pmid_name) != 0) {
+    LOG(kError) << "Vault process with Pmid " << DebugId(entry.pmid_name) << " already exists.";
+    BOOST_THROW_EXCEPTION(MakeError(CommonErrors::already_initialised));
+  }
+
+  if (vault_dirs_.count(entry.vault_dir) != 0) {
+    LOG(kError) << "Vault process with vault dir " << entry.vault_dir << " already exists.";
+    BOOST_THROW_EXCEPTION(MakeError(CommonErrors::already_initialised));
+  }
+
+  if (labels_.count(entry.label) != 0) {
+    LOG(kError) << "Vault process with label " << entry.label.string() << " already exists.";
+    BOOST_THROW_EXCEPTION(MakeError(CommonErrors::already_initialised));
+  }
+
+  if (entry.connection && connections_.count(entry.connection) != 0) {
+    LOG(kError) << "Vault process with this tcp_connection already exists.";
+    BOOST_THROW_EXCEPTION(MakeError(CommonErrors::already_initialised));
+  }
+}
+
+template <typename Value>
+Value& VaultRegistry<Value>::Insert(Value value, const VaultInfo& vault_info) {
+  return Insert(std::move(value), vault_info.label, vault_info.pmid_and_signer->first.name().value,
+                vault_info.vault_dir, vault_info.tcp_connection);
+}
+
+template <typename Value>
+Value& VaultRegistry<Value>::Insert(Value value, const NonEmptyString& label,
+                                   const Identity& pmid_name,
+                                   const boost::filesystem::path& vault_dir,
+                                   tcp::ConnectionPtr connection) {
+  std::unique_ptr<Entry> entry{ maidsafe::make_unique<Entry>(std::move(value), label, pmid_name,
+                                                             vault_dir, std::move(connection)) };
+  CheckDoesntConflict(*entry);
+
+  // Reserve space for the new slot up front so that storing the entry below can't throw.
+  if (free_slots_.empty())
+    slots_.reserve(slots_.size() + 1);
+  Slot slot{ free_slots_.empty() ? slots_.size() : free_slots_.back() };
+
+  // None of the keys are already present, so on failure we only need to erase what we added.
+  on_scope_exit strong_guarantee{ [&] {
+    labels_.erase(entry->label);
+    pmid_names_.erase(entry->pmid_name);
+    vault_dirs_.erase(entry->vault_dir);
+  } };
+  labels_.emplace(entry->label, slot);
+  pmid_names_.emplace(entry->pmid_name, slot);
+  vault_dirs_.emplace(entry->vault_dir, slot);
+  if (entry->connection)
+    connections_.emplace(entry->connection, slot);
+  strong_guarantee.Release();
+
+  if (free_slots_.empty()) {
+    slots_.push_back(std::move(entry));
+  } else {
+    free_slots_.pop_back();
+    slots_[slot] = std::move(entry);
+  }
+  return slots_[slot]->value;
+}
+
+template <typename Value>
+void VaultRegistry<Value>::Erase(const NonEmptyString& label) {
+  auto itr(labels_.find(label));
+  if (itr == std::end(labels_))
+    return;
+  Slot slot{ itr->second };
+  free_slots_.reserve(free_slots_.size() + 1);
+  std::unique_ptr<Entry> entry{ std::move(slots_[slot]) };
+  labels_.erase(itr);
+  pmid_names_.erase(entry->pmid_name);
+  vault_dirs_.erase(entry->vault_dir);
+  if (entry->process_id != 0)
+    process_ids_.erase(entry->process_id);
+  if (entry->connection)
+    connections_.erase(entry->connection);
+  free_slots_.push_back(slot);
+}
+
+template <typename Value>
+typename VaultRegistry<Value>::Entry& VaultRegistry<Value>::GetEntry(const NonEmptyString& label) {
+  auto itr(labels_.find(label));
+  if (itr == std::end(labels_)) {
+    LOG(kError) << "Vault process with label " << label.string() << " doesn't exist.";
+    BOOST_THROW_EXCEPTION(MakeError(CommonErrors::no_such_element));
+  }
+  return *slots_[itr->second];
+}
+
+template <typename Value>
+void VaultRegistry<Value>::SetProcessId(const NonEmptyString& label,
+                                        process::ProcessId process_id) {
+  Entry& entry(GetEntry(label));
+  if (entry.process_id == process_id)
+    return;
+  Slot slot{ labels_.find(label)->second };
+  if (process_id != 0 && !process_ids_.emplace(process_id, slot).second) {
+    LOG(kError) << "Vault process with process ID " << process_id << " already exists.";
+    BOOST_THROW_EXCEPTION(MakeError(CommonErrors::already_initialised));
+  }
+  if (entry.process_id != 0)
+    process_ids_.erase(entry.process_id);
+  entry.process_id = process_id;
+}
+
+template <typename Value>
+void VaultRegistry<Value>::SetConnection(const NonEmptyString& label,
+                                         tcp::ConnectionPtr connection) {
+  Entry& entry(GetEntry(label));
+  Slot slot{ labels_.find(label)->second };
+  if (connection) {
+    auto result(connections_.emplace(connection, slot));
+    if (!result.second && result.first->second != slot) {
+      LOG(kError) << "Vault process with this tcp_connection already exists.";
+      BOOST_THROW_EXCEPTION(MakeError(CommonErrors::already_initialised));
+    }
+  }
+  if (entry.connection && (!connection || entry.connection.owner_before(connection) ||
+                           connection.owner_before(entry.connection))) {
+    connections_.erase(entry.connection);
+  }
+  entry.connection = std::move(connection);
+}
+
+template <typename Value>
+template <typename Index, typename Key>
+const Value* VaultRegistry<Value>::DoFind(const std::vector<std::unique_ptr<Entry>>& slots,
+                                          const Index& index, const Key& key) {
+  auto itr(index.find(key));
+  return itr == std::end(index) ? nullptr : &slots[itr->second]->value;
+}
+
+template <typename Value>
+const Value* VaultRegistry<Value>::Find(const NonEmptyString& label) const {
+  return DoFind(slots_, labels_, label);
+}
+
+template <typename Value>
+Value* VaultRegistry<Value>::Find(const NonEmptyString& label) {
+  return const_cast<Value*>(static_cast<const VaultRegistry&>(*this).Find(label));
+}
+
+template <typename Value>
+const Value* VaultRegistry<Value>::Find(process::ProcessId process_id) const {
+  return DoFind(slots_, process_ids_, process_id);
+}
+
+template <typename Value>
+Value* VaultRegistry<Value>::Find(process::ProcessId process_id) {
+  return const_cast<Value*>(static_cast<const VaultRegistry&>(*this).Find(process_id));
+}
+
+template <typename Value>
+const Value* VaultRegistry<Value>::Find(const tcp::ConnectionPtr& connection) const {
+  return connection ? DoFind(slots_, connections_, connection) : nullptr;
+}
+
+template <typename Value>
+Value* VaultRegistry<Value>::Find(const tcp::ConnectionPtr& connection) {
+  return const_cast<Value*>(static_cast<const VaultRegistry&>(*this).Find(connection));
+}
+
+template <typename Value>
+template <typename Functor>
+void VaultRegistry<Value>::ForEach(Functor functor) const {
+  for (const auto& entry : slots_) {
+    if (entry)
+      functor(static_cast<const Value&>(entry->value));
+  }
+}
+
+template <typename Value>
+template <typename Functor>
+void VaultRegistry<Value>::ForEach(Functor functor) {
+  for (auto& entry : slots_) {
+    if (entry)
+      functor(entry->value);
+  }
+}
+
+}  // namespace vault_manager
+
+}  // namespace maidsafe
+
+#endif  // MAIDSAFE_VAULT_MANAGER_VAULT_REGISTRY_H_
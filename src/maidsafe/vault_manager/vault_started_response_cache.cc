@@ -0,0 +1,70 @@
+/*  Copyright 2014 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include "maidsafe/vault_manager/vault_started_response_cache.h"
+
+#include <utility>
+
+#include "maidsafe/passport/passport.h"
+
+#include "maidsafe/vault_manager/dispatcher.h"
+#include "maidsafe/vault_manager/vault_info.h"
+
+namespace maidsafe {
+
+namespace vault_manager {
+
+VaultStartedResponseCache::VaultStartedResponseCache(crypto::AES256Key symm_key,
+                                                     crypto::AES256InitialisationVector symm_iv)
+    : kSymmKey_(std::move(symm_key)), kSymmIv_(std::move(symm_iv)), entries_() {}
+
+const std::string& VaultStartedResponseCache::Get(const VaultInfo& vault_info) {
+  Entry& entry(entries_[vault_info.label]);
+  const Identity pmid_name(vault_info.pmid_and_signer->first.name().value);
+  if (!entry.pmid_name.IsInitialised() || entry.pmid_name != pmid_name) {
+    entry = Entry();
+    entry.pmid_name = pmid_name;
+    entry.encrypted_pmid =
+        passport::EncryptPmid(vault_info.pmid_and_signer->first, kSymmKey_, kSymmIv_)->string();
+  } else if (IsCurrent(entry, vault_info)) {
+    return entry.message;
+  }
+
+  entry.vault_dir = vault_info.vault_dir;
+  entry.max_disk_usage = vault_info.max_disk_usage;
+#ifdef USE_VLOGGING
+  entry.vlog_session_id = vault_info.vlog_session_id;
+#endif
+  entry.message = MakeVaultStartedResponse(vault_info, entry.encrypted_pmid, kSymmKey_, kSymmIv_);
+  return entry.message;
+}
+
+void VaultStartedResponseCache::Erase(const NonEmptyString& label) { entries_.erase(label); }
+
+bool VaultStartedResponseCache::IsCurrent(const Entry& entry, const VaultInfo& vault_info) {
+#ifdef USE_VLOGGING
+  if (entry.vlog_session_id != vault_info.vlog_session_id)
+    return false;
+#endif
+  return entry.vault_dir == vault_info.vault_dir &&
+         entry.max_disk_usage == vault_info.max_disk_usage;
+}
+
+}  // namespace vault_manager
+
+}  // namespace maidsafe
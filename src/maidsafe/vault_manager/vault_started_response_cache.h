@@ -0,0 +1,86 @@
+/*  Copyright 2014 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#ifndef MAIDSAFE_VAULT_MANAGER_VAULT_STARTED_RESPONSE_CACHE_H_
+#define MAIDSAFE_VAULT_MANAGER_VAULT_STARTED_RESPONSE_CACHE_H_
+
+#include <map>
+#include <string>
+
+#include "boost/filesystem/path.hpp"
+
+#include "maidsafe/common/crypto.h"
+#include "maidsafe/common/types.h"
+
+namespace maidsafe {
+
+namespace vault_manager {
+
+struct VaultInfo;
+
+// Keeps each vault's serialised VaultStartedResponse, so that restarting a vault (perhaps
+// repeatedly, during a crash storm) doesn't re-encrypt its PMID and rebuild the message every
+// time.  A vault's message is only rebuilt if its vault_dir or max_disk_usage has changed since it
+// was cached, and even then its encrypted PMID is reused.  Not threadsafe.
+class VaultStartedResponseCache {
+ public:
+  VaultStartedResponseCache(crypto::AES256Key symm_key,
+                            crypto::AES256InitialisationVector symm_iv);
+  VaultStartedResponseCache(const VaultStartedResponseCache&) = delete;
+  VaultStartedResponseCache(VaultStartedResponseCache&&) = delete;
+  VaultStartedResponseCache& operator=(VaultStartedResponseCache) = delete;
+
+  // Returns the vault's wrapped VaultStartedResponse, ready to be sent.  The reference remains
+  // valid until the next call.
+  const std::string& Get(const VaultInfo& vault_info);
+  // Forgets the vault's message.  Must be called whenever a vault is removed, since nothing else
+  // evicts its entry.
+  void Erase(const NonEmptyString& label);
+  size_t Size() const { return entries_.size(); }
+
+ private:
+  struct Entry {
+    Entry()
+        : pmid_name(), encrypted_pmid(), vault_dir(), max_disk_usage(0),
+#ifdef USE_VLOGGING
+          vlog_session_id(),
+#endif
+          message() {}
+    Identity pmid_name;
+    std::string encrypted_pmid;
+    boost::filesystem::path vault_dir;
+    DiskUsage max_disk_usage;
+#ifdef USE_VLOGGING
+    std::string vlog_session_id;
+#endif
+    std::string message;
+  };
+
+  // Whether 'entry' holds the message for the vault's current settings.
+  static bool IsCurrent(const Entry& entry, const VaultInfo& vault_info);
+
+  const crypto::AES256Key kSymmKey_;
+  const crypto::AES256InitialisationVector kSymmIv_;
+  std::map<NonEmptyString, Entry> entries_;
+};
+
+}  // namespace vault_manager
+
+}  // namespace maidsafe
+
+#endif  // MAIDSAFE_VAULT_MANAGER_VAULT_STARTED_RESPONSE_CACHE_H_